@@ -19,9 +19,16 @@ LOCAL_PATH := $(call my-dir)
 include art/build/Android.common_build.mk
 
 LIBARTBENCHMARK_COMMON_SRC_FILES := \
+  class-preload/class_preload_benchmark.cc \
+  gc-young-gen/gc_young_gen_benchmark.cc \
   jobject-benchmark/jobject_benchmark.cc \
+  jit-code-locality/jit_code_locality_benchmark.cc \
+  jit-threads/jit_threads_benchmark.cc \
+  jit-tiered/jit_tiered_benchmark.cc \
   jni-perf/perf_jni.cc \
-  scoped-primitive-array/scoped_primitive_array.cc
+  rosalloc-contention/rosalloc_contention_benchmark.cc \
+  scoped-primitive-array/scoped_primitive_array.cc \
+  xposed-hook/xposed_hook_benchmark.cc
 
 # $(1): target or host
 define build-libartbenchmark
@@ -0,0 +1,64 @@
+/*
+ * Copyright (C) 2016 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <string>
+#include <vector>
+
+#include "jni.h"
+
+#include "jit/jit.h"
+#include "jit/profile_saver.h"
+#include "runtime.h"
+#include "ScopedUtfChars.h"
+
+namespace art {
+
+namespace {
+
+// Registers the benchmark as the application, which starts the profile saver and, with
+// -Xjitpreloadclasses, the class preloader.
+extern "C" JNIEXPORT void JNICALL Java_ClassPreloadBenchmark_registerAppInfo(JNIEnv* env,
+                                                                             jclass,
+                                                                             jstring profile,
+                                                                             jstring code_path) {
+  ScopedUtfChars profile_chars(env, profile);
+  CHECK(profile_chars.c_str() != nullptr);
+  ScopedUtfChars code_path_chars(env, code_path);
+  CHECK(code_path_chars.c_str() != nullptr);
+  std::vector<std::string> code_paths;
+  code_paths.push_back(code_path_chars.c_str());
+  Runtime::Current()->RegisterAppInfo(code_paths,
+                                      profile_chars.c_str(),
+                                      /* foreign_dex_profile_path */ "",
+                                      /* app_dir */ "");
+}
+
+// Writes the classes and methods recorded so far to the profile.
+extern "C" JNIEXPORT void JNICALL Java_ClassPreloadBenchmark_forceSaveProfile(JNIEnv*, jclass) {
+  ProfileSaver::ForceProcessProfiles();
+}
+
+// Dumps the JIT state, including the statistics of the class preloader.
+extern "C" JNIEXPORT void JNICALL Java_ClassPreloadBenchmark_dumpJitInfo(JNIEnv*, jclass) {
+  jit::Jit* jit = Runtime::Current()->GetJit();
+  if (jit != nullptr) {
+    jit->DumpForSigQuit(LOG(INFO));
+  }
+}
+
+}  // namespace
+
+}  // namespace art
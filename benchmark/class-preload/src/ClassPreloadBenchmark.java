@@ -0,0 +1,209 @@
+/*
+ * Copyright (C) 2016 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Classes are loaded once per process, so this benchmark is a plain program, see info.txt.
+public class ClassPreloadBenchmark {
+  private static final int NUMBER_OF_CLASSES = 48;
+  // Iterations of the startup work done before the classes are used.
+  private static final int STARTUP_WORK_ITERATIONS = 2000000;
+  // The profile saver records the resolved classes two seconds after the registration.
+  private static final long RECORD_DELAY_MS = 3000;
+
+  private static volatile int sink;
+
+  public static void main(String[] args) throws Exception {
+    System.loadLibrary("artbenchmark");
+    if (args.length != 2 || !(args[0].equals("record") || args[0].equals("measure"))) {
+      System.out.println("Usage: ClassPreloadBenchmark record|measure <profile>");
+      return;
+    }
+    registerAppInfo(args[1], System.getProperty("java.class.path"));
+
+    if (args[0].equals("record")) {
+      for (int i = 0; i < NUMBER_OF_CLASSES; ++i) {
+        sink += useClass(i, i);
+      }
+      Thread.sleep(RECORD_DELAY_MS);
+      forceSaveProfile();
+      System.out.println("Recorded the classes in " + args[1]);
+      return;
+    }
+
+    // The main thread of an application has work to do before it needs its own classes, for
+    // example creating its first views. The preloader runs meanwhile.
+    int work = 0;
+    for (int i = 0; i < STARTUP_WORK_ITERATIONS; ++i) {
+      work = work * 31 + i;
+    }
+    sink += work;
+
+    long start = System.nanoTime();
+    int result = 0;
+    for (int i = 0; i < NUMBER_OF_CLASSES; ++i) {
+      result += useClass(i, i);
+    }
+    long timeNs = System.nanoTime() - start;
+    sink += result;
+
+    System.out.println("First use of " + NUMBER_OF_CLASSES + " classes: " + (timeNs / 1000) + "us");
+    dumpJitInfo();
+  }
+
+  static int useClass(int index, int x) {
+    switch (index) {
+      case 0: return new Startup0().run(x);
+      case 1: return new Startup1().run(x);
+      case 2: return new Startup2().run(x);
+      case 3: return new Startup3().run(x);
+      case 4: return new Startup4().run(x);
+      case 5: return new Startup5().run(x);
+      case 6: return new Startup6().run(x);
+      case 7: return new Startup7().run(x);
+      case 8: return new Startup8().run(x);
+      case 9: return new Startup9().run(x);
+      case 10: return new Startup10().run(x);
+      case 11: return new Startup11().run(x);
+      case 12: return new Startup12().run(x);
+      case 13: return new Startup13().run(x);
+      case 14: return new Startup14().run(x);
+      case 15: return new Startup15().run(x);
+      case 16: return new Startup16().run(x);
+      case 17: return new Startup17().run(x);
+      case 18: return new Startup18().run(x);
+      case 19: return new Startup19().run(x);
+      case 20: return new Startup20().run(x);
+      case 21: return new Startup21().run(x);
+      case 22: return new Startup22().run(x);
+      case 23: return new Startup23().run(x);
+      case 24: return new Startup24().run(x);
+      case 25: return new Startup25().run(x);
+      case 26: return new Startup26().run(x);
+      case 27: return new Startup27().run(x);
+      case 28: return new Startup28().run(x);
+      case 29: return new Startup29().run(x);
+      case 30: return new Startup30().run(x);
+      case 31: return new Startup31().run(x);
+      case 32: return new Startup32().run(x);
+      case 33: return new Startup33().run(x);
+      case 34: return new Startup34().run(x);
+      case 35: return new Startup35().run(x);
+      case 36: return new Startup36().run(x);
+      case 37: return new Startup37().run(x);
+      case 38: return new Startup38().run(x);
+      case 39: return new Startup39().run(x);
+      case 40: return new Startup40().run(x);
+      case 41: return new Startup41().run(x);
+      case 42: return new Startup42().run(x);
+      case 43: return new Startup43().run(x);
+      case 44: return new Startup44().run(x);
+      case 45: return new Startup45().run(x);
+      case 46: return new Startup46().run(x);
+      case 47: return new Startup47().run(x);
+      default: return 0;
+    }
+  }
+
+  // Small classes, as used at the startup of an application. One class in four has a class
+  // initializer.
+  static class Startup0 { static final int K = 3; int run(int x) { return (x ^ K) + 0; } }
+  static class Startup1 { static final int K = 10; int run(int x) { return (x ^ K) + 1; } }
+  static class Startup2 { static final int K = 17; int run(int x) { return (x ^ K) + 2; } }
+  static class Startup3 {
+    static final int[] T = { 3, 4 };
+    int run(int x) { return T[x & 1] + x; }
+  }
+  static class Startup4 { static final int K = 31; int run(int x) { return (x ^ K) + 4; } }
+  static class Startup5 { static final int K = 38; int run(int x) { return (x ^ K) + 5; } }
+  static class Startup6 { static final int K = 45; int run(int x) { return (x ^ K) + 6; } }
+  static class Startup7 {
+    static final int[] T = { 7, 8 };
+    int run(int x) { return T[x & 1] + x; }
+  }
+  static class Startup8 { static final int K = 59; int run(int x) { return (x ^ K) + 8; } }
+  static class Startup9 { static final int K = 66; int run(int x) { return (x ^ K) + 9; } }
+  static class Startup10 { static final int K = 73; int run(int x) { return (x ^ K) + 10; } }
+  static class Startup11 {
+    static final int[] T = { 11, 12 };
+    int run(int x) { return T[x & 1] + x; }
+  }
+  static class Startup12 { static final int K = 87; int run(int x) { return (x ^ K) + 12; } }
+  static class Startup13 { static final int K = 94; int run(int x) { return (x ^ K) + 13; } }
+  static class Startup14 { static final int K = 101; int run(int x) { return (x ^ K) + 14; } }
+  static class Startup15 {
+    static final int[] T = { 15, 16 };
+    int run(int x) { return T[x & 1] + x; }
+  }
+  static class Startup16 { static final int K = 115; int run(int x) { return (x ^ K) + 16; } }
+  static class Startup17 { static final int K = 122; int run(int x) { return (x ^ K) + 17; } }
+  static class Startup18 { static final int K = 129; int run(int x) { return (x ^ K) + 18; } }
+  static class Startup19 {
+    static final int[] T = { 19, 20 };
+    int run(int x) { return T[x & 1] + x; }
+  }
+  static class Startup20 { static final int K = 143; int run(int x) { return (x ^ K) + 20; } }
+  static class Startup21 { static final int K = 150; int run(int x) { return (x ^ K) + 21; } }
+  static class Startup22 { static final int K = 157; int run(int x) { return (x ^ K) + 22; } }
+  static class Startup23 {
+    static final int[] T = { 23, 24 };
+    int run(int x) { return T[x & 1] + x; }
+  }
+  static class Startup24 { static final int K = 171; int run(int x) { return (x ^ K) + 24; } }
+  static class Startup25 { static final int K = 178; int run(int x) { return (x ^ K) + 25; } }
+  static class Startup26 { static final int K = 185; int run(int x) { return (x ^ K) + 26; } }
+  static class Startup27 {
+    static final int[] T = { 27, 28 };
+    int run(int x) { return T[x & 1] + x; }
+  }
+  static class Startup28 { static final int K = 199; int run(int x) { return (x ^ K) + 28; } }
+  static class Startup29 { static final int K = 206; int run(int x) { return (x ^ K) + 29; } }
+  static class Startup30 { static final int K = 213; int run(int x) { return (x ^ K) + 30; } }
+  static class Startup31 {
+    static final int[] T = { 31, 32 };
+    int run(int x) { return T[x & 1] + x; }
+  }
+  static class Startup32 { static final int K = 227; int run(int x) { return (x ^ K) + 32; } }
+  static class Startup33 { static final int K = 234; int run(int x) { return (x ^ K) + 33; } }
+  static class Startup34 { static final int K = 241; int run(int x) { return (x ^ K) + 34; } }
+  static class Startup35 {
+    static final int[] T = { 35, 36 };
+    int run(int x) { return T[x & 1] + x; }
+  }
+  static class Startup36 { static final int K = 255; int run(int x) { return (x ^ K) + 36; } }
+  static class Startup37 { static final int K = 262; int run(int x) { return (x ^ K) + 37; } }
+  static class Startup38 { static final int K = 269; int run(int x) { return (x ^ K) + 38; } }
+  static class Startup39 {
+    static final int[] T = { 39, 40 };
+    int run(int x) { return T[x & 1] + x; }
+  }
+  static class Startup40 { static final int K = 283; int run(int x) { return (x ^ K) + 40; } }
+  static class Startup41 { static final int K = 290; int run(int x) { return (x ^ K) + 41; } }
+  static class Startup42 { static final int K = 297; int run(int x) { return (x ^ K) + 42; } }
+  static class Startup43 {
+    static final int[] T = { 43, 44 };
+    int run(int x) { return T[x & 1] + x; }
+  }
+  static class Startup44 { static final int K = 311; int run(int x) { return (x ^ K) + 44; } }
+  static class Startup45 { static final int K = 318; int run(int x) { return (x ^ K) + 45; } }
+  static class Startup46 { static final int K = 325; int run(int x) { return (x ^ K) + 46; } }
+  static class Startup47 {
+    static final int[] T = { 47, 48 };
+    int run(int x) { return T[x & 1] + x; }
+  }
+
+  private static native void registerAppInfo(String profile, String codePath);
+  private static native void forceSaveProfile();
+  private static native void dumpJitInfo();
+}
@@ -0,0 +1,47 @@
+/*
+ * Copyright (C) 2016 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <sstream>
+
+#include "jni.h"
+
+#include "gc/collector/concurrent_copying.h"
+#include "gc/heap.h"
+#include "runtime.h"
+
+namespace art {
+
+namespace {
+
+// Returns the statistics of the concurrent copying collector, which include its young and full
+// cycles when the young generation is enabled.
+extern "C" JNIEXPORT jstring JNICALL Java_GcYoungGenBenchmark_getGcInfo(JNIEnv* env, jclass) {
+  std::ostringstream os;
+  gc::Heap* heap = Runtime::Current()->GetHeap();
+  gc::collector::ConcurrentCopying* collector = heap->ConcurrentCopyingCollector();
+  if (collector == nullptr || heap->CurrentCollectorType() != gc::kCollectorTypeCC) {
+    os << "The concurrent copying collector is not in use";
+  } else {
+    os << "Young generation: "
+       << (heap->UseGenerationalConcurrentCopying() ? "enabled" : "disabled") << "\n";
+    collector->DumpPerformanceInfo(os);
+  }
+  return env->NewStringUTF(os.str().c_str());
+}
+
+}  // namespace
+
+}  // namespace art
@@ -0,0 +1,98 @@
+/*
+ * Copyright (C) 2016 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+import java.util.Arrays;
+
+// The collector mode is set once per process, so this benchmark is a plain program, see info.txt.
+public class GcYoungGenBenchmark {
+  // Must be a power of two.
+  private static final int OLD_OBJECTS = 1 << 18;
+  private static final int WARMUP_REQUESTS = 50000;
+  private static final int MEASURED_REQUESTS = 500000;
+  // Short-lived objects allocated per request.
+  private static final int REQUEST_OBJECTS = 64;
+  // One request in REPLACE_INTERVAL stores a new object into an old one.
+  private static final int REPLACE_INTERVAL = 16;
+
+  static class Node {
+    Node next;
+    Object payload;
+    int value;
+  }
+
+  private static Node[] oldObjects;
+  private static volatile int sink;
+
+  public static void main(String[] args) {
+    System.loadLibrary("artbenchmark");
+
+    oldObjects = new Node[OLD_OBJECTS];
+    for (int i = 0; i < OLD_OBJECTS; ++i) {
+      Node node = new Node();
+      node.value = i;
+      node.payload = new int[8];
+      oldObjects[i] = node;
+    }
+    // Start the measurements with all the old objects surviving a full collection.
+    Runtime.getRuntime().gc();
+
+    for (int request = 0; request < WARMUP_REQUESTS; ++request) {
+      sink += runRequest(request);
+    }
+
+    long[] latencies = new long[MEASURED_REQUESTS];
+    long start = System.nanoTime();
+    int result = 0;
+    for (int request = 0; request < MEASURED_REQUESTS; ++request) {
+      long requestStart = System.nanoTime();
+      result += runRequest(request);
+      latencies[request] = System.nanoTime() - requestStart;
+    }
+    long timeNs = System.nanoTime() - start;
+    sink += result;
+
+    Arrays.sort(latencies);
+    System.out.println("Requests: " + (MEASURED_REQUESTS * 1000000000L / timeNs) + " per second");
+    System.out.println("Request latency: median " + latencies[MEASURED_REQUESTS / 2] + "ns"
+        + ", 99th percentile " + latencies[MEASURED_REQUESTS * 99 / 100] + "ns"
+        + ", 99.9th percentile " + latencies[MEASURED_REQUESTS * 999 / 1000] + "ns"
+        + ", max " + latencies[MEASURED_REQUESTS - 1] + "ns");
+    System.out.println(getGcInfo());
+  }
+
+  static int runRequest(int request) {
+    Node head = null;
+    for (int i = 0; i < REQUEST_OBJECTS; ++i) {
+      Node node = new Node();
+      node.next = head;
+      node.value = request + i;
+      node.payload = new byte[32];
+      head = node;
+    }
+    int sum = 0;
+    for (Node node = head; node != null; node = node.next) {
+      sum += node.value;
+    }
+    if (request % REPLACE_INTERVAL == 0) {
+      // Keep the newest object of the request live through an old object only.
+      head.next = null;
+      oldObjects[(request * 31) & (OLD_OBJECTS - 1)].payload = head;
+    }
+    return sum;
+  }
+
+  private static native String getGcInfo();
+}
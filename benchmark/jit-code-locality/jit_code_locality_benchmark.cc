@@ -0,0 +1,97 @@
+/*
+ * Copyright (C) 2016 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <linux/perf_event.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "jni.h"
+
+#include "jit/jit.h"
+#include "runtime.h"
+#include "thread.h"
+
+namespace art {
+
+namespace {
+
+// The counter of the calling thread, -1 if perf counters are not available.
+static int itlb_miss_counter_fd = -1;
+
+// Starts counting the i-TLB misses of the calling thread. Returns false if the kernel or the
+// hardware do not support it.
+extern "C" JNIEXPORT jboolean JNICALL Java_JitCodeLocalityBenchmark_startItlbMissCounter(
+    JNIEnv*, jclass) {
+#ifdef __NR_perf_event_open
+  perf_event_attr attr;
+  memset(&attr, 0, sizeof(attr));
+  attr.type = PERF_TYPE_HW_CACHE;
+  attr.size = sizeof(attr);
+  attr.config = PERF_COUNT_HW_CACHE_ITLB |
+      (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+      (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+  attr.disabled = 1;
+  attr.exclude_kernel = 1;
+  attr.exclude_hv = 1;
+  itlb_miss_counter_fd = syscall(__NR_perf_event_open, &attr, /* pid */ 0, /* cpu */ -1,
+                                 /* group_fd */ -1, /* flags */ 0);
+  if (itlb_miss_counter_fd < 0) {
+    return JNI_FALSE;
+  }
+  ioctl(itlb_miss_counter_fd, PERF_EVENT_IOC_RESET, 0);
+  ioctl(itlb_miss_counter_fd, PERF_EVENT_IOC_ENABLE, 0);
+  return JNI_TRUE;
+#else
+  return JNI_FALSE;
+#endif
+}
+
+// Stops the counter started by startItlbMissCounter, and returns the number of misses counted.
+extern "C" JNIEXPORT jlong JNICALL Java_JitCodeLocalityBenchmark_stopItlbMissCounter(
+    JNIEnv*, jclass) {
+  if (itlb_miss_counter_fd < 0) {
+    return -1;
+  }
+  ioctl(itlb_miss_counter_fd, PERF_EVENT_IOC_DISABLE, 0);
+  uint64_t misses = 0;
+  ssize_t bytes_read = read(itlb_miss_counter_fd, &misses, sizeof(misses));
+  close(itlb_miss_counter_fd);
+  itlb_miss_counter_fd = -1;
+  return (bytes_read == sizeof(misses)) ? static_cast<jlong>(misses) : -1;
+}
+
+// Blocks until the JIT has no pending compilation request.
+extern "C" JNIEXPORT void JNICALL Java_JitCodeLocalityBenchmark_waitForJitCompilation(
+    JNIEnv*, jclass) {
+  jit::Jit* jit = Runtime::Current()->GetJit();
+  if (jit != nullptr) {
+    jit->WaitForCompilationToFinish(Thread::Current());
+  }
+}
+
+// Dumps the JIT state, including the use of the hot region of the code cache.
+extern "C" JNIEXPORT void JNICALL Java_JitCodeLocalityBenchmark_dumpJitInfo(JNIEnv*, jclass) {
+  jit::Jit* jit = Runtime::Current()->GetJit();
+  if (jit != nullptr) {
+    jit->DumpForSigQuit(LOG(INFO));
+  }
+}
+
+}  // namespace
+
+}  // namespace art
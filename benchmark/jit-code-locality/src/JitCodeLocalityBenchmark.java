@@ -0,0 +1,142 @@
+/*
+ * Copyright (C) 2016 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// The layout of the code cache is set once per process, so this benchmark is a plain program,
+// see info.txt.
+public class JitCodeLocalityBenchmark {
+  private static final int WARMUP_ROUNDS = 30000;
+  private static final int MEASURED_ROUNDS = 200000;
+  // Iterations of the loops of the hot methods per call.
+  private static final int LOOP_ITERATIONS = 64;
+
+  private static volatile int sink;
+
+  public static void main(String[] args) throws Exception {
+    System.loadLibrary("artbenchmark");
+
+    // Compile the cold methods and the hot loops in an interleaved order. The hot loops are
+    // called less often, but spend their time in loops.
+    for (int round = 0; round < WARMUP_ROUNDS; ++round) {
+      sink += runColdMethod(round);
+      if (round % 8 == 0) {
+        sink += runHotLoops(round);
+      }
+    }
+    waitForJitCompilation();
+
+    boolean counting = startItlbMissCounter();
+    long start = System.nanoTime();
+    int result = 0;
+    for (int round = 0; round < MEASURED_ROUNDS; ++round) {
+      result += runHotLoops(round);
+    }
+    long timeNs = System.nanoTime() - start;
+    long misses = counting ? stopItlbMissCounter() : -1;
+    sink += result;
+
+    System.out.println("Hot loops: " + (timeNs / MEASURED_ROUNDS) + "ns per round");
+    if (misses >= 0) {
+      System.out.println("i-TLB misses: " + misses + " ("
+          + (misses * 1000000L / MEASURED_ROUNDS) + " per million rounds)");
+    } else {
+      System.out.println("i-TLB misses: perf counters not available");
+    }
+    dumpJitInfo();
+  }
+
+  static int runHotLoops(int seed) {
+    return sumLoop(seed) + xorLoop(seed) + shiftLoop(seed) + countLoop(seed);
+  }
+
+  static int sumLoop(int seed) {
+    int sum = 0;
+    for (int i = 0; i < LOOP_ITERATIONS; ++i) {
+      sum += i * seed;
+    }
+    return sum;
+  }
+
+  static int xorLoop(int seed) {
+    int value = seed;
+    for (int i = 0; i < LOOP_ITERATIONS; ++i) {
+      value ^= value << 3;
+      value ^= value >>> 5;
+    }
+    return value;
+  }
+
+  static int shiftLoop(int seed) {
+    int value = 0;
+    for (int i = 0; i < LOOP_ITERATIONS; ++i) {
+      value = (value << 1) | ((seed >>> (i & 31)) & 1);
+    }
+    return value;
+  }
+
+  static int countLoop(int seed) {
+    int count = 0;
+    for (int i = 0; i < LOOP_ITERATIONS; ++i) {
+      if (((seed + i) & 3) == 0) {
+        ++count;
+      }
+    }
+    return count;
+  }
+
+  // Short methods without loops, each compiled once the warm-up has called it enough.
+  static int runColdMethod(int round) {
+    switch (round % 16) {
+      case 0: return cold0(round);
+      case 1: return cold1(round);
+      case 2: return cold2(round);
+      case 3: return cold3(round);
+      case 4: return cold4(round);
+      case 5: return cold5(round);
+      case 6: return cold6(round);
+      case 7: return cold7(round);
+      case 8: return cold8(round);
+      case 9: return cold9(round);
+      case 10: return cold10(round);
+      case 11: return cold11(round);
+      case 12: return cold12(round);
+      case 13: return cold13(round);
+      case 14: return cold14(round);
+      default: return cold15(round);
+    }
+  }
+
+  static int cold0(int x) { return x * 3 + 1; }
+  static int cold1(int x) { return (x >> 1) ^ x; }
+  static int cold2(int x) { return Integer.bitCount(x) + x; }
+  static int cold3(int x) { return x % 7 == 0 ? x / 7 : x * 7; }
+  static int cold4(int x) { return Math.max(x, 100) - Math.min(x, 50); }
+  static int cold5(int x) { return Integer.reverse(x) >>> 3; }
+  static int cold6(int x) { return (x & 0xff) << 8 | (x >>> 8 & 0xff); }
+  static int cold7(int x) { return x < 0 ? -x : x + 11; }
+  static int cold8(int x) { return Integer.numberOfLeadingZeros(x) * x; }
+  static int cold9(int x) { return (int) ((long) x * 2654435761L >>> 16); }
+  static int cold10(int x) { return Integer.rotateLeft(x, 13) + 5; }
+  static int cold11(int x) { return (x | 0x5555) & ~(x >> 2); }
+  static int cold12(int x) { return String.valueOf(x & 0xfff).length(); }
+  static int cold13(int x) { return Character.isDigit((char) ('0' + x % 20)) ? 1 : 2; }
+  static int cold14(int x) { return Integer.highestOneBit(x) | Integer.lowestOneBit(x); }
+  static int cold15(int x) { return (x * x) ^ (x >>> 7); }
+
+  private static native boolean startItlbMissCounter();
+  private static native long stopItlbMissCounter();
+  private static native void waitForJitCompilation();
+  private static native void dumpJitInfo();
+}
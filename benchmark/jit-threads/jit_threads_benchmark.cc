@@ -0,0 +1,54 @@
+/*
+ * Copyright (C) 2016 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "jni.h"
+
+#include "jit/jit.h"
+#include "runtime.h"
+#include "thread.h"
+
+namespace art {
+
+namespace {
+
+// Returns the number of JIT workers the runtime was started with, 0 if the JIT is off.
+extern "C" JNIEXPORT jint JNICALL Java_JitThreadsBenchmark_jitThreadCount(JNIEnv*, jclass) {
+  Runtime* runtime = Runtime::Current();
+  if (runtime->GetJit() == nullptr || !runtime->UseJitCompilation()) {
+    return 0;
+  }
+  return static_cast<jint>(runtime->GetJITOptions()->GetThreadCount());
+}
+
+// Blocks until the JIT has no pending compilation request.
+extern "C" JNIEXPORT void JNICALL Java_JitThreadsBenchmark_waitForJitCompilation(JNIEnv*, jclass) {
+  jit::Jit* jit = Runtime::Current()->GetJit();
+  if (jit != nullptr) {
+    jit->WaitForCompilationToFinish(Thread::Current());
+  }
+}
+
+// Dumps the JIT state, including the busy and idle time of each worker.
+extern "C" JNIEXPORT void JNICALL Java_JitThreadsBenchmark_dumpJitInfo(JNIEnv*, jclass) {
+  jit::Jit* jit = Runtime::Current()->GetJit();
+  if (jit != nullptr) {
+    jit->DumpForSigQuit(LOG(INFO));
+  }
+}
+
+}  // namespace
+
+}  // namespace art
@@ -0,0 +1,321 @@
+/*
+ * Copyright (C) 2016 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+import java.util.concurrent.atomic.AtomicLong;
+
+// Warm-up is a one-off event of a process, so this benchmark is a plain program to be run once per
+// JIT worker count, see info.txt.
+public class JitThreadsBenchmark {
+  private static final int MUTATOR_THREADS = 4;
+  private static final long WINDOW_MS = 50;
+  private static final int WINDOWS = 60;
+  // Warm-up is over once a window reaches this fraction of the steady state throughput.
+  private static final double WARM_FRACTION = 0.9;
+
+  private static final AtomicLong operations = new AtomicLong();
+  private static volatile boolean running = true;
+  private static volatile int sink;
+
+  public static void main(String[] args) throws Exception {
+    System.loadLibrary("artbenchmark");
+    System.out.println("JIT threads: " + jitThreadCount());
+
+    Thread[] mutators = new Thread[MUTATOR_THREADS];
+    for (int i = 0; i < MUTATOR_THREADS; ++i) {
+      final int seed = i + 1;
+      mutators[i] = new Thread() {
+        public void run() {
+          int kernel = seed;
+          while (running) {
+            sink += runKernel(kernel++, seed);
+            operations.incrementAndGet();
+          }
+        }
+      };
+    }
+
+    long[] curve = new long[WINDOWS];
+    long start = System.nanoTime();
+    for (Thread mutator : mutators) {
+      mutator.start();
+    }
+    long previous = 0;
+    for (int i = 0; i < WINDOWS; ++i) {
+      Thread.sleep(WINDOW_MS);
+      long current = operations.get();
+      curve[i] = current - previous;
+      previous = current;
+    }
+    running = false;
+    for (Thread mutator : mutators) {
+      mutator.join();
+    }
+    long drainStart = System.nanoTime();
+    waitForJitCompilation();
+    long drainMs = (System.nanoTime() - drainStart) / 1000000;
+
+    // The steady state is the best of the last quarter of the run.
+    long steady = 0;
+    for (int i = WINDOWS - WINDOWS / 4; i < WINDOWS; ++i) {
+      steady = Math.max(steady, curve[i]);
+    }
+    int warmWindow = WINDOWS;
+    for (int i = 0; i < WINDOWS; ++i) {
+      System.out.println("t=" + ((i + 1) * WINDOW_MS) + "ms ops=" + curve[i]);
+      if (warmWindow == WINDOWS && curve[i] >= steady * WARM_FRACTION) {
+        warmWindow = i;
+      }
+    }
+    System.out.println("Warm-up time: " + ((warmWindow + 1) * WINDOW_MS) + "ms");
+    System.out.println("Pending compilations drained in " + drainMs + "ms");
+    System.out.println("Total time: " + ((System.nanoTime() - start) / 1000000) + "ms");
+    dumpJitInfo();
+  }
+
+  // Many small kernels, so that warm-up needs many methods to be compiled.
+  static int runKernel(int kernel, int seed) {
+    switch (kernel % 12) {
+      case 0: return sieve(1000 + seed);
+      case 1: return fibonacci(500 + seed);
+      case 2: return crc(seed);
+      case 3: return sort(seed);
+      case 4: return digits(seed * 12345);
+      case 5: return matrix(seed);
+      case 6: return collatz(27 + seed);
+      case 7: return gcdSum(seed);
+      case 8: return bitCounts(seed);
+      case 9: return search(seed);
+      case 10: return editDistance("kitten" + seed, "sitting" + seed);
+      default: return polynomial(seed);
+    }
+  }
+
+  static int sieve(int n) {
+    boolean[] composite = new boolean[n + 1];
+    int count = 0;
+    for (int i = 2; i <= n; ++i) {
+      if (!composite[i]) {
+        ++count;
+        for (int j = i * 2; j <= n; j += i) {
+          composite[j] = true;
+        }
+      }
+    }
+    return count;
+  }
+
+  static int fibonacci(int n) {
+    int a = 0;
+    int b = 1;
+    for (int i = 0; i < n; ++i) {
+      int c = a + b;
+      a = b;
+      b = c;
+    }
+    return a;
+  }
+
+  static int crc(int seed) {
+    int crc = ~0;
+    for (int i = 0; i < 256; ++i) {
+      crc = crcStep(crc, (byte) (i ^ seed));
+    }
+    return ~crc;
+  }
+
+  static int crcStep(int crc, byte b) {
+    crc ^= b & 0xff;
+    for (int k = 0; k < 8; ++k) {
+      crc = (crc >>> 1) ^ (0xedb88320 & -(crc & 1));
+    }
+    return crc;
+  }
+
+  static int sort(int seed) {
+    int[] array = new int[64];
+    for (int i = 0; i < array.length; ++i) {
+      array[i] = (i * 7919 + seed) % 101;
+    }
+    quickSort(array, 0, array.length - 1);
+    return array[array.length / 2];
+  }
+
+  static void quickSort(int[] array, int low, int high) {
+    if (low < high) {
+      int pivot = partition(array, low, high);
+      quickSort(array, low, pivot - 1);
+      quickSort(array, pivot + 1, high);
+    }
+  }
+
+  static int partition(int[] array, int low, int high) {
+    int pivot = array[high];
+    int i = low;
+    for (int j = low; j < high; ++j) {
+      if (array[j] < pivot) {
+        int tmp = array[i];
+        array[i++] = array[j];
+        array[j] = tmp;
+      }
+    }
+    int tmp = array[i];
+    array[i] = array[high];
+    array[high] = tmp;
+    return i;
+  }
+
+  static int digits(int value) {
+    String string = Integer.toString(value);
+    int sum = 0;
+    for (int i = 0; i < string.length(); ++i) {
+      sum += string.charAt(i) - '0';
+    }
+    return sum;
+  }
+
+  static int matrix(int seed) {
+    int[][] a = new int[8][8];
+    int[][] b = new int[8][8];
+    for (int i = 0; i < 8; ++i) {
+      for (int j = 0; j < 8; ++j) {
+        a[i][j] = i + j + seed;
+        b[i][j] = i - j;
+      }
+    }
+    int trace = 0;
+    for (int i = 0; i < 8; ++i) {
+      trace += dot(a[i], b, i);
+    }
+    return trace;
+  }
+
+  static int dot(int[] row, int[][] matrix, int column) {
+    int sum = 0;
+    for (int k = 0; k < row.length; ++k) {
+      sum += row[k] * matrix[k][column];
+    }
+    return sum;
+  }
+
+  static int collatz(int n) {
+    int steps = 0;
+    long value = n;
+    while (value != 1) {
+      value = (value & 1) == 0 ? value / 2 : value * 3 + 1;
+      ++steps;
+    }
+    return steps;
+  }
+
+  static int gcdSum(int seed) {
+    int sum = 0;
+    for (int i = 1; i < 50; ++i) {
+      sum += gcd(i * seed + 12, 36);
+    }
+    return sum;
+  }
+
+  static int gcd(int a, int b) {
+    return b == 0 ? a : gcd(b, a % b);
+  }
+
+  static int bitCounts(int seed) {
+    int sum = 0;
+    for (int i = 0; i < 200; ++i) {
+      sum += popCount(i * seed);
+    }
+    return sum;
+  }
+
+  static int popCount(int value) {
+    int count = 0;
+    while (value != 0) {
+      value &= value - 1;
+      ++count;
+    }
+    return count;
+  }
+
+  static int search(int seed) {
+    int[] array = new int[128];
+    for (int i = 0; i < array.length; ++i) {
+      array[i] = i * 3;
+    }
+    int found = 0;
+    for (int key = seed; key < 384; key += 5) {
+      if (binarySearch(array, key) >= 0) {
+        ++found;
+      }
+    }
+    return found;
+  }
+
+  static int binarySearch(int[] array, int key) {
+    int low = 0;
+    int high = array.length - 1;
+    while (low <= high) {
+      int mid = (low + high) >>> 1;
+      if (array[mid] < key) {
+        low = mid + 1;
+      } else if (array[mid] > key) {
+        high = mid - 1;
+      } else {
+        return mid;
+      }
+    }
+    return -1;
+  }
+
+  static int editDistance(String a, String b) {
+    int[] previous = new int[b.length() + 1];
+    int[] current = new int[b.length() + 1];
+    for (int j = 0; j <= b.length(); ++j) {
+      previous[j] = j;
+    }
+    for (int i = 1; i <= a.length(); ++i) {
+      current[0] = i;
+      for (int j = 1; j <= b.length(); ++j) {
+        int cost = a.charAt(i - 1) == b.charAt(j - 1) ? 0 : 1;
+        current[j] = Math.min(Math.min(current[j - 1], previous[j]) + 1, previous[j - 1] + cost);
+      }
+      int[] tmp = previous;
+      previous = current;
+      current = tmp;
+    }
+    return previous[b.length()];
+  }
+
+  static int polynomial(int seed) {
+    int result = 0;
+    for (int x = 0; x < 100; ++x) {
+      result += horner(x + seed);
+    }
+    return result;
+  }
+
+  static int horner(int x) {
+    int[] coefficients = { 3, -2, 7, 1, -5 };
+    int value = 0;
+    for (int coefficient : coefficients) {
+      value = value * x + coefficient;
+    }
+    return value;
+  }
+
+  private static native int jitThreadCount();
+  private static native void waitForJitCompilation();
+  private static native void dumpJitInfo();
+}
@@ -0,0 +1,63 @@
+/*
+ * Copyright (C) 2016 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "jni.h"
+
+#include "art_method-inl.h"
+#include "jit/jit.h"
+#include "jit/jit_code_cache.h"
+#include "runtime.h"
+#include "scoped_thread_state_change.h"
+#include "ScopedUtfChars.h"
+
+namespace art {
+
+namespace {
+
+// Returns 0 if the static method `name` of `klass` runs in the interpreter, 1 if it runs baseline
+// code, and 2 if it runs optimized code.
+extern "C" JNIEXPORT jint JNICALL Java_JitTieredBenchmark_jitCodeState(JNIEnv* env,
+                                                                      jclass,
+                                                                      jclass klass,
+                                                                      jstring name) {
+  jit::Jit* jit = Runtime::Current()->GetJit();
+  if (jit == nullptr) {
+    return 0;
+  }
+  ScopedUtfChars chars(env, name);
+  CHECK(chars.c_str() != nullptr);
+  jmethodID method_id = env->GetStaticMethodID(klass, chars.c_str(), "(I)I");
+  CHECK(method_id != nullptr);
+  ScopedObjectAccess soa(env);
+  ArtMethod* method = soa.DecodeMethod(method_id);
+  jit::JitCodeCache* code_cache = jit->GetCodeCache();
+  if (!code_cache->ContainsPc(method->GetEntryPointFromQuickCompiledCode())) {
+    return 0;
+  }
+  return code_cache->IsBaselineCode(method) ? 1 : 2;
+}
+
+// Dumps the JIT state, including the time from baseline code to optimized code.
+extern "C" JNIEXPORT void JNICALL Java_JitTieredBenchmark_dumpJitInfo(JNIEnv*, jclass) {
+  jit::Jit* jit = Runtime::Current()->GetJit();
+  if (jit != nullptr) {
+    jit->DumpForSigQuit(LOG(INFO));
+  }
+}
+
+}  // namespace
+
+}  // namespace art
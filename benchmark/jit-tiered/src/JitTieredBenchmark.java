@@ -0,0 +1,86 @@
+/*
+ * Copyright (C) 2016 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// The tier of a method only goes up once per process, so this benchmark is a plain program to be
+// run with and without a baseline tier, see info.txt.
+public class JitTieredBenchmark {
+  // Values of jitCodeState.
+  private static final int INTERPRETED = 0;
+  private static final int BASELINE = 1;
+  private static final int OPTIMIZED = 2;
+
+  private static final int POLL_INTERVAL = 64;
+  private static final long TIMEOUT_NS = 10000000000L;
+  private static final int MEASURED_ROUNDS = 1000000;
+  private static final int LOOP_ITERATIONS = 32;
+
+  private static volatile int sink;
+
+  public static void main(String[] args) throws Exception {
+    System.loadLibrary("artbenchmark");
+
+    long start = System.nanoTime();
+    long firstCodeNs = -1;
+    long optimizedCodeNs = -1;
+    int rounds = 0;
+    while (optimizedCodeNs < 0 && System.nanoTime() - start < TIMEOUT_NS) {
+      for (int i = 0; i < POLL_INTERVAL; ++i) {
+        sink += kernel(rounds++);
+      }
+      int state = jitCodeState(JitTieredBenchmark.class, "kernel");
+      long now = System.nanoTime() - start;
+      if (state != INTERPRETED && firstCodeNs < 0) {
+        firstCodeNs = now;
+      }
+      if (state == OPTIMIZED) {
+        optimizedCodeNs = now;
+      }
+    }
+    System.out.println("Time to compiled code: " + formatMs(firstCodeNs));
+    System.out.println("Time to optimized code: " + formatMs(optimizedCodeNs));
+    System.out.println("Rounds before optimized code: " + rounds);
+
+    long measureStart = System.nanoTime();
+    int result = 0;
+    for (int round = 0; round < MEASURED_ROUNDS; ++round) {
+      result += kernel(round);
+    }
+    long timeNs = System.nanoTime() - measureStart;
+    sink += result;
+    System.out.println("Optimized kernel: " + (timeNs / MEASURED_ROUNDS) + "ns per round");
+    dumpJitInfo();
+  }
+
+  private static String formatMs(long timeNs) {
+    return (timeNs < 0) ? "not reached" : ((timeNs / 1000) / 1000.0) + "ms";
+  }
+
+  static int kernel(int seed) {
+    int[] values = new int[LOOP_ITERATIONS];
+    for (int i = 0; i < LOOP_ITERATIONS; ++i) {
+      values[i] = seed ^ (i * 31);
+    }
+    int sum = 0;
+    for (int i = 0; i < LOOP_ITERATIONS; ++i) {
+      sum += values[i] >>> (i & 7);
+    }
+    return sum;
+  }
+
+  // Returns INTERPRETED, BASELINE or OPTIMIZED for the static method `name` of `klass`.
+  private static native int jitCodeState(Class<?> klass, String name);
+  private static native void dumpJitInfo();
+}
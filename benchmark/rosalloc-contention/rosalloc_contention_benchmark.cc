@@ -0,0 +1,55 @@
+/*
+ * Copyright (C) 2016 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "jni.h"
+
+#include "gc/allocator/rosalloc.h"
+#include "gc/heap.h"
+#include "gc/space/rosalloc_space.h"
+#include "runtime.h"
+
+namespace art {
+
+namespace {
+
+gc::allocator::RosAlloc* GetRosAlloc() {
+  gc::Heap* heap = Runtime::Current()->GetHeap();
+  gc::space::RosAllocSpace* space = heap->GetRosAllocSpace();
+  if (space == nullptr || heap->GetCurrentAllocator() != gc::kAllocatorTypeRosAlloc) {
+    return nullptr;
+  }
+  return space->GetRosAlloc();
+}
+
+extern "C" JNIEXPORT jboolean JNICALL Java_RosAllocContentionBenchmark_isRosAllocInUse(JNIEnv*,
+                                                                                      jclass) {
+  return GetRosAlloc() != nullptr ? JNI_TRUE : JNI_FALSE;
+}
+
+extern "C" JNIEXPORT jint JNICALL Java_RosAllocContentionBenchmark_getMaxThreadLocalRunBytes(
+    JNIEnv*, jclass) {
+  return static_cast<jint>(GetRosAlloc()->GetMaxThreadLocalRunBytes());
+}
+
+// With 0, the threads allocate the sizes above the small brackets from the shared runs only.
+extern "C" JNIEXPORT void JNICALL Java_RosAllocContentionBenchmark_setMaxThreadLocalRunBytes(
+    JNIEnv*, jclass, jint bytes) {
+  GetRosAlloc()->SetMaxThreadLocalRunBytes(static_cast<size_t>(bytes));
+}
+
+}  // namespace
+
+}  // namespace art
@@ -0,0 +1,105 @@
+/*
+ * Copyright (C) 2016 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// The allocator is set once per process, so this benchmark is a plain program, see info.txt.
+public class RosAllocContentionBenchmark {
+  private static final int[] THREAD_COUNTS = { 1, 2, 4, 8, 16, 32 };
+  private static final long RUN_MS = 1000;
+  // Each thread keeps its last LIVE_BUFFERS buffers live. Must be a power of two.
+  private static final int LIVE_BUFFERS = 64;
+  // The byte sizes of the buffers, which fall into the brackets of 256 bytes to 2KB.
+  private static final int[] BUFFER_SIZES = { 256, 320, 384, 448, 512, 1024, 2048 };
+
+  private static volatile boolean running;
+  private static volatile int sink;
+
+  public static void main(String[] args) throws Exception {
+    System.loadLibrary("artbenchmark");
+    if (!isRosAllocInUse()) {
+      System.out.println("RosAlloc is not the current allocator");
+      return;
+    }
+    int maxThreadLocalRunBytes = getMaxThreadLocalRunBytes();
+    for (int threads : THREAD_COUNTS) {
+      setMaxThreadLocalRunBytes(0);
+      long shared = allocationsPerSecond(threads);
+      setMaxThreadLocalRunBytes(maxThreadLocalRunBytes);
+      long threadLocal = allocationsPerSecond(threads);
+      System.out.println("Threads: " + threads
+          + ", shared runs: " + shared + " allocations per second"
+          + ", thread-local runs: " + threadLocal + " allocations per second");
+    }
+  }
+
+  static long allocationsPerSecond(int threadCount) throws Exception {
+    // Start each measurement with an empty heap, the thread-local runs of the previous threads
+    // having been revoked when they exited.
+    Runtime.getRuntime().gc();
+    final long[] allocations = new long[threadCount];
+    Thread[] threads = new Thread[threadCount];
+    for (int i = 0; i < threadCount; ++i) {
+      final int index = i;
+      threads[i] = new Thread() {
+        public void run() {
+          allocations[index] = allocate(index);
+        }
+      };
+    }
+    running = true;
+    long start = System.nanoTime();
+    for (Thread thread : threads) {
+      thread.start();
+    }
+    Thread.sleep(RUN_MS);
+    running = false;
+    for (Thread thread : threads) {
+      thread.join();
+    }
+    long timeNs = System.nanoTime() - start;
+    long total = 0;
+    for (long count : allocations) {
+      total += count;
+    }
+    return total * 1000000000L / timeNs;
+  }
+
+  static long allocate(int seed) {
+    Object[] live = new Object[LIVE_BUFFERS];
+    long count = 0;
+    int size = seed;
+    while (running) {
+      for (int i = 0; i < LIVE_BUFFERS; ++i) {
+        int bytes = BUFFER_SIZES[size++ % BUFFER_SIZES.length] - 16;
+        if ((i & 1) == 0) {
+          byte[] buffer = new byte[bytes];
+          buffer[0] = (byte) i;
+          live[i] = buffer;
+        } else {
+          char[] buffer = new char[bytes / 2];
+          buffer[0] = (char) i;
+          live[i] = buffer;
+        }
+      }
+      count += LIVE_BUFFERS;
+    }
+    sink += live.length;
+    return count;
+  }
+
+  private static native boolean isRosAllocInUse();
+  private static native int getMaxThreadLocalRunBytes();
+  private static native void setMaxThreadLocalRunBytes(int bytes);
+}
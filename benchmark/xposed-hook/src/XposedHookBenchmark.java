@@ -0,0 +1,111 @@
+/*
+ * Copyright (C) 2016 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+import com.google.caliper.SimpleBenchmark;
+
+import java.lang.reflect.InvocationHandler;
+import java.lang.reflect.Member;
+import java.lang.reflect.Method;
+import java.lang.reflect.Proxy;
+
+public class XposedHookBenchmark extends SimpleBenchmark {
+  interface Adder {
+    int add(int a, int b);
+  }
+
+  static class DirectAdder implements Adder {
+    public int add(int a, int b) {
+      return a + b;
+    }
+  }
+
+  static class HookedAdder implements Adder {
+    public int add(int a, int b) {
+      return a + b;
+    }
+  }
+
+  static class ObservedAdder implements Adder {
+    public int add(int a, int b) {
+      return a + b;
+    }
+  }
+
+  private final Adder direct = new DirectAdder();
+  private final Adder hooked = new HookedAdder();
+  private final Adder observed = new ObservedAdder();
+  private final Adder proxied;
+  private int sink;
+
+  public XposedHookBenchmark() {
+    System.loadLibrary("artbenchmark");
+    proxied = (Adder) Proxy.newProxyInstance(Adder.class.getClassLoader(),
+        new Class<?>[] { Adder.class },
+        new InvocationHandler() {
+          public Object invoke(Object proxy, Method method, Object[] args) {
+            return sum(args);
+          }
+        });
+    try {
+      installHook(HookedAdder.class.getDeclaredMethod("add", int.class, int.class));
+      installObserver(ObservedAdder.class.getDeclaredMethod("add", int.class, int.class));
+    } catch (NoSuchMethodException e) {
+      throw new RuntimeException(e);
+    }
+    // Make sure everything is linked before the benchmark starts.
+    timeDirectCall(1);
+    timeHookedCall(1);
+    timeObservedCall(1);
+    timeProxyCall(1);
+  }
+
+  // Called by the runtime in place of XposedBridge.handleHookedMethod.
+  private static Object handleHookedMethod(Member method, int originalMethodId,
+      Object additionalInfo, Object thisObject, Object[] args) {
+    return sum(args);
+  }
+
+  private static Object sum(Object[] args) {
+    return (Integer) args[0] + (Integer) args[1];
+  }
+
+  public void timeDirectCall(int reps) {
+    for (int i = 0; i < reps; ++i) {
+      sink += direct.add(i, 1);
+    }
+  }
+
+  public void timeHookedCall(int reps) {
+    for (int i = 0; i < reps; ++i) {
+      sink += hooked.add(i, 1);
+    }
+  }
+
+  public void timeObservedCall(int reps) {
+    for (int i = 0; i < reps; ++i) {
+      sink += observed.add(i, 1);
+    }
+  }
+
+  public void timeProxyCall(int reps) {
+    for (int i = 0; i < reps; ++i) {
+      sink += proxied.add(i, 1);
+    }
+  }
+
+  private static native void installHook(Method method);
+  private static native void installObserver(Method method);
+}
@@ -0,0 +1,63 @@
+/*
+ * Copyright (C) 2016 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "jni.h"
+
+#include "art_method-inl.h"
+#include "scoped_thread_state_change.h"
+
+namespace art {
+namespace {
+
+// Hooks `method` and routes its invocations to XposedHookBenchmark.handleHookedMethod. The
+// benchmark runs in its own process, so it takes the place of XposedBridge as the callback.
+extern "C" JNIEXPORT void JNICALL Java_XposedHookBenchmark_installHook(
+    JNIEnv* env, jclass klass, jobject method) {
+  if (ArtMethod::xposed_callback_class == nullptr) {
+    ArtMethod::xposed_callback_class = reinterpret_cast<jclass>(env->NewGlobalRef(klass));
+    ArtMethod::xposed_callback_method = env->GetStaticMethodID(
+        klass,
+        "handleHookedMethod",
+        "(Ljava/lang/reflect/Member;ILjava/lang/Object;Ljava/lang/Object;[Ljava/lang/Object;)"
+        "Ljava/lang/Object;");
+    CHECK(ArtMethod::xposed_callback_method != nullptr);
+  }
+  ScopedObjectAccess soa(env);
+  ArtMethod* art_method = ArtMethod::FromReflectedMethod(soa, method);
+  art_method->EnableXposedHook(soa, nullptr);
+}
+
+static void CountingObserver(JNIEnv*, jobject, jobject, const jvalue*, size_t, const jvalue*,
+                             void* data) {
+  ++*reinterpret_cast<size_t*>(data);
+}
+
+static size_t observed_calls = 0;
+
+// Hooks `method` with native observers only, so its invocations call the original method directly.
+extern "C" JNIEXPORT void JNICALL Java_XposedHookBenchmark_installObserver(
+    JNIEnv* env, jclass, jobject method) {
+  XposedHookObservers observers = {};
+  observers.native_before = CountingObserver;
+  observers.native_after = CountingObserver;
+  observers.native_data = &observed_calls;
+  ScopedObjectAccess soa(env);
+  ArtMethod* art_method = ArtMethod::FromReflectedMethod(soa, method);
+  art_method->EnableXposedHook(soa, nullptr, 0u, &observers);
+}
+
+}  // namespace
+}  // namespace art
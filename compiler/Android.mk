@@ -50,6 +50,7 @@ LIBART_COMPILER_SRC_FILES := \
 	optimizing/dex_cache_array_fixups_arm.cc \
 	optimizing/graph_checker.cc \
 	optimizing/graph_visualizer.cc \
+	optimizing/guarded_devirtualization.cc \
 	optimizing/gvn.cc \
 	optimizing/induction_var_analysis.cc \
 	optimizing/induction_var_range.cc \
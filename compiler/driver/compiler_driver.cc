@@ -45,6 +45,7 @@
 #include "dex/quick/dex_file_method_inliner.h"
 #include "dex/quick/dex_file_to_method_inliner_map.h"
 #include "driver/compiler_options.h"
+#include "jit/jit.h"
 #include "jni_internal.h"
 #include "object_lock.h"
 #include "profiler.h"
@@ -1326,8 +1327,9 @@ bool CompilerDriver::CanAssumeClassIsLoaded(mirror::Class* klass) {
   Runtime* runtime = Runtime::Current();
   if (!runtime->IsAotCompiler()) {
     DCHECK(runtime->UseJitCompilation());
-    // Having the klass reference here implies that the klass is already loaded.
-    return true;
+    // Having the klass reference here implies that the klass is already loaded, but not in the
+    // processes running saved code.
+    return !IsJitCodePersistent();
   }
   if (!IsBootImage()) {
     // Assume loaded only if klass is in the boot image. App classes cannot be assumed
@@ -1340,6 +1342,13 @@ bool CompilerDriver::CanAssumeClassIsLoaded(mirror::Class* klass) {
   return IsImageClass(descriptor);
 }
 
+bool CompilerDriver::IsJitCodePersistent() const {
+  Runtime* runtime = Runtime::Current();
+  return runtime != nullptr &&
+      runtime->UseJitCompilation() &&
+      runtime->GetJit()->HasPersistentCodeCache();
+}
+
 void CompilerDriver::MarkForDexToDexCompilation(Thread* self, const MethodReference& method_ref) {
   MutexLock lock(self, dex_to_dex_references_lock_);
   // Since we're compiling one dex file at a time, we need to look for the
@@ -1357,7 +1366,7 @@ bool CompilerDriver::CanAssumeTypeIsPresentInDexCache(Handle<mirror::DexCache> d
   if ((IsBootImage() &&
        IsImageClass(dex_cache->GetDexFile()->StringDataByIdx(
            dex_cache->GetDexFile()->GetTypeId(type_idx).descriptor_idx_))) ||
-      Runtime::Current()->UseJitCompilation()) {
+      (Runtime::Current()->UseJitCompilation() && !IsJitCodePersistent())) {
     mirror::Class* resolved_class = dex_cache->GetResolvedType(type_idx);
     result = (resolved_class != nullptr);
   }
@@ -1375,7 +1384,7 @@ bool CompilerDriver::CanAssumeStringIsPresentInDexCache(const DexFile& dex_file,
   // See also Compiler::ResolveDexFile
 
   bool result = false;
-  if (IsBootImage() || Runtime::Current()->UseJitCompilation()) {
+  if (IsBootImage() || (Runtime::Current()->UseJitCompilation() && !IsJitCodePersistent())) {
     ScopedObjectAccess soa(Thread::Current());
     StackHandleScope<1> hs(soa.Self());
     ClassLinker* const class_linker = Runtime::Current()->GetClassLinker();
@@ -469,7 +469,15 @@ class CompilerDriver {
   bool CanAssumeClassIsLoaded(mirror::Class* klass)
       SHARED_REQUIRES(Locks::mutator_lock_);
 
+  // Is the code compiled by the JIT saved for later runs of the application? Such code must not
+  // depend on addresses nor on the resolution state of the current process.
+  bool IsJitCodePersistent() const;
+
   bool MayInline(const DexFile* inlined_from, const DexFile* inlined_into) const {
+    if (inlined_from != inlined_into && IsJitCodePersistent()) {
+      // Saved code is only validated against the dex file of the compiled method.
+      return false;
+    }
     if (!kIsTargetBuild) {
       return MayInlineInternal(inlined_from, inlined_into);
     }
@@ -24,6 +24,7 @@
 #include "base/timing_logger.h"
 #include "base/unix_file/fd_file.h"
 #include "debug/elf_debug_writer.h"
+#include "debug/method_debug_info.h"
 #include "driver/compiler_driver.h"
 #include "driver/compiler_options.h"
 #include "jit/debugger_interface.h"
@@ -56,11 +57,21 @@ extern "C" void jit_unload(void* handle) {
 }
 
 extern "C" bool jit_compile_method(
-    void* handle, ArtMethod* method, Thread* self, bool osr)
+    void* handle, ArtMethod* method, Thread* self, bool osr, bool baseline)
     SHARED_REQUIRES(Locks::mutator_lock_) {
   auto* jit_compiler = reinterpret_cast<JitCompiler*>(handle);
   DCHECK(jit_compiler != nullptr);
-  return jit_compiler->CompileMethod(self, method, osr);
+  return jit_compiler->CompileMethod(self, method, osr, baseline);
+}
+
+extern "C" void jit_code_moved(void* handle,
+                               ArtMethod* method,
+                               const void* old_code,
+                               const void* new_code)
+    SHARED_REQUIRES(Locks::mutator_lock_) {
+  auto* jit_compiler = reinterpret_cast<JitCompiler*>(handle);
+  DCHECK(jit_compiler != nullptr);
+  jit_compiler->CodeMoved(Thread::Current(), method, old_code, new_code);
 }
 
 extern "C" void jit_types_loaded(void* handle, mirror::Class** types, size_t count)
@@ -86,7 +97,7 @@ NO_RETURN static void Usage(const char* fmt, ...) {
   exit(EXIT_FAILURE);
 }
 
-JitCompiler::JitCompiler() {
+JitCompiler::JitCompiler() : perf_file_lock_("JIT perf file lock") {
   compiler_options_.reset(new CompilerOptions(
       CompilerOptions::kDefaultCompilerFilter,
       CompilerOptions::kDefaultHugeMethodThreshold,
@@ -160,7 +171,7 @@ JitCompiler::JitCompiler() {
       /* image_classes */ nullptr,
       /* compiled_classes */ nullptr,
       /* compiled_methods */ nullptr,
-      /* thread_count */ 1,
+      Runtime::Current()->GetJITOptions()->GetThreadCount(),
       /* dump_stats */ false,
       /* dump_passes */ false,
       cumulative_logger_.get(),
@@ -177,9 +188,8 @@ JitCompiler::JitCompiler() {
 #else
     const char* prefix = "/tmp";
 #endif
-    DCHECK_EQ(thread_count, 1u)
-        << "Generating debug info only works with one compiler thread";
     std::string perf_filename = std::string(prefix) + "/perf-" + std::to_string(getpid()) + ".map";
+    MutexLock mu(Thread::Current(), perf_file_lock_);
     perf_file_.reset(OS::CreateEmptyFileWriteOnly(perf_filename.c_str()));
     if (perf_file_ == nullptr) {
       LOG(ERROR) << "Could not create perf file at " << perf_filename <<
@@ -193,13 +203,14 @@ JitCompiler::JitCompiler() {
 }
 
 JitCompiler::~JitCompiler() {
+  MutexLock mu(Thread::Current(), perf_file_lock_);
   if (perf_file_ != nullptr) {
     UNUSED(perf_file_->Flush());
     UNUSED(perf_file_->Close());
   }
 }
 
-bool JitCompiler::CompileMethod(Thread* self, ArtMethod* method, bool osr) {
+bool JitCompiler::CompileMethod(Thread* self, ArtMethod* method, bool osr, bool baseline) {
   DCHECK(!method->IsProxyMethod());
   TimingLogger logger("JIT compiler timing logger", true, VLOG_IS_ON(jit));
   StackHandleScope<2> hs(self);
@@ -218,20 +229,10 @@ bool JitCompiler::CompileMethod(Thread* self, ArtMethod* method, bool osr) {
   {
     TimingLogger::ScopedTiming t2("Compiling", &logger);
     JitCodeCache* const code_cache = runtime->GetJit()->GetCodeCache();
-    success = compiler_driver_->GetCompiler()->JitCompile(self, code_cache, method, osr);
-    if (success && (perf_file_ != nullptr)) {
+    success = compiler_driver_->GetCompiler()->JitCompile(self, code_cache, method, osr, baseline);
+    if (success && compiler_options_->GetGenerateDebugInfo()) {
       const void* ptr = method->GetEntryPointFromQuickCompiledCode();
-      std::ostringstream stream;
-      stream << std::hex
-             << reinterpret_cast<uintptr_t>(ptr)
-             << " "
-             << code_cache->GetMemorySizeOfCodePointer(ptr)
-             << " "
-             << PrettyMethod(method)
-             << std::endl;
-      std::string str = stream.str();
-      bool res = perf_file_->WriteFully(str.c_str(), str.size());
-      CHECK(res);
+      WritePerfMapEntry(self, ptr, code_cache->GetMemorySizeOfCodePointer(ptr), method);
     }
   }
 
@@ -246,5 +247,67 @@ bool JitCompiler::CompileMethod(Thread* self, ArtMethod* method, bool osr) {
   return success;
 }
 
+void JitCompiler::CodeMoved(Thread* self,
+                            ArtMethod* method,
+                            const void* old_code,
+                            const void* new_code) {
+  if (!compiler_options_->GetGenerateDebugInfo()) {
+    return;
+  }
+  const OatQuickMethodHeader* method_header = OatQuickMethodHeader::FromCodePointer(new_code);
+  const uintptr_t code_address = reinterpret_cast<uintptr_t>(new_code);
+  // The debug information of the old copy is written again with the new addresses. Only the
+  // call frame information, which comes from the code generator, is not in the copy.
+  std::vector<uint8_t> cfi;
+  if (GetJITCodeEntryCfiForAddress(reinterpret_cast<uintptr_t>(old_code), &cfi)) {
+    const DexFile* dex_file = method->GetDexFile();
+    debug::MethodDebugInfo info = debug::MethodDebugInfo();
+    info.trampoline_name = nullptr;
+    info.dex_file = dex_file;
+    info.class_def_index = method->GetClassDefIndex();
+    info.dex_method_index = method->GetDexMethodIndex();
+    info.access_flags = method->GetAccessFlags();
+    info.code_item = dex_file->GetCodeItem(method->GetCodeItemOffset());
+    info.isa = compiler_driver_->GetInstructionSet();
+    info.deduped = false;
+    info.is_native_debuggable = compiler_options_->GetNativeDebuggable();
+    info.is_optimized = true;
+    info.is_code_address_text_relative = false;
+    info.code_address = code_address;
+    info.code_size = method_header->GetCodeSize();
+    info.frame_size_in_bytes = method_header->GetFrameSizeInBytes();
+    info.code_info =
+        method_header->IsOptimized() ? method_header->GetOptimizedCodeInfoPtr() : nullptr;
+    info.cfi = ArrayRef<const uint8_t>(cfi);
+    std::vector<uint8_t> elf_file = debug::WriteDebugElfFileForMethods(
+        compiler_driver_->GetInstructionSet(),
+        compiler_driver_->GetInstructionSetFeatures(),
+        ArrayRef<const debug::MethodDebugInfo>(&info, 1));
+    CreateJITCodeEntryForAddress(code_address, std::move(elf_file), std::move(cfi));
+  }
+  // The code cache lock is held, so use the size of the code rather than of its allocation.
+  WritePerfMapEntry(self, method_header->GetEntryPoint(), method_header->GetCodeSize(), method);
+}
+
+void JitCompiler::WritePerfMapEntry(Thread* self,
+                                    const void* code,
+                                    size_t size,
+                                    ArtMethod* method) {
+  std::ostringstream stream;
+  stream << std::hex
+         << reinterpret_cast<uintptr_t>(code)
+         << " "
+         << size
+         << " "
+         << PrettyMethod(method)
+         << std::endl;
+  std::string str = stream.str();
+  MutexLock mu(self, perf_file_lock_);
+  if (perf_file_ != nullptr) {
+    bool res = perf_file_->WriteFully(str.c_str(), str.size());
+    CHECK(res);
+  }
+}
+
 }  // namespace jit
 }  // namespace art
@@ -36,7 +36,12 @@ class JitCompiler {
   virtual ~JitCompiler();
 
   // Compilation entrypoint. Returns whether the compilation succeeded.
-  bool CompileMethod(Thread* self, ArtMethod* method, bool osr)
+  bool CompileMethod(Thread* self, ArtMethod* method, bool osr, bool baseline)
+      SHARED_REQUIRES(Locks::mutator_lock_);
+
+  // Describes to the native debugger and to perf the copy `new_code` of the compiled code
+  // `old_code` of `method`. The entry of `old_code` is removed once it is freed.
+  void CodeMoved(Thread* self, ArtMethod* method, const void* old_code, const void* new_code)
       SHARED_REQUIRES(Locks::mutator_lock_);
 
   CompilerOptions* GetCompilerOptions() const {
@@ -52,7 +57,9 @@ class JitCompiler {
   std::unique_ptr<DexFileToMethodInlinerMap> method_inliner_map_;
   std::unique_ptr<CompilerDriver> compiler_driver_;
   std::unique_ptr<const InstructionSetFeatures> instruction_set_features_;
-  std::unique_ptr<File> perf_file_;
+  // Written by all the JIT threads.
+  Mutex perf_file_lock_ DEFAULT_MUTEX_ACQUIRED_AFTER;
+  std::unique_ptr<File> perf_file_ GUARDED_BY(perf_file_lock_);
 
   JitCompiler();
 
@@ -61,6 +68,11 @@ class JitCompiler {
   bool AddToCodeCache(ArtMethod* method, const CompiledMethod* compiled_method)
       SHARED_REQUIRES(Locks::mutator_lock_);
 
+  // Maps the `size` bytes at `code` to `method` in the perf map file, if there is one.
+  void WritePerfMapEntry(Thread* self, const void* code, size_t size, ArtMethod* method)
+      REQUIRES(!perf_file_lock_)
+      SHARED_REQUIRES(Locks::mutator_lock_);
+
   DISALLOW_COPY_AND_ASSIGN(JitCompiler);
 };
 
@@ -529,7 +529,8 @@ void CodeGenerator::AllocateLocations(HInstruction* instruction) {
   instruction->Accept(GetLocationBuilder());
   DCHECK(CheckTypeConsistency(instruction));
   LocationSummary* locations = instruction->GetLocations();
-  if (!instruction->IsSuspendCheckEntry()) {
+  // The entry suspend check is removed from leaf methods, unless it counts their hotness.
+  if (!instruction->IsSuspendCheckEntry() || counts_hotness_) {
     if (locations != nullptr) {
       if (locations->CanCall()) {
         MarkNotLeaf();
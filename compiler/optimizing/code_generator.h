@@ -254,6 +254,9 @@ class CodeGenerator : public DeletableArenaObject<kArenaAllocCodeGenerator> {
   virtual bool NeedsTwoRegisters(Primitive::Type type) const = 0;
   // Returns whether we should split long moves in parallel moves.
   virtual bool ShouldSplitLongMoves() const { return false; }
+  // Returns whether the generated code can count down the hotness of the method, see
+  // SetCountsHotness().
+  virtual bool SupportsHotnessCountdown() const { return false; }
 
   size_t GetNumberOfCoreCalleeSaveRegisters() const {
     return POPCOUNT(core_callee_save_mask_);
@@ -323,6 +326,18 @@ class CodeGenerator : public DeletableArenaObject<kArenaAllocCodeGenerator> {
     return requires_current_method_;
   }
 
+  // Makes the generated code count down the hotness counter of the method at its entry and at
+  // the back edges of its loops, and call pJitBaselineCodeIsHot when the count reaches zero. Used
+  // by the baseline tier of the JIT, see Jit::NotifyBaselineCodeIsHot().
+  void SetCountsHotness() {
+    DCHECK(SupportsHotnessCountdown());
+    counts_hotness_ = true;
+  }
+
+  bool CountsHotness() const {
+    return counts_hotness_;
+  }
+
   // Clears the spill slots taken by loop phis in the `LocationSummary` of the
   // suspend check. This is called when the code generator generates code
   // for the suspend check at the back edge (instead of where the suspend check
@@ -521,7 +536,8 @@ class CodeGenerator : public DeletableArenaObject<kArenaAllocCodeGenerator> {
         current_slow_path_(nullptr),
         current_block_index_(0),
         is_leaf_(true),
-        requires_current_method_(false) {
+        requires_current_method_(false),
+        counts_hotness_(false) {
     slow_paths_.reserve(8);
   }
 
@@ -633,6 +649,9 @@ class CodeGenerator : public DeletableArenaObject<kArenaAllocCodeGenerator> {
   // Whether an instruction in the graph accesses the current method.
   bool requires_current_method_;
 
+  // Whether the suspend checks count down the hotness of the method.
+  bool counts_hotness_;
+
   friend class OptimizingCFITest;
 
   DISALLOW_COPY_AND_ASSIGN(CodeGenerator);
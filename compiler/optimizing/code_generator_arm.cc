@@ -151,6 +151,27 @@ class SuspendCheckSlowPathARM : public SlowPathCode {
   DISALLOW_COPY_AND_ASSIGN(SuspendCheckSlowPathARM);
 };
 
+class HotnessCountdownSlowPathARM : public SlowPathCode {
+ public:
+  explicit HotnessCountdownSlowPathARM(HSuspendCheck* instruction) : SlowPathCode(instruction) {}
+
+  void EmitNativeCode(CodeGenerator* codegen) OVERRIDE {
+    CodeGeneratorARM* arm_codegen = down_cast<CodeGeneratorARM*>(codegen);
+    __ Bind(GetEntryLabel());
+    SaveLiveRegisters(codegen, instruction_->GetLocations());
+    arm_codegen->InvokeRuntime(
+        QUICK_ENTRY_POINT(pJitBaselineCodeIsHot), instruction_, instruction_->GetDexPc(), this);
+    CheckEntrypointTypes<kQuickJitBaselineCodeIsHot, void, void>();
+    RestoreLiveRegisters(codegen, instruction_->GetLocations());
+    __ b(GetExitLabel());
+  }
+
+  const char* GetDescription() const OVERRIDE { return "HotnessCountdownSlowPathARM"; }
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(HotnessCountdownSlowPathARM);
+};
+
 class BoundsCheckSlowPathARM : public SlowPathCode {
  public:
   explicit BoundsCheckSlowPathARM(HBoundsCheck* instruction)
@@ -4835,6 +4856,21 @@ void InstructionCodeGeneratorARM::GenerateSuspendCheck(HSuspendCheck* instructio
     DCHECK_EQ(slow_path->GetSuccessor(), successor);
   }
 
+  if (codegen_->CountsHotness()) {
+    // A suspend check is emitted again at each back edge of its loop, which all need an exit.
+    HotnessCountdownSlowPathARM* hotness_slow_path =
+        new (GetGraph()->GetArena()) HotnessCountdownSlowPathARM(instruction);
+    codegen_->AddSlowPath(hotness_slow_path);
+    // LR is saved by the frame entry, and free in the body of the method.
+    int32_t count_offset = ArtMethod::HotnessCountOffset().Int32Value();
+    __ LoadFromOffset(kLoadWord, LR, SP, kCurrentMethodStackOffset);
+    __ LoadFromOffset(kLoadUnsignedHalfword, IP, LR, count_offset);
+    __ subs(IP, IP, ShifterOperand(1));
+    __ StoreToOffset(kStoreHalfword, IP, LR, count_offset);
+    __ b(hotness_slow_path->GetEntryLabel(), EQ);
+    __ Bind(hotness_slow_path->GetExitLabel());
+  }
+
   __ LoadFromOffset(
       kLoadUnsignedHalfword, IP, TR, Thread::ThreadFlagsOffset<kArmWordSize>().Int32Value());
   if (successor == nullptr) {
@@ -398,6 +398,8 @@ class CodeGeneratorARM : public CodeGenerator {
     return type == Primitive::kPrimDouble || type == Primitive::kPrimLong;
   }
 
+  bool SupportsHotnessCountdown() const OVERRIDE { return true; }
+
   void ComputeSpillMask() OVERRIDE;
 
   Label* GetFrameEntryLabel() { return &frame_entry_label_; }
@@ -428,6 +428,28 @@ class SuspendCheckSlowPathARM64 : public SlowPathCodeARM64 {
   DISALLOW_COPY_AND_ASSIGN(SuspendCheckSlowPathARM64);
 };
 
+class HotnessCountdownSlowPathARM64 : public SlowPathCodeARM64 {
+ public:
+  explicit HotnessCountdownSlowPathARM64(HSuspendCheck* instruction)
+      : SlowPathCodeARM64(instruction) {}
+
+  void EmitNativeCode(CodeGenerator* codegen) OVERRIDE {
+    CodeGeneratorARM64* arm64_codegen = down_cast<CodeGeneratorARM64*>(codegen);
+    __ Bind(GetEntryLabel());
+    SaveLiveRegisters(codegen, instruction_->GetLocations());
+    arm64_codegen->InvokeRuntime(
+        QUICK_ENTRY_POINT(pJitBaselineCodeIsHot), instruction_, instruction_->GetDexPc(), this);
+    CheckEntrypointTypes<kQuickJitBaselineCodeIsHot, void, void>();
+    RestoreLiveRegisters(codegen, instruction_->GetLocations());
+    __ B(GetExitLabel());
+  }
+
+  const char* GetDescription() const OVERRIDE { return "HotnessCountdownSlowPathARM64"; }
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(HotnessCountdownSlowPathARM64);
+};
+
 class TypeCheckSlowPathARM64 : public SlowPathCodeARM64 {
  public:
   TypeCheckSlowPathARM64(HInstruction* instruction, bool is_fatal)
@@ -1526,6 +1548,23 @@ void InstructionCodeGeneratorARM64::GenerateSuspendCheck(HSuspendCheck* instruct
     DCHECK_EQ(slow_path->GetSuccessor(), successor);
   }
 
+  if (codegen_->CountsHotness()) {
+    // A suspend check is emitted again at each back edge of its loop, which all need an exit.
+    HotnessCountdownSlowPathARM64* hotness_slow_path =
+        new (GetGraph()->GetArena()) HotnessCountdownSlowPathARM64(instruction);
+    codegen_->AddSlowPath(hotness_slow_path);
+    UseScratchRegisterScope temps(codegen_->GetVIXLAssembler());
+    Register method = temps.AcquireX();
+    Register count = temps.AcquireW();
+    MemOperand count_address(method, ArtMethod::HotnessCountOffset().Int32Value());
+    __ Ldr(method, MemOperand(sp, kCurrentMethodStackOffset));
+    __ Ldrh(count, count_address);
+    __ Subs(count, count, 1);
+    __ Strh(count, count_address);
+    __ B(eq, hotness_slow_path->GetEntryLabel());
+    __ Bind(hotness_slow_path->GetExitLabel());
+  }
+
   UseScratchRegisterScope temps(codegen_->GetVIXLAssembler());
   Register temp = temps.AcquireW();
 
@@ -455,6 +455,8 @@ class CodeGeneratorARM64 : public CodeGenerator {
     return false;
   }
 
+  bool SupportsHotnessCountdown() const OVERRIDE { return true; }
+
   // Check if the desired_string_load_kind is supported. If it is, return it,
   // otherwise return a fall-back kind that should be used instead.
   HLoadString::LoadKind GetSupportedLoadStringKind(
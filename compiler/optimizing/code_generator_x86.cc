@@ -202,6 +202,29 @@ class SuspendCheckSlowPathX86 : public SlowPathCode {
   DISALLOW_COPY_AND_ASSIGN(SuspendCheckSlowPathX86);
 };
 
+class HotnessCountdownSlowPathX86 : public SlowPathCode {
+ public:
+  explicit HotnessCountdownSlowPathX86(HSuspendCheck* instruction) : SlowPathCode(instruction) {}
+
+  void EmitNativeCode(CodeGenerator* codegen) OVERRIDE {
+    CodeGeneratorX86* x86_codegen = down_cast<CodeGeneratorX86*>(codegen);
+    __ Bind(GetEntryLabel());
+    SaveLiveRegisters(codegen, instruction_->GetLocations());
+    x86_codegen->InvokeRuntime(QUICK_ENTRY_POINT(pJitBaselineCodeIsHot),
+                               instruction_,
+                               instruction_->GetDexPc(),
+                               this);
+    CheckEntrypointTypes<kQuickJitBaselineCodeIsHot, void, void>();
+    RestoreLiveRegisters(codegen, instruction_->GetLocations());
+    __ jmp(GetExitLabel());
+  }
+
+  const char* GetDescription() const OVERRIDE { return "HotnessCountdownSlowPathX86"; }
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(HotnessCountdownSlowPathX86);
+};
+
 class LoadStringSlowPathX86 : public SlowPathCode {
  public:
   explicit LoadStringSlowPathX86(HLoadString* instruction): SlowPathCode(instruction) {}
@@ -5599,6 +5622,23 @@ void InstructionCodeGeneratorX86::GenerateSuspendCheck(HSuspendCheck* instructio
     DCHECK_EQ(slow_path->GetSuccessor(), successor);
   }
 
+  if (codegen_->CountsHotness()) {
+    // A suspend check is emitted again at each back edge of its loop, which all need an exit.
+    HotnessCountdownSlowPathX86* hotness_slow_path =
+        new (GetGraph()->GetArena()) HotnessCountdownSlowPathX86(instruction);
+    codegen_->AddSlowPath(hotness_slow_path);
+    // There is no free register here, borrow EAX to load the current method. The flags of the
+    // count are left untouched by the pop.
+    __ pushl(EAX);
+    __ cfi().AdjustCFAOffset(kX86WordSize);
+    __ movl(EAX, Address(ESP, kCurrentMethodStackOffset + kX86WordSize));
+    __ addw(Address(EAX, ArtMethod::HotnessCountOffset().Int32Value()), Immediate(-1));
+    __ popl(EAX);
+    __ cfi().AdjustCFAOffset(-static_cast<int>(kX86WordSize));
+    __ j(kEqual, hotness_slow_path->GetEntryLabel());
+    __ Bind(hotness_slow_path->GetExitLabel());
+  }
+
   __ fs()->cmpw(Address::Absolute(Thread::ThreadFlagsOffset<kX86WordSize>().Int32Value()),
                 Immediate(0));
   if (successor == nullptr) {
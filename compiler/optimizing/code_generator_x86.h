@@ -434,6 +434,8 @@ class CodeGeneratorX86 : public CodeGenerator {
 
   bool ShouldSplitLongMoves() const OVERRIDE { return true; }
 
+  bool SupportsHotnessCountdown() const OVERRIDE { return true; }
+
   Label* GetFrameEntryLabel() { return &frame_entry_label_; }
 
   const X86InstructionSetFeatures& GetInstructionSetFeatures() const {
@@ -180,6 +180,30 @@ class SuspendCheckSlowPathX86_64 : public SlowPathCode {
   DISALLOW_COPY_AND_ASSIGN(SuspendCheckSlowPathX86_64);
 };
 
+class HotnessCountdownSlowPathX86_64 : public SlowPathCode {
+ public:
+  explicit HotnessCountdownSlowPathX86_64(HSuspendCheck* instruction)
+      : SlowPathCode(instruction) {}
+
+  void EmitNativeCode(CodeGenerator* codegen) OVERRIDE {
+    CodeGeneratorX86_64* x86_64_codegen = down_cast<CodeGeneratorX86_64*>(codegen);
+    __ Bind(GetEntryLabel());
+    SaveLiveRegisters(codegen, instruction_->GetLocations());
+    x86_64_codegen->InvokeRuntime(QUICK_ENTRY_POINT(pJitBaselineCodeIsHot),
+                                  instruction_,
+                                  instruction_->GetDexPc(),
+                                  this);
+    CheckEntrypointTypes<kQuickJitBaselineCodeIsHot, void, void>();
+    RestoreLiveRegisters(codegen, instruction_->GetLocations());
+    __ jmp(GetExitLabel());
+  }
+
+  const char* GetDescription() const OVERRIDE { return "HotnessCountdownSlowPathX86_64"; }
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(HotnessCountdownSlowPathX86_64);
+};
+
 class BoundsCheckSlowPathX86_64 : public SlowPathCode {
  public:
   explicit BoundsCheckSlowPathX86_64(HBoundsCheck* instruction)
@@ -5094,6 +5118,18 @@ void InstructionCodeGeneratorX86_64::GenerateSuspendCheck(HSuspendCheck* instruc
     DCHECK_EQ(slow_path->GetSuccessor(), successor);
   }
 
+  if (codegen_->CountsHotness()) {
+    // A suspend check is emitted again at each back edge of its loop, which all need an exit.
+    HotnessCountdownSlowPathX86_64* hotness_slow_path =
+        new (GetGraph()->GetArena()) HotnessCountdownSlowPathX86_64(instruction);
+    codegen_->AddSlowPath(hotness_slow_path);
+    __ movq(CpuRegister(TMP), Address(CpuRegister(RSP), kCurrentMethodStackOffset));
+    __ addw(Address(CpuRegister(TMP), ArtMethod::HotnessCountOffset().Int32Value()),
+            Immediate(-1));
+    __ j(kEqual, hotness_slow_path->GetEntryLabel());
+    __ Bind(hotness_slow_path->GetExitLabel());
+  }
+
   __ gs()->cmpw(Address::Absolute(Thread::ThreadFlagsOffset<kX86_64WordSize>().Int32Value(),
                                   /* no_rip */ true),
                 Immediate(0));
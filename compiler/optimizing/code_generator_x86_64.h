@@ -383,6 +383,8 @@ class CodeGeneratorX86_64 : public CodeGenerator {
     return false;
   }
 
+  bool SupportsHotnessCountdown() const OVERRIDE { return true; }
+
   // Check if the desired_string_load_kind is supported. If it is, return it,
   // otherwise return a fall-back kind that should be used instead.
   HLoadString::LoadKind GetSupportedLoadStringKind(
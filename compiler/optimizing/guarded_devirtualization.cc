@@ -0,0 +1,230 @@
+/*
+ * Copyright (C) 2016 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "guarded_devirtualization.h"
+
+#include "art_method-inl.h"
+#include "class_linker.h"
+#include "driver/compiler_driver.h"
+#include "driver/dex_compilation_unit.h"
+#include "imtable.h"
+#include "inliner.h"
+#include "jit/jit.h"
+#include "jit/jit_code_cache.h"
+#include "jit/profiling_info.h"
+#include "nodes.h"
+#include "reference_type_propagation.h"
+#include "runtime.h"
+#include "scoped_thread_state_change.h"
+#include "thread.h"
+
+namespace art {
+
+// Maximum number of direct calls added in front of a virtual or interface call.
+static constexpr size_t kMaximumNumberOfGuardedTargets = 2;
+
+// Minimum percentage of the receivers of a call site that a target must have been called for
+// to get a direct call. The receivers of other targets go through one more guard each.
+static constexpr uint32_t kMinimumTargetPercentage = 30;
+
+void HGuardedDevirtualization::Run() {
+  // Inline caches name classes and methods of the current process, which saved code cannot
+  // refer to.
+  if (!Runtime::Current()->UseJitCompilation() || compiler_driver_->IsJitCodePersistent()) {
+    return;
+  }
+  if (graph_->IsDebuggable()) {
+    // Like the inliner, keep the calls of debuggable code as the dex code has them.
+    return;
+  }
+  if (graph_->GetInstructionSet() == kMips64) {
+    // TODO: Support HClassTableGet for mips64.
+    return;
+  }
+
+  // The guards split the blocks of the calls, so collect the calls first.
+  ArenaVector<HInvoke*> invokes(graph_->GetArena()->Adapter(kArenaAllocOptimization));
+  for (HBasicBlock* block : graph_->GetReversePostOrder()) {
+    for (HInstructionIterator it(block->GetInstructions()); !it.Done(); it.Advance()) {
+      HInstruction* instruction = it.Current();
+      if ((instruction->IsInvokeVirtual() || instruction->IsInvokeInterface()) &&
+          instruction->AsInvoke()->GetIntrinsic() == Intrinsics::kNone) {
+        invokes.push_back(instruction->AsInvoke());
+      }
+    }
+  }
+  if (invokes.empty()) {
+    return;
+  }
+
+  ArtMethod* method = graph_->GetArtMethod();
+  // Under JIT, we should always know the method.
+  DCHECK(method != nullptr);
+  ScopedObjectAccess soa(Thread::Current());
+  jit::JitCodeCache* code_cache = Runtime::Current()->GetJit()->GetCodeCache();
+  // Keep the code cache from clearing the inline caches while we read them.
+  ProfilingInfo* profiling_info = code_cache->NotifyCompilerUse(method, soa.Self());
+  if (profiling_info == nullptr) {
+    return;
+  }
+  bool devirtualized = false;
+  for (HInvoke* invoke : invokes) {
+    InlineCache* ic = profiling_info->GetInlineCache(invoke->GetDexPc());
+    if (ic != nullptr && TryDevirtualize(invoke, *ic)) {
+      devirtualized = true;
+    }
+  }
+  code_cache->DoneCompilerUse(method, soa.Self());
+
+  if (devirtualized) {
+    // Run type propagation to get the guards and the direct calls typed.
+    ReferenceTypePropagation rtp_fixup(graph_,
+                                       compilation_unit_.GetDexCache(),
+                                       handles_,
+                                       /* is_first_run */ false);
+    rtp_fixup.Run();
+  }
+}
+
+bool HGuardedDevirtualization::TryDevirtualize(HInvoke* invoke, const InlineCache& ic) {
+  size_t pointer_size = Runtime::Current()->GetClassLinker()->GetImagePointerSize();
+  // Count the receivers per target, classes which do not override the method share one.
+  ArtMethod* targets[InlineCache::kIndividualCacheSize];
+  uint32_t counts[InlineCache::kIndividualCacheSize];
+  size_t number_of_targets = 0;
+  uint32_t total_count = ic.GetUntrackedCount();
+  for (size_t i = 0; i < InlineCache::kIndividualCacheSize; ++i) {
+    mirror::Class* type = ic.GetTypeAt(i);
+    if (type == nullptr) {
+      break;
+    }
+    uint32_t count = ic.GetCountAt(i);
+    total_count += count;
+    ArtMethod* target;
+    if (invoke->IsInvokeInterface()) {
+      target = type->GetImt(pointer_size)->Get(
+          invoke->AsInvokeInterface()->GetImtIndex() % ImTable::kSize, pointer_size);
+    } else {
+      DCHECK(invoke->IsInvokeVirtual());
+      target = type->GetEmbeddedVTableEntry(invoke->AsInvokeVirtual()->GetVTableIndex(),
+                                            pointer_size);
+    }
+    DCHECK(target != nullptr);
+    if (target->IsRuntimeMethod() || !target->IsInvokable()) {
+      // Leave IMT conflicts and methods throwing errors to the original call.
+      continue;
+    }
+    size_t index = 0;
+    while (index < number_of_targets && targets[index] != target) {
+      ++index;
+    }
+    if (index == number_of_targets) {
+      targets[number_of_targets] = target;
+      counts[number_of_targets] = 0;
+      ++number_of_targets;
+    }
+    counts[index] += count;
+  }
+
+  // Guard the most frequent target first.
+  size_t number_of_guards = 0;
+  while (number_of_guards < kMaximumNumberOfGuardedTargets) {
+    size_t best = number_of_targets;
+    for (size_t i = 0; i < number_of_targets; ++i) {
+      if (counts[i] != 0 && (best == number_of_targets || counts[i] > counts[best])) {
+        best = i;
+      }
+    }
+    if (best == number_of_targets ||
+        counts[best] * 100u < total_count * kMinimumTargetPercentage) {
+      break;
+    }
+    AddGuardedDirectCall(invoke, targets[best]);
+    counts[best] = 0;
+    ++number_of_guards;
+  }
+  MaybeRecordStat(kGuardedDirectCall, number_of_guards);
+  return number_of_guards != 0;
+}
+
+void HGuardedDevirtualization::AddGuardedDirectCall(HInvoke* invoke, ArtMethod* target) {
+  ArenaAllocator* arena = graph_->GetArena();
+  uint32_t dex_pc = invoke->GetDexPc();
+  HInstruction* cursor = invoke->GetPrevious();
+  HBasicBlock* bb_cursor = invoke->GetBlock();
+
+  // Look up the method the receiver dispatches to, as the call would.
+  HInstanceFieldGet* receiver_class = HInliner::BuildGetReceiverClass(
+      graph_, handles_, Runtime::Current()->GetClassLinker(), invoke->InputAt(0), dex_pc);
+  Primitive::Type type = Is64BitInstructionSet(graph_->GetInstructionSet())
+      ? Primitive::kPrimLong
+      : Primitive::kPrimInt;
+  HClassTableGet* class_table_get = new (arena) HClassTableGet(
+      receiver_class,
+      type,
+      invoke->IsInvokeVirtual() ? HClassTableGet::TableKind::kVTable
+                                : HClassTableGet::TableKind::kIMTable,
+      invoke->IsInvokeVirtual() ? invoke->AsInvokeVirtual()->GetVTableIndex()
+                                : invoke->AsInvokeInterface()->GetImtIndex(),
+      dex_pc);
+  HConstant* constant;
+  if (type == Primitive::kPrimLong) {
+    constant = graph_->GetLongConstant(reinterpret_cast<intptr_t>(target), dex_pc);
+  } else {
+    constant = graph_->GetIntConstant(reinterpret_cast<intptr_t>(target), dex_pc);
+  }
+  HNotEqual* compare = new (arena) HNotEqual(class_table_get, constant);
+  if (cursor != nullptr) {
+    bb_cursor->InsertInstructionAfter(receiver_class, cursor);
+  } else {
+    bb_cursor->InsertInstructionBefore(receiver_class, bb_cursor->GetFirstInstruction());
+  }
+  bb_cursor->InsertInstructionAfter(class_table_get, receiver_class);
+  bb_cursor->InsertInstructionAfter(compare, class_table_get);
+
+  // The direct call goes between the guard and the original call, which makes it the then
+  // branch of the diamond.
+  HInvokeStaticOrDirect::DispatchInfo dispatch_info = {
+      HInvokeStaticOrDirect::MethodLoadKind::kDirectAddress,
+      HInvokeStaticOrDirect::CodePtrLocation::kCallArtMethod,
+      reinterpret_cast<uintptr_t>(target),
+      0u
+  };
+  HInvokeStaticOrDirect* direct_call = new (arena) HInvokeStaticOrDirect(
+      arena,
+      invoke->GetNumberOfArguments(),
+      invoke->GetType(),
+      dex_pc,
+      invoke->GetDexMethodIndex(),
+      MethodReference(&graph_->GetDexFile(), invoke->GetDexMethodIndex()),
+      dispatch_info,
+      invoke->GetOriginalInvokeType(),
+      kDirect,
+      HInvokeStaticOrDirect::ClinitCheckRequirement::kNone);
+  for (size_t i = 0; i < invoke->GetNumberOfArguments(); ++i) {
+    direct_call->SetArgumentAt(i, invoke->InputAt(i));
+  }
+  bb_cursor->InsertInstructionBefore(direct_call, invoke);
+  direct_call->CopyEnvironmentFrom(invoke->GetEnvironment());
+
+  HInliner::CreateDiamondPatternForPolymorphicInline(
+      graph_,
+      compare,
+      invoke->GetType() == Primitive::kPrimVoid ? nullptr : direct_call,
+      invoke);
+}
+
+}  // namespace art
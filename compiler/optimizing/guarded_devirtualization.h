@@ -0,0 +1,76 @@
+/*
+ * Copyright (C) 2016 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ART_COMPILER_OPTIMIZING_GUARDED_DEVIRTUALIZATION_H_
+#define ART_COMPILER_OPTIMIZING_GUARDED_DEVIRTUALIZATION_H_
+
+#include "optimization.h"
+
+namespace art {
+
+class CompilerDriver;
+class DexCompilationUnit;
+class InlineCache;
+
+// Optimization that calls the most frequent targets of a virtual or interface call directly,
+// based on the receiver counts of the inline caches of the JIT. Each direct call is guarded by
+// a comparison with the method found in the vtable or IMT of the receiver's class, and the
+// original call handles the other receivers:
+//
+//   if (receiver.klass.vtable[index] != target) {
+//     invoke-virtual receiver, ...
+//   } else {
+//     invoke-direct target, receiver, ...
+//   }
+//
+// Unlike the inliner, this also helps megamorphic call sites with a dominant target.
+class HGuardedDevirtualization : public HOptimization {
+ public:
+  HGuardedDevirtualization(HGraph* graph,
+                           const DexCompilationUnit& compilation_unit,
+                           CompilerDriver* compiler_driver,
+                           StackHandleScopeCollection* handles,
+                           OptimizingCompilerStats* stats)
+      : HOptimization(graph, kGuardedDevirtualizationPassName, stats),
+        compilation_unit_(compilation_unit),
+        compiler_driver_(compiler_driver),
+        handles_(handles) { }
+
+  void Run() OVERRIDE;
+
+  static constexpr const char* kGuardedDevirtualizationPassName = "guarded_devirtualization";
+
+ private:
+  // Add guarded direct calls of the targets of `invoke` which got enough of the receivers
+  // counted in `ic`. Return whether any was added.
+  bool TryDevirtualize(HInvoke* invoke, const InlineCache& ic)
+      SHARED_REQUIRES(Locks::mutator_lock_);
+
+  // Add a direct call of `target` in front of `invoke`, taken when the receiver dispatches to
+  // `target`.
+  void AddGuardedDirectCall(HInvoke* invoke, ArtMethod* target)
+      SHARED_REQUIRES(Locks::mutator_lock_);
+
+  const DexCompilationUnit& compilation_unit_;
+  CompilerDriver* const compiler_driver_;
+  StackHandleScopeCollection* const handles_;
+
+  DISALLOW_COPY_AND_ASSIGN(HGuardedDevirtualization);
+};
+
+}  // namespace art
+
+#endif  // ART_COMPILER_OPTIMIZING_GUARDED_DEVIRTUALIZATION_H_
@@ -301,7 +301,8 @@ bool HInliner::TryInline(HInvoke* invoke_instruction) {
 
   // Check if we can use an inline cache.
   ArtMethod* caller = graph_->GetArtMethod();
-  if (Runtime::Current()->UseJitCompilation()) {
+  // Inline caches name classes of the current process, which saved code cannot guard against.
+  if (Runtime::Current()->UseJitCompilation() && !compiler_driver_->IsJitCodePersistent()) {
     // Under JIT, we should always know the caller.
     DCHECK(caller != nullptr);
     ScopedProfilingInfoInlineUse spiis(caller, soa.Self());
@@ -342,12 +343,14 @@ bool HInliner::TryInline(HInvoke* invoke_instruction) {
   return false;
 }
 
-HInstanceFieldGet* HInliner::BuildGetReceiverClass(ClassLinker* class_linker,
+HInstanceFieldGet* HInliner::BuildGetReceiverClass(HGraph* graph,
+                                                   StackHandleScopeCollection* handles,
+                                                   ClassLinker* class_linker,
                                                    HInstruction* receiver,
-                                                   uint32_t dex_pc) const {
+                                                   uint32_t dex_pc) {
   ArtField* field = class_linker->GetClassRoot(ClassLinker::kJavaLangObject)->GetInstanceField(0);
   DCHECK_EQ(std::string(field->GetName()), "shadow$_klass_");
-  HInstanceFieldGet* result = new (graph_->GetArena()) HInstanceFieldGet(
+  HInstanceFieldGet* result = new (graph->GetArena()) HInstanceFieldGet(
       receiver,
       Primitive::kPrimNot,
       field->GetOffset(),
@@ -355,7 +358,7 @@ HInstanceFieldGet* HInliner::BuildGetReceiverClass(ClassLinker* class_linker,
       field->GetDexFieldIndex(),
       field->GetDeclaringClass()->GetDexClassDefIndex(),
       *field->GetDexFile(),
-      handles_->NewHandle(field->GetDexCache()),
+      handles->NewHandle(field->GetDexCache()),
       dex_pc);
   // The class of a field is effectively final, and does not have any memory dependencies.
   result->SetSideEffects(SideEffects::None());
@@ -429,18 +432,21 @@ HInstruction* HInliner::AddTypeGuard(HInstruction* receiver,
                                      bool with_deoptimization) {
   ClassLinker* class_linker = caller_compilation_unit_.GetClassLinker();
   HInstanceFieldGet* receiver_class = BuildGetReceiverClass(
-      class_linker, receiver, invoke_instruction->GetDexPc());
+      graph_, handles_, class_linker, receiver, invoke_instruction->GetDexPc());
 
   const DexFile& caller_dex_file = *caller_compilation_unit_.GetDexFile();
   // Note that we will just compare the classes, so we don't need Java semantics access checks.
   // Also, the caller of `AddTypeGuard` must have guaranteed that the class is in the dex cache.
+  // Ahead of time, the class may not be resolved yet when the code runs.
+  bool is_in_dex_cache = compiler_driver_->CanAssumeTypeIsPresentInDexCache(
+      caller_compilation_unit_.GetDexCache(), class_index);
   HLoadClass* load_class = new (graph_->GetArena()) HLoadClass(graph_->GetCurrentMethod(),
                                                                class_index,
                                                                caller_dex_file,
                                                                is_referrer,
                                                                invoke_instruction->GetDexPc(),
                                                                /* needs_access_check */ false,
-                                                               /* is_in_dex_cache */ true);
+                                                               is_in_dex_cache);
 
   HNotEqual* compare = new (graph_->GetArena()) HNotEqual(load_class, receiver_class);
   // TODO: Extend reference type propagation to understand the guard.
@@ -525,7 +531,8 @@ bool HInliner::TryInlinePolymorphicCall(HInvoke* invoke_instruction,
         // iteration. Otherhwise, we could see a new receiver type.
         break;
       } else {
-        CreateDiamondPatternForPolymorphicInline(compare, return_replacement, invoke_instruction);
+        CreateDiamondPatternForPolymorphicInline(
+            graph_, compare, return_replacement, invoke_instruction);
       }
     }
   }
@@ -547,13 +554,14 @@ bool HInliner::TryInlinePolymorphicCall(HInvoke* invoke_instruction,
   return true;
 }
 
-void HInliner::CreateDiamondPatternForPolymorphicInline(HInstruction* compare,
+void HInliner::CreateDiamondPatternForPolymorphicInline(HGraph* graph,
+                                                        HInstruction* compare,
                                                         HInstruction* return_replacement,
                                                         HInstruction* invoke_instruction) {
   uint32_t dex_pc = invoke_instruction->GetDexPc();
   HBasicBlock* cursor_block = compare->GetBlock();
   HBasicBlock* original_invoke_block = invoke_instruction->GetBlock();
-  ArenaAllocator* allocator = graph_->GetArena();
+  ArenaAllocator* allocator = graph->GetArena();
 
   // Spit the block after the compare: `cursor_block` will now be the start of the diamond,
   // and the returned block is the start of the then branch (that could contain multiple blocks).
@@ -584,9 +592,9 @@ void HInliner::CreateDiamondPatternForPolymorphicInline(HInstruction* compare,
   cursor_block->AddInstruction(new (allocator) HIf(compare, dex_pc));
 
   // Add the newly created blocks to the graph.
-  graph_->AddBlock(then);
-  graph_->AddBlock(otherwise);
-  graph_->AddBlock(merge);
+  graph->AddBlock(then);
+  graph->AddBlock(otherwise);
+  graph->AddBlock(merge);
 
   // Set up successor (and implictly predecessor) relations.
   cursor_block->AddSuccessor(otherwise);
@@ -603,23 +611,23 @@ void HInliner::CreateDiamondPatternForPolymorphicInline(HInstruction* compare,
   cursor_block->AddDominatedBlock(merge);
 
   // Update the revert post order.
-  size_t index = IndexOfElement(graph_->reverse_post_order_, cursor_block);
-  MakeRoomFor(&graph_->reverse_post_order_, 1, index);
-  graph_->reverse_post_order_[++index] = then;
-  index = IndexOfElement(graph_->reverse_post_order_, end_then);
-  MakeRoomFor(&graph_->reverse_post_order_, 2, index);
-  graph_->reverse_post_order_[++index] = otherwise;
-  graph_->reverse_post_order_[++index] = merge;
+  size_t index = IndexOfElement(graph->reverse_post_order_, cursor_block);
+  MakeRoomFor(&graph->reverse_post_order_, 1, index);
+  graph->reverse_post_order_[++index] = then;
+  index = IndexOfElement(graph->reverse_post_order_, end_then);
+  MakeRoomFor(&graph->reverse_post_order_, 2, index);
+  graph->reverse_post_order_[++index] = otherwise;
+  graph->reverse_post_order_[++index] = merge;
 
 
-  graph_->UpdateLoopAndTryInformationOfNewBlock(
+  graph->UpdateLoopAndTryInformationOfNewBlock(
       then, original_invoke_block, /* replace_if_back_edge */ false);
-  graph_->UpdateLoopAndTryInformationOfNewBlock(
+  graph->UpdateLoopAndTryInformationOfNewBlock(
       otherwise, original_invoke_block, /* replace_if_back_edge */ false);
 
   // In case the original invoke location was a back edge, we need to update
   // the loop to now have the merge block as a back edge.
-  graph_->UpdateLoopAndTryInformationOfNewBlock(
+  graph->UpdateLoopAndTryInformationOfNewBlock(
       merge, original_invoke_block, /* replace_if_back_edge */ true);
 }
 
@@ -683,7 +691,7 @@ bool HInliner::TryInlinePolymorphicCallToSameTarget(HInvoke* invoke_instruction,
 
   // We successfully inlined, now add a guard.
   HInstanceFieldGet* receiver_class = BuildGetReceiverClass(
-      class_linker, receiver, invoke_instruction->GetDexPc());
+      graph_, handles_, class_linker, receiver, invoke_instruction->GetDexPc());
 
   Primitive::Type type = Is64BitInstructionSet(graph_->GetInstructionSet())
       ? Primitive::kPrimLong
@@ -715,7 +723,8 @@ bool HInliner::TryInlinePolymorphicCallToSameTarget(HInvoke* invoke_instruction,
   bb_cursor->InsertInstructionAfter(compare, class_table_get);
 
   if (outermost_graph_->IsCompilingOsr()) {
-    CreateDiamondPatternForPolymorphicInline(compare, return_replacement, invoke_instruction);
+    CreateDiamondPatternForPolymorphicInline(
+        graph_, compare, return_replacement, invoke_instruction);
   } else {
     // TODO: Extend reference type propagation to understand the guard.
     HDeoptimize* deoptimize = new (graph_->GetArena()) HDeoptimize(
@@ -57,6 +57,48 @@ class HInliner : public HOptimization {
 
   static constexpr const char* kInlinerPassName = "inliner";
 
+  // Create a load of the class of `receiver`, to be inserted in `graph`.
+  static HInstanceFieldGet* BuildGetReceiverClass(HGraph* graph,
+                                                  StackHandleScopeCollection* handles,
+                                                  ClassLinker* class_linker,
+                                                  HInstruction* receiver,
+                                                  uint32_t dex_pc)
+    SHARED_REQUIRES(Locks::mutator_lock_);
+
+  /*
+   * Ad-hoc implementation for implementing a diamond pattern in `graph` for
+   * polymorphic inlining and guarded devirtualization:
+   * 1) `compare` becomes the input of the new `HIf`.
+   * 2) Everything up until `invoke_instruction` is in the then branch (could
+   *    contain multiple blocks).
+   * 3) `invoke_instruction` is moved to the otherwise block.
+   * 4) If `return_replacement` is not null, the merge block will have
+   *    a phi whose inputs are `return_replacement` and `invoke_instruction`.
+   *
+   * Before:
+   *             Block1
+   *             compare
+   *              ...
+   *         invoke_instruction
+   *
+   * After:
+   *            Block1
+   *            compare
+   *              if
+   *          /        \
+   *         /          \
+   *   Then block    Otherwise block
+   *      ...       invoke_instruction
+   *       \              /
+   *        \            /
+   *          Merge block
+   *  phi(return_replacement, invoke_instruction)
+   */
+  static void CreateDiamondPatternForPolymorphicInline(HGraph* graph,
+                                                       HInstruction* compare,
+                                                       HInstruction* return_replacement,
+                                                       HInstruction* invoke_instruction);
+
  private:
   bool TryInline(HInvoke* invoke_instruction);
 
@@ -118,12 +160,6 @@ class HInliner : public HOptimization {
                                             const InlineCache& ic)
     SHARED_REQUIRES(Locks::mutator_lock_);
 
-
-  HInstanceFieldGet* BuildGetReceiverClass(ClassLinker* class_linker,
-                                           HInstruction* receiver,
-                                           uint32_t dex_pc) const
-    SHARED_REQUIRES(Locks::mutator_lock_);
-
   void FixUpReturnReferenceType(HInvoke* invoke_instruction,
                                 ArtMethod* resolved_method,
                                 HInstruction* return_replacement,
@@ -148,39 +184,6 @@ class HInliner : public HOptimization {
                              bool with_deoptimization)
     SHARED_REQUIRES(Locks::mutator_lock_);
 
-  /*
-   * Ad-hoc implementation for implementing a diamond pattern in the graph for
-   * polymorphic inlining:
-   * 1) `compare` becomes the input of the new `HIf`.
-   * 2) Everything up until `invoke_instruction` is in the then branch (could
-   *    contain multiple blocks).
-   * 3) `invoke_instruction` is moved to the otherwise block.
-   * 4) If `return_replacement` is not null, the merge block will have
-   *    a phi whose inputs are `return_replacement` and `invoke_instruction`.
-   *
-   * Before:
-   *             Block1
-   *             compare
-   *              ...
-   *         invoke_instruction
-   *
-   * After:
-   *            Block1
-   *            compare
-   *              if
-   *          /        \
-   *         /          \
-   *   Then block    Otherwise block
-   *      ...       invoke_instruction
-   *       \              /
-   *        \            /
-   *          Merge block
-   *  phi(return_replacement, invoke_instruction)
-   */
-  void CreateDiamondPatternForPolymorphicInline(HInstruction* compare,
-                                                HInstruction* return_replacement,
-                                                HInstruction* invoke_instruction);
-
   HGraph* const outermost_graph_;
   const DexCompilationUnit& outer_compilation_unit_;
   const DexCompilationUnit& caller_compilation_unit_;
@@ -56,6 +56,7 @@
 #include "elf_writer_quick.h"
 #include "graph_checker.h"
 #include "graph_visualizer.h"
+#include "guarded_devirtualization.h"
 #include "gvn.h"
 #include "induction_var_analysis.h"
 #include "inliner.h"
@@ -292,7 +293,11 @@ class OptimizingCompiler FINAL : public Compiler {
     }
   }
 
-  bool JitCompile(Thread* self, jit::JitCodeCache* code_cache, ArtMethod* method, bool osr)
+  bool JitCompile(Thread* self,
+                  jit::JitCodeCache* code_cache,
+                  ArtMethod* method,
+                  bool osr,
+                  bool baseline)
       OVERRIDE
       SHARED_REQUIRES(Locks::mutator_lock_);
 
@@ -309,7 +314,9 @@ class OptimizingCompiler FINAL : public Compiler {
   // This method:
   // 1) Builds the graph. Returns null if it failed to build it.
   // 2) Transforms the graph to SSA. Returns null if it failed.
-  // 3) Runs optimizations on the graph, including register allocator.
+  // 3) Runs optimizations on the graph, including register allocator. Baseline code
+  //    only gets the optimizations the code generator relies on, and counts the
+  //    hotness of the method.
   // 4) Generates code with the `code_allocator` provided.
   CodeGenerator* TryCompile(ArenaAllocator* arena,
                             CodeVectorAllocator* code_allocator,
@@ -322,7 +329,8 @@ class OptimizingCompiler FINAL : public Compiler {
                             const DexFile& dex_file,
                             Handle<mirror::DexCache> dex_cache,
                             ArtMethod* method,
-                            bool osr) const;
+                            bool osr,
+                            bool baseline) const;
 
   std::unique_ptr<OptimizingCompilerStats> compilation_stats_;
 
@@ -525,6 +533,8 @@ static void RunOptimizations(HGraph* graph,
   InstructionSimplifier* simplify3 = new (arena) InstructionSimplifier(
       graph, stats, "instruction_simplifier_before_codegen");
   IntrinsicsRecognizer* intrinsics = new (arena) IntrinsicsRecognizer(graph, driver, stats);
+  HGuardedDevirtualization* devirtualization = new (arena) HGuardedDevirtualization(
+      graph, dex_compilation_unit, driver, handles, stats);
 
   HOptimization* optimizations1[] = {
     intrinsics,
@@ -538,6 +548,9 @@ static void RunOptimizations(HGraph* graph,
   MaybeRunInliner(graph, codegen, driver, stats, dex_compilation_unit, pass_observer, handles);
 
   HOptimization* optimizations2[] = {
+    // Calls left virtual by the inliner can still be called directly for their most frequent
+    // receivers.
+    devirtualization,
     // SelectGenerator depends on the InstructionSimplifier removing
     // redundant suspend checks to recognize empty blocks.
     select_generator,
@@ -562,6 +575,36 @@ static void RunOptimizations(HGraph* graph,
   AllocateRegisters(graph, codegen, pass_observer);
 }
 
+// Baseline code of the JIT only gets the optimizations which are both cheap and local: no
+// inlining, no loop optimizations, no bounds check or load store elimination. The method is
+// recompiled with RunOptimizations once the baseline code has made it hot.
+static void RunBaselineOptimizations(HGraph* graph,
+                                     CodeGenerator* codegen,
+                                     CompilerDriver* driver,
+                                     OptimizingCompilerStats* stats,
+                                     const DexCompilationUnit& dex_compilation_unit,
+                                     PassObserver* pass_observer) {
+  ArenaAllocator* arena = graph->GetArena();
+  IntrinsicsRecognizer* intrinsics = new (arena) IntrinsicsRecognizer(graph, driver, stats);
+  HSharpening* sharpening = new (arena) HSharpening(graph, codegen, dex_compilation_unit, driver);
+  HDeadCodeElimination* dce = new (arena) HDeadCodeElimination(
+      graph, stats, HDeadCodeElimination::kFinalDeadCodeEliminationPassName);
+  InstructionSimplifier* simplify = new (arena) InstructionSimplifier(
+      graph, stats, "instruction_simplifier_before_codegen");
+
+  HOptimization* optimizations[] = {
+    intrinsics,
+    sharpening,
+    dce,
+    // The codegen relies on the instruction simplifier, see RunOptimizations.
+    simplify,
+  };
+  RunOptimizations(optimizations, arraysize(optimizations), pass_observer);
+
+  RunArchOptimizations(driver->GetInstructionSet(), graph, codegen, stats, pass_observer);
+  AllocateRegisters(graph, codegen, pass_observer);
+}
+
 static ArenaVector<LinkerPatch> EmitAndSortLinkerPatches(CodeGenerator* codegen) {
   ArenaVector<LinkerPatch> linker_patches(codegen->GetGraph()->GetArena()->Adapter());
   codegen->EmitLinkerPatches(&linker_patches);
@@ -614,7 +657,8 @@ CodeGenerator* OptimizingCompiler::TryCompile(ArenaAllocator* arena,
                                               const DexFile& dex_file,
                                               Handle<mirror::DexCache> dex_cache,
                                               ArtMethod* method,
-                                              bool osr) const {
+                                              bool osr,
+                                              bool baseline) const {
   MaybeRecordStat(MethodCompilationStat::kAttemptCompilation);
   CompilerDriver* compiler_driver = GetCompilerDriver();
   InstructionSet instruction_set = compiler_driver->GetInstructionSet();
@@ -718,6 +762,12 @@ CodeGenerator* OptimizingCompiler::TryCompile(ArenaAllocator* arena,
   }
   codegen->GetAssembler()->cfi().SetEnabled(
       compiler_driver->GetCompilerOptions().GenerateAnyDebugInfo());
+  // Baseline code which does not count the hotness of the method would never be replaced, so
+  // the method gets optimized code right away on architectures which cannot count it.
+  if (baseline && codegen->SupportsHotnessCountdown()) {
+    DCHECK(!osr);
+    codegen->SetCountsHotness();
+  }
 
   PassObserver pass_observer(graph,
                              codegen.get(),
@@ -767,13 +817,22 @@ CodeGenerator* OptimizingCompiler::TryCompile(ArenaAllocator* arena,
       }
     }
 
-    RunOptimizations(graph,
-                     codegen.get(),
-                     compiler_driver,
-                     compilation_stats_.get(),
-                     dex_compilation_unit,
-                     &pass_observer,
-                     &handles);
+    if (codegen->CountsHotness()) {
+      RunBaselineOptimizations(graph,
+                               codegen.get(),
+                               compiler_driver,
+                               compilation_stats_.get(),
+                               dex_compilation_unit,
+                               &pass_observer);
+    } else {
+      RunOptimizations(graph,
+                       codegen.get(),
+                       compiler_driver,
+                       compilation_stats_.get(),
+                       dex_compilation_unit,
+                       &pass_observer,
+                       &handles);
+    }
 
     codegen->Compile(code_allocator);
     pass_observer.DumpDisassembly();
@@ -812,7 +871,8 @@ CompiledMethod* OptimizingCompiler::Compile(const DexFile::CodeItem* code_item,
                    dex_file,
                    dex_cache,
                    nullptr,
-                   /* osr */ false));
+                   /* osr */ false,
+                   /* baseline */ false));
     if (codegen.get() != nullptr) {
       MaybeRecordStat(MethodCompilationStat::kCompiled);
       method = Emit(&arena, &code_allocator, codegen.get(), compiler_driver, code_item);
@@ -866,7 +926,8 @@ bool IsCompilingWithCoreImage() {
 bool OptimizingCompiler::JitCompile(Thread* self,
                                     jit::JitCodeCache* code_cache,
                                     ArtMethod* method,
-                                    bool osr) {
+                                    bool osr,
+                                    bool baseline) {
   StackHandleScope<2> hs(self);
   Handle<mirror::ClassLoader> class_loader(hs.NewHandle(
       method->GetDeclaringClass()->GetClassLoader()));
@@ -899,7 +960,8 @@ bool OptimizingCompiler::JitCompile(Thread* self,
                    *dex_file,
                    dex_cache,
                    method,
-                   osr));
+                   osr,
+                   baseline));
     if (codegen.get() == nullptr) {
       return false;
     }
@@ -928,7 +990,8 @@ bool OptimizingCompiler::JitCompile(Thread* self,
       codegen->GetFpuSpillMask(),
       code_allocator.GetMemory().data(),
       code_allocator.GetSize(),
-      osr);
+      osr,
+      /* baseline */ codegen->CountsHotness());
 
   if (code == nullptr) {
     code_cache->ClearData(self, stack_map_data);
@@ -960,7 +1023,9 @@ bool OptimizingCompiler::JitCompile(Thread* self,
         GetCompilerDriver()->GetInstructionSet(),
         GetCompilerDriver()->GetInstructionSetFeatures(),
         ArrayRef<const debug::MethodDebugInfo>(&info, 1));
-    CreateJITCodeEntryForAddress(code_address, std::move(elf_file));
+    CreateJITCodeEntryForAddress(code_address,
+                                 std::move(elf_file),
+                                 std::vector<uint8_t>(info.cfi.begin(), info.cfi.end()));
   }
 
   Runtime::Current()->GetJit()->AddMemoryUsage(method, arena.BytesUsed());
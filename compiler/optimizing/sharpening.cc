@@ -187,6 +187,10 @@ void HSharpening::ProcessLoadString(HLoadString* load_string) {
             ? HLoadString::LoadKind::kBootImageLinkTimePcRelative
             : HLoadString::LoadKind::kBootImageLinkTimeAddress;
       }
+    } else if (compiler_driver_->IsJitCodePersistent()) {
+      // Saved code may run in another process, where the strings and the dex cache are
+      // elsewhere and the string may not be resolved yet.
+      desired_load_kind = HLoadString::LoadKind::kDexCacheViaMethod;
     } else if (runtime->UseJitCompilation()) {
       // TODO: Make sure we don't set the "compile PIC" flag for JIT as that's bogus.
       // DCHECK(!codegen_->GetCompilerOptions().GetCompilePic());
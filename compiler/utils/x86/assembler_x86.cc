@@ -1202,6 +1202,23 @@ void X86Assembler::addl(const Address& address, const Immediate& imm) {
 }
 
 
+void X86Assembler::addw(const Address& address, const Immediate& imm) {
+  AssemblerBuffer::EnsureCapacity ensured(&buffer_);
+  CHECK(imm.is_uint16() || imm.is_int16()) << imm.value();
+  EmitOperandSizeOverride();
+  if (imm.is_int8()) {
+    EmitUint8(0x83);
+    EmitOperand(0, address);
+    EmitUint8(imm.value() & 0xFF);
+  } else {
+    EmitUint8(0x81);
+    EmitOperand(0, address);
+    EmitUint8(imm.value() & 0xFF);
+    EmitUint8(imm.value() >> 8);
+  }
+}
+
+
 void X86Assembler::adcl(Register reg, const Immediate& imm) {
   AssemblerBuffer::EnsureCapacity ensured(&buffer_);
   EmitComplex(2, Operand(reg), imm);
@@ -122,6 +122,18 @@ TEST_F(AssemblerX86Test, Movntl) {
   DriverStr(expected, "movntl");
 }
 
+TEST_F(AssemblerX86Test, Addw) {
+  GetAssembler()->addw(x86::Address(x86::EAX, 0), x86::Immediate(-1));
+  GetAssembler()->addw(x86::Address(x86::EDI, 14), x86::Immediate(1));
+  GetAssembler()->addw(x86::Address(x86::ESP, 0), x86::Immediate(0x1234));
+  const char* expected =
+    "addw $-1, (%EAX)\n"
+    "addw $1, 14(%EDI)\n"
+    "addw $0x1234, (%ESP)\n";
+
+  DriverStr(expected, "addw");
+}
+
 TEST_F(AssemblerX86Test, psrlq) {
   GetAssembler()->psrlq(x86::XMM0, CreateImmediate(32));
   const char* expected = "psrlq $0x20, %xmm0\n";
@@ -1619,6 +1619,24 @@ void X86_64Assembler::addl(const Address& address, const Immediate& imm) {
 }
 
 
+void X86_64Assembler::addw(const Address& address, const Immediate& imm) {
+  AssemblerBuffer::EnsureCapacity ensured(&buffer_);
+  CHECK(imm.is_uint16() || imm.is_int16()) << imm.value();
+  EmitOperandSizeOverride();
+  EmitOptionalRex32(address);
+  if (imm.is_int8()) {
+    EmitUint8(0x83);
+    EmitOperand(0, address);
+    EmitUint8(imm.value() & 0xFF);
+  } else {
+    EmitUint8(0x81);
+    EmitOperand(0, address);
+    EmitUint8(imm.value() & 0xFF);
+    EmitUint8(imm.value() >> 8);
+  }
+}
+
+
 void X86_64Assembler::subl(CpuRegister dst, CpuRegister src) {
   AssemblerBuffer::EnsureCapacity ensured(&buffer_);
   EmitOptionalRex32(dst, src);
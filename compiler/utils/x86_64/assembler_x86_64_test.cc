@@ -771,6 +771,20 @@ TEST_F(AssemblerX86_64Test, Movw) {
   DriverStr(expected, "movw");
 }
 
+TEST_F(AssemblerX86_64Test, Addw) {
+  GetAssembler()->addw(x86_64::Address(x86_64::CpuRegister(x86_64::RAX), 0),
+                       x86_64::Immediate(-1));
+  GetAssembler()->addw(x86_64::Address(x86_64::CpuRegister(x86_64::R9), 14),
+                       x86_64::Immediate(1));
+  GetAssembler()->addw(x86_64::Address(x86_64::CpuRegister(x86_64::R14), 0),
+                       x86_64::Immediate(0x1234));
+  const char* expected =
+      "addw $-1, 0(%RAX)\n"
+      "addw $1, 14(%R9)\n"
+      "addw $0x1234, 0(%R14)\n";
+  DriverStr(expected, "addw");
+}
+
 TEST_F(AssemblerX86_64Test, Cmpw) {
   GetAssembler()->cmpw(x86_64::Address(x86_64::CpuRegister(x86_64::RAX), 0),
                        x86_64::Immediate(0));
@@ -32,8 +32,9 @@ ProfileAssistant::ProcessingResult ProfileAssistant::ProcessProfilesInternal(
   DCHECK(!profile_files.empty());
 
   ProfileCompilationInfo info;
-  // Load the reference profile.
-  if (!info.Load(reference_profile_file.GetFile()->Fd())) {
+  // Load the reference profile. A profile of an older version is treated as empty, and replaced.
+  bool reference_profile_is_obsolete = false;
+  if (!info.Load(reference_profile_file.GetFile()->Fd(), &reference_profile_is_obsolete)) {
     LOG(WARNING) << "Could not load reference profile file";
     return kErrorBadProfiles;
   }
@@ -42,21 +43,25 @@ ProfileAssistant::ProcessingResult ProfileAssistant::ProcessProfilesInternal(
   uint32_t number_of_methods = info.GetNumberOfMethods();
   uint32_t number_of_classes = info.GetNumberOfResolvedClasses();
 
-  // Merge all current profiles.
+  // Merge all current profiles. The runtime replaces the current profiles of an older version.
   for (size_t i = 0; i < profile_files.size(); i++) {
-    if (!info.Load(profile_files[i].GetFile()->Fd())) {
+    bool is_obsolete = false;
+    if (!info.Load(profile_files[i].GetFile()->Fd(), &is_obsolete)) {
       LOG(WARNING) << "Could not load profile file at index " << i;
       return kErrorBadProfiles;
     }
   }
 
   // Check if there is enough new information added by the current profiles.
-  if (((info.GetNumberOfMethods() - number_of_methods) < kMinNewMethodsForCompilation) &&
-      ((info.GetNumberOfResolvedClasses() - number_of_classes) < kMinNewClassesForCompilation)) {
+  bool should_compile =
+      ((info.GetNumberOfMethods() - number_of_methods) >= kMinNewMethodsForCompilation) ||
+      ((info.GetNumberOfResolvedClasses() - number_of_classes) >= kMinNewClassesForCompilation);
+  if (!should_compile && !reference_profile_is_obsolete) {
     return kSkipCompilation;
   }
 
-  // We were successful in merging all profile information. Update the reference profile.
+  // We were successful in merging all profile information. Update the reference profile, even
+  // without compilation if it is obsolete, so that it can be loaded the next time.
   if (!reference_profile_file.GetFile()->ClearContent()) {
     PLOG(WARNING) << "Could not clear reference profile file";
     return kErrorIO;
@@ -66,7 +71,7 @@ ProfileAssistant::ProcessingResult ProfileAssistant::ProcessProfilesInternal(
     return kErrorIO;
   }
 
-  return kCompile;
+  return should_compile ? kCompile : kSkipCompilation;
 }
 
 static bool InitFlock(const std::string& filename, ScopedFlock& flock, std::string* error) {
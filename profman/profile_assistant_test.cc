@@ -282,4 +282,31 @@ TEST_F(ProfileAssistantTest, FailProcessingBecauseOfReferenceProfiles) {
   CheckProfileInfo(profile1, info1);
 }
 
+TEST_F(ProfileAssistantTest, ReplaceObsoleteReferenceProfile) {
+  ScratchFile profile1;
+  ScratchFile reference_profile;
+
+  std::vector<int> profile_fds({
+      GetFd(profile1)});
+  int reference_profile_fd = GetFd(reference_profile);
+
+  // Too few new methods to compile, but the reference profile must be replaced anyway.
+  const uint16_t kNumberOfMethodsToSkipCompilation = 1;
+  ProfileCompilationInfo info1;
+  SetupProfile("p1", 1, kNumberOfMethodsToSkipCompilation, 0, profile1, &info1);
+
+  // A reference profile of the previous version of the format.
+  const char kObsoleteProfile[] = "pro\0" "001\0" "location1p1;1,2,3";
+  ASSERT_TRUE(reference_profile.GetFile()->WriteFully(kObsoleteProfile, sizeof(kObsoleteProfile)));
+  ASSERT_EQ(0, reference_profile.GetFile()->Flush());
+  ASSERT_TRUE(reference_profile.GetFile()->ResetOffset());
+
+  ASSERT_EQ(ProfileAssistant::kSkipCompilation,
+            ProcessProfiles(profile_fds, reference_profile_fd));
+
+  // The reference profile now holds the current profiles, in the current format.
+  CheckProfileInfo(reference_profile, info1);
+  CheckProfileInfo(profile1, info1);
+}
+
 }  // namespace art
@@ -106,8 +106,11 @@ LIBART_COMMON_SRC_FILES := \
   jit/debugger_interface.cc \
   jit/jit.cc \
   jit/jit_code_cache.cc \
+  jit/jit_compile_queue.cc \
   jit/offline_profiling_info.cc \
+  jit/persistent_code_cache.cc \
   jit/profiling_info.cc \
+  jit/profile_class_preloader.cc \
   jit/profile_saver.cc  \
   lambda/art_lambda_method.cc \
   lambda/box_table.cc \
@@ -193,6 +196,8 @@ LIBART_COMMON_SRC_FILES := \
   verifier/reg_type_cache.cc \
   verifier/register_line.cc \
   well_known_classes.cc \
+  xposed_bridge.cc \
+  xposed_hook_stats.cc \
   zip_archive.cc
 
 LIBART_COMMON_SRC_FILES += \
@@ -254,6 +254,9 @@ void InitEntryPoints(JniEntryPoints* jpoints, QuickEntryPoints* qpoints) {
   // Thread
   qpoints->pTestSuspend = art_quick_test_suspend;
   static_assert(!IsDirectEntrypoint(kQuickTestSuspend), "Non-direct C stub marked direct.");
+  qpoints->pJitBaselineCodeIsHot = art_quick_jit_baseline_code_is_hot;
+  static_assert(!IsDirectEntrypoint(kQuickJitBaselineCodeIsHot),
+                "Non-direct C stub marked direct.");
 
   // Throws
   qpoints->pDeliverException = art_quick_deliver_exception;
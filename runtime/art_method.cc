@@ -16,21 +16,30 @@
 
 #include "art_method.h"
 
+#include <map>
+
 #include "arch/context.h"
 #include "art_field-inl.h"
 #include "art_method-inl.h"
+#include "base/dumpable.h"
+#include "base/hash_set.h"
 #include "base/stringpiece.h"
+#include "base/time_utils.h"
+#include "base/timing_logger.h"
 #include "class_linker-inl.h"
 #include "debugger.h"
 #include "dex_file-inl.h"
 #include "dex_instruction.h"
+#include "entrypoints/entrypoint_utils.h"
 #include "entrypoints/runtime_asm_entrypoints.h"
 #include "gc/accounting/card_table-inl.h"
 #include "interpreter/interpreter.h"
+#include "java_vm_ext.h"
 #include "jit/jit.h"
 #include "jit/jit_code_cache.h"
 #include "jit/profiling_info.h"
 #include "jni_internal.h"
+#include "linear_alloc.h"
 #include "mirror/abstract_method.h"
 #include "mirror/class-inl.h"
 #include "mirror/method.h"
@@ -41,6 +50,8 @@
 #include "scoped_thread_state_change.h"
 #include "thread_list.h"
 #include "well_known_classes.h"
+#include "xposed_bridge.h"
+#include "xposed_hook_stats.h"
 
 namespace art {
 
@@ -406,6 +417,11 @@ const OatQuickMethodHeader* ArtMethod::GetOatQuickMethodHeader(uintptr_t pc) {
     return nullptr;
   }
 
+  if (existing_entry_point == GetQuickXposedInvokeHandler()) {
+    // The Xposed hook entry point does not have any method header.
+    return nullptr;
+  }
+
   // Check whether the current entry point contains this pc.
   if (!class_linker->IsQuickResolutionStub(existing_entry_point) &&
       !class_linker->IsQuickToInterpreterBridge(existing_entry_point)) {
@@ -510,85 +526,494 @@ void ArtMethod::CopyFrom(ArtMethod* src, size_t image_pointer_size) {
   hotness_count_ = 0;
 }
 
-static void StackReplaceMethod(Thread* thread, void* arg) SHARED_REQUIRES(Locks::mutator_lock_) {
-  struct StackReplaceMethodVisitor FINAL : public StackVisitor {
-    StackReplaceMethodVisitor(Thread* thread_in, ArtMethod* search, ArtMethod* replace)
-        : StackVisitor(thread_in, nullptr, StackVisitor::StackWalkKind::kSkipInlinedFrames),
-          search_(search), replace_(replace) {};
+void ArtMethod::FixupXposedHookedFrames(Thread* self, ArtMethod** hook_frame) {
+  // The stack walk itself switches the stale frames, see StackVisitor::WalkStack().
+  struct FixupXposedHookedFramesVisitor FINAL : public StackVisitor {
+    FixupXposedHookedFramesVisitor(Thread* thread_in, ArtMethod** hook_frame_in)
+        : StackVisitor(thread_in, nullptr, StackVisitor::StackWalkKind::kSkipInlinedFrames) {
+      SetXposedHookFrame(hook_frame_in);
+    }
 
     bool VisitFrame() SHARED_REQUIRES(Locks::mutator_lock_) {
-      if (GetMethod() == search_) {
-        SetMethod(replace_);
-      }
       return true;
     }
-
-    ArtMethod* search_;
-    ArtMethod* replace_;
   };
 
-  ArtMethod* search = reinterpret_cast<ArtMethod*>(arg);
+  const size_t epoch = Runtime::Current()->GetXposedHookEpoch();
+  FixupXposedHookedFramesVisitor visitor(self, hook_frame);
+  visitor.WalkStack();
+  self->SetXposedHookEpoch(epoch);
+}
 
-  // We cannot use GetXposedOriginalMethod() because the access flags aren't modified yet.
-  auto hook_info = reinterpret_cast<const XposedHookInfo*>(search->GetEntryPointFromJni());
-  ArtMethod* replace = hook_info->originalMethod;
+// Returns whether the backup and information of a released hook may be used by a new hook. No
+// frame runs the backup anymore once the Method object of the backup has been collected, as the
+// backup is not called otherwise and reflective calls keep the Method object alive.
+static bool CanReuseXposedHookInfo(Thread* self, XposedHookInfo* hook_info)
+    SHARED_REQUIRES(Locks::mutator_lock_) {
+  DCHECK_NE(hook_info->flags & kXposedHookReleased, 0u);
+  JavaVMExt* vm = Runtime::Current()->GetJavaVM();
+  if (hook_info->reflectedMethod != nullptr) {
+    if (!vm->IsWeakGlobalCleared(self, hook_info->reflectedMethod)) {
+      return false;
+    }
+    vm->DeleteWeakGlobalRef(self, hook_info->reflectedMethod);
+    hook_info->reflectedMethod = nullptr;
+  }
+  jit::Jit* jit = Runtime::Current()->GetJit();
+  return jit == nullptr ||
+      jit->GetCodeCache()->RemoveUnusedXposedBackup(self, hook_info->originalMethod);
+}
 
-  StackReplaceMethodVisitor visitor(thread, search, replace);
-  visitor.WalkStack();
+// Takes up to `count` released hooks of `class_loader` which can be reused, the others stay in
+// the free list.
+static std::vector<XposedHookInfo*> TakeReusableXposedHookInfos(Thread* self,
+                                                                mirror::ClassLoader* class_loader,
+                                                                size_t count)
+    SHARED_REQUIRES(Locks::mutator_lock_) {
+  ClassLinker* cl = Runtime::Current()->GetClassLinker();
+  std::vector<XposedHookInfo*> hook_infos;
+  XposedHookInfo* free_infos = cl->TakeFreeXposedHookInfos(class_loader);
+  while (free_infos != nullptr) {
+    XposedHookInfo* hook_info = free_infos;
+    free_infos = hook_info->next_free;
+    hook_info->next_free = nullptr;
+    if (hook_infos.size() < count && CanReuseXposedHookInfo(self, hook_info)) {
+      hook_infos.push_back(hook_info);
+    } else {
+      cl->AddFreeXposedHookInfo(class_loader, hook_info);
+    }
+  }
+  return hook_infos;
 }
 
-void ArtMethod::EnableXposedHook(ScopedObjectAccess& soa, jobject additional_info) {
-  if (UNLIKELY(IsXposedHookedMethod())) {
-    // Already hooked
+// Puts the reused hooks back into the free lists when an installation fails.
+static void FreeReusedXposedHookInfos(const std::vector<ArtMethod*>& targets,
+                                      const std::vector<XposedHookInfo*>& hook_infos,
+                                      const std::vector<bool>& reused)
+    SHARED_REQUIRES(Locks::mutator_lock_) {
+  ClassLinker* cl = Runtime::Current()->GetClassLinker();
+  for (size_t i = 0; i != targets.size(); ++i) {
+    if (reused[i]) {
+      cl->AddFreeXposedHookInfo(targets[i]->GetDeclaringClass()->GetClassLoader(), hook_infos[i]);
+    }
+  }
+}
+
+void ArtMethod::EnableXposedHook(ScopedObjectAccess& soa, jobject additional_info, uint32_t flags,
+                                 const XposedHookObservers* observers) {
+  EnableXposedHooks(soa, std::vector<ArtMethod*>({this}), std::vector<jobject>({additional_info}),
+                    flags, observers);
+}
+
+void ArtMethod::EnableXposedHooks(ScopedObjectAccess& soa,
+                                  const std::vector<ArtMethod*>& methods,
+                                  const std::vector<jobject>& additional_infos,
+                                  uint32_t flags,
+                                  const XposedHookObservers* observers) {
+  CHECK_EQ(methods.size(), additional_infos.size());
+  if (observers != nullptr) {
+    flags |= kXposedHookObserveOnly;
+  }
+  Thread* self = soa.Self();
+  TimingLogger logger("Xposed hook installation", true, VLOG_IS_ON(xposed));
+
+  std::vector<ArtMethod*> targets;
+  std::vector<jobject> target_infos;
+  HashSet<ArtMethod*> target_set;
+  {
+    TimingLogger::ScopedTiming st("Select methods", &logger);
+    for (size_t i = 0; i != methods.size(); ++i) {
+      ArtMethod* method = methods[i];
+      if (UNLIKELY(method->IsXposedHookedMethod())) {
+        // Already hooked
+        continue;
+      } else if (UNLIKELY(method->IsXposedOriginalMethod())) {
+        // This should never happen
+        ThrowIllegalArgumentException(StringPrintf("Cannot hook the method backup: %s", PrettyMethod(method).c_str()).c_str());
+        return;
+      }
+      if (target_set.Find(method) == target_set.end()) {
+        target_set.Insert(method);
+        targets.push_back(method);
+        target_infos.push_back(additional_infos[i]);
+      }
+    }
+  }
+  if (targets.empty()) {
     return;
-  } else if (UNLIKELY(IsXposedOriginalMethod())) {
-    // This should never happen
-    ThrowIllegalArgumentException(StringPrintf("Cannot hook the method backup: %s", PrettyMethod(this).c_str()).c_str());
+  }
+
+  // Make sure small primitive arguments can be boxed without calling into managed code.
+  if (UNLIKELY(!InitXposedBoxCache(self))) {
     return;
   }
 
-  // Create a backup of the ArtMethod object
-  auto cl = Runtime::Current()->GetClassLinker();
-  //auto allocator = GetClassLoader()->GetAllocator(); SIGSEGV
-  auto allocator = Runtime::Current()->GetLinearAlloc();
-  const size_t method_alignment = ArtMethod::Alignment(cl->GetImagePointerSize());
-  const size_t method_size = ArtMethod::Size(cl->GetImagePointerSize());
-  LengthPrefixedArray<ArtMethod>* method_array = cl->AllocArtMethodArray(Thread::Current(), allocator, 1);
-  ArtMethod* backup_method = &method_array->At(0, method_size, method_alignment);
-  backup_method->CopyFrom(this, cl->GetImagePointerSize());
-  backup_method->SetAccessFlags(backup_method->GetAccessFlags() | kAccXposedOriginalMethod);
-
-  // Create a Method/Constructor object for the backup ArtMethod object
-  mirror::AbstractMethod* reflect_method;
-  if (IsConstructor()) {
-    reflect_method = mirror::Constructor::CreateFromArtMethod(soa.Self(), backup_method);
-  } else {
-    reflect_method = mirror::Method::CreateFromArtMethod(soa.Self(), backup_method);
+  // Everything that allocates is done before threads are suspended: backups of the ArtMethod
+  // objects, Method/Constructor objects for the backups, and the hook information.
+  std::vector<XposedHookInfo*> hook_infos;
+  {
+    TimingLogger::ScopedTiming st("Create backups", &logger);
+    auto cl = Runtime::Current()->GetClassLinker();
+    const size_t method_alignment = ArtMethod::Alignment(cl->GetImagePointerSize());
+    const size_t method_size = ArtMethod::Size(cl->GetImagePointerSize());
+    XposedHookProfiler* hook_profiler = Runtime::Current()->GetXposedHookProfiler();
+    XposedBridgeCache* bridge_cache = Runtime::Current()->GetXposedBridgeCache();
+
+    // The backups and hook information are placed in the hook arena of the class loader defining
+    // the hooked method, so they are freed when it is unloaded. Released hooks of the class loader
+    // are reused first, each batch packs the other backups of a class loader into a single array.
+    std::map<LinearAlloc*, std::vector<size_t>> targets_by_arena;
+    for (size_t i = 0; i != targets.size(); ++i) {
+      mirror::ClassLoader* class_loader = targets[i]->GetDeclaringClass()->GetClassLoader();
+      targets_by_arena[cl->GetOrCreateXposedHookAllocatorForClassLoader(class_loader)].push_back(i);
+    }
+    std::vector<ArtMethod*> backups(targets.size());
+    hook_infos.resize(targets.size());
+    std::vector<bool> reused(targets.size(), false);
+    // The hook information only holds weak references to the Method objects, which are kept alive
+    // by the class loader through an array per batch.
+    StackHandleScopeCollection root_arrays(self);
+    std::vector<MutableHandle<mirror::ObjectArray<mirror::Object>>> roots(targets.size());
+    std::vector<size_t> root_indexes(targets.size());
+    // The new arrays, with the index of a method of their class loader.
+    std::vector<std::pair<MutableHandle<mirror::ObjectArray<mirror::Object>>, size_t>> new_roots;
+    for (const auto& arena_targets : targets_by_arena) {
+      LinearAlloc* const arena = arena_targets.first;
+      const std::vector<size_t>& indexes = arena_targets.second;
+      std::vector<XposedHookInfo*> reusable_infos = TakeReusableXposedHookInfos(
+          self, targets[indexes[0]]->GetDeclaringClass()->GetClassLoader(), indexes.size());
+      for (size_t j = 0; j != reusable_infos.size(); ++j) {
+        XposedHookInfo* hook_info = reusable_infos[j];
+        backups[indexes[j]] = hook_info->originalMethod;
+        hook_infos[indexes[j]] = hook_info;
+        reused[indexes[j]] = true;
+        roots[indexes[j]] = root_arrays.NewHandle(
+            soa.Decode<mirror::ObjectArray<mirror::Object>*>(hook_info->root_array));
+        root_indexes[indexes[j]] = hook_info->root_index;
+      }
+      const size_t num_new = indexes.size() - reusable_infos.size();
+      if (num_new == 0) {
+        continue;
+      }
+      MutableHandle<mirror::ObjectArray<mirror::Object>> root_array =
+          root_arrays.NewHandle(mirror::ObjectArray<mirror::Object>::Alloc(
+              self, cl->GetClassRoot(ClassLinker::kObjectArrayClass), num_new));
+      if (UNLIKELY(root_array.Get() == nullptr)) {
+        self->AssertPendingOOMException();
+        FreeReusedXposedHookInfos(targets, hook_infos, reused);
+        return;
+      }
+      new_roots.emplace_back(root_array, indexes[0]);
+      LengthPrefixedArray<ArtMethod>* method_array =
+          cl->AllocArtMethodArray(self, arena, num_new);
+      // Arena memory is zero-initialized.
+      XposedHookInfo* info_array = arena->AllocArray<XposedHookInfo>(self, num_new);
+      for (size_t j = 0; j != num_new; ++j) {
+        const size_t index = indexes[reusable_infos.size() + j];
+        backups[index] = &method_array->At(j, method_size, method_alignment);
+        hook_infos[index] = &info_array[j];
+        roots[index] = root_array;
+        root_indexes[index] = j;
+      }
+    }
+
+    for (size_t i = 0; i != targets.size(); ++i) {
+      ArtMethod* method = targets[i];
+      ArtMethod* backup_method = backups[i];
+      backup_method->CopyFrom(method, cl->GetImagePointerSize());
+      backup_method->SetAccessFlags(backup_method->GetAccessFlags() | kAccXposedOriginalMethod);
+
+      // Create a Method/Constructor object for the backup ArtMethod object
+      mirror::AbstractMethod* reflect_method;
+      if (method->IsConstructor()) {
+        reflect_method = mirror::Constructor::CreateFromArtMethod(self, backup_method);
+      } else {
+        reflect_method = mirror::Method::CreateFromArtMethod(self, backup_method);
+      }
+      if (UNLIKELY(reflect_method == nullptr)) {
+        self->AssertPendingOOMException();
+        // No hook is installed. The new backups and hook information stay in the hook arenas,
+        // which are freed with their class loaders, but the references they hold must be
+        // released.
+        for (size_t j = 0; j != i; ++j) {
+          soa.Vm()->DeleteWeakGlobalRef(self, hook_infos[j]->reflectedMethod);
+          hook_infos[j]->reflectedMethod = nullptr;
+          roots[j]->Set<false>(root_indexes[j], nullptr);
+        }
+        FreeReusedXposedHookInfos(targets, hook_infos, reused);
+        return;
+      }
+      reflect_method->SetAccessible<false>(true);
+      roots[i]->Set<false>(root_indexes[i], reflect_method);
+      hook_infos[i]->reflectedMethod = soa.Vm()->AddWeakGlobalRef(self, reflect_method);
+    }
+
+    // Nothing fails from here on.
+    for (const auto& new_root : new_roots) {
+      cl->InsertStrongRootInToClassLoader(
+          new_root.first.Get(), targets[new_root.second]->GetDeclaringClass()->GetClassLoader());
+    }
+    for (size_t i = 0; i != targets.size(); ++i) {
+      ArtMethod* method = targets[i];
+      ArtMethod* backup_method = backups[i];
+
+      // Save extra information in a separate structure, stored instead of the native method
+      XposedHookInfo* hookInfo = hook_infos[i];
+      hookInfo->additionalInfo = soa.Env()->NewGlobalRef(target_infos[i]);
+      hookInfo->originalMethod = backup_method;
+      hookInfo->flags = flags;
+      hookInfo->bridge = bridge_cache->GetOrCreate(method);
+      hookInfo->observers = XposedHookObservers();
+      if (observers != nullptr) {
+        hookInfo->observers = *observers;
+        hookInfo->observers.managed_class =
+            reinterpret_cast<jclass>(soa.Env()->NewGlobalRef(observers->managed_class));
+      }
+      hookInfo->stats = nullptr;
+      if (hook_profiler != nullptr) {
+        hookInfo->stats = hook_profiler->AddHook(method);
+      }
+      hookInfo->pending_calls.StoreRelaxed(0);
+      if (reused[i]) {
+        // Already known to the class loader.
+        Runtime::Current()->RecordXposedHookReused();
+      } else {
+        hookInfo->root_array = soa.Vm()->AddWeakGlobalRef(self, roots[i].Get());
+        hookInfo->root_index = static_cast<int32_t>(root_indexes[i]);
+        cl->AddXposedHookInfo(method->GetDeclaringClass()->GetClassLoader(), hookInfo);
+      }
+    }
   }
-  reflect_method->SetAccessible<false>(true);
 
-  // Save extra information in a separate structure, stored instead of the native method
-  XposedHookInfo* hookInfo = reinterpret_cast<XposedHookInfo*>(calloc(1, sizeof(XposedHookInfo)));
-  hookInfo->reflectedMethod = soa.Vm()->AddGlobalRef(soa.Self(), reflect_method);
-  hookInfo->additionalInfo = soa.Env()->NewGlobalRef(additional_info);
-  hookInfo->originalMethod = backup_method;
-  SetEntryPointFromJni(reinterpret_cast<uint8_t*>(hookInfo));
+  // Switch all methods over in a single pause, walking each thread's stack only once.
+  {
+    TimingLogger::ScopedTiming st("Pause", &logger);
+    const uint64_t pause_start_ns = NanoTime();
+    ScopedThreadSuspension sts(self, kSuspended);
+    ScopedSuspendAll ssa("Hooking methods");
+    jit::Jit* jit = Runtime::Current()->GetJit();
+    if (jit != nullptr) {
+      // The compiled code of the methods moves to their backups.
+      TimingLogger::ScopedTiming st2("Invalidate JIT code", &logger);
+      std::vector<ArtMethod*> backups;
+      backups.reserve(hook_infos.size());
+      for (XposedHookInfo* hook_info : hook_infos) {
+        backups.push_back(hook_info->originalMethod);
+      }
+      jit->GetCodeCache()->InvalidateCompiledCodeForXposedHooks(targets, backups);
+    }
+    // Frames running the original code are recognized by their epoch, instead of walking the
+    // stacks of all threads here.
+    const size_t epoch = Runtime::Current()->IncrementXposedHookEpoch();
+    Runtime::Current()->RecordXposedHooksInstalled(targets.size());
+    for (size_t i = 0; i != targets.size(); ++i) {
+      hook_infos[i]->epoch = epoch;
+      targets[i]->SetEntryPointFromJni(reinterpret_cast<uint8_t*>(hook_infos[i]));
+    }
+    for (ArtMethod* method : targets) {
+      method->SetEntryPointFromQuickCompiledCode(GetQuickXposedInvokeHandler());
+      //SetEntryPointFromInterpreter(artInterpreterToCompiledCodeBridge);
+
+      // Adjust access flags. The JIT compiles the backup, never the hooked method.
+      method->SetAccessFlags((method->GetAccessFlags() & ~kAccNative & ~kAccSynchronized) |
+                             kAccXposedHookedMethod | kAccCompileDontBother);
+    }
+    Runtime::Current()->RecordXposedHookPause(NanoTime() - pause_start_ns);
+  }
+
+  VLOG(xposed) << "Hooked " << targets.size() << " methods "
+               << Dumpable<TimingLogger>(logger);
+}
+
+// Turns the frames of calls through the trampoline of hooks being disabled into frames of the
+// refs-and-args callee save method, which has the same layout. The hooked method is not a proxy
+// method anymore once its original code is restored, so its own frame information would not
+// describe these frames. Frames still running the original code have already been switched to
+// the backups by the stack walk, their hooks are retained.
+class DisableXposedHookFramesVisitor FINAL : public StackVisitor {
+ public:
+  DisableXposedHookFramesVisitor(Thread* thread,
+                                 const std::map<ArtMethod*, XposedHookInfo*>& disabled_backups)
+      SHARED_REQUIRES(Locks::mutator_lock_)
+      : StackVisitor(thread, nullptr, StackVisitor::StackWalkKind::kSkipInlinedFrames),
+        callee_save_method_(Runtime::Current()->GetCalleeSaveMethod(Runtime::kRefsAndArgs)),
+        disabled_backups_(disabled_backups) {}
+
+  bool VisitFrame() OVERRIDE SHARED_REQUIRES(Locks::mutator_lock_) {
+    ArtMethod** frame = GetCurrentQuickFrame();
+    ArtMethod* method = GetMethod();
+    if (method == nullptr) {
+      return true;
+    }
+    if (method->IsXposedOriginalMethod()) {
+      // The frame may have been running since before the method was hooked, which no pending
+      // call tracks. Calls of the backup through the trampoline look the same.
+      auto it = disabled_backups_.find(method);
+      if (it != disabled_backups_.end()) {
+        it->second->flags |= kXposedHookRetained;
+      }
+      return true;
+    }
+    if (frame == nullptr || !method->IsXposedHookedMethod()) {
+      return true;
+    }
+    XposedHookInfo* hook_info = const_cast<XposedHookInfo*>(method->GetXposedHookInfo());
+    if ((hook_info->flags & kXposedHookDisabled) != 0) {
+      // All threads are suspended.
+      hook_info->pending_calls.StoreRelaxed(hook_info->pending_calls.LoadRelaxed() + 1);
+      *frame = callee_save_method_;
+    }
+    return true;
+  }
+
+ private:
+  ArtMethod* const callee_save_method_;
+  const std::map<ArtMethod*, XposedHookInfo*>& disabled_backups_;
+};
+
+static void DisableXposedHookFrames(Thread* thread, void* arg)
+    SHARED_REQUIRES(Locks::mutator_lock_) {
+  DisableXposedHookFramesVisitor visitor(
+      thread, *reinterpret_cast<std::map<ArtMethod*, XposedHookInfo*>*>(arg));
+  visitor.WalkStack();
+}
+
+// Releases the global references and the statistics of a disabled hook. Unless the class loader is
+// being unloaded, the slot of the Method object of the backup is cleared and the hook is kept for
+// reuse, see CanReuseXposedHookInfo().
+static void ReleaseXposedHookReferences(Thread* self, XposedHookInfo* hook_info, bool unloading)
+    SHARED_REQUIRES(Locks::mutator_lock_) {
+  JavaVMExt* vm = Runtime::Current()->GetJavaVM();
+  vm->DeleteGlobalRef(self, hook_info->additionalInfo);
+  vm->DeleteGlobalRef(self, hook_info->observers.managed_class);
+  hook_info->additionalInfo = nullptr;
+  hook_info->observers.managed_class = nullptr;
+  if (hook_info->stats != nullptr) {
+    Runtime::Current()->GetXposedHookProfiler()->RemoveHook(hook_info->stats);
+    hook_info->stats = nullptr;
+  }
+  hook_info->flags |= kXposedHookReleased;
+  Runtime::Current()->RecordXposedHookReleased();
+  if (unloading) {
+    return;
+  }
+  mirror::ObjectArray<mirror::Object>* root_array =
+      down_cast<mirror::ObjectArray<mirror::Object>*>(self->DecodeJObject(hook_info->root_array));
+  DCHECK(root_array != nullptr);
+  root_array->Set<false>(hook_info->root_index, nullptr);
+  if ((hook_info->flags & kXposedHookRetained) != 0) {
+    vm->DeleteWeakGlobalRef(self, hook_info->reflectedMethod);
+    hook_info->reflectedMethod = nullptr;
+    return;
+  }
+  // The Method object is now only weakly reachable, unless the application still uses it.
+  Runtime::Current()->GetClassLinker()->AddFreeXposedHookInfo(
+      hook_info->originalMethod->GetDeclaringClass()->GetClassLoader(), hook_info);
+}
+
+void ArtMethod::DisableXposedHook(ScopedObjectAccess& soa) {
+  DisableXposedHooks(soa, std::vector<ArtMethod*>({this}));
+}
+
+void ArtMethod::DisableXposedHooks(ScopedObjectAccess& soa,
+                                   const std::vector<ArtMethod*>& methods) {
+  Thread* self = soa.Self();
+  TimingLogger logger("Xposed hook removal", true, VLOG_IS_ON(xposed));
+
+  std::vector<ArtMethod*> targets;
+  std::vector<XposedHookInfo*> hook_infos;
+  HashSet<ArtMethod*> target_set;
+  for (ArtMethod* method : methods) {
+    if (UNLIKELY(!method->IsXposedHookedMethod())) {
+      // Not hooked, or already unhooked
+      continue;
+    }
+    if (target_set.Find(method) == target_set.end()) {
+      target_set.Insert(method);
+      targets.push_back(method);
+      hook_infos.push_back(const_cast<XposedHookInfo*>(method->GetXposedHookInfo()));
+    }
+  }
+  if (targets.empty()) {
+    return;
+  }
 
-  ThreadList* tl = Runtime::Current()->GetThreadList();
-  soa.Self()->TransitionFromRunnableToSuspended(kSuspended);
-  tl->SuspendAll("Hooking method");
+  // Hooks without calls in progress have their references released right after the pause, the
+  // others by the last of these calls.
+  std::vector<XposedHookInfo*> released_infos;
+  std::map<ArtMethod*, XposedHookInfo*> disabled_backups;
+  for (XposedHookInfo* hook_info : hook_infos) {
+    disabled_backups.emplace(hook_info->originalMethod, hook_info);
+  }
   {
-    MutexLock mu(soa.Self(), *Locks::thread_list_lock_);
-    tl->ForEach(StackReplaceMethod, this);
+    TimingLogger::ScopedTiming st("Pause", &logger);
+    ScopedThreadSuspension sts(self, kSuspended);
+    ScopedSuspendAll ssa("Unhooking methods");
+    for (XposedHookInfo* hook_info : hook_infos) {
+      hook_info->flags |= kXposedHookDisabled;
+    }
+    {
+      TimingLogger::ScopedTiming st2("Walk stacks", &logger);
+      MutexLock mu(self, *Locks::thread_list_lock_);
+      Runtime::Current()->GetThreadList()->ForEach(DisableXposedHookFrames, &disabled_backups);
+    }
+
+    jit::Jit* jit = Runtime::Current()->GetJit();
+    std::vector<ArtMethod*> backups;
+    backups.reserve(targets.size());
+    for (size_t i = 0; i != targets.size(); ++i) {
+      ArtMethod* method = targets[i];
+      ArtMethod* backup = hook_infos[i]->originalMethod;
+      backups.push_back(backup);
+      // The JIT code of the backup stays with the backup, the method is compiled again when hot.
+      const void* entry_point = backup->GetEntryPointFromQuickCompiledCode();
+      if (jit != nullptr && jit->GetCodeCache()->ContainsPc(entry_point)) {
+        entry_point = GetQuickToInterpreterBridge();
+      }
+      method->SetEntryPointFromQuickCompiledCode(entry_point);
+      // Native methods get back their registered code, the JIT reattaches the ProfilingInfo of
+      // other methods.
+      method->SetEntryPointFromJni(backup->IsNative() ? backup->GetEntryPointFromJni() : nullptr);
+      method->SetAccessFlags(backup->GetAccessFlags() & ~kAccXposedOriginalMethod);
+      if (hook_infos[i]->pending_calls.LoadRelaxed() == 0) {
+        released_infos.push_back(hook_infos[i]);
+      }
+    }
+    if (jit != nullptr) {
+      TimingLogger::ScopedTiming st2("Restore JIT state", &logger);
+      jit->GetCodeCache()->RestoreCompiledCodeForXposedUnhooks(targets, backups);
+    }
+    Runtime::Current()->RecordXposedHooksDisabled(targets.size());
   }
-  tl->ResumeAll();
-  soa.Self()->TransitionFromSuspendedToRunnable();
 
-  SetEntryPointFromQuickCompiledCode(GetQuickProxyInvokeHandler());
-  //SetEntryPointFromInterpreter(artInterpreterToCompiledCodeBridge);
+  for (XposedHookInfo* hook_info : released_infos) {
+    ReleaseXposedHookReferences(self, hook_info, /* unloading */ false);
+  }
 
-  // Adjust access flags
-  SetAccessFlags((GetAccessFlags() & ~kAccNative & ~kAccSynchronized) | kAccXposedHookedMethod);
+  VLOG(xposed) << "Unhooked " << targets.size() << " methods, " << released_infos.size()
+               << " released " << Dumpable<TimingLogger>(logger);
+}
+
+void ArtMethod::FinishDisabledXposedHookCall(Thread* self, const XposedHookInfo* hook_info) {
+  XposedHookInfo* info = const_cast<XposedHookInfo*>(hook_info);
+  if (info->pending_calls.FetchAndSubSequentiallyConsistent(1) == 1) {
+    ReleaseXposedHookReferences(self, info, /* unloading */ false);
+  }
+}
+
+void ArtMethod::ReleaseUnloadedXposedHooks(Thread* self, XposedHookInfo* hook_info) {
+  JavaVMExt* vm = Runtime::Current()->GetJavaVM();
+  for (; hook_info != nullptr; hook_info = hook_info->next_in_class_loader) {
+    // Disabled hooks have already been released, as no call through their trampoline can be
+    // running once the class loader is unloaded.
+    if ((hook_info->flags & kXposedHookReleased) == 0) {
+      ReleaseXposedHookReferences(self, hook_info, /* unloading */ true);
+    }
+    vm->DeleteWeakGlobalRef(self, hook_info->reflectedMethod);
+    vm->DeleteWeakGlobalRef(self, hook_info->root_array);
+    hook_info->reflectedMethod = nullptr;
+    hook_info->root_array = nullptr;
+  }
 }
 
 }  // namespace art
@@ -38,11 +38,72 @@ class ProfilingInfo;
 class ScopedObjectAccessAlreadyRunnable;
 class StringPiece;
 class ShadowFrame;
+class XposedBridge;
+class XposedHookStats;
+
+// Flags for XposedHookInfo::flags.
+// The callback does not keep a reference to the arguments array after it returns, so the runtime
+// may reuse the array for later calls.
+static constexpr uint32_t kXposedHookNonEscapingArgs = 0x1;
+// The hook only observes calls. Instead of XposedBridge.handleHookedMethod, the observers in
+// XposedHookInfo::observers are called around a direct call of the original method.
+static constexpr uint32_t kXposedHookObserveOnly = 0x2;
+// Set by the runtime when the hook is disabled, see ArtMethod::DisableXposedHooks().
+static constexpr uint32_t kXposedHookDisabled = 0x4;
+// Set by the runtime when the references of a disabled hook are released.
+static constexpr uint32_t kXposedHookReleased = 0x8;
+// Set by the runtime when frames of the backup were running when the hook was disabled. The
+// backup and hook information of such a hook are never reused.
+static constexpr uint32_t kXposedHookRetained = 0x10;
+
+// Native observer of a call of a method hooked with kXposedHookObserveOnly. `receiver` is null
+// for static methods, `args` does not include the receiver. `result` is null for the observer
+// called before the original method.
+typedef void (*XposedHookObserver)(JNIEnv* env, jobject method, jobject receiver,
+                                   const jvalue* args, size_t num_args, const jvalue* result,
+                                   void* data);
+
+// Observers of a method hooked with kXposedHookObserveOnly. Any of them may be null. The managed
+// observers are static methods of `managed_class` with the signatures
+//   void before(Member method, Object additionalInfo, Object thisObject, Object[] args)
+//   void after(Member method, Object additionalInfo, Object thisObject, Object[] args,
+//              Object result)
+// The after observers are not called if the original method throws.
+struct XposedHookObservers {
+  XposedHookObserver native_before;
+  XposedHookObserver native_after;
+  void* native_data;
+  jclass managed_class;
+  jmethodID managed_before;
+  jmethodID managed_after;
+};
 
 struct XposedHookInfo {
-  jobject reflectedMethod;
+  // Weak global reference, the Method object is kept alive by the class loader of the hooked
+  // method, so that the hook does not prevent its unloading.
+  jweak reflectedMethod;
   jobject additionalInfo;
   ArtMethod* originalMethod;
+  uint32_t flags;
+  XposedHookObservers observers;
+  // Call statistics, or null if the hook was installed without -XX:XposedHookStats.
+  XposedHookStats* stats;
+  // See Runtime::GetXposedHookEpoch().
+  size_t epoch;
+  // Marshals the arguments, shared with other hooked methods of the same shorty.
+  const XposedBridge* bridge;
+  // Calls through the trampoline which were running when the hook was disabled. The last of them
+  // to return releases the global references.
+  Atomic<uint32_t> pending_calls;
+  // Next hook of a method of the same class loader, see ClassLinker::AddXposedHookInfo().
+  XposedHookInfo* next_in_class_loader;
+  // Weak global reference to the array kept alive by the class loader which holds the Method
+  // object at `root_index`. The slot is cleared when the hook is released, and used again along
+  // with the backup and this information by a later hook.
+  jweak root_array;
+  int32_t root_index;
+  // Next released hook of the same class loader, see ClassLinker::AddFreeXposedHookInfo().
+  XposedHookInfo* next_free;
 };
 
 namespace mirror {
@@ -689,6 +750,11 @@ class ArtMethod FINAL {
     return hotness_count_;
   }
 
+  // Baseline code of the JIT counts down the hotness counter, see Jit::NotifyBaselineCodeIsHot().
+  static MemberOffset HotnessCountOffset() {
+    return MemberOffset(OFFSETOF_MEMBER(ArtMethod, hotness_count_));
+  }
+
   const uint8_t* GetQuickenedInfo() SHARED_REQUIRES(Locks::mutator_lock_);
 
   // Returns the method header for the compiled code containing 'pc'. Note that runtime
@@ -719,7 +785,49 @@ class ArtMethod FINAL {
     return (GetAccessFlags() & kAccXposedOriginalMethod) != 0;
   }
 
-  void EnableXposedHook(ScopedObjectAccess& soa, jobject additional_info) SHARED_REQUIRES(Locks::mutator_lock_);
+  // If `observers` is not null, the hook is installed with kXposedHookObserveOnly. The hook keeps
+  // a global reference to the managed class of the observers until it is released.
+  void EnableXposedHook(ScopedObjectAccess& soa, jobject additional_info, uint32_t flags = 0,
+                        const XposedHookObservers* observers = nullptr)
+      SHARED_REQUIRES(Locks::mutator_lock_);
+
+  // Hooks all `methods` with a single suspension of all threads. `additional_infos[i]` is passed to
+  // the callback for `methods[i]`. Methods which are already hooked are skipped. Thread stacks are
+  // not walked: frames still running the original code are switched to the backups when they are
+  // walked, see FixupXposedHookedFrames().
+  static void EnableXposedHooks(ScopedObjectAccess& soa,
+                                const std::vector<ArtMethod*>& methods,
+                                const std::vector<jobject>& additional_infos,
+                                uint32_t flags = 0,
+                                const XposedHookObservers* observers = nullptr)
+      SHARED_REQUIRES(Locks::mutator_lock_);
+
+  void DisableXposedHook(ScopedObjectAccess& soa) SHARED_REQUIRES(Locks::mutator_lock_);
+
+  // Restores the original code and access flags of all `methods` with a single suspension of all
+  // threads, so that the JIT may compile and inline them again. Methods which are not hooked are
+  // skipped. Calls through the hook trampoline which are still running finish with the hook
+  // information they started with, their frames are turned into runtime frames. The global
+  // references of the hooks are released once these calls have returned. The backups and hook
+  // information are then reused by later hooks of the same class loader, once the Method objects
+  // of the backups have been collected.
+  static void DisableXposedHooks(ScopedObjectAccess& soa, const std::vector<ArtMethod*>& methods)
+      SHARED_REQUIRES(Locks::mutator_lock_);
+
+  // Called when a call through the trampoline of a disabled hook returns.
+  static void FinishDisabledXposedHookCall(Thread* self, const XposedHookInfo* hook_info)
+      SHARED_REQUIRES(Locks::mutator_lock_);
+
+  // Releases the references of the hooks in the list starting at `hook_info`, including the ones
+  // kept for reuse. Called when the class loader of the hooked methods is unloaded.
+  static void ReleaseUnloadedXposedHooks(Thread* self, XposedHookInfo* hook_info)
+      SHARED_REQUIRES(Locks::mutator_lock_);
+
+  // Switches the frames of `self` which run the original code of methods hooked since the last call
+  // to their backups, so that calls through the hook trampoline can be told apart from them.
+  // `hook_frame` is the frame of the call through the trampoline being handled.
+  static void FixupXposedHookedFrames(Thread* self, ArtMethod** hook_frame)
+      SHARED_REQUIRES(Locks::mutator_lock_);
 
   const XposedHookInfo* GetXposedHookInfo() SHARED_REQUIRES(Locks::mutator_lock_) {
     DCHECK(IsXposedHookedMethod());
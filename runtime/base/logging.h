@@ -68,6 +68,7 @@ struct LogVerbosity {
   bool verifier;
   bool image;
   bool systrace_lock_logging;  // Enabled with "-verbose:sys-locks".
+  bool xposed;
 };
 
 // Global log verbosity setting, initialized by InitLogging.
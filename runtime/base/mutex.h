@@ -99,6 +99,7 @@ enum LockLevel {
   kMethodVerifiersLock,
   kClassLinkerClassesLock,  // TODO rename.
   kJitCodeCacheLock,
+  kJitPersistentCodeCacheSaveLock,
   kBreakpointLock,
   kMonitorLock,
   kMonitorListLock,
@@ -318,6 +318,8 @@ ClassLinker::ClassLinker(InternTable* intern_table)
       find_array_class_cache_next_victim_(0),
       init_done_(false),
       log_new_class_table_roots_(false),
+      boot_xposed_hook_allocator_(nullptr),
+      boot_free_xposed_hook_infos_(nullptr),
       intern_table_(intern_table),
       quick_resolution_trampoline_(nullptr),
       quick_imt_conflict_trampoline_(nullptr),
@@ -2036,20 +2038,27 @@ ClassLinker::~ClassLinker() {
     DeleteClassLoader(self, data);
   }
   class_loaders_.clear();
+  delete boot_xposed_hook_allocator_;
 }
 
 void ClassLinker::DeleteClassLoader(Thread* self, const ClassLoaderData& data) {
   Runtime* const runtime = Runtime::Current();
   JavaVMExt* const vm = runtime->GetJavaVM();
   vm->DeleteWeakGlobalRef(self, data.weak_root);
+  // No hooked method of the class loader can run anymore.
+  ArtMethod::ReleaseUnloadedXposedHooks(self, data.xposed_hook_infos);
   // Notify the JIT that we need to remove the methods and/or profiling info.
   if (runtime->GetJit() != nullptr) {
     jit::JitCodeCache* code_cache = runtime->GetJit()->GetCodeCache();
     if (code_cache != nullptr) {
       code_cache->RemoveMethodsIn(self, *data.allocator);
+      if (data.xposed_hook_allocator != nullptr) {
+        code_cache->RemoveMethodsIn(self, *data.xposed_hook_allocator);
+      }
     }
   }
   delete data.allocator;
+  delete data.xposed_hook_allocator;
   delete data.class_table;
 }
 
@@ -3032,6 +3041,31 @@ LinearAlloc* ClassLinker::GetOrCreateAllocatorForClassLoader(mirror::ClassLoader
   return allocator;
 }
 
+LinearAlloc* ClassLinker::GetOrCreateXposedHookAllocatorForClassLoader(
+    mirror::ClassLoader* class_loader) {
+  WriterMutexLock mu(Thread::Current(), *Locks::classlinker_classes_lock_);
+  if (class_loader == nullptr) {
+    if (boot_xposed_hook_allocator_ == nullptr) {
+      boot_xposed_hook_allocator_ = Runtime::Current()->CreateLinearAlloc();
+    }
+    return boot_xposed_hook_allocator_;
+  }
+  if (class_loader->GetAllocator() == nullptr) {
+    RegisterClassLoader(class_loader);
+  }
+  LinearAlloc* const allocator = class_loader->GetAllocator();
+  for (ClassLoaderData& data : class_loaders_) {
+    if (data.allocator == allocator) {
+      if (data.xposed_hook_allocator == nullptr) {
+        data.xposed_hook_allocator = Runtime::Current()->CreateLinearAlloc();
+      }
+      return data.xposed_hook_allocator;
+    }
+  }
+  LOG(FATAL) << "Unregistered class loader " << class_loader;
+  UNREACHABLE();
+}
+
 void ClassLinker::LoadClassMembers(Thread* self,
                                    const DexFile& dex_file,
                                    const uint8_t* class_data,
@@ -5072,6 +5106,9 @@ void ClassLinker::RegisterClassLoader(mirror::ClassLoader* class_loader) {
   // Create and set the linear allocator.
   data.allocator = Runtime::Current()->CreateLinearAlloc();
   class_loader->SetAllocator(data.allocator);
+  data.xposed_hook_allocator = nullptr;
+  data.xposed_hook_infos = nullptr;
+  data.free_xposed_hook_infos = nullptr;
   // Add to the list so that we know to free the data later.
   class_loaders_.push_back(data);
 }
@@ -7994,6 +8031,30 @@ void ClassLinker::DumpForSigQuit(std::ostream& os) {
   ReaderMutexLock mu(soa.Self(), *Locks::classlinker_classes_lock_);
   os << "Zygote loaded classes=" << NumZygoteClasses() << " post zygote classes="
      << NumNonZygoteClasses() << "\n";
+  size_t num_hook_arenas = 0;
+  size_t hook_arena_bytes = 0;
+  size_t num_free_hooks = 0;
+  auto count_free_hooks = [&num_free_hooks](const XposedHookInfo* hook_info) {
+    for (; hook_info != nullptr; hook_info = hook_info->next_free) {
+      ++num_free_hooks;
+    }
+  };
+  if (boot_xposed_hook_allocator_ != nullptr) {
+    ++num_hook_arenas;
+    hook_arena_bytes += boot_xposed_hook_allocator_->GetUsedMemory();
+    count_free_hooks(boot_free_xposed_hook_infos_);
+  }
+  for (const ClassLoaderData& data : class_loaders_) {
+    if (data.xposed_hook_allocator != nullptr) {
+      ++num_hook_arenas;
+      hook_arena_bytes += data.xposed_hook_allocator->GetUsedMemory();
+      count_free_hooks(data.free_xposed_hook_infos);
+    }
+  }
+  if (num_hook_arenas != 0) {
+    os << "Xposed hook arenas=" << num_hook_arenas << " used=" << PrettySize(hook_arena_bytes)
+       << " free hooks=" << num_free_hooks << "\n";
+  }
 }
 
 class CountClassesVisitor : public ClassLoaderVisitor {
@@ -8242,17 +8303,79 @@ void ClassLinker::VisitClassLoaders(ClassLoaderVisitor* visitor) const {
 void ClassLinker::InsertDexFileInToClassLoader(mirror::Object* dex_file,
                                                mirror::ClassLoader* class_loader) {
   DCHECK(dex_file != nullptr);
+  InsertStrongRootInToClassLoader(dex_file, class_loader);
+}
+
+void ClassLinker::InsertStrongRootInToClassLoader(mirror::Object* root,
+                                                  mirror::ClassLoader* class_loader) {
+  DCHECK(root != nullptr);
   Thread* const self = Thread::Current();
   WriterMutexLock mu(self, *Locks::classlinker_classes_lock_);
   ClassTable* const table = ClassTableForClassLoader(class_loader);
   DCHECK(table != nullptr);
-  if (table->InsertStrongRoot(dex_file) && class_loader != nullptr) {
+  if (table->InsertStrongRoot(root) && class_loader != nullptr) {
     // It was not already inserted, perform the write barrier to let the GC know the class loader's
     // class table was modified.
     Runtime::Current()->GetHeap()->WriteBarrierEveryFieldOf(class_loader);
   }
 }
 
+void ClassLinker::AddXposedHookInfo(mirror::ClassLoader* class_loader, XposedHookInfo* hook_info) {
+  if (class_loader == nullptr) {
+    return;
+  }
+  WriterMutexLock mu(Thread::Current(), *Locks::classlinker_classes_lock_);
+  LinearAlloc* const allocator = class_loader->GetAllocator();
+  for (ClassLoaderData& data : class_loaders_) {
+    if (data.allocator == allocator) {
+      DCHECK(data.xposed_hook_allocator != nullptr);
+      hook_info->next_in_class_loader = data.xposed_hook_infos;
+      data.xposed_hook_infos = hook_info;
+      return;
+    }
+  }
+  LOG(FATAL) << "Unregistered class loader " << class_loader;
+  UNREACHABLE();
+}
+
+void ClassLinker::AddFreeXposedHookInfo(mirror::ClassLoader* class_loader,
+                                        XposedHookInfo* hook_info) {
+  WriterMutexLock mu(Thread::Current(), *Locks::classlinker_classes_lock_);
+  if (class_loader == nullptr) {
+    hook_info->next_free = boot_free_xposed_hook_infos_;
+    boot_free_xposed_hook_infos_ = hook_info;
+    return;
+  }
+  LinearAlloc* const allocator = class_loader->GetAllocator();
+  for (ClassLoaderData& data : class_loaders_) {
+    if (data.allocator == allocator) {
+      DCHECK(data.xposed_hook_allocator != nullptr);
+      hook_info->next_free = data.free_xposed_hook_infos;
+      data.free_xposed_hook_infos = hook_info;
+      return;
+    }
+  }
+  LOG(FATAL) << "Unregistered class loader " << class_loader;
+  UNREACHABLE();
+}
+
+XposedHookInfo* ClassLinker::TakeFreeXposedHookInfos(mirror::ClassLoader* class_loader) {
+  WriterMutexLock mu(Thread::Current(), *Locks::classlinker_classes_lock_);
+  XposedHookInfo* hook_infos = nullptr;
+  if (class_loader == nullptr) {
+    std::swap(hook_infos, boot_free_xposed_hook_infos_);
+    return hook_infos;
+  }
+  LinearAlloc* const allocator = class_loader->GetAllocator();
+  for (ClassLoaderData& data : class_loaders_) {
+    if (data.allocator == allocator) {
+      std::swap(hook_infos, data.free_xposed_hook_infos);
+      return hook_infos;
+    }
+  }
+  return nullptr;
+}
+
 void ClassLinker::CleanupClassLoaders() {
   Thread* const self = Thread::Current();
   std::vector<ClassLoaderData> to_delete;
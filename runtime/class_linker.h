@@ -61,6 +61,7 @@ template<class T> class ObjectLock;
 class Runtime;
 class ScopedObjectAccessAlreadyRunnable;
 template<size_t kNumReferences> class PACKED(4) StackHandleScope;
+struct XposedHookInfo;
 
 enum VisitRootFlags : uint8_t;
 
@@ -597,11 +598,41 @@ class ClassLinker {
       REQUIRES(!Locks::classlinker_classes_lock_)
       SHARED_REQUIRES(Locks::mutator_lock_);
 
+  // Return the arena holding the backups and hook information of the Xposed hooks of methods
+  // defined by a class loader, creating it if necessary. The arena is freed with the class loader.
+  LinearAlloc* GetOrCreateXposedHookAllocatorForClassLoader(mirror::ClassLoader* class_loader)
+      REQUIRES(!Locks::classlinker_classes_lock_)
+      SHARED_REQUIRES(Locks::mutator_lock_);
+
   // May be called with null class_loader due to legacy code. b/27954959
   void InsertDexFileInToClassLoader(mirror::Object* dex_file, mirror::ClassLoader* class_loader)
       REQUIRES(!Locks::classlinker_classes_lock_)
       SHARED_REQUIRES(Locks::mutator_lock_);
 
+  // Keeps `root` alive as long as `class_loader`, or forever for the boot class loader.
+  void InsertStrongRootInToClassLoader(mirror::Object* root, mirror::ClassLoader* class_loader)
+      REQUIRES(!Locks::classlinker_classes_lock_)
+      SHARED_REQUIRES(Locks::mutator_lock_);
+
+  // Records the hook information of a method defined by `class_loader`, so that its references
+  // are released when the class loader is unloaded. The hooks of the boot class path are never
+  // unloaded.
+  void AddXposedHookInfo(mirror::ClassLoader* class_loader, XposedHookInfo* hook_info)
+      REQUIRES(!Locks::classlinker_classes_lock_)
+      SHARED_REQUIRES(Locks::mutator_lock_);
+
+  // Keeps the released hook information of a method defined by `class_loader`, and its backup, for
+  // the hooks of later methods of the same class loader.
+  void AddFreeXposedHookInfo(mirror::ClassLoader* class_loader, XposedHookInfo* hook_info)
+      REQUIRES(!Locks::classlinker_classes_lock_)
+      SHARED_REQUIRES(Locks::mutator_lock_);
+
+  // Removes the released hook information of `class_loader` and returns it, linked through
+  // next_free.
+  XposedHookInfo* TakeFreeXposedHookInfos(mirror::ClassLoader* class_loader)
+      REQUIRES(!Locks::classlinker_classes_lock_)
+      SHARED_REQUIRES(Locks::mutator_lock_);
+
   static bool ShouldUseInterpreterEntrypoint(ArtMethod* method, const void* quick_code)
       SHARED_REQUIRES(Locks::mutator_lock_);
 
@@ -667,6 +698,12 @@ class ClassLinker {
     jweak weak_root;  // Weak root to enable class unloading.
     ClassTable* class_table;
     LinearAlloc* allocator;
+    // Backups and hook information of Xposed hooks, or null if no method is hooked.
+    LinearAlloc* xposed_hook_allocator;
+    // Hook information in `xposed_hook_allocator`, linked through next_in_class_loader.
+    XposedHookInfo* xposed_hook_infos;
+    // See AddFreeXposedHookInfo().
+    XposedHookInfo* free_xposed_hook_infos;
   };
 
   // Ensures that the supertype of 'klass' ('supertype') is verified. Returns false and throws
@@ -1134,6 +1171,11 @@ class ClassLinker {
   // Boot class path table. Since the class loader for this is null.
   ClassTable boot_class_table_ GUARDED_BY(Locks::classlinker_classes_lock_);
 
+  // Xposed hook arena of the boot class path, created on demand.
+  LinearAlloc* boot_xposed_hook_allocator_ GUARDED_BY(Locks::classlinker_classes_lock_);
+  // See AddFreeXposedHookInfo().
+  XposedHookInfo* boot_free_xposed_hook_infos_ GUARDED_BY(Locks::classlinker_classes_lock_);
+
   // New class roots, only used by CMS since the GC needs to mark these in the pause.
   std::vector<GcRoot<mirror::Class>> new_class_roots_ GUARDED_BY(Locks::classlinker_classes_lock_);
 
@@ -1176,6 +1218,8 @@ class ClassLinker {
   friend class ImageWriter;  // for GetClassRoots
   friend class JniCompilerTest;  // for GetRuntimeQuickGenericJniStub
   friend class JniInternalTest;  // for GetRuntimeQuickGenericJniStub
+  friend class XposedHookTest;  // for ClassTableForClassLoader and boot_xposed_hook_allocator_
+  friend class ProfileClassPreloader;  // for DexLock and VisitClassLoaders
   ART_FRIEND_TEST(ClassLinkerTest, RegisterDexFileName);  // for DexLock, and RegisterDexFileLocked
   ART_FRIEND_TEST(mirror::DexCacheTest, Open);  // for AllocDexCache
   DISALLOW_COPY_AND_ASSIGN(ClassLinker);
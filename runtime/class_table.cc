@@ -91,6 +91,11 @@ size_t ClassTable::NumNonZygoteClasses() const {
   return classes_.back().Size();
 }
 
+size_t ClassTable::NumStrongRoots() const {
+  ReaderMutexLock mu(Thread::Current(), lock_);
+  return strong_roots_.size();
+}
+
 mirror::Class* ClassTable::Lookup(const char* descriptor, size_t hash) {
   ReaderMutexLock mu(Thread::Current(), lock_);
   for (ClassSet& class_set : classes_) {
@@ -162,6 +167,17 @@ bool ClassTable::InsertStrongRoot(mirror::Object* obj) {
   return true;
 }
 
+bool ClassTable::ContainsStrongRoot(mirror::Object* obj) {
+  ReaderMutexLock mu(Thread::Current(), lock_);
+  DCHECK(obj != nullptr);
+  for (GcRoot<mirror::Object>& root : strong_roots_) {
+    if (root.Read() == obj) {
+      return true;
+    }
+  }
+  return false;
+}
+
 size_t ClassTable::WriteToMemory(uint8_t* ptr) const {
   ReaderMutexLock mu(Thread::Current(), lock_);
   ClassSet combined;
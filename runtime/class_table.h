@@ -86,6 +86,9 @@ class ClassTable {
   // Returns all off the classes in the lastest snapshot.
   size_t NumNonZygoteClasses() const REQUIRES(!lock_);
 
+  // Returns the number of objects added with InsertStrongRoot().
+  size_t NumStrongRoots() const REQUIRES(!lock_);
+
   // Update a class in the table with the new class. Returns the existing class which was replaced.
   mirror::Class* UpdateClass(const char* descriptor, mirror::Class* new_klass, size_t hash)
       REQUIRES(!lock_)
@@ -138,6 +141,11 @@ class ClassTable {
       REQUIRES(!lock_)
       SHARED_REQUIRES(Locks::mutator_lock_);
 
+  // Return true if obj is one of the strong roots.
+  bool ContainsStrongRoot(mirror::Object* obj)
+      REQUIRES(!lock_)
+      SHARED_REQUIRES(Locks::mutator_lock_);
+
   // Combines all of the tables into one class set.
   size_t WriteToMemory(uint8_t* ptr) const
       REQUIRES(!lock_)
@@ -146,19 +146,19 @@ JValue InvokeProxyInvocationHandler(ScopedObjectAccessAlreadyRunnable& soa, cons
   const JValue zero;
   int32_t target_sdk_version = Runtime::Current()->GetTargetSdkVersion();
   // Do not create empty arrays unless needed to maintain Dalvik bug compatibility.
-  if (args.size() > 0 || (target_sdk_version > 0 && target_sdk_version <= 21)) {
-    args_jobj = soa.Env()->NewObjectArray(args.size(), WellKnownClasses::java_lang_Object, nullptr);
+  if (num_args > 0 || (target_sdk_version > 0 && target_sdk_version <= 21)) {
+    args_jobj = soa.Env()->NewObjectArray(num_args, WellKnownClasses::java_lang_Object, nullptr);
     if (args_jobj == nullptr) {
       CHECK(soa.Self()->IsExceptionPending());
       return zero;
     }
-    for (size_t i = 0; i < args.size(); ++i) {
+    for (size_t i = 0; i < num_args; ++i) {
       if (shorty[i + 1] == 'L') {
-        jobject val = args.at(i).l;
+        jobject val = args[i].l;
         soa.Env()->SetObjectArrayElement(args_jobj, i, val);
       } else {
         JValue jv;
-        jv.SetJ(args.at(i).j);
+        jv.SetJ(args[i].j);
         mirror::Object* val = BoxPrimitive(Primitive::GetType(shorty[i + 1]), jv);
         if (val == nullptr) {
           CHECK(soa.Self()->IsExceptionPending());
@@ -234,39 +234,219 @@ JValue InvokeProxyInvocationHandler(ScopedObjectAccessAlreadyRunnable& soa, cons
   }
 }
 
-JValue InvokeXposedHandleHookedMethod(ScopedObjectAccessAlreadyRunnable& soa, const char* shorty,
-                                    jobject rcvr_jobj, jmethodID method,
-                                    std::vector<jvalue>& args) {
+// Layout of the Xposed box cache: the Boolean boxes for false and true, followed by the Byte,
+// Character, Short, Integer and Long boxes of the values cached by the respective valueOf() methods.
+// Taking the boxes from those caches keeps identity comparisons in callbacks working as they
+// would with boxes created by managed code.
+static constexpr int32_t kXposedBoxCacheLow = -128;
+static constexpr int32_t kXposedBoxCacheHigh = 127;
+static constexpr int32_t kXposedBoxCacheRange = kXposedBoxCacheHigh - kXposedBoxCacheLow + 1;
+static constexpr int32_t kXposedBoxCacheBooleanStart = 0;
+static constexpr int32_t kXposedBoxCacheByteStart = kXposedBoxCacheBooleanStart + 2;
+static constexpr int32_t kXposedBoxCacheCharStart = kXposedBoxCacheByteStart + kXposedBoxCacheRange;
+static constexpr int32_t kXposedBoxCacheShortStart =
+    kXposedBoxCacheCharStart + kXposedBoxCacheHigh + 1;
+static constexpr int32_t kXposedBoxCacheIntStart = kXposedBoxCacheShortStart + kXposedBoxCacheRange;
+static constexpr int32_t kXposedBoxCacheLongStart = kXposedBoxCacheIntStart + kXposedBoxCacheRange;
+static constexpr int32_t kXposedBoxCacheSize = kXposedBoxCacheLongStart + kXposedBoxCacheRange;
+
+// Longest arguments array kept in the per-thread pool of reusable arguments arrays.
+static constexpr int32_t kXposedArgsPoolMaxLength = 8;
+
+// Returns the index of the box of `value` in the Xposed box cache, or -1 if it is not cached.
+static int32_t XposedBoxCacheIndex(Primitive::Type type, const JValue& value) {
+  switch (type) {
+    case Primitive::kPrimBoolean:
+      return kXposedBoxCacheBooleanStart + (value.GetZ() != 0 ? 1 : 0);
+    case Primitive::kPrimByte:
+      return kXposedBoxCacheByteStart + (value.GetB() - kXposedBoxCacheLow);
+    case Primitive::kPrimChar:
+      return (value.GetC() <= kXposedBoxCacheHigh) ? kXposedBoxCacheCharStart + value.GetC() : -1;
+    case Primitive::kPrimShort:
+      return (value.GetS() >= kXposedBoxCacheLow && value.GetS() <= kXposedBoxCacheHigh)
+          ? kXposedBoxCacheShortStart + (value.GetS() - kXposedBoxCacheLow)
+          : -1;
+    case Primitive::kPrimInt:
+      return (value.GetI() >= kXposedBoxCacheLow && value.GetI() <= kXposedBoxCacheHigh)
+          ? kXposedBoxCacheIntStart + (value.GetI() - kXposedBoxCacheLow)
+          : -1;
+    case Primitive::kPrimLong:
+      return (value.GetJ() >= kXposedBoxCacheLow && value.GetJ() <= kXposedBoxCacheHigh)
+          ? kXposedBoxCacheLongStart + static_cast<int32_t>(value.GetJ() - kXposedBoxCacheLow)
+          : -1;
+    default:
+      return -1;
+  }
+}
+
+bool InitXposedBoxCache(Thread* self) {
+  Runtime* runtime = Runtime::Current();
+  if (runtime->GetXposedBoxCache() != nullptr) {
+    return true;
+  }
+  StackHandleScope<1> hs(self);
+  Handle<mirror::ObjectArray<mirror::Object>> cache(hs.NewHandle(
+      mirror::ObjectArray<mirror::Object>::Alloc(
+          self,
+          runtime->GetClassLinker()->GetClassRoot(ClassLinker::kObjectArrayClass),
+          kXposedBoxCacheSize)));
+  if (cache.Get() == nullptr) {
+    self->AssertPendingOOMException();
+    return false;
+  }
+  static const Primitive::Type kCachedTypes[] = {
+      Primitive::kPrimBoolean, Primitive::kPrimByte, Primitive::kPrimChar, Primitive::kPrimShort,
+      Primitive::kPrimInt, Primitive::kPrimLong };
+  for (Primitive::Type type : kCachedTypes) {
+    for (int32_t v = kXposedBoxCacheLow; v <= kXposedBoxCacheHigh; ++v) {
+      JValue value;
+      switch (type) {
+        case Primitive::kPrimBoolean: value.SetZ(v & 1); break;
+        case Primitive::kPrimByte: value.SetB(v); break;
+        case Primitive::kPrimChar: value.SetC(v); break;
+        case Primitive::kPrimShort: value.SetS(v); break;
+        case Primitive::kPrimInt: value.SetI(v); break;
+        default: value.SetJ(v); break;
+      }
+      int32_t index = XposedBoxCacheIndex(type, value);
+      if (index < 0 || cache->GetWithoutChecks(index) != nullptr) {
+        continue;
+      }
+      // This can cause thread suspension.
+      mirror::Object* box = BoxPrimitive(type, value);
+      if (box == nullptr) {
+        DCHECK(self->IsExceptionPending());
+        return false;
+      }
+      cache->SetWithoutChecks<false>(index, box);
+    }
+  }
+  // Racing initializations all produce equivalent caches, so the last one simply wins.
+  runtime->SetXposedBoxCache(cache.Get());
+  return true;
+}
+
+// Boxes an argument of a hooked method, preferring a cached box over calling into valueOf().
+static mirror::Object* BoxXposedArgument(Primitive::Type type, const JValue& value)
+    SHARED_REQUIRES(Locks::mutator_lock_) {
+  mirror::ObjectArray<mirror::Object>* cache = Runtime::Current()->GetXposedBoxCache();
+  if (LIKELY(cache != nullptr)) {
+    int32_t index = XposedBoxCacheIndex(type, value);
+    if (index >= 0) {
+      return cache->GetWithoutChecks(index);
+    }
+  }
+  return BoxPrimitive(type, value);
+}
+
+// Takes an arguments array of the given length out of the thread's pool, allocating the array
+// (and the pool) if needed. The array is not handed out again until it is released, so nested
+// hooked calls get their own. Returns null with a pending exception on allocation failure.
+static mirror::ObjectArray<mirror::Object>* AcquireXposedArgsArray(Thread* self, int32_t length)
+    SHARED_REQUIRES(Locks::mutator_lock_) {
+  DCHECK_LE(length, kXposedArgsPoolMaxLength);
+  ClassLinker* class_linker = Runtime::Current()->GetClassLinker();
+  mirror::ObjectArray<mirror::Object>* pool = self->GetXposedArgsPool();
+  if (UNLIKELY(pool == nullptr)) {
+    // This can cause thread suspension.
+    pool = mirror::ObjectArray<mirror::Object>::Alloc(
+        self, class_linker->GetClassRoot(ClassLinker::kObjectArrayClass),
+        kXposedArgsPoolMaxLength + 1);
+    if (pool == nullptr) {
+      return nullptr;
+    }
+    self->SetXposedArgsPool(pool);
+  }
+  mirror::Object* array = pool->GetWithoutChecks(length);
+  if (LIKELY(array != nullptr)) {
+    pool->SetWithoutChecks<false>(length, nullptr);
+    return array->AsObjectArray<mirror::Object>();
+  }
+  // This can cause thread suspension.
+  return mirror::ObjectArray<mirror::Object>::Alloc(
+      self, class_linker->GetClassRoot(ClassLinker::kObjectArrayClass), length);
+}
+
+// Clears an arguments array and puts it back into the thread's pool.
+static void ReleaseXposedArgsArray(Thread* self, mirror::ObjectArray<mirror::Object>* array)
+    SHARED_REQUIRES(Locks::mutator_lock_) {
+  mirror::ObjectArray<mirror::Object>* pool = self->GetXposedArgsPool();
+  DCHECK(pool != nullptr);
+  int32_t length = array->GetLength();
+  for (int32_t i = 0; i < length; ++i) {
+    array->SetWithoutChecks<false>(i, nullptr);
+  }
+  pool->SetWithoutChecks<false>(length, array);
+}
+
+// Builds the Object[] of boxed arguments passed to Xposed callbacks, taking it from the thread's
+// pool if `reuse_args` is set. Returns false with a pending exception on failure.
+static bool BoxXposedArguments(ScopedObjectAccessAlreadyRunnable& soa, bool reuse_args,
+                               const char* shorty, const jvalue* args, size_t num_args,
+                               jobjectArray* args_jobj)
+    SHARED_REQUIRES(Locks::mutator_lock_) {
   // Build argument array possibly triggering GC.
   soa.Self()->AssertThreadSuspensionIsAllowable();
-  jobjectArray args_jobj = nullptr;
-  const JValue zero;
+  *args_jobj = nullptr;
   int32_t target_sdk_version = Runtime::Current()->GetTargetSdkVersion();
   // Do not create empty arrays unless needed to maintain Dalvik bug compatibility.
-  if (args.size() > 0 || (target_sdk_version > 0 && target_sdk_version <= 21)) {
-    args_jobj = soa.Env()->NewObjectArray(args.size(), WellKnownClasses::java_lang_Object, nullptr);
-    if (args_jobj == nullptr) {
+  if (num_args == 0 && (target_sdk_version <= 0 || target_sdk_version > 21)) {
+    return true;
+  }
+  if (reuse_args) {
+    mirror::ObjectArray<mirror::Object>* array =
+        AcquireXposedArgsArray(soa.Self(), static_cast<int32_t>(num_args));
+    if (array == nullptr) {
       CHECK(soa.Self()->IsExceptionPending());
-      return zero;
+      return false;
     }
-    for (size_t i = 0; i < args.size(); ++i) {
-      if (shorty[i + 1] == 'L') {
-        jobject val = args.at(i).l;
-        soa.Env()->SetObjectArrayElement(args_jobj, i, val);
-      } else {
-        JValue jv;
-        jv.SetJ(args.at(i).j);
-        mirror::Object* val = BoxPrimitive(Primitive::GetType(shorty[i + 1]), jv);
-        if (val == nullptr) {
-          CHECK(soa.Self()->IsExceptionPending());
-          return zero;
+    *args_jobj = soa.AddLocalReference<jobjectArray>(array);
+  } else {
+    *args_jobj = soa.Env()->NewObjectArray(num_args, WellKnownClasses::java_lang_Object, nullptr);
+    if (*args_jobj == nullptr) {
+      CHECK(soa.Self()->IsExceptionPending());
+      return false;
+    }
+  }
+  for (size_t i = 0; i < num_args; ++i) {
+    if (shorty[i + 1] == 'L') {
+      jobject val = args[i].l;
+      soa.Env()->SetObjectArrayElement(*args_jobj, i, val);
+    } else {
+      JValue jv;
+      jv.SetJ(args[i].j);
+      mirror::Object* val = BoxXposedArgument(Primitive::GetType(shorty[i + 1]), jv);
+      if (val == nullptr) {
+        CHECK(soa.Self()->IsExceptionPending());
+        if (reuse_args) {
+          ReleaseXposedArgsArray(soa.Self(),
+                                 soa.Decode<mirror::ObjectArray<mirror::Object>*>(*args_jobj));
         }
-        soa.Decode<mirror::ObjectArray<mirror::Object>* >(args_jobj)->Set<false>(i, val);
+        *args_jobj = nullptr;
+        return false;
       }
+      soa.Decode<mirror::ObjectArray<mirror::Object>* >(*args_jobj)->Set<false>(i, val);
     }
   }
+  return true;
+}
 
-  const XposedHookInfo* hookInfo = soa.DecodeMethod(method)->GetXposedHookInfo();
+static bool CanReuseXposedArgs(const XposedHookInfo* hook_info, size_t num_args) {
+  return (hook_info->flags & kXposedHookNonEscapingArgs) != 0 &&
+      num_args <= static_cast<size_t>(kXposedArgsPoolMaxLength);
+}
+
+JValue InvokeXposedHandleHookedMethod(ScopedObjectAccessAlreadyRunnable& soa,
+                                      const XposedHookInfo* hookInfo, const char* shorty,
+                                      jobject rcvr_jobj, jmethodID method,
+                                      const jvalue* args, size_t num_args) {
+  // Arrays the callback does not keep a reference to are taken from a per-thread pool.
+  const bool reuse_args = CanReuseXposedArgs(hookInfo, num_args);
+  const JValue zero;
+  jobjectArray args_jobj;
+  if (!BoxXposedArguments(soa, reuse_args, shorty, args, num_args, &args_jobj)) {
+    return zero;
+  }
 
   // Call XposedBridge.handleHookedMethod(Member method, int originalMethodId, Object additionalInfoObj,
   //                                      Object thisObject, Object[] args)
@@ -281,6 +461,10 @@ JValue InvokeXposedHandleHookedMethod(ScopedObjectAccessAlreadyRunnable& soa, co
                                          ArtMethod::xposed_callback_method,
                                          invocation_args);
 
+  if (reuse_args && args_jobj != nullptr) {
+    ReleaseXposedArgsArray(soa.Self(),
+                           soa.Decode<mirror::ObjectArray<mirror::Object>*>(args_jobj));
+  }
 
   // Unbox the result if necessary and return it.
   if (UNLIKELY(soa.Self()->IsExceptionPending())) {
@@ -302,6 +486,66 @@ JValue InvokeXposedHandleHookedMethod(ScopedObjectAccessAlreadyRunnable& soa, co
   }
 }
 
+void NotifyXposedObservers(ScopedObjectAccessAlreadyRunnable& soa, const XposedHookInfo* hook_info,
+                           const char* shorty, jobject rcvr_jobj, const jvalue* args,
+                           size_t num_args, JValue* result) {
+  const XposedHookObservers& observers = hook_info->observers;
+  const bool after = result != nullptr;
+  XposedHookObserver native_observer = after ? observers.native_after : observers.native_before;
+  jmethodID managed_observer = after ? observers.managed_after : observers.managed_before;
+  if (native_observer == nullptr && managed_observer == nullptr) {
+    return;
+  }
+
+  // The observers may cause thread suspension, keep a reference result in a local reference.
+  jvalue result_jvalue;
+  result_jvalue.j = after ? result->GetJ() : 0;
+  const bool reference_result = after && shorty[0] == 'L';
+  if (reference_result) {
+    result_jvalue.l = soa.AddLocalReference<jobject>(result->GetL());
+  }
+
+  if (native_observer != nullptr) {
+    native_observer(soa.Env(), hook_info->reflectedMethod, rcvr_jobj, args, num_args,
+                    after ? &result_jvalue : nullptr, observers.native_data);
+  }
+  if (managed_observer != nullptr && !soa.Self()->IsExceptionPending()) {
+    const bool reuse_args = CanReuseXposedArgs(hook_info, num_args);
+    jobjectArray args_jobj;
+    if (BoxXposedArguments(soa, reuse_args, shorty, args, num_args, &args_jobj)) {
+      jvalue invocation_args[5];
+      invocation_args[0].l = hook_info->reflectedMethod;
+      invocation_args[1].l = hook_info->additionalInfo;
+      invocation_args[2].l = rcvr_jobj;
+      invocation_args[3].l = args_jobj;
+      invocation_args[4].l = nullptr;
+      if (after && shorty[0] != 'V') {
+        if (reference_result) {
+          invocation_args[4].l = result_jvalue.l;
+        } else {
+          JValue jv;
+          jv.SetJ(result_jvalue.j);
+          // This can cause thread suspension.
+          invocation_args[4].l = soa.AddLocalReference<jobject>(
+              BoxXposedArgument(Primitive::GetType(shorty[0]), jv));
+        }
+      }
+      if (!soa.Self()->IsExceptionPending()) {
+        soa.Env()->CallStaticVoidMethodA(observers.managed_class, managed_observer,
+                                         invocation_args);
+      }
+      if (reuse_args && args_jobj != nullptr) {
+        ReleaseXposedArgsArray(soa.Self(),
+                               soa.Decode<mirror::ObjectArray<mirror::Object>*>(args_jobj));
+      }
+    }
+  }
+
+  if (reference_result) {
+    result->SetL(soa.Decode<mirror::Object*>(result_jvalue.l));
+  }
+}
+
 bool FillArrayData(mirror::Object* obj, const Instruction::ArrayDataPayload* payload) {
   DCHECK_EQ(payload->ident, static_cast<uint16_t>(Instruction::kArrayDataSignature));
   if (UNLIKELY(obj == nullptr)) {
@@ -42,6 +42,7 @@ class ArtMethod;
 class OatQuickMethodHeader;
 class ScopedObjectAccessAlreadyRunnable;
 class Thread;
+struct XposedHookInfo;
 
 template <const bool kAccessCheck>
 ALWAYS_INLINE inline mirror::Class* CheckObjectAlloc(uint32_t type_idx,
@@ -173,9 +174,21 @@ JValue InvokeProxyInvocationHandler(ScopedObjectAccessAlreadyRunnable& soa, cons
                                     std::vector<jvalue>& args)
     SHARED_REQUIRES(Locks::mutator_lock_);
 
-JValue InvokeXposedHandleHookedMethod(ScopedObjectAccessAlreadyRunnable& soa, const char* shorty,
-                                    jobject rcvr_jobj, jmethodID method,
-                                    std::vector<jvalue>& args)
+// Creates the cache of boxed small primitive values passed to Xposed hook callbacks, unless it
+// exists already. Returns false with a pending exception on failure.
+bool InitXposedBoxCache(Thread* self) SHARED_REQUIRES(Locks::mutator_lock_);
+
+JValue InvokeXposedHandleHookedMethod(ScopedObjectAccessAlreadyRunnable& soa,
+                                      const XposedHookInfo* hook_info, const char* shorty,
+                                      jobject rcvr_jobj, jmethodID method,
+                                      const jvalue* args, size_t num_args)
+    SHARED_REQUIRES(Locks::mutator_lock_);
+
+// Calls the observers of a method hooked with kXposedHookObserveOnly. `result` is null before the
+// original method is called, afterwards it holds its result, updated if the observers moved it.
+void NotifyXposedObservers(ScopedObjectAccessAlreadyRunnable& soa, const XposedHookInfo* hook_info,
+                           const char* shorty, jobject rcvr_jobj, const jvalue* args,
+                           size_t num_args, JValue* result)
     SHARED_REQUIRES(Locks::mutator_lock_);
 
 bool FillArrayData(mirror::Object* obj, const Instruction::ArrayDataPayload* payload)
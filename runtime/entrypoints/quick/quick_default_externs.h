@@ -113,6 +113,7 @@ extern "C" void art_quick_invoke_virtual_trampoline_with_access_check(uint32_t,
 
 // Thread entrypoints.
 extern "C" void art_quick_test_suspend();
+extern "C" void art_quick_jit_baseline_code_is_hot();
 
 // Throw entrypoints.
 extern "C" void art_quick_deliver_exception(art::mirror::Object*);
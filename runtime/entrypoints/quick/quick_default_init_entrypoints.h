@@ -106,6 +106,7 @@ void DefaultInitEntryPoints(JniEntryPoints* jpoints, QuickEntryPoints* qpoints)
 
   // Thread
   qpoints->pTestSuspend = art_quick_test_suspend;
+  qpoints->pJitBaselineCodeIsHot = art_quick_jit_baseline_code_is_hot;
 
   // Throws
   qpoints->pDeliverException = art_quick_deliver_exception;
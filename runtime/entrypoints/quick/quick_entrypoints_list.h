@@ -133,6 +133,7 @@
   V(InvokeVirtualTrampolineWithAccessCheck, void, uint32_t, void*) \
 \
   V(TestSuspend, void, void) \
+  V(JitBaselineCodeIsHot, void, void) \
 \
   V(DeliverException, void, mirror::Object*) \
   V(ThrowArrayBounds, void, int32_t, int32_t) \
@@ -124,6 +124,10 @@ extern uint64_t GenericJniMethodEnd(Thread* self,
     // TODO: NO_THREAD_SAFETY_ANALYSIS as GoToRunnable() is NO_THREAD_SAFETY_ANALYSIS
     NO_THREAD_SAFETY_ANALYSIS {
   GoToRunnable(self);
+  if (UNLIKELY(called->IsXposedHookedMethod())) {
+    // The method was hooked while its native code was running, the frame belongs to the backup.
+    called = called->GetXposedOriginalMethod();
+  }
   // We need the mutator lock (i.e., calling GoToRunnable()) before accessing the shorty or the
   // locked object.
   jobject locked = called->IsSynchronized() ? handle_scope->GetHandle(0).ToJObject() : nullptr;
@@ -14,7 +14,9 @@
  * limitations under the License.
  */
 
+#include "art_method.h"
 #include "callee_save_frame.h"
+#include "jit/jit.h"
 #include "thread-inl.h"
 
 namespace art {
@@ -25,4 +27,22 @@ extern "C" void artTestSuspendFromCode(Thread* self) SHARED_REQUIRES(Locks::muta
   self->CheckSuspend();
 }
 
+extern "C" void artJitBaselineCodeIsHotFromCode(Thread* self)
+    SHARED_REQUIRES(Locks::mutator_lock_) {
+  // Called when the hotness countdown in the suspend checks of baseline JIT code reaches 0. The
+  // caller checks the thread flags after this returns.
+  ScopedQuickEntrypointChecks sqec(self);
+  jit::Jit* jit = Runtime::Current()->GetJit();
+  if (jit != nullptr) {
+    ArtMethod** sp = self->GetManagedStack()->GetTopQuickFrame();
+    DCHECK_EQ(*sp, Runtime::Current()->GetCalleeSaveMethod(Runtime::kRefsOnly));
+    ArtMethod* caller = *reinterpret_cast<ArtMethod**>(
+        reinterpret_cast<uintptr_t>(sp) + GetCalleeSaveFrameSize(kRuntimeISA, Runtime::kRefsOnly));
+    uintptr_t caller_pc = *reinterpret_cast<uintptr_t*>(
+        reinterpret_cast<uintptr_t>(sp) +
+        GetCalleeSaveReturnPcOffset(kRuntimeISA, Runtime::kRefsOnly));
+    jit->NotifyBaselineCodeIsHot(self, caller, reinterpret_cast<const void*>(caller_pc));
+  }
+}
+
 }  // namespace art
@@ -15,6 +15,7 @@
  */
 
 #include "art_method-inl.h"
+#include "base/time_utils.h"
 #include "callee_save_frame.h"
 #include "common_throws.h"
 #include "dex_file-inl.h"
@@ -35,6 +36,8 @@
 #include "runtime.h"
 #include "scoped_thread_state_change.h"
 #include "stack.h"
+#include "xposed_bridge.h"
+#include "xposed_hook_stats.h"
 #include "debugger.h"
 
 namespace art {
@@ -417,8 +420,11 @@ class QuickArgumentVisitor {
 
   uint64_t ReadSplitLongParam() const {
     // The splitted long is always available through the stack.
-    return *reinterpret_cast<uint64_t*>(stack_args_
-        + stack_index_ * kBytesStackArgLocation);
+    return *reinterpret_cast<uint64_t*>(GetSplitLongParamAddress());
+  }
+
+  uint8_t* GetSplitLongParamAddress() const {
+    return stack_args_ + stack_index_ * kBytesStackArgLocation;
   }
 
   void IncGprIndex() {
@@ -840,9 +846,7 @@ extern "C" uint64_t artQuickProxyInvokeHandler(
     ArtMethod* proxy_method, mirror::Object* receiver, Thread* self, ArtMethod** sp)
     SHARED_REQUIRES(Locks::mutator_lock_) {
   DCHECK(proxy_method->IsProxyMethod()) << PrettyMethod(proxy_method);
-  const bool is_xposed = proxy_method->IsXposedHookedMethod();
-  const bool is_static = proxy_method->IsStatic();
-  DCHECK(is_xposed || receiver->GetClass()->IsProxyClass()) << PrettyMethod(proxy_method);
+  DCHECK(receiver->GetClass()->IsProxyClass()) << PrettyMethod(proxy_method);
   // Ensure we don't get thread suspension until the object arguments are safely in jobjects.
   const char* old_cause =
       self->StartAssertNoThreadSuspension("Adding to IRT proxy object arguments");
@@ -854,30 +858,20 @@ extern "C" uint64_t artQuickProxyInvokeHandler(
   ScopedObjectAccessUnchecked soa(env);
   ScopedJniEnvLocalRefState env_state(env);
   // Create local ref. copies of proxy method and the receiver.
-  jobject rcvr_jobj = is_static ? nullptr : soa.AddLocalReference<jobject>(receiver);
+  jobject rcvr_jobj = soa.AddLocalReference<jobject>(receiver);
 
   // Placing arguments into args vector and remove the receiver.
   ArtMethod* non_proxy_method = proxy_method->GetInterfaceMethodIfProxy(sizeof(void*));
-  CHECK(is_xposed || !non_proxy_method->IsStatic()) << PrettyMethod(proxy_method) << " "
+  CHECK(!non_proxy_method->IsStatic()) << PrettyMethod(proxy_method) << " "
                                        << PrettyMethod(non_proxy_method);
   std::vector<jvalue> args;
   uint32_t shorty_len = 0;
   const char* shorty = non_proxy_method->GetShorty(&shorty_len);
-  BuildQuickArgumentVisitor local_ref_visitor(sp, is_static, shorty, shorty_len, &soa, &args);
+  BuildQuickArgumentVisitor local_ref_visitor(sp, false, shorty, shorty_len, &soa, &args);
 
   local_ref_visitor.VisitArguments();
-  if (!is_static) {
-    DCHECK_GT(args.size(), 0U) << PrettyMethod(proxy_method);
-    args.erase(args.begin());
-  }
-
-  if (is_xposed) {
-    jmethodID proxy_methodid = soa.EncodeMethod(proxy_method);
-    self->EndAssertNoThreadSuspension(old_cause);
-    JValue result = InvokeXposedHandleHookedMethod(soa, shorty, rcvr_jobj, proxy_methodid, args);
-    local_ref_visitor.FixupReferences();
-    return result.GetJ();
-  }
+  DCHECK_GT(args.size(), 0U) << PrettyMethod(proxy_method);
+  args.erase(args.begin());
 
   // Convert proxy method into expected interface method.
   ArtMethod* interface_method = proxy_method->FindOverriddenMethod(sizeof(void*));
@@ -895,6 +889,176 @@ extern "C" uint64_t artQuickProxyInvokeHandler(
   return result.GetJ();
 }
 
+// Number of arguments of a hooked method that are marshalled in a buffer on the native stack.
+// Methods taking more arguments are rare and use a heap allocated buffer instead.
+static constexpr size_t kXposedInlineArgumentCount = 16;
+
+// Records where the arguments of a hooked method are found in the quick frame of the hook
+// trampoline. The frame is never accessed, only the offsets of the argument addresses are used.
+class XposedBridgeSlotVisitor FINAL : public QuickArgumentVisitor {
+ public:
+  XposedBridgeSlotVisitor(ArtMethod** sp, bool is_static, const char* shorty, uint32_t shorty_len,
+                          std::vector<XposedBridge::Slot>* slots) :
+      QuickArgumentVisitor(sp, is_static, shorty, shorty_len),
+      frame_(reinterpret_cast<uint8_t*>(sp)), slots_(slots) {}
+
+  void Visit() SHARED_REQUIRES(Locks::mutator_lock_) OVERRIDE;
+
+ private:
+  uint8_t* const frame_;
+  std::vector<XposedBridge::Slot>* const slots_;
+
+  DISALLOW_COPY_AND_ASSIGN(XposedBridgeSlotVisitor);
+};
+
+void XposedBridgeSlotVisitor::Visit() {
+  XposedBridge::Slot slot;
+  uint8_t* address = GetParamAddress();
+  switch (GetParamPrimitiveType()) {
+    case Primitive::kPrimNot:
+      slot.kind = XposedBridge::SlotKind::kReference;
+      break;
+    case Primitive::kPrimLong:  // Fall-through.
+    case Primitive::kPrimDouble:
+      slot.kind = XposedBridge::SlotKind::kDoubleWord;
+      if (IsSplitLongOrDouble()) {
+        address = GetSplitLongParamAddress();
+      }
+      break;
+    case Primitive::kPrimBoolean:  // Fall-through.
+    case Primitive::kPrimByte:     // Fall-through.
+    case Primitive::kPrimChar:     // Fall-through.
+    case Primitive::kPrimShort:    // Fall-through.
+    case Primitive::kPrimInt:      // Fall-through.
+    case Primitive::kPrimFloat:
+      slot.kind = XposedBridge::SlotKind::kWord;
+      break;
+    case Primitive::kPrimVoid:
+      LOG(FATAL) << "UNREACHABLE";
+      UNREACHABLE();
+  }
+  slot.offset = dchecked_integral_cast<uint32_t>(address - frame_);
+  slots_->push_back(slot);
+}
+
+void ComputeXposedBridgeSlots(const char* shorty, uint32_t shorty_len, bool is_static,
+                              std::vector<XposedBridge::Slot>* slots) {
+  // Any address will do as the frame is not accessed.
+  ArtMethod* frame = nullptr;
+  XposedBridgeSlotVisitor visitor(&frame, is_static, shorty, shorty_len, slots);
+  visitor.VisitArguments();
+}
+
+// Calls the original method of a hooked method with the arguments of the hooked method's quick
+// frame, skipping the reflective Method.invoke() and the boxing of arguments and result.
+static JValue InvokeXposedOriginalMethod(ArtMethod* original_method, const XposedBridge* bridge,
+                                         Thread* self, ArtMethod** sp)
+    SHARED_REQUIRES(Locks::mutator_lock_) {
+  const size_t max_words = bridge->GetMaxArgArrayWords();
+  uint32_t inline_arg_array[1 + 2 * kXposedInlineArgumentCount];
+  std::unique_ptr<uint32_t[]> heap_arg_array;
+  uint32_t* arg_array = inline_arg_array;
+  if (UNLIKELY(max_words > arraysize(inline_arg_array))) {
+    heap_arg_array.reset(new uint32_t[max_words]);
+    arg_array = heap_arg_array.get();
+  }
+  const char* old_cause = self->StartAssertNoThreadSuspension("Invoking Xposed original method");
+  const uint32_t num_bytes = bridge->ReadArgArray(sp, arg_array);
+  self->EndAssertNoThreadSuspension(old_cause);
+  JValue result;
+  original_method->Invoke(self, arg_array, num_bytes, &result, bridge->GetShorty());
+  return result;
+}
+
+// Handler for invocation on methods hooked by Xposed. On entry a frame will exist for the hooked
+// method which is responsible for recording callee save registers. Unlike proxy methods, there is
+// no interface method to look up, so the bridge of the method's shorty copies the arguments
+// straight into a fixed size buffer, which is handed to XposedBridge.handleHookedMethod.
+// Observe-only hooks call their observers around a direct call of the original method instead.
+extern "C" uint64_t artQuickXposedInvokeHandler(
+    ArtMethod* hooked_method, mirror::Object* receiver ATTRIBUTE_UNUSED, Thread* self,
+    ArtMethod** sp)
+    SHARED_REQUIRES(Locks::mutator_lock_) {
+  DCHECK(hooked_method->IsXposedHookedMethod()) << PrettyMethod(hooked_method);
+  if (UNLIKELY(self->GetXposedHookEpoch() != Runtime::Current()->GetXposedHookEpoch())) {
+    // Catch up with the hooks installed since the last call, before this frame can be walked.
+    ArtMethod::FixupXposedHookedFrames(self, sp);
+  }
+  // The hook may be disabled during the call. The method must not be asked for its hook
+  // information anymore after the first suspension point.
+  const XposedHookInfo* hook_info = hooked_method->GetXposedHookInfo();
+  // Statistics are only collected for hooks installed with -XX:XposedHookStats.
+  XposedHookSample sample = { hook_info->stats, 0, 0, 0 };
+  const uint64_t start_ns = UNLIKELY(sample.stats != nullptr) ? NanoTime() : 0;
+  // Ensure we don't get thread suspension until the object arguments are safely in jobjects.
+  const char* old_cause =
+      self->StartAssertNoThreadSuspension("Adding to IRT Xposed hooked method arguments");
+  // Register the top of the managed stack, making stack crawlable.
+  DCHECK_EQ((*sp), hooked_method) << PrettyMethod(hooked_method);
+  self->VerifyStack();
+  // Start new JNI local reference state.
+  JNIEnvExt* env = self->GetJniEnv();
+  ScopedObjectAccessUnchecked soa(env);
+  ScopedJniEnvLocalRefState env_state(env);
+
+  const XposedBridge* const bridge = hook_info->bridge;
+  DCHECK_EQ(bridge->IsStatic(), hooked_method->IsStatic()) << PrettyMethod(hooked_method);
+  const char* shorty = bridge->GetShorty();
+  const size_t num_params = bridge->GetNumberOfArgs();
+  jvalue inline_args[kXposedInlineArgumentCount];
+  std::unique_ptr<jvalue[]> heap_args;
+  jvalue* args = inline_args;
+  if (UNLIKELY(num_params > kXposedInlineArgumentCount)) {
+    heap_args.reset(new jvalue[num_params]);
+    args = heap_args.get();
+  }
+  jobject receiver_jobj = bridge->ReadArguments(soa, sp, args);
+
+  jmethodID hooked_methodid = soa.EncodeMethod(hooked_method);
+  self->EndAssertNoThreadSuspension(old_cause);
+
+  // All naked Object*s should now be in jobjects, so its safe to go into the main invoke code
+  // that performs allocations.
+  JValue result;
+  if ((hook_info->flags & kXposedHookObserveOnly) != 0) {
+    NotifyXposedObservers(soa, hook_info, shorty, receiver_jobj, args, num_params, nullptr);
+    if (LIKELY(!self->IsExceptionPending())) {
+      // The original method reads its arguments from this frame, which must not hold references
+      // moved by the observers.
+      bridge->WriteBackReferences(soa, sp, receiver_jobj, args);
+      const uint64_t original_start_ns = UNLIKELY(sample.stats != nullptr) ? NanoTime() : 0;
+      result = InvokeXposedOriginalMethod(hook_info->originalMethod, bridge, self, sp);
+      if (UNLIKELY(sample.stats != nullptr)) {
+        sample.original_ns = NanoTime() - original_start_ns;
+      }
+      if (LIKELY(!self->IsExceptionPending())) {
+        NotifyXposedObservers(soa, hook_info, shorty, receiver_jobj, args, num_params, &result);
+      }
+    }
+  } else {
+    const uint64_t callback_start_ns = UNLIKELY(sample.stats != nullptr) ? NanoTime() : 0;
+    result = InvokeXposedHandleHookedMethod(soa, hook_info, shorty, receiver_jobj,
+                                            hooked_methodid, args, num_params);
+    if (UNLIKELY(sample.stats != nullptr)) {
+      sample.callback_ns = NanoTime() - callback_start_ns;
+    }
+  }
+  // Restore references which might have moved.
+  bridge->WriteBackReferences(soa, sp, receiver_jobj, args);
+  if (UNLIKELY(sample.stats != nullptr)) {
+    sample.total_ns = NanoTime() - start_ns;
+    if ((hook_info->flags & kXposedHookObserveOnly) != 0) {
+      // Everything but the original method is spent marshaling and notifying the observers.
+      sample.callback_ns = sample.total_ns - sample.original_ns;
+    }
+    Runtime::Current()->GetXposedHookProfiler()->RecordCall(self, sample);
+  }
+  if (UNLIKELY((hook_info->flags & kXposedHookDisabled) != 0)) {
+    ArtMethod::FinishDisabledXposedHookCall(self, hook_info);
+  }
+  return result.GetJ();
+}
+
 // Read object references held in arguments from quick frames and place in a JNI local references,
 // so they don't get garbage collected.
 class RememberForGcArgumentVisitor FINAL : public QuickArgumentVisitor {
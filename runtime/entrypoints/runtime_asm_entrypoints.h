@@ -52,6 +52,12 @@ static inline const void* GetQuickProxyInvokeHandler() {
   return reinterpret_cast<const void*>(art_quick_proxy_invoke_handler);
 }
 
+// Return the address of quick stub code for handling calls to methods hooked by Xposed.
+extern "C" void art_quick_xposed_invoke_handler();
+static inline const void* GetQuickXposedInvokeHandler() {
+  return reinterpret_cast<const void*>(art_quick_xposed_invoke_handler);
+}
+
 // Return the address of quick stub code for resolving a method at first call.
 extern "C" void art_quick_resolution_trampoline(ArtMethod*);
 static inline const void* GetQuickResolutionStub() {
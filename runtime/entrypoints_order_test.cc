@@ -136,7 +136,10 @@ class EntrypointsOrderTest : public CommonRuntimeTest {
     EXPECT_OFFSET_DIFFP(Thread, tlsPtr_, nested_signal_state, flip_function, sizeof(void*));
     EXPECT_OFFSET_DIFFP(Thread, tlsPtr_, flip_function, method_verifier, sizeof(void*));
     EXPECT_OFFSET_DIFFP(Thread, tlsPtr_, method_verifier, thread_local_mark_stack, sizeof(void*));
-    EXPECT_OFFSET_DIFF(Thread, tlsPtr_.thread_local_mark_stack, Thread, wait_mutex_, sizeof(void*),
+    EXPECT_OFFSET_DIFFP(Thread, tlsPtr_, thread_local_mark_stack, xposed_args_pool, sizeof(void*));
+    EXPECT_OFFSET_DIFFP(Thread, tlsPtr_, xposed_args_pool, xposed_hook_samples, sizeof(void*));
+    EXPECT_OFFSET_DIFFP(Thread, tlsPtr_, xposed_hook_samples, xposed_hook_epoch, sizeof(void*));
+    EXPECT_OFFSET_DIFF(Thread, tlsPtr_.xposed_hook_epoch, Thread, wait_mutex_, sizeof(void*),
                        thread_tlsptr_end);
   }
 
@@ -278,7 +281,9 @@ class EntrypointsOrderTest : public CommonRuntimeTest {
                          pInvokeVirtualTrampolineWithAccessCheck, sizeof(void*));
     EXPECT_OFFSET_DIFFNP(QuickEntryPoints, pInvokeVirtualTrampolineWithAccessCheck,
                          pTestSuspend, sizeof(void*));
-    EXPECT_OFFSET_DIFFNP(QuickEntryPoints, pTestSuspend, pDeliverException, sizeof(void*));
+    EXPECT_OFFSET_DIFFNP(QuickEntryPoints, pTestSuspend, pJitBaselineCodeIsHot, sizeof(void*));
+    EXPECT_OFFSET_DIFFNP(QuickEntryPoints, pJitBaselineCodeIsHot, pDeliverException,
+                         sizeof(void*));
 
     EXPECT_OFFSET_DIFFNP(QuickEntryPoints, pDeliverException, pThrowArrayBounds, sizeof(void*));
     EXPECT_OFFSET_DIFFNP(QuickEntryPoints, pThrowArrayBounds, pThrowDivZero, sizeof(void*));
@@ -0,0 +1,165 @@
+/*
+ * Copyright (C) 2016 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ART_RUNTIME_GC_ACCOUNTING_WORK_STEALING_DEQUE_H_
+#define ART_RUNTIME_GC_ACCOUNTING_WORK_STEALING_DEQUE_H_
+
+#include <memory>
+#include <vector>
+
+#include "atomic.h"
+#include "base/bit_utils.h"
+#include "base/logging.h"
+#include "base/macros.h"
+
+namespace art {
+namespace gc {
+namespace accounting {
+
+// Chase-Lev work-stealing deque of pointers to T. A single thread, the owner, pushes and pops at
+// the bottom end; other threads steal from the top end. Only taking the last element, or
+// stealing, needs a compare-and-swap. The memory orders follow "Correct and Efficient
+// Work-Stealing for Weak Memory Models" (Le et al., PPoPP 2013).
+// The deque grows when it is full. As a thief may still read from the buffers the deque grew out
+// of, those are only freed by Reset().
+template <typename T>
+class WorkStealingDeque {
+ public:
+  explicit WorkStealingDeque(size_t initial_capacity) : top_(0), bottom_(0) {
+    DCHECK(IsPowerOfTwo(initial_capacity)) << initial_capacity;
+    buffers_.emplace_back(new Buffer(initial_capacity));
+    buffer_.StoreRelaxed(buffers_.back().get());
+  }
+
+  // Pushes a non-null value at the bottom end. Only called by the owner.
+  void Push(T* value) {
+    DCHECK(value != nullptr);
+    const intptr_t bottom = bottom_.LoadRelaxed();
+    const intptr_t top = top_.LoadAcquire();
+    Buffer* buffer = buffer_.LoadRelaxed();
+    if (UNLIKELY(bottom - top >= static_cast<intptr_t>(buffer->Capacity()))) {
+      buffer = Grow(buffer, top, bottom);
+    }
+    buffer->Set(bottom, value);
+    QuasiAtomic::ThreadFenceRelease();
+    bottom_.StoreRelaxed(bottom + 1);
+  }
+
+  // Pops the value at the bottom end. Returns null if the deque is empty, or if a thief stole the
+  // last value first. Only called by the owner.
+  T* Pop() {
+    const intptr_t bottom = bottom_.LoadRelaxed() - 1;
+    Buffer* buffer = buffer_.LoadRelaxed();
+    bottom_.StoreRelaxed(bottom);
+    QuasiAtomic::ThreadFenceSequentiallyConsistent();
+    const intptr_t top = top_.LoadRelaxed();
+    if (top > bottom) {
+      bottom_.StoreRelaxed(bottom + 1);
+      return nullptr;
+    }
+    T* value = buffer->Get(bottom);
+    if (top == bottom) {
+      // The last value, which the thieves compete for.
+      if (!top_.CompareExchangeStrongSequentiallyConsistent(top, top + 1)) {
+        value = nullptr;
+      }
+      bottom_.StoreRelaxed(bottom + 1);
+    }
+    return value;
+  }
+
+  // Steals the value at the top end. Returns null if the deque is empty, or if another thread took
+  // the value first. May be called by any thread.
+  T* Steal() {
+    const intptr_t top = top_.LoadAcquire();
+    QuasiAtomic::ThreadFenceSequentiallyConsistent();
+    const intptr_t bottom = bottom_.LoadAcquire();
+    if (top >= bottom) {
+      return nullptr;
+    }
+    T* value = buffer_.LoadAcquire()->Get(top);
+    if (!top_.CompareExchangeStrongSequentiallyConsistent(top, top + 1)) {
+      return nullptr;
+    }
+    return value;
+  }
+
+  // May be called by any thread, in which case the result may be stale by the time it returns.
+  bool IsEmpty() const {
+    return bottom_.LoadAcquire() <= top_.LoadAcquire();
+  }
+
+  // Empties the deque and frees the buffers it grew out of, keeping the largest one. Only called
+  // by the owner, when no other thread accesses the deque.
+  void Reset() {
+    DCHECK(IsEmpty());
+    top_.StoreRelaxed(0);
+    bottom_.StoreRelaxed(0);
+    buffers_.erase(buffers_.begin(), buffers_.end() - 1);
+  }
+
+ private:
+  class Buffer {
+   public:
+    explicit Buffer(size_t capacity) : capacity_(capacity), values_(new Atomic<T*>[capacity]) {}
+
+    size_t Capacity() const {
+      return capacity_;
+    }
+
+    T* Get(intptr_t index) const {
+      return values_[static_cast<size_t>(index) & (capacity_ - 1)].LoadRelaxed();
+    }
+
+    void Set(intptr_t index, T* value) {
+      values_[static_cast<size_t>(index) & (capacity_ - 1)].StoreRelaxed(value);
+    }
+
+   private:
+    const size_t capacity_;
+    std::unique_ptr<Atomic<T*>[]> values_;
+
+    DISALLOW_COPY_AND_ASSIGN(Buffer);
+  };
+
+  // Copies the values of `buffer` to a buffer twice as large, and publishes the new buffer.
+  Buffer* Grow(Buffer* buffer, intptr_t top, intptr_t bottom) {
+    Buffer* new_buffer = new Buffer(buffer->Capacity() * 2);
+    for (intptr_t i = top; i < bottom; ++i) {
+      new_buffer->Set(i, buffer->Get(i));
+    }
+    buffers_.emplace_back(new_buffer);
+    buffer_.StoreRelease(new_buffer);
+    return new_buffer;
+  }
+
+  // Index of the next value to steal.
+  Atomic<intptr_t> top_;
+  // Index past the last pushed value.
+  Atomic<intptr_t> bottom_;
+  // The buffer the values are in.
+  Atomic<Buffer*> buffer_;
+  // All of the buffers, the current one last. Only accessed by the owner.
+  std::vector<std::unique_ptr<Buffer>> buffers_;
+
+  DISALLOW_COPY_AND_ASSIGN(WorkStealingDeque);
+};
+
+}  // namespace accounting
+}  // namespace gc
+}  // namespace art
+
+#endif  // ART_RUNTIME_GC_ACCOUNTING_WORK_STEALING_DEQUE_H_
@@ -0,0 +1,97 @@
+/*
+ * Copyright (C) 2016 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "work_stealing_deque.h"
+
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace art {
+namespace gc {
+namespace accounting {
+
+TEST(WorkStealingDequeTest, PushPop) {
+  int values[3];
+  WorkStealingDeque<int> deque(2);
+  EXPECT_TRUE(deque.IsEmpty());
+  EXPECT_EQ(nullptr, deque.Pop());
+  EXPECT_EQ(nullptr, deque.Steal());
+  // The third push grows the deque.
+  for (int& value : values) {
+    deque.Push(&value);
+  }
+  EXPECT_FALSE(deque.IsEmpty());
+  // The owner pops the newest value, a thief steals the oldest.
+  EXPECT_EQ(&values[2], deque.Pop());
+  EXPECT_EQ(&values[0], deque.Steal());
+  EXPECT_EQ(&values[1], deque.Pop());
+  EXPECT_TRUE(deque.IsEmpty());
+  EXPECT_EQ(nullptr, deque.Pop());
+  deque.Reset();
+  deque.Push(&values[0]);
+  EXPECT_EQ(&values[0], deque.Steal());
+  EXPECT_EQ(nullptr, deque.Steal());
+}
+
+// Each value must be taken exactly once, whether the owner pops it or a thief steals it.
+TEST(WorkStealingDequeTest, ConcurrentSteals) {
+  static constexpr size_t kValues = 1 << 20;
+  static constexpr size_t kThieves = 3;
+  std::unique_ptr<int[]> values(new int[kValues]);
+  std::unique_ptr<Atomic<int32_t>[]> taken(new Atomic<int32_t>[kValues]);
+  WorkStealingDeque<int> deque(16);
+  Atomic<bool> done(false);
+  std::vector<std::thread> thieves;
+  for (size_t i = 0; i < kThieves; ++i) {
+    thieves.emplace_back([&]() {
+      while (!done.LoadSequentiallyConsistent()) {
+        int* value = deque.Steal();
+        if (value != nullptr) {
+          taken[value - values.get()].FetchAndAddSequentiallyConsistent(1);
+        }
+      }
+    });
+  }
+  for (size_t i = 0; i < kValues; ++i) {
+    deque.Push(&values[i]);
+    if (i % 3 == 0) {
+      int* value = deque.Pop();
+      if (value != nullptr) {
+        taken[value - values.get()].FetchAndAddSequentiallyConsistent(1);
+      }
+    }
+  }
+  while (!deque.IsEmpty()) {
+    int* value = deque.Pop();
+    if (value != nullptr) {
+      taken[value - values.get()].FetchAndAddSequentiallyConsistent(1);
+    }
+  }
+  done.StoreSequentiallyConsistent(true);
+  for (std::thread& thief : thieves) {
+    thief.join();
+  }
+  for (size_t i = 0; i < kValues; ++i) {
+    ASSERT_EQ(1, taken[i].LoadRelaxed()) << i;
+  }
+}
+
+}  // namespace accounting
+}  // namespace gc
+}  // namespace art
@@ -26,6 +26,7 @@
 #include "thread-inl.h"
 #include "thread_list.h"
 
+#include <algorithm>
 #include <map>
 #include <list>
 #include <sstream>
@@ -57,7 +58,8 @@ RosAlloc::RosAlloc(void* base, size_t capacity, size_t max_capacity,
       bulk_free_lock_("rosalloc bulk free lock", kRosAllocBulkFreeLock),
       page_release_mode_(page_release_mode),
       page_release_size_threshold_(page_release_size_threshold),
-      is_running_on_memory_tool_(running_on_memory_tool) {
+      is_running_on_memory_tool_(running_on_memory_tool),
+      max_thread_local_run_bytes_(kDefaultMaxThreadLocalRunBytes) {
   DCHECK_ALIGNED(base, kPageSize);
   DCHECK_EQ(RoundUp(capacity, kPageSize), capacity);
   DCHECK_EQ(RoundUp(max_capacity, kPageSize), max_capacity);
@@ -561,7 +563,6 @@ RosAlloc::Run* RosAlloc::AllocRun(Thread* self, size_t idx) {
     }
     new_run->size_bracket_idx_ = idx;
     DCHECK(!new_run->IsThreadLocal());
-    DCHECK(!new_run->to_be_bulk_freed_);
     if (kUsePrefetchDuringAllocRun && idx < kNumThreadLocalSizeBrackets) {
       // Take ownership of the cache lines if we are likely to be thread local run.
       if (kPrefetchNewRunDataByZeroing) {
@@ -694,6 +695,19 @@ void* RosAlloc::AllocFromRun(Thread* self, size_t size, size_t* bytes_allocated,
       } else {
         // No slots got freed. Try to refill the thread-local run.
         DCHECK(thread_local_run->IsFull());
+        if (thread_local_run == dedicated_full_run_ &&
+            idx >= kNumSmallSizeBrackets &&
+            LargeThreadLocalRunBytes(self) + numOfPages[idx] * kPageSize >
+                max_thread_local_run_bytes_.LoadRelaxed()) {
+          // The thread holds as many thread-local runs as it may. Use the shared current run.
+          slot_addr = AllocFromCurrentRunUnlocked(self, idx);
+          if (LIKELY(slot_addr != nullptr)) {
+            *bytes_allocated = bracket_size;
+            *usable_size = bracket_size;
+            *bytes_tl_bulk_allocated = bracket_size;
+          }
+          return slot_addr;
+        }
         if (thread_local_run != dedicated_full_run_) {
           thread_local_run->SetIsThreadLocal(false);
           if (kIsDebugBuild) {
@@ -867,7 +881,6 @@ std::string RosAlloc::Run::Dump() {
          << "{ magic_num=" << static_cast<int>(magic_num_)
          << " size_bracket_idx=" << idx
          << " is_thread_local=" << static_cast<int>(is_thread_local_)
-         << " to_be_bulk_freed=" << static_cast<int>(to_be_bulk_freed_)
          << " free_list=" << FreeListToStr(&free_list_)
          << " bulk_free_list=" << FreeListToStr(&bulk_free_list_)
          << " thread_local_list=" << FreeListToStr(&thread_local_free_list_)
@@ -919,20 +932,24 @@ inline void RosAlloc::Run::MergeBulkFreeListToThreadLocalFreeList() {
 
 inline void RosAlloc::Run::AddToThreadLocalFreeList(void* ptr) {
   DCHECK(IsThreadLocal());
-  AddToFreeListShared(ptr, &thread_local_free_list_, __FUNCTION__);
+  AddToFreeListShared(ptr, &thread_local_free_list_, /* zero_slot */ true, __FUNCTION__);
 }
 
 inline size_t RosAlloc::Run::AddToBulkFreeList(void* ptr) {
-  return AddToFreeListShared(ptr, &bulk_free_list_, __FUNCTION__);
+  // BulkFreeFromRun() zeroes the slots before it takes the size bracket lock.
+  return AddToFreeListShared(ptr, &bulk_free_list_, /* zero_slot */ false, __FUNCTION__);
 }
 
 inline size_t RosAlloc::Run::AddToFreeListShared(void* ptr,
                                                  SlotFreeList<true>* free_list,
+                                                 bool zero_slot,
                                                  const char* caller_name) {
   const uint8_t idx = size_bracket_idx_;
   const size_t bracket_size = bracketSizes[idx];
   Slot* slot = ToSlot(ptr);
-  memset(slot, 0, bracket_size);
+  if (zero_slot) {
+    memset(slot, 0, bracket_size);
+  }
   free_list->Add(slot);
   if (kTraceRosAlloc) {
     LOG(INFO) << "RosAlloc::Run::" << caller_name << "() : " << ptr
@@ -1017,16 +1034,15 @@ size_t RosAlloc::BulkFree(Thread* self, void** ptrs, size_t num_ptrs) {
     return freed_bytes;
   }
 
-  WriterMutexLock wmu(self, bulk_free_lock_);
+  // The slots of a run are freed under its size bracket lock, so that the GC threads sweeping in
+  // parallel and the mutators freeing objects do not exclude each other.
+  ReaderMutexLock rmu(self, bulk_free_lock_);
 
-  // First mark slots to free in the bulk free bit map without locking the
-  // size bracket locks. On host, unordered_set is faster than vector + flag.
-#ifdef __ANDROID__
-  std::vector<Run*> runs;
-#else
-  std::unordered_set<Run*, hash_run, eq_run> runs;
-#endif
-  for (size_t i = 0; i < num_ptrs; i++) {
+  // Group the slots by run. Sweeping already passes the pointers in address order.
+  if (!std::is_sorted(ptrs, ptrs + num_ptrs)) {
+    std::sort(ptrs, ptrs + num_ptrs);
+  }
+  for (size_t i = 0; i < num_ptrs; ) {
     void* ptr = ptrs[i];
     DCHECK_LE(base_, ptr);
     DCHECK_LT(ptr, base_ + footprint_);
@@ -1053,6 +1069,7 @@ size_t RosAlloc::BulkFree(Thread* self, void** ptrs, size_t num_ptrs) {
       } else if (page_map_entry == kPageMapLargeObject) {
         MutexLock mu(self, lock_);
         freed_bytes += FreePages(self, ptr, false);
+        ++i;
         continue;
       } else {
         LOG(FATAL) << "Unreachable - page map type: " << static_cast<int>(page_map_entry);
@@ -1079,6 +1096,7 @@ size_t RosAlloc::BulkFree(Thread* self, void** ptrs, size_t num_ptrs) {
         run = reinterpret_cast<Run*>(base_ + pi * kPageSize);
       } else if (page_map_entry == kPageMapLargeObject) {
         freed_bytes += FreePages(self, ptr, false);
+        ++i;
         continue;
       } else {
         LOG(FATAL) << "Unreachable - page map type: " << static_cast<int>(page_map_entry);
@@ -1086,127 +1104,143 @@ size_t RosAlloc::BulkFree(Thread* self, void** ptrs, size_t num_ptrs) {
     }
     DCHECK(run != nullptr);
     DCHECK_EQ(run->magic_num_, kMagicNum);
-    // Set the bit in the bulk free bit map.
-    freed_bytes += run->AddToBulkFreeList(ptr);
-#ifdef __ANDROID__
-    if (!run->to_be_bulk_freed_) {
-      run->to_be_bulk_freed_ = true;
-      runs.push_back(run);
-    }
-#else
-    runs.insert(run);
-#endif
-  }
-
-  // Now, iterate over the affected runs and update the alloc bit map
-  // based on the bulk free bit map (for non-thread-local runs) and
-  // union the bulk free bit map into the thread-local free bit map
-  // (for thread-local runs.)
-  for (Run* run : runs) {
-#ifdef __ANDROID__
-    DCHECK(run->to_be_bulk_freed_);
-    run->to_be_bulk_freed_ = false;
-#endif
-    size_t idx = run->size_bracket_idx_;
-    MutexLock brackets_mu(self, *size_bracket_locks_[idx]);
-    if (run->IsThreadLocal()) {
-      DCHECK_LT(run->size_bracket_idx_, kNumThreadLocalSizeBrackets);
-      DCHECK(non_full_runs_[idx].find(run) == non_full_runs_[idx].end());
-      DCHECK(full_runs_[idx].find(run) == full_runs_[idx].end());
-      run->MergeBulkFreeListToThreadLocalFreeList();
-      if (kTraceRosAlloc) {
-        LOG(INFO) << "RosAlloc::BulkFree() : Freed slot(s) in a thread local run 0x"
-                  << std::hex << reinterpret_cast<intptr_t>(run);
-      }
-      DCHECK(run->IsThreadLocal());
-      // A thread local run will be kept as a thread local even if
-      // it's become all free.
-    } else {
-      bool run_was_full = run->IsFull();
-      run->MergeBulkFreeListToFreeList();
-      if (kTraceRosAlloc) {
-        LOG(INFO) << "RosAlloc::BulkFree() : Freed slot(s) in a run 0x" << std::hex
-                  << reinterpret_cast<intptr_t>(run);
-      }
-      // Check if the run should be moved to non_full_runs_ or
-      // free_page_runs_.
-      auto* non_full_runs = &non_full_runs_[idx];
-      auto* full_runs = kIsDebugBuild ? &full_runs_[idx] : nullptr;
-      if (run->IsAllFree()) {
-        // It has just become completely free. Free the pages of the
-        // run.
-        bool run_was_current = run == current_runs_[idx];
-        if (run_was_current) {
-          DCHECK(full_runs->find(run) == full_runs->end());
-          DCHECK(non_full_runs->find(run) == non_full_runs->end());
-          // If it was a current run, reuse it.
-        } else if (run_was_full) {
-          // If it was full, remove it from the full run set (debug
-          // only.)
-          if (kIsDebugBuild) {
-            std::unordered_set<Run*, hash_run, eq_run>::iterator pos = full_runs->find(run);
-            DCHECK(pos != full_runs->end());
-            full_runs->erase(pos);
-            if (kTraceRosAlloc) {
-              LOG(INFO) << "RosAlloc::BulkFree() : Erased run 0x" << std::hex
-                        << reinterpret_cast<intptr_t>(run)
-                        << " from full_runs_";
-            }
-            DCHECK(full_runs->find(run) == full_runs->end());
-          }
-        } else {
-          // If it was in a non full run set, remove it from the set.
-          DCHECK(full_runs->find(run) == full_runs->end());
-          DCHECK(non_full_runs->find(run) != non_full_runs->end());
-          non_full_runs->erase(run);
+    // The slots of the run are the following pointers up to the end of the run.
+    uint8_t* const run_end =
+        reinterpret_cast<uint8_t*>(run) + numOfPages[run->size_bracket_idx_] * kPageSize;
+    size_t num_slots = 1;
+    while (i + num_slots < num_ptrs && reinterpret_cast<uint8_t*>(ptrs[i + num_slots]) < run_end) {
+      ++num_slots;
+    }
+    freed_bytes += BulkFreeFromRun(self, run, ptrs + i, num_slots);
+    i += num_slots;
+  }
+  return freed_bytes;
+}
+
+size_t RosAlloc::BulkFreeFromRun(Thread* self, Run* run, void** ptrs, size_t num_ptrs) {
+  const size_t idx = run->size_bracket_idx_;
+  const size_t bracket_size = bracketSizes[idx];
+  // Nothing else accesses the slots being freed, so zero them before taking the lock.
+  for (size_t i = 0; i < num_ptrs; ++i) {
+    memset(ptrs[i], 0, bracket_size);
+  }
+  MutexLock brackets_mu(self, *size_bracket_locks_[idx]);
+  // The size bracket lock guards the bulk free list, as other threads may bulk free at the same
+  // time.
+  DCHECK(run->IsBulkFreeListEmpty());
+  for (size_t i = 0; i < num_ptrs; ++i) {
+    run->AddToBulkFreeList(ptrs[i]);
+  }
+  if (run->IsThreadLocal()) {
+    DCHECK_LT(run->size_bracket_idx_, kNumThreadLocalSizeBrackets);
+    DCHECK(non_full_runs_[idx].find(run) == non_full_runs_[idx].end());
+    DCHECK(full_runs_[idx].find(run) == full_runs_[idx].end());
+    run->MergeBulkFreeListToThreadLocalFreeList();
+    if (kTraceRosAlloc) {
+      LOG(INFO) << "RosAlloc::BulkFree() : Freed slot(s) in a thread local run 0x"
+                << std::hex << reinterpret_cast<intptr_t>(run);
+    }
+    DCHECK(run->IsThreadLocal());
+    // A thread local run will be kept as a thread local even if
+    // it's become all free.
+  } else {
+    bool run_was_full = run->IsFull();
+    run->MergeBulkFreeListToFreeList();
+    if (kTraceRosAlloc) {
+      LOG(INFO) << "RosAlloc::BulkFree() : Freed slot(s) in a run 0x" << std::hex
+                << reinterpret_cast<intptr_t>(run);
+    }
+    // Check if the run should be moved to non_full_runs_ or
+    // free_page_runs_.
+    auto* non_full_runs = &non_full_runs_[idx];
+    auto* full_runs = kIsDebugBuild ? &full_runs_[idx] : nullptr;
+    if (run->IsAllFree()) {
+      // It has just become completely free. Free the pages of the
+      // run.
+      bool run_was_current = run == current_runs_[idx];
+      if (run_was_current) {
+        DCHECK(full_runs->find(run) == full_runs->end());
+        DCHECK(non_full_runs->find(run) == non_full_runs->end());
+        // If it was a current run, reuse it.
+      } else if (run_was_full) {
+        // If it was full, remove it from the full run set (debug
+        // only.)
+        if (kIsDebugBuild) {
+          std::unordered_set<Run*, hash_run, eq_run>::iterator pos = full_runs->find(run);
+          DCHECK(pos != full_runs->end());
+          full_runs->erase(pos);
           if (kTraceRosAlloc) {
             LOG(INFO) << "RosAlloc::BulkFree() : Erased run 0x" << std::hex
                       << reinterpret_cast<intptr_t>(run)
-                      << " from non_full_runs_";
+                      << " from full_runs_";
           }
-          DCHECK(non_full_runs->find(run) == non_full_runs->end());
-        }
-        if (!run_was_current) {
-          run->ZeroHeaderAndSlotHeaders();
-          MutexLock lock_mu(self, lock_);
-          FreePages(self, run, true);
+          DCHECK(full_runs->find(run) == full_runs->end());
         }
       } else {
-        // It is not completely free. If it wasn't the current run or
-        // already in the non-full run set (i.e., it was full) insert
-        // it into the non-full run set.
-        if (run == current_runs_[idx]) {
-          DCHECK(non_full_runs->find(run) == non_full_runs->end());
-          DCHECK(full_runs->find(run) == full_runs->end());
-          // If it was a current run, keep it.
-        } else if (run_was_full) {
-          // If it was full, remove it from the full run set (debug
-          // only) and insert into the non-full run set.
-          DCHECK(full_runs->find(run) != full_runs->end());
-          DCHECK(non_full_runs->find(run) == non_full_runs->end());
-          if (kIsDebugBuild) {
-            full_runs->erase(run);
-            if (kTraceRosAlloc) {
-              LOG(INFO) << "RosAlloc::BulkFree() : Erased run 0x" << std::hex
-                        << reinterpret_cast<intptr_t>(run)
-                        << " from full_runs_";
-            }
-          }
-          non_full_runs->insert(run);
+        // If it was in a non full run set, remove it from the set.
+        DCHECK(full_runs->find(run) == full_runs->end());
+        DCHECK(non_full_runs->find(run) != non_full_runs->end());
+        non_full_runs->erase(run);
+        if (kTraceRosAlloc) {
+          LOG(INFO) << "RosAlloc::BulkFree() : Erased run 0x" << std::hex
+                    << reinterpret_cast<intptr_t>(run)
+                    << " from non_full_runs_";
+        }
+        DCHECK(non_full_runs->find(run) == non_full_runs->end());
+      }
+      if (!run_was_current) {
+        run->ZeroHeaderAndSlotHeaders();
+        MutexLock lock_mu(self, lock_);
+        FreePages(self, run, true);
+      }
+    } else {
+      // It is not completely free. If it wasn't the current run or
+      // already in the non-full run set (i.e., it was full) insert
+      // it into the non-full run set.
+      if (run == current_runs_[idx]) {
+        DCHECK(non_full_runs->find(run) == non_full_runs->end());
+        DCHECK(full_runs->find(run) == full_runs->end());
+        // If it was a current run, keep it.
+      } else if (run_was_full) {
+        // If it was full, remove it from the full run set (debug
+        // only) and insert into the non-full run set.
+        DCHECK(full_runs->find(run) != full_runs->end());
+        DCHECK(non_full_runs->find(run) == non_full_runs->end());
+        if (kIsDebugBuild) {
+          full_runs->erase(run);
           if (kTraceRosAlloc) {
-            LOG(INFO) << "RosAlloc::BulkFree() : Inserted run 0x" << std::hex
+            LOG(INFO) << "RosAlloc::BulkFree() : Erased run 0x" << std::hex
                       << reinterpret_cast<intptr_t>(run)
-                      << " into non_full_runs_[" << std::dec << idx;
+                      << " from full_runs_";
           }
-        } else {
-          // If it was not full, so leave it in the non full run set.
-          DCHECK(full_runs->find(run) == full_runs->end());
-          DCHECK(non_full_runs->find(run) != non_full_runs->end());
         }
+        non_full_runs->insert(run);
+        if (kTraceRosAlloc) {
+          LOG(INFO) << "RosAlloc::BulkFree() : Inserted run 0x" << std::hex
+                    << reinterpret_cast<intptr_t>(run)
+                    << " into non_full_runs_[" << std::dec << idx;
+        }
+      } else {
+        // If it was not full, so leave it in the non full run set.
+        DCHECK(full_runs->find(run) == full_runs->end());
+        DCHECK(non_full_runs->find(run) != non_full_runs->end());
       }
     }
   }
-  return freed_bytes;
+  return num_ptrs * bracket_size;
+}
+
+uint8_t* RosAlloc::PageRunBegin(uint8_t* addr) {
+  DCHECK_LE(base_, addr);
+  MutexLock mu(Thread::Current(), lock_);
+  size_t pm_idx = RoundDownToPageMapIndex(addr);
+  if (pm_idx < page_map_size_) {
+    while (pm_idx > 0 &&
+           (page_map_[pm_idx] == kPageMapRunPart || page_map_[pm_idx] == kPageMapLargeObjectPart)) {
+      --pm_idx;
+    }
+  }
+  return base_ + pm_idx * kPageSize;
 }
 
 std::string RosAlloc::DumpPageMap() {
@@ -1509,42 +1543,77 @@ void RosAlloc::SetFootprintLimit(size_t new_capacity) {
   }
 }
 
+size_t RosAlloc::RevokeThreadLocalRun(Thread* self, Thread* thread, size_t idx) {
+  MutexLock mu(self, *size_bracket_locks_[idx]);
+  Run* thread_local_run = reinterpret_cast<Run*>(thread->GetRosAllocRun(idx));
+  CHECK(thread_local_run != nullptr);
+  // Invalid means already revoked.
+  DCHECK(thread_local_run->IsThreadLocal());
+  if (thread_local_run == dedicated_full_run_) {
+    return 0U;
+  }
+  // Note the thread local run may not be full here.
+  thread->SetRosAllocRun(idx, dedicated_full_run_);
+  DCHECK_EQ(thread_local_run->magic_num_, kMagicNum);
+  // Count the number of free slots left.
+  size_t num_free_slots = thread_local_run->NumberOfFreeSlots();
+  // The above bracket index lock guards thread local free list to avoid race condition
+  // with unioning bulk free list to thread local free list by GC thread in BulkFree.
+  // If thread local run is true, GC thread will help update thread local free list
+  // in BulkFree. And the latest thread local free list will be merged to free list
+  // either when this thread local run is full or when revoking this run here. In this
+  // case the free list wll be updated. If thread local run is false, GC thread will help
+  // merge bulk free list in next BulkFree.
+  // Thus no need to merge bulk free list to free list again here.
+  bool dont_care;
+  thread_local_run->MergeThreadLocalFreeListToFreeList(&dont_care);
+  thread_local_run->SetIsThreadLocal(false);
+  DCHECK(non_full_runs_[idx].find(thread_local_run) == non_full_runs_[idx].end());
+  DCHECK(full_runs_[idx].find(thread_local_run) == full_runs_[idx].end());
+  RevokeRun(self, idx, thread_local_run);
+  return num_free_slots * bracketSizes[idx];
+}
+
 // Below may be called by mutator itself just before thread termination.
 size_t RosAlloc::RevokeThreadLocalRuns(Thread* thread) {
   Thread* self = Thread::Current();
   size_t free_bytes = 0U;
   for (size_t idx = 0; idx < kNumThreadLocalSizeBrackets; idx++) {
-    MutexLock mu(self, *size_bracket_locks_[idx]);
+    free_bytes += RevokeThreadLocalRun(self, thread, idx);
+  }
+  return free_bytes;
+}
+
+size_t RosAlloc::RevokeIdleThreadLocalRuns(Thread* thread) {
+  Thread* self = Thread::Current();
+  DCHECK_EQ(thread, self);
+  // Only the thread itself allocates from the free lists of its runs, so they can be read without
+  // the size bracket locks.
+  size_t idle_free_bytes = 0U;
+  for (size_t idx = kNumSmallSizeBrackets; idx < kNumThreadLocalSizeBrackets; ++idx) {
     Run* thread_local_run = reinterpret_cast<Run*>(thread->GetRosAllocRun(idx));
-    CHECK(thread_local_run != nullptr);
-    // Invalid means already revoked.
-    DCHECK(thread_local_run->IsThreadLocal());
-    if (thread_local_run != dedicated_full_run_) {
-      // Note the thread local run may not be full here.
-      thread->SetRosAllocRun(idx, dedicated_full_run_);
-      DCHECK_EQ(thread_local_run->magic_num_, kMagicNum);
-      // Count the number of free slots left.
-      size_t num_free_slots = thread_local_run->NumberOfFreeSlots();
-      free_bytes += num_free_slots * bracketSizes[idx];
-      // The above bracket index lock guards thread local free list to avoid race condition
-      // with unioning bulk free list to thread local free list by GC thread in BulkFree.
-      // If thread local run is true, GC thread will help update thread local free list
-      // in BulkFree. And the latest thread local free list will be merged to free list
-      // either when this thread local run is full or when revoking this run here. In this
-      // case the free list wll be updated. If thread local run is false, GC thread will help
-      // merge bulk free list in next BulkFree.
-      // Thus no need to merge bulk free list to free list again here.
-      bool dont_care;
-      thread_local_run->MergeThreadLocalFreeListToFreeList(&dont_care);
-      thread_local_run->SetIsThreadLocal(false);
-      DCHECK(non_full_runs_[idx].find(thread_local_run) == non_full_runs_[idx].end());
-      DCHECK(full_runs_[idx].find(thread_local_run) == full_runs_[idx].end());
-      RevokeRun(self, idx, thread_local_run);
-    }
+    idle_free_bytes += thread_local_run->FreeList()->Size() * bracketSizes[idx];
+  }
+  if (idle_free_bytes < kMinIdleRevokeFreeBytes) {
+    return 0U;
+  }
+  size_t free_bytes = 0U;
+  for (size_t idx = kNumSmallSizeBrackets; idx < kNumThreadLocalSizeBrackets; ++idx) {
+    free_bytes += RevokeThreadLocalRun(self, thread, idx);
   }
   return free_bytes;
 }
 
+size_t RosAlloc::LargeThreadLocalRunBytes(Thread* thread) {
+  size_t bytes = 0U;
+  for (size_t idx = kNumSmallSizeBrackets; idx < kNumThreadLocalSizeBrackets; ++idx) {
+    if (thread->GetRosAllocRun(idx) != dedicated_full_run_) {
+      bytes += numOfPages[idx] * kPageSize;
+    }
+  }
+  return bytes;
+}
+
 void RosAlloc::RevokeRun(Thread* self, size_t idx, Run* run) {
   size_bracket_locks_[idx]->AssertHeld(self);
   DCHECK(run != dedicated_full_run_);
@@ -1633,11 +1702,11 @@ void RosAlloc::Initialize() {
   static_assert(kNumRegularSizeBrackets == kNumOfSizeBrackets - 2,
                 "There should be two non-regular brackets");
   for (size_t i = 0; i < kNumOfSizeBrackets; i++) {
-    if (i < kNumThreadLocalSizeBrackets) {
-      bracketSizes[i] = kThreadLocalBracketQuantumSize * (i + 1);
+    if (i < kNumSmallSizeBrackets) {
+      bracketSizes[i] = kSmallBracketQuantumSize * (i + 1);
     } else if (i < kNumRegularSizeBrackets) {
-      bracketSizes[i] = kBracketQuantumSize * (i - kNumThreadLocalSizeBrackets + 1) +
-          (kThreadLocalBracketQuantumSize *  kNumThreadLocalSizeBrackets);
+      bracketSizes[i] = kBracketQuantumSize * (i - kNumSmallSizeBrackets + 1) +
+          (kSmallBracketQuantumSize *  kNumSmallSizeBrackets);
     } else if (i == kNumOfSizeBrackets - 2) {
       bracketSizes[i] = 1 * KB;
     } else {
@@ -1650,9 +1719,9 @@ void RosAlloc::Initialize() {
   }
   // numOfPages.
   for (size_t i = 0; i < kNumOfSizeBrackets; i++) {
-    if (i < kNumThreadLocalSizeBrackets) {
+    if (i < kNumSmallSizeBrackets) {
       numOfPages[i] = 1;
-    } else if (i < (kNumThreadLocalSizeBrackets + kNumRegularSizeBrackets) / 2) {
+    } else if (i < (kNumSmallSizeBrackets + kNumRegularSizeBrackets) / 2) {
       numOfPages[i] = 1;
     } else if (i < kNumRegularSizeBrackets) {
       numOfPages[i] = 1;
@@ -1721,7 +1790,7 @@ void RosAlloc::Initialize() {
   // The smallest bracket size must be at least as large as the sizeof(Slot).
   DCHECK_LE(sizeof(Slot), bracketSizes[0]) << "sizeof(Slot) <= the smallest bracket size";
   // Check the invariants between the max bracket sizes and the number of brackets.
-  DCHECK_EQ(kMaxThreadLocalBracketSize, bracketSizes[kNumThreadLocalSizeBrackets - 1]);
+  DCHECK_EQ(kMaxSmallBracketSize, bracketSizes[kNumSmallSizeBrackets - 1]);
   DCHECK_EQ(kMaxRegularBracketSize, bracketSizes[kNumRegularSizeBrackets - 1]);
 }
 
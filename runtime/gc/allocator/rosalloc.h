@@ -26,6 +26,7 @@
 #include <unordered_set>
 #include <vector>
 
+#include "atomic.h"
 #include "base/allocator.h"
 #include "base/bit_utils.h"
 #include "base/mutex.h"
@@ -318,8 +319,6 @@ class RosAlloc {
   // +-------------------+
   // | is_thread_local   |
   // +-------------------+
-  // | to_be_bulk_freed  |
-  // +-------------------+
   // |                   |
   // | free list         |
   // |                   |
@@ -352,7 +351,6 @@ class RosAlloc {
     uint8_t magic_num_;                 // The magic number used for debugging.
     uint8_t size_bracket_idx_;          // The index of the size bracket of this run.
     uint8_t is_thread_local_;           // True if this run is used as a thread-local run.
-    uint8_t to_be_bulk_freed_;          // Used within BulkFree() to flag a run that's involved with a bulk free.
     uint32_t padding_ ATTRIBUTE_UNUSED;
     // Use a tailless free list for free_list_ so that the alloc fast path does not manage the tail.
     SlotFreeList<false> free_list_;
@@ -421,7 +419,7 @@ class RosAlloc {
     ALWAYS_INLINE void* AllocSlot();
     // Frees a slot in a run. This is used in a non-bulk free.
     void FreeSlot(void* ptr);
-    // Add the given slot to the bulk free list. Returns the bracket size.
+    // Add the given slot, which must be zeroed, to the bulk free list. Returns the bracket size.
     size_t AddToBulkFreeList(void* ptr);
     // Add the given slot to the thread-local free list.
     void AddToThreadLocalFreeList(void* ptr);
@@ -459,7 +457,10 @@ class RosAlloc {
    private:
     // The common part of AddToBulkFreeList() and AddToThreadLocalFreeList(). Returns the bracket
     // size.
-    size_t AddToFreeListShared(void* ptr, SlotFreeList<true>* free_list, const char* caller_name);
+    size_t AddToFreeListShared(void* ptr,
+                               SlotFreeList<true>* free_list,
+                               bool zero_slot,
+                               const char* caller_name);
     // Turns a FreeList into a string for debugging.
     template<bool kUseTail>
     std::string FreeListToStr(SlotFreeList<kUseTail>* free_list);
@@ -515,7 +516,7 @@ class RosAlloc {
   // Returns the index of the size bracket from the bracket size.
   static size_t BracketSizeToIndex(size_t size) {
     DCHECK(8 <= size &&
-           ((size <= kMaxThreadLocalBracketSize && size % kThreadLocalBracketQuantumSize == 0) ||
+           ((size <= kMaxSmallBracketSize && size % kSmallBracketQuantumSize == 0) ||
             (size <= kMaxRegularBracketSize && size % kBracketQuantumSize == 0) ||
             size == 1 * KB || size == 2 * KB));
     size_t idx;
@@ -523,14 +524,14 @@ class RosAlloc {
       idx = kNumOfSizeBrackets - 2;
     } else if (UNLIKELY(size == 2 * KB)) {
       idx = kNumOfSizeBrackets - 1;
-    } else if (LIKELY(size <= kMaxThreadLocalBracketSize)) {
-      DCHECK_EQ(size % kThreadLocalBracketQuantumSize, 0U);
-      idx = size / kThreadLocalBracketQuantumSize - 1;
+    } else if (LIKELY(size <= kMaxSmallBracketSize)) {
+      DCHECK_EQ(size % kSmallBracketQuantumSize, 0U);
+      idx = size / kSmallBracketQuantumSize - 1;
     } else {
       DCHECK(size <= kMaxRegularBracketSize);
-      DCHECK_EQ((size - kMaxThreadLocalBracketSize) % kBracketQuantumSize, 0U);
-      idx = ((size - kMaxThreadLocalBracketSize) / kBracketQuantumSize - 1)
-          + kNumThreadLocalSizeBrackets;
+      DCHECK_EQ((size - kMaxSmallBracketSize) % kBracketQuantumSize, 0U);
+      idx = ((size - kMaxSmallBracketSize) / kBracketQuantumSize - 1)
+          + kNumSmallSizeBrackets;
     }
     DCHECK(bracketSizes[idx] == size);
     return idx;
@@ -545,8 +546,8 @@ class RosAlloc {
   // Rounds up the size up the nearest bracket size.
   static size_t RoundToBracketSize(size_t size) {
     DCHECK(size <= kLargeSizeThreshold);
-    if (LIKELY(size <= kMaxThreadLocalBracketSize)) {
-      return RoundUp(size, kThreadLocalBracketQuantumSize);
+    if (LIKELY(size <= kMaxSmallBracketSize)) {
+      return RoundUp(size, kSmallBracketQuantumSize);
     } else if (size <= kMaxRegularBracketSize) {
       return RoundUp(size, kBracketQuantumSize);
     } else if (UNLIKELY(size <= 1 * KB)) {
@@ -559,11 +560,11 @@ class RosAlloc {
   // Returns the size bracket index from the byte size with rounding.
   static size_t SizeToIndex(size_t size) {
     DCHECK(size <= kLargeSizeThreshold);
-    if (LIKELY(size <= kMaxThreadLocalBracketSize)) {
-      return RoundUp(size, kThreadLocalBracketQuantumSize) / kThreadLocalBracketQuantumSize - 1;
+    if (LIKELY(size <= kMaxSmallBracketSize)) {
+      return RoundUp(size, kSmallBracketQuantumSize) / kSmallBracketQuantumSize - 1;
     } else if (size <= kMaxRegularBracketSize) {
-      return (RoundUp(size, kBracketQuantumSize) - kMaxThreadLocalBracketSize) / kBracketQuantumSize
-          - 1 + kNumThreadLocalSizeBrackets;
+      return (RoundUp(size, kBracketQuantumSize) - kMaxSmallBracketSize) / kBracketQuantumSize
+          - 1 + kNumSmallSizeBrackets;
     } else if (size <= 1 * KB) {
       return kNumOfSizeBrackets - 2;
     } else {
@@ -576,13 +577,13 @@ class RosAlloc {
     DCHECK(size <= kLargeSizeThreshold);
     size_t idx;
     size_t bracket_size;
-    if (LIKELY(size <= kMaxThreadLocalBracketSize)) {
-      bracket_size = RoundUp(size, kThreadLocalBracketQuantumSize);
-      idx = bracket_size / kThreadLocalBracketQuantumSize - 1;
+    if (LIKELY(size <= kMaxSmallBracketSize)) {
+      bracket_size = RoundUp(size, kSmallBracketQuantumSize);
+      idx = bracket_size / kSmallBracketQuantumSize - 1;
     } else if (size <= kMaxRegularBracketSize) {
       bracket_size = RoundUp(size, kBracketQuantumSize);
-      idx = ((bracket_size - kMaxThreadLocalBracketSize) / kBracketQuantumSize - 1)
-          + kNumThreadLocalSizeBrackets;
+      idx = ((bracket_size - kMaxSmallBracketSize) / kBracketQuantumSize - 1)
+          + kNumSmallSizeBrackets;
     } else if (size <= 1 * KB) {
       bracket_size = 1 * KB;
       idx = kNumOfSizeBrackets - 2;
@@ -596,8 +597,8 @@ class RosAlloc {
     DCHECK_EQ(bracket_size, bracketSizes[idx]) << idx;
     DCHECK_LE(size, bracket_size) << idx;
     DCHECK(size > kMaxRegularBracketSize ||
-           (size <= kMaxThreadLocalBracketSize &&
-            bracket_size - size < kThreadLocalBracketQuantumSize) ||
+           (size <= kMaxSmallBracketSize &&
+            bracket_size - size < kSmallBracketQuantumSize) ||
            (size <= kMaxRegularBracketSize && bracket_size - size < kBracketQuantumSize)) << idx;
     *bracket_size_out = bracket_size;
     return idx;
@@ -658,17 +659,35 @@ class RosAlloc {
   // The default value for page_release_size_threshold_.
   static constexpr size_t kDefaultPageReleaseSizeThreshold = 4 * MB;
 
+  // The default value for max_thread_local_run_bytes_.
+  static constexpr size_t kDefaultMaxThreadLocalRunBytes = 64 * KB;
+
+  // RevokeIdleThreadLocalRuns() keeps the thread-local runs of a thread if their free slots add up
+  // to less than this, as the thread would only refill them once it runs again.
+  static constexpr size_t kMinIdleRevokeFreeBytes = 16 * KB;
+
   // We use thread-local runs for the size brackets whose indexes
-  // are less than this index. We use shared (current) runs for the rest.
+  // are less than this index, that is all of them. A thread holds at most
+  // max_thread_local_run_bytes_ of thread-local runs of the brackets above kMaxSmallBracketSize,
+  // and uses the shared (current) runs of the others.
   // Sync this with the length of Thread::rosalloc_runs_.
-  static const size_t kNumThreadLocalSizeBrackets = 16;
+  static const size_t kNumThreadLocalSizeBrackets = kNumOfSizeBrackets;
   static_assert(kNumThreadLocalSizeBrackets == kNumRosAllocThreadLocalSizeBracketsInThread,
                 "Mismatch between kNumThreadLocalSizeBrackets and "
                 "kNumRosAllocThreadLocalSizeBracketsInThread");
 
   // The size of the largest bracket we use thread-local runs for.
   // This should be equal to bracketSizes[kNumThreadLocalSizeBrackets - 1].
-  static const size_t kMaxThreadLocalBracketSize = 128;
+  static const size_t kMaxThreadLocalBracketSize = 2 * KB;
+
+  // We use 8-byte increment runs for the size brackets whose indexes are less than this index.
+  // The compiled code allocates from the thread-local runs of these brackets without calling into
+  // the runtime.
+  static const size_t kNumSmallSizeBrackets = 16;
+
+  // The size of the largest small bracket.
+  // This should be equal to bracketSizes[kNumSmallSizeBrackets - 1].
+  static const size_t kMaxSmallBracketSize = 128;
 
   // We use regular (8 or 16-bytes increment) runs for the size brackets whose indexes are less than
   // this index.
@@ -678,14 +697,14 @@ class RosAlloc {
   // 1 KB and the 2 KB brackets. This should be equal to bracketSizes[kNumRegularSizeBrackets - 1].
   static const size_t kMaxRegularBracketSize = 512;
 
-  // The bracket size increment for the thread-local brackets (<= kMaxThreadLocalBracketSize bytes).
-  static constexpr size_t kThreadLocalBracketQuantumSize = 8;
+  // The bracket size increment for the small brackets (<= kMaxSmallBracketSize bytes).
+  static constexpr size_t kSmallBracketQuantumSize = 8;
 
-  // Equal to Log2(kThreadLocalBracketQuantumSize).
-  static constexpr size_t kThreadLocalBracketQuantumSizeShift = 3;
+  // Equal to Log2(kSmallBracketQuantumSize).
+  static constexpr size_t kSmallBracketQuantumSizeShift = 3;
 
-  // The bracket size increment for the non-thread-local, regular brackets (of size <=
-  // kMaxRegularBracketSize bytes and > kMaxThreadLocalBracketSize bytes).
+  // The bracket size increment for the other regular brackets (of size <=
+  // kMaxRegularBracketSize bytes and > kMaxSmallBracketSize bytes).
   static constexpr size_t kBracketQuantumSize = 16;
 
   // Equal to Log2(kBracketQuantumSize).
@@ -752,10 +771,8 @@ class RosAlloc {
   // The global lock. Used to guard the page map, the free page set,
   // and the footprint.
   Mutex lock_ DEFAULT_MUTEX_ACQUIRED_AFTER;
-  // The reader-writer lock to allow one bulk free at a time while
-  // allowing multiple individual frees at the same time. Also, this
-  // is used to avoid race conditions between BulkFree() and
-  // RevokeThreadLocalRuns() on the bulk free list.
+  // The reader-writer lock held shared by the frees and bulk frees, and by the revocations of
+  // thread-local runs. The bulk free list of a run is only used under its size bracket lock.
   ReaderWriterMutex bulk_free_lock_ DEFAULT_MUTEX_ACQUIRED_AFTER;
 
   // The page release mode.
@@ -767,6 +784,10 @@ class RosAlloc {
   // Whether this allocator is running under Valgrind.
   bool is_running_on_memory_tool_;
 
+  // The most bytes of thread-local runs of the brackets above kMaxSmallBracketSize a thread holds.
+  // Read without a lock, as a thread merely keeps its runs a bit longer on a stale value.
+  Atomic<size_t> max_thread_local_run_bytes_;
+
   // The base address of the memory region that's managed by this allocator.
   uint8_t* Begin() { return base_; }
   // The end address of the memory region that's managed by this allocator.
@@ -793,6 +814,11 @@ class RosAlloc {
   size_t FreeFromRun(Thread* self, void* ptr, Run* run)
       REQUIRES(!lock_);
 
+  // Frees the `num_ptrs` slots of `run` in `ptrs`, under the size bracket lock taken once.
+  // Returns the freed bytes.
+  size_t BulkFreeFromRun(Thread* self, Run* run, void** ptrs, size_t num_ptrs)
+      REQUIRES(!lock_);
+
   // Used to allocate a new thread local run for a size bracket.
   Run* AllocRun(Thread* self, size_t idx) REQUIRES(!lock_);
 
@@ -811,6 +837,14 @@ class RosAlloc {
   // Revoke a run by adding it to non_full_runs_ or freeing the pages.
   void RevokeRun(Thread* self, size_t idx, Run* run) REQUIRES(!lock_);
 
+  // Revokes the thread-local run of `thread` for the size bracket `idx`, if it has one. Returns
+  // the bytes of its free slots.
+  size_t RevokeThreadLocalRun(Thread* self, Thread* thread, size_t idx) REQUIRES(!lock_);
+
+  // Returns the bytes of the thread-local runs of `thread` for the brackets above
+  // kMaxSmallBracketSize.
+  size_t LargeThreadLocalRunBytes(Thread* thread);
+
   // Revoke the current runs which share an index with the thread local runs.
   void RevokeThreadUnsafeCurrentRuns() REQUIRES(!lock_);
 
@@ -848,9 +882,15 @@ class RosAlloc {
       REQUIRES(!lock_);
   size_t Free(Thread* self, void* ptr)
       REQUIRES(!bulk_free_lock_, !lock_);
+  // Frees the slots and large objects of `ptrs`, which it sorts. The runs are returned to the
+  // allocator as soon as their slots are freed. Several threads may bulk free at the same time.
   size_t BulkFree(Thread* self, void** ptrs, size_t num_ptrs)
       REQUIRES(!bulk_free_lock_, !lock_);
 
+  // Returns the beginning of the run or large object the page of `addr` belongs to, or the page
+  // itself if it is free. Used to split the space into ranges which do not share runs.
+  uint8_t* PageRunBegin(uint8_t* addr) REQUIRES(!lock_);
+
   // Returns true if the given allocation request can be allocated in
   // an existing thread local run without allocating a new run.
   ALWAYS_INLINE bool CanAllocFromThreadLocalRun(Thread* self, size_t size);
@@ -898,6 +938,19 @@ class RosAlloc {
   // Returns the total bytes of free slots in the revoked thread local runs. This is to be
   // subtracted from Heap::num_bytes_allocated_ to cancel out the ahead-of-time counting.
   size_t RevokeAllThreadLocalRuns() REQUIRES(!Locks::thread_list_lock_, !lock_, !bulk_free_lock_);
+  // Releases the thread-local runs of the brackets above kMaxSmallBracketSize assigned to
+  // `thread`, which goes idle, unless their free slots add up to less than
+  // kMinIdleRevokeFreeBytes. Called by `thread` itself. Returns the total bytes of free slots in
+  // the revoked runs, like RevokeThreadLocalRuns().
+  size_t RevokeIdleThreadLocalRuns(Thread* thread) REQUIRES(!lock_, !bulk_free_lock_);
+  // Sets the most bytes of thread-local runs of the brackets above kMaxSmallBracketSize a thread
+  // may hold. The threads past the limit allocate from the shared runs of these brackets.
+  void SetMaxThreadLocalRunBytes(size_t bytes) {
+    max_thread_local_run_bytes_.StoreRelaxed(bytes);
+  }
+  size_t GetMaxThreadLocalRunBytes() const {
+    return max_thread_local_run_bytes_.LoadRelaxed();
+  }
   // Assert the thread local runs of a thread are revoked.
   void AssertThreadLocalRunsAreRevoked(Thread* thread) REQUIRES(!bulk_free_lock_);
   // Assert all the thread local runs are revoked.
@@ -68,6 +68,10 @@ inline mirror::Object* ConcurrentCopying::Mark(mirror::Object* from_ref) {
       return to_ref;
     }
     case space::RegionSpace::RegionType::kRegionTypeUnevacFromSpace: {
+      if (young_gen_) {
+        // An old object. The ones that may refer to the young generation were grayed at the flip.
+        return from_ref;
+      }
       // This may or may not succeed, which is ok.
       if (kUseBakerReadBarrier) {
         from_ref->AtomicSetReadBarrierPointer(ReadBarrier::WhitePtr(), ReadBarrier::GrayPtr());
@@ -16,13 +16,17 @@
 
 #include "concurrent_copying.h"
 
+#include <sched.h>
+
 #include "art_field-inl.h"
 #include "base/stl_util.h"
 #include "debugger.h"
+#include "gc/accounting/card_table-inl.h"
 #include "gc/accounting/heap_bitmap-inl.h"
 #include "gc/accounting/space_bitmap-inl.h"
 #include "gc/reference_processor.h"
 #include "gc/space/image_space.h"
+#include "gc/space/region_space-inl.h"
 #include "gc/space/space-inl.h"
 #include "image-inl.h"
 #include "intern_table.h"
@@ -31,6 +35,7 @@
 #include "scoped_thread_state_change.h"
 #include "thread-inl.h"
 #include "thread_list.h"
+#include "thread_pool.h"
 #include "well_known_classes.h"
 
 namespace art {
@@ -48,13 +53,25 @@ ConcurrentCopying::ConcurrentCopying(Heap* heap, const std::string& name_prefix)
                                                      kDefaultGcMarkStackSize,
                                                      kDefaultGcMarkStackSize)),
       mark_stack_lock_("concurrent copying mark stack lock", kMarkSweepMarkStackLock),
+      num_revoked_mark_stacks_(0),
+      thread_count_(1),
+      started_markers_(0),
+      idle_markers_(0),
+      parallel_marked_refs_(0),
       thread_running_gc_(nullptr),
       is_marking_(false), is_active_(false), is_asserting_to_space_invariant_(false),
-      heap_mark_bitmap_(nullptr), live_stack_freeze_size_(0), mark_stack_mode_(kMarkStackModeOff),
+      region_space_bitmap_(nullptr), heap_mark_bitmap_(nullptr), heap_live_bitmap_(nullptr),
+      live_stack_freeze_size_(0), mark_stack_mode_(kMarkStackModeOff),
       weak_ref_access_enabled_(true),
       skipped_blocks_lock_("concurrent copying bytes blocks lock", kMarkSweepMarkStackLock),
       rb_table_(heap_->GetReadBarrierTable()),
-      force_evacuate_all_(false) {
+      force_evacuate_all_(false),
+      young_gen_enabled_(heap->UseGenerationalConcurrentCopying()),
+      young_gen_(false),
+      // The first collection marks the old objects.
+      force_full_cycle_(true),
+      young_cycles_since_full_cycle_(0),
+      cycle_stats_lock_("concurrent copying cycle stats lock") {
   static_assert(space::RegionSpace::kRegionSize == accounting::ReadBarrierTable::kRegionSize,
                 "The region space size and the read barrier table region size must match");
   cc_heap_bitmap_.reset(new accounting::HeapBitmap(heap));
@@ -66,6 +83,7 @@ ConcurrentCopying::ConcurrentCopying(Heap* heap, const std::string& name_prefix)
     // when GC causes a RB while doing GC or a lock order violation
     // (class_linker_lock_ and heap_bitmap_lock_).
     heap_mark_bitmap_ = heap->GetMarkBitmap();
+    heap_live_bitmap_ = heap->GetLiveBitmap();
   }
   {
     MutexLock mu(self, mark_stack_lock_);
@@ -88,6 +106,9 @@ void ConcurrentCopying::MarkHeapReference(mirror::HeapReference<mirror::Object>*
 
 ConcurrentCopying::~ConcurrentCopying() {
   STLDeleteElements(&pooled_mark_stacks_);
+  if (young_gen_enabled_) {
+    delete region_space_bitmap_;
+  }
 }
 
 void ConcurrentCopying::RunPhases() {
@@ -97,15 +118,18 @@ void ConcurrentCopying::RunPhases() {
   Thread* self = Thread::Current();
   thread_running_gc_ = self;
   Locks::mutator_lock_->AssertNotHeld(self);
+  const uint64_t start_time = NanoTime();
   {
     ReaderMutexLock mu(self, *Locks::mutator_lock_);
     InitializePhase();
   }
   FlipThreadRoots();
+  const uint64_t marking_start_time = NanoTime();
   {
     ReaderMutexLock mu(self, *Locks::mutator_lock_);
     MarkingPhase();
   }
+  const uint64_t marking_ns = NanoTime() - marking_start_time;
   // Verify no from space refs. This causes a pause.
   if (kEnableNoFromSpaceRefsVerification || kIsDebugBuild) {
     TimingLogger::ScopedTiming split("(Paused)VerifyNoFromSpaceReferences", GetTimings());
@@ -125,6 +149,23 @@ void ConcurrentCopying::RunPhases() {
     ReclaimPhase();
   }
   FinishPhase();
+  {
+    const uint64_t total_ns = NanoTime() - start_time;
+    MutexLock mu(self, cycle_stats_lock_);
+    CycleStats& stats = cycle_stats_[thread_count_];
+    ++stats.cycles;
+    stats.total_ns += total_ns;
+    stats.marking_ns += marking_ns;
+    GenerationStats& gen_stats = young_gen_ ? young_gen_stats_ : full_gen_stats_;
+    ++gen_stats.cycles;
+    gen_stats.total_ns += total_ns;
+    for (uint64_t pause_ns : GetCurrentIteration()->GetPauseTimes()) {
+      gen_stats.pause_ns += pause_ns;
+      gen_stats.max_pause_ns = std::max(gen_stats.max_pause_ns, pause_ns);
+    }
+    gen_stats.freed_bytes += GetCurrentIteration()->GetFreedBytes() +
+        GetCurrentIteration()->GetFreedLargeObjectBytes();
+  }
   CHECK(is_active_);
   is_active_ = false;
   thread_running_gc_ = nullptr;
@@ -147,11 +188,17 @@ void ConcurrentCopying::BindBitmaps() {
       cc_heap_bitmap_->AddContinuousSpaceBitmap(bitmap);
       cc_bitmaps_.push_back(bitmap);
     } else if (space == region_space_) {
+      if (young_gen_enabled_ && region_space_bitmap_ != nullptr) {
+        // Kept from the previous collection.
+        continue;
+      }
       accounting::ContinuousSpaceBitmap* bitmap =
           accounting::ContinuousSpaceBitmap::Create("cc region space bitmap",
                                                     space->Begin(), space->Capacity());
       cc_heap_bitmap_->AddContinuousSpaceBitmap(bitmap);
-      cc_bitmaps_.push_back(bitmap);
+      if (!young_gen_enabled_) {
+        cc_bitmaps_.push_back(bitmap);
+      }
       region_space_bitmap_ = bitmap;
     }
   }
@@ -175,9 +222,17 @@ void ConcurrentCopying::InitializePhase() {
   } else {
     force_evacuate_all_ = false;
   }
+  thread_count_ = GetThreadCount();
+  young_gen_ = ShouldCollectYoungGen();
   BindBitmaps();
+  if (young_gen_enabled_ && !young_gen_) {
+    // Only the objects that survive this collection are old afterwards.
+    region_space_bitmap_->Clear();
+  }
   if (kVerboseMode) {
     LOG(INFO) << "force_evacuate_all=" << force_evacuate_all_;
+    LOG(INFO) << "young_gen=" << young_gen_;
+    LOG(INFO) << "thread_count=" << thread_count_;
     LOG(INFO) << "Largest immune region: " << immune_spaces_.GetLargestImmuneRegion().Begin()
               << "-" << immune_spaces_.GetLargestImmuneRegion().End();
     for (space::ContinuousSpace* space : immune_spaces_.GetSpaces()) {
@@ -187,6 +242,21 @@ void ConcurrentCopying::InitializePhase() {
   }
 }
 
+bool ConcurrentCopying::ShouldCollectYoungGen() {
+  if (!young_gen_enabled_) {
+    return false;
+  }
+  if (force_evacuate_all_ || force_full_cycle_ ||
+      young_cycles_since_full_cycle_ >= kYoungCyclesPerFullCycle) {
+    // A full collection frees the old objects that died since the previous one.
+    force_full_cycle_ = false;
+    young_cycles_since_full_cycle_ = 0;
+    return false;
+  }
+  ++young_cycles_since_full_cycle_;
+  return true;
+}
+
 // Used to switch the thread roots of a thread from from-space refs to to-space refs.
 class ConcurrentCopying::ThreadFlipVisitor : public Closure {
  public:
@@ -238,7 +308,7 @@ class ConcurrentCopying::FlipCallback : public Closure {
     Thread* self = Thread::Current();
     CHECK(thread == self);
     Locks::mutator_lock_->AssertExclusiveHeld(self);
-    cc->region_space_->SetFromSpace(cc->rb_table_, cc->force_evacuate_all_);
+    cc->region_space_->SetFromSpace(cc->rb_table_, cc->force_evacuate_all_, cc->young_gen_);
     cc->SwapStacks();
     if (ConcurrentCopying::kEnableFromSpaceAccountingCheck) {
       cc->RecordLiveStackFreezeSize(self);
@@ -247,6 +317,9 @@ class ConcurrentCopying::FlipCallback : public Closure {
     }
     cc->is_marking_ = true;
     cc->mark_stack_mode_.StoreRelaxed(ConcurrentCopying::kMarkStackModeThreadLocal);
+    if (cc->young_gen_enabled_) {
+      cc->ProcessCards(self);
+    }
     if (UNLIKELY(Runtime::Current()->IsActiveTransaction())) {
       CHECK(Runtime::Current()->IsAotCompiler());
       TimingLogger::ScopedTiming split2("(Paused)VisitTransactionRoots", cc->GetTimings());
@@ -296,6 +369,87 @@ void ConcurrentCopying::RecordLiveStackFreezeSize(Thread* self) {
   live_stack_freeze_size_ = heap_->GetLiveStack()->Size();
 }
 
+// Used to gray the old objects on dirty cards.
+class ConcurrentCopying::GrayDirtyObjectVisitor {
+ public:
+  explicit GrayDirtyObjectVisitor(ConcurrentCopying* collector) : collector_(collector) {}
+
+  void operator()(mirror::Object* obj) const SHARED_REQUIRES(Locks::mutator_lock_) {
+    if (kUseBakerReadBarrier) {
+      // Nothing else grays objects during the pause.
+      bool success = obj->AtomicSetReadBarrierPointer(ReadBarrier::WhitePtr(),
+                                                      ReadBarrier::GrayPtr());
+      DCHECK(success) << obj;
+      collector_->dirty_objects_.push_back(obj);
+    }
+    collector_->PushOntoMarkStack(obj);
+  }
+
+ private:
+  ConcurrentCopying* const collector_;
+};
+
+// Used to visit the cards of the unevacuated from-space regions.
+class ConcurrentCopying::UnevacFromSpaceCardsVisitor {
+ public:
+  explicit UnevacFromSpaceCardsVisitor(ConcurrentCopying* collector) : collector_(collector) {}
+
+  // ProcessCards() holds the heap bitmap lock.
+  void operator()(uint8_t* begin, uint8_t* end) const NO_THREAD_SAFETY_ANALYSIS {
+    collector_->ProcessCardRange(collector_->region_space_bitmap_, begin, end);
+  }
+
+ private:
+  ConcurrentCopying* const collector_;
+};
+
+void ConcurrentCopying::ProcessCardRange(accounting::ContinuousSpaceBitmap* bitmap,
+                                         uint8_t* begin,
+                                         uint8_t* end) {
+  accounting::CardTable* card_table = heap_->GetCardTable();
+  if (young_gen_) {
+    GrayDirtyObjectVisitor visitor(this);
+    card_table->Scan<true>(bitmap, begin, end, visitor);
+  } else {
+    // The marking phase traces all of the objects.
+    card_table->ClearCardRange(begin, AlignUp(end, accounting::CardTable::kCardSize));
+  }
+}
+
+// The card table is the remembered set of the young generation: the write barrier dirties the
+// card of an object when a reference is stored into it. The cards of the old objects are
+// processed and cleared at each flip, so at the next flip, the old objects on dirty cards are the
+// only ones that may refer to the young generation. As old objects are not marked through in a
+// young-generation collection, those are grayed before the mutators resume, which keeps the
+// to-space invariant. The immune spaces are scanned in full by every collection.
+void ConcurrentCopying::ProcessCards(Thread* self) {
+  TimingLogger::ScopedTiming split("(Paused)ProcessCards", GetTimings());
+  WriterMutexLock mu(self, *Locks::heap_bitmap_lock_);
+  if (young_gen_) {
+    // Make the objects allocated in the non-moving spaces since the previous collection visible
+    // in the live bitmaps.
+    heap_->MarkAllocStackAsLive(heap_->GetLiveStack());
+  }
+  UnevacFromSpaceCardsVisitor visitor(this);
+  region_space_->VisitUnevacFromSpaceRanges(visitor);
+  for (const auto& space : heap_->GetContinuousSpaces()) {
+    if (space->IsContinuousMemMapAllocSpace() && space != region_space_ &&
+        !immune_spaces_.ContainsSpace(space)) {
+      ProcessCardRange(space->GetLiveBitmap(), space->Begin(), space->End());
+    }
+  }
+  // The large object space only holds primitive arrays and strings.
+}
+
+void ConcurrentCopying::ClearDirtyObjectsBlackPtrs() {
+  TimingLogger::ScopedTiming split("ClearDirtyObjectsBlackPtrs", GetTimings());
+  for (mirror::Object* obj : dirty_objects_) {
+    obj->AtomicSetReadBarrierPointer(ReadBarrier::BlackPtr(), ReadBarrier::WhitePtr());
+    DCHECK_EQ(obj->GetReadBarrierPointer(), ReadBarrier::WhitePtr()) << obj;
+  }
+  dirty_objects_.clear();
+}
+
 // Used to visit objects in the immune spaces.
 class ConcurrentCopying::ImmuneSpaceObjVisitor {
  public:
@@ -599,24 +753,13 @@ void ConcurrentCopying::PushOntoMarkStack(mirror::Object* to_ref) {
       if (UNLIKELY(tl_mark_stack == nullptr || tl_mark_stack->IsFull())) {
         MutexLock mu(self, mark_stack_lock_);
         // Get a new thread local mark stack.
-        accounting::AtomicStack<mirror::Object>* new_tl_mark_stack;
-        if (!pooled_mark_stacks_.empty()) {
-          // Use a pooled mark stack.
-          new_tl_mark_stack = pooled_mark_stacks_.back();
-          pooled_mark_stacks_.pop_back();
-        } else {
-          // None pooled. Create a new one.
-          new_tl_mark_stack =
-              accounting::AtomicStack<mirror::Object>::Create(
-                  "thread local mark stack", 4 * KB, 4 * KB);
-        }
-        DCHECK(new_tl_mark_stack != nullptr);
-        DCHECK(new_tl_mark_stack->IsEmpty());
+        accounting::AtomicStack<mirror::Object>* new_tl_mark_stack = GetMarkStackFromPool();
         new_tl_mark_stack->PushBack(to_ref);
         self->SetThreadLocalMarkStack(new_tl_mark_stack);
         if (tl_mark_stack != nullptr) {
           // Store the old full stack into a vector.
           revoked_mark_stacks_.push_back(tl_mark_stack);
+          num_revoked_mark_stacks_.StoreRelaxed(revoked_mark_stacks_.size());
         }
       } else {
         tl_mark_stack->PushBack(to_ref);
@@ -674,9 +817,10 @@ class ConcurrentCopying::VerifyNoFromSpaceRefsVisitor : public SingleRootVisitor
             << "To-space ref " << ref << " " << PrettyTypeOf(ref)
             << " has non-white rb_ptr " << ref->GetReadBarrierPointer();
       } else {
+        // Old objects are not marked through in a young-generation collection.
         CHECK(ref->GetReadBarrierPointer() == ReadBarrier::BlackPtr() ||
               (ref->GetReadBarrierPointer() == ReadBarrier::WhitePtr() &&
-               collector_->IsOnAllocStack(ref)))
+               (collector_->young_gen_ || collector_->IsOnAllocStack(ref))))
             << "Non-moving/unevac from space ref " << ref << " " << PrettyTypeOf(ref)
             << " has non-black rb_ptr " << ref->GetReadBarrierPointer()
             << " but isn't on the alloc stack (and has white rb_ptr)."
@@ -754,7 +898,7 @@ class ConcurrentCopying::VerifyNoFromSpaceRefsObjectVisitor {
       } else {
         CHECK(obj->GetReadBarrierPointer() == ReadBarrier::BlackPtr() ||
               (obj->GetReadBarrierPointer() == ReadBarrier::WhitePtr() &&
-               collector->IsOnAllocStack(obj)))
+               (collector->young_gen_ || collector->IsOnAllocStack(obj))))
             << "Non-moving space/unevac from space ref " << obj << " " << PrettyTypeOf(obj)
             << " has non-black rb_ptr " << obj->GetReadBarrierPointer()
             << " but isn't on the alloc stack (and has white rb_ptr). Is it in the non-moving space="
@@ -903,6 +1047,8 @@ class ConcurrentCopying::RevokeThreadLocalMarkStackCheckpoint : public Closure {
     if (tl_mark_stack != nullptr) {
       MutexLock mu(self, concurrent_copying_->mark_stack_lock_);
       concurrent_copying_->revoked_mark_stacks_.push_back(tl_mark_stack);
+      concurrent_copying_->num_revoked_mark_stacks_.StoreRelaxed(
+          concurrent_copying_->revoked_mark_stacks_.size());
       thread->SetThreadLocalMarkStack(nullptr);
     }
     // Disable weak ref access.
@@ -946,6 +1092,7 @@ void ConcurrentCopying::RevokeThreadLocalMarkStack(Thread* thread) {
     CHECK(is_marking_);
     MutexLock mu(self, mark_stack_lock_);
     revoked_mark_stacks_.push_back(tl_mark_stack);
+    num_revoked_mark_stacks_.StoreRelaxed(revoked_mark_stacks_.size());
     thread->SetThreadLocalMarkStack(nullptr);
   }
 }
@@ -972,7 +1119,10 @@ bool ConcurrentCopying::ProcessMarkStackOnce() {
   CHECK(self->GetThreadLocalMarkStack() == nullptr);
   size_t count = 0;
   MarkStackMode mark_stack_mode = mark_stack_mode_.LoadRelaxed();
-  if (mark_stack_mode == kMarkStackModeThreadLocal) {
+  if (mark_stack_mode == kMarkStackModeThreadLocal && thread_count_ > 1) {
+    // Process the thread-local mark stacks and the GC mark stack on the GC threads.
+    count += ProcessMarkStackParallel();
+  } else if (mark_stack_mode == kMarkStackModeThreadLocal) {
     // Process the thread-local mark stacks and the GC mark stack.
     count += ProcessThreadLocalMarkStacks(false);
     while (!gc_mark_stack_->IsEmpty()) {
@@ -1026,6 +1176,185 @@ bool ConcurrentCopying::ProcessMarkStackOnce() {
   return count == 0;
 }
 
+size_t ConcurrentCopying::GetThreadCount() const {
+  // Use one thread in a background state (non jank perceptible) since we want to leave more CPU
+  // time for the foreground apps.
+  if (heap_->GetThreadPool() == nullptr || !Runtime::Current()->InJankPerceptibleProcessState()) {
+    return 1;
+  }
+  return heap_->GetConcGCThreadCount() + 1;
+}
+
+class ConcurrentCopying::ParallelMarkTask : public Task {
+ public:
+  explicit ParallelMarkTask(ConcurrentCopying* concurrent_copying)
+      : concurrent_copying_(concurrent_copying) {
+  }
+
+  // The GC-running thread holds the mutator lock on behalf of the markers.
+  virtual void Run(Thread* self) OVERRIDE NO_THREAD_SAFETY_ANALYSIS {
+    concurrent_copying_->RunParallelMarker(self);
+  }
+
+  virtual void Finalize() OVERRIDE {
+    delete this;
+  }
+
+ private:
+  ConcurrentCopying* const concurrent_copying_;
+};
+
+size_t ConcurrentCopying::ProcessMarkStackParallel() {
+  Thread* self = Thread::Current();
+  // Collect the thread-local mark stacks. The markers take their work from revoked_mark_stacks_,
+  // which also receives the full thread-local mark stacks of the mutators while they mark.
+  RevokeThreadLocalMarkStacks(false);
+  started_markers_.StoreRelaxed(0);
+  idle_markers_.StoreRelaxed(0);
+  parallel_marked_refs_.StoreRelaxed(0);
+  size_t size = gc_mark_stack_->Size();
+  {
+    MutexLock mu(self, mark_stack_lock_);
+    for (accounting::ObjectStack* mark_stack : revoked_mark_stacks_) {
+      size += mark_stack->Size();
+    }
+  }
+  if (size < kMinimumParallelMarkStackSize) {
+    // Not worth waking up the workers, mark on this thread only.
+    RunParallelMarker(self);
+  } else {
+    // Split the GC mark stack up so that any marker can start with it.
+    const size_t chunk_size = std::min(gc_mark_stack_->Size() / thread_count_ + 1,
+                                       static_cast<size_t>(kMarkStackSize));
+    {
+      MutexLock mu(self, mark_stack_lock_);
+      while (!gc_mark_stack_->IsEmpty()) {
+        accounting::ObjectStack* mark_stack = GetMarkStackFromPool();
+        for (size_t i = 0; i < chunk_size && !gc_mark_stack_->IsEmpty(); ++i) {
+          mark_stack->PushBack(gc_mark_stack_->PopBack());
+        }
+        revoked_mark_stacks_.push_back(mark_stack);
+      }
+      num_revoked_mark_stacks_.StoreRelaxed(revoked_mark_stacks_.size());
+    }
+    gc_mark_stack_->Reset();
+    ThreadPool* thread_pool = heap_->GetThreadPool();
+    for (size_t i = 0; i < thread_count_; ++i) {
+      thread_pool->AddTask(self, new ParallelMarkTask(this));
+    }
+    thread_pool->SetMaxActiveWorkers(thread_count_ - 1);
+    thread_pool->StartWorkers(self);
+    thread_pool->Wait(self, true, true);
+    thread_pool->StopWorkers(self);
+  }
+  CHECK(gc_mark_stack_->IsEmpty());
+  return parallel_marked_refs_.LoadSequentiallyConsistent();
+}
+
+void ConcurrentCopying::RunParallelMarker(Thread* self) {
+  started_markers_.FetchAndAddSequentiallyConsistent(1);
+  // The GC-running thread pushes onto the GC mark stack, the other threads onto their thread-local
+  // mark stacks, see PushOntoMarkStack().
+  const bool is_gc_thread = self == thread_running_gc_;
+  size_t count = 0;
+  while (true) {
+    while (true) {
+      // A thread-local mark stack is replaced when it gets full, reload it.
+      accounting::ObjectStack* mark_stack =
+          is_gc_thread ? gc_mark_stack_.get() : self->GetThreadLocalMarkStack();
+      if (mark_stack == nullptr || mark_stack->IsEmpty()) {
+        break;
+      }
+      if (count % kMinimumSharedMarkStackSize == 0 &&
+          idle_markers_.LoadRelaxed() != 0 &&
+          mark_stack->Size() >= kMinimumSharedMarkStackSize) {
+        ShareMarkStack(self, mark_stack);
+      }
+      ProcessMarkStackRef(mark_stack->PopBack());
+      ++count;
+    }
+    // Out of work, take the mark stack of another thread.
+    accounting::ObjectStack* shared_mark_stack = TakeSharedMarkStack(self);
+    if (shared_mark_stack != nullptr) {
+      if (is_gc_thread) {
+        for (StackReference<mirror::Object>* p = shared_mark_stack->Begin();
+             p != shared_mark_stack->End(); ++p) {
+          if (UNLIKELY(gc_mark_stack_->IsFull())) {
+            ExpandGcMarkStack();
+          }
+          gc_mark_stack_->PushBack(p->AsMirrorPtr());
+        }
+        MutexLock mu(self, mark_stack_lock_);
+        ReturnMarkStackToPool(shared_mark_stack);
+      } else {
+        accounting::ObjectStack* tl_mark_stack = self->GetThreadLocalMarkStack();
+        if (tl_mark_stack != nullptr) {
+          MutexLock mu(self, mark_stack_lock_);
+          ReturnMarkStackToPool(tl_mark_stack);
+        }
+        self->SetThreadLocalMarkStack(shared_mark_stack);
+      }
+      continue;
+    }
+    // Wait for work to be shared until all of the markers are idle.
+    idle_markers_.FetchAndAddSequentiallyConsistent(1);
+    bool done = false;
+    while (true) {
+      if (HasSharedMarkStack()) {
+        idle_markers_.FetchAndSubSequentiallyConsistent(1);
+        break;
+      }
+      if (idle_markers_.LoadSequentiallyConsistent() ==
+          started_markers_.LoadSequentiallyConsistent()) {
+        done = true;
+        break;
+      }
+      sched_yield();
+    }
+    if (done) {
+      break;
+    }
+  }
+  if (is_gc_thread) {
+    gc_mark_stack_->Reset();
+  } else {
+    accounting::ObjectStack* tl_mark_stack = self->GetThreadLocalMarkStack();
+    if (tl_mark_stack != nullptr) {
+      DCHECK(tl_mark_stack->IsEmpty());
+      MutexLock mu(self, mark_stack_lock_);
+      ReturnMarkStackToPool(tl_mark_stack);
+      self->SetThreadLocalMarkStack(nullptr);
+    }
+  }
+  parallel_marked_refs_.FetchAndAddSequentiallyConsistent(count);
+}
+
+void ConcurrentCopying::ShareMarkStack(Thread* self, accounting::ObjectStack* mark_stack) {
+  const size_t count = std::min(mark_stack->Size() / 2, static_cast<size_t>(kMarkStackSize));
+  MutexLock mu(self, mark_stack_lock_);
+  accounting::ObjectStack* shared_mark_stack = GetMarkStackFromPool();
+  for (size_t i = 0; i < count; ++i) {
+    shared_mark_stack->PushBack(mark_stack->PopBack());
+  }
+  revoked_mark_stacks_.push_back(shared_mark_stack);
+  num_revoked_mark_stacks_.StoreRelaxed(revoked_mark_stacks_.size());
+}
+
+accounting::ObjectStack* ConcurrentCopying::TakeSharedMarkStack(Thread* self) {
+  MutexLock mu(self, mark_stack_lock_);
+  if (revoked_mark_stacks_.empty()) {
+    return nullptr;
+  }
+  accounting::ObjectStack* mark_stack = revoked_mark_stacks_.back();
+  revoked_mark_stacks_.pop_back();
+  num_revoked_mark_stacks_.StoreRelaxed(revoked_mark_stacks_.size());
+  return mark_stack;
+}
+
+bool ConcurrentCopying::HasSharedMarkStack() const {
+  return num_revoked_mark_stacks_.LoadRelaxed() != 0;
+}
+
 size_t ConcurrentCopying::ProcessThreadLocalMarkStacks(bool disable_weak_ref_access) {
   // Run a checkpoint to collect all thread local mark stacks and iterate over them all.
   RevokeThreadLocalMarkStacks(disable_weak_ref_access);
@@ -1036,6 +1365,7 @@ size_t ConcurrentCopying::ProcessThreadLocalMarkStacks(bool disable_weak_ref_acc
     // Make a copy of the mark stack vector.
     mark_stacks = revoked_mark_stacks_;
     revoked_mark_stacks_.clear();
+    num_revoked_mark_stacks_.StoreRelaxed(0);
   }
   for (accounting::AtomicStack<mirror::Object>* mark_stack : mark_stacks) {
     for (StackReference<mirror::Object>* p = mark_stack->Begin(); p != mark_stack->End(); ++p) {
@@ -1045,19 +1375,39 @@ size_t ConcurrentCopying::ProcessThreadLocalMarkStacks(bool disable_weak_ref_acc
     }
     {
       MutexLock mu(Thread::Current(), mark_stack_lock_);
-      if (pooled_mark_stacks_.size() >= kMarkStackPoolSize) {
-        // The pool has enough. Delete it.
-        delete mark_stack;
-      } else {
-        // Otherwise, put it into the pool for later reuse.
-        mark_stack->Reset();
-        pooled_mark_stacks_.push_back(mark_stack);
-      }
+      ReturnMarkStackToPool(mark_stack);
     }
   }
   return count;
 }
 
+accounting::ObjectStack* ConcurrentCopying::GetMarkStackFromPool() {
+  accounting::ObjectStack* mark_stack;
+  if (!pooled_mark_stacks_.empty()) {
+    // Use a pooled mark stack.
+    mark_stack = pooled_mark_stacks_.back();
+    pooled_mark_stacks_.pop_back();
+  } else {
+    // None pooled. Create a new one.
+    mark_stack = accounting::ObjectStack::Create(
+        "thread local mark stack", kMarkStackSize, kMarkStackSize);
+  }
+  DCHECK(mark_stack != nullptr);
+  DCHECK(mark_stack->IsEmpty());
+  return mark_stack;
+}
+
+void ConcurrentCopying::ReturnMarkStackToPool(accounting::ObjectStack* mark_stack) {
+  if (pooled_mark_stacks_.size() >= kMarkStackPoolSize) {
+    // The pool has enough. Delete it.
+    delete mark_stack;
+  } else {
+    // Otherwise, put it into the pool for later reuse.
+    mark_stack->Reset();
+    pooled_mark_stacks_.push_back(mark_stack);
+  }
+}
+
 inline void ConcurrentCopying::ProcessMarkStackRef(mirror::Object* to_ref) {
   DCHECK(!region_space_->IsInFromSpace(to_ref));
   if (kUseBakerReadBarrier) {
@@ -1193,16 +1543,18 @@ void ConcurrentCopying::SweepSystemWeaks(Thread* self) {
   Runtime::Current()->SweepSystemWeaks(this);
 }
 
-void ConcurrentCopying::Sweep(bool swap_bitmaps) {
-  {
-    TimingLogger::ScopedTiming t("MarkStackAsLive", GetTimings());
-    accounting::ObjectStack* live_stack = heap_->GetLiveStack();
-    if (kEnableFromSpaceAccountingCheck) {
-      CHECK_GE(live_stack_freeze_size_, live_stack->Size());
-    }
-    heap_->MarkAllocStackAsLive(live_stack);
-    live_stack->Reset();
+void ConcurrentCopying::MarkLiveStackAsLive() {
+  TimingLogger::ScopedTiming t("MarkStackAsLive", GetTimings());
+  accounting::ObjectStack* live_stack = heap_->GetLiveStack();
+  if (kEnableFromSpaceAccountingCheck) {
+    CHECK_GE(live_stack_freeze_size_, live_stack->Size());
   }
+  heap_->MarkAllocStackAsLive(live_stack);
+  live_stack->Reset();
+}
+
+void ConcurrentCopying::Sweep(bool swap_bitmaps) {
+  MarkLiveStackAsLive();
   CheckEmptyMarkStack();
   TimingLogger::ScopedTiming split("Sweep", GetTimings());
   for (const auto& space : GetHeap()->GetContinuousSpaces()) {
@@ -1219,6 +1571,25 @@ void ConcurrentCopying::Sweep(bool swap_bitmaps) {
   SweepLargeObjects(swap_bitmaps);
 }
 
+void ConcurrentCopying::SweepYoungGen() {
+  MarkLiveStackAsLive();
+  CheckEmptyMarkStack();
+  TimingLogger::ScopedTiming split("SweepYoungGen", GetTimings());
+  // Nothing is swept. The only marked objects are the ones copied to the non-moving spaces
+  // because the region space was full, and they are live from now on.
+  for (const auto& space : GetHeap()->GetContinuousSpaces()) {
+    if (space->IsContinuousMemMapAllocSpace() && space != region_space_ &&
+        !immune_spaces_.ContainsSpace(space)) {
+      accounting::ContinuousSpaceBitmap* live_bitmap = space->GetLiveBitmap();
+      space->GetMarkBitmap()->VisitMarkedRange(reinterpret_cast<uintptr_t>(space->Begin()),
+                                               reinterpret_cast<uintptr_t>(space->Limit()),
+                                               [live_bitmap](mirror::Object* obj) {
+        live_bitmap->Set(obj);
+      });
+    }
+  }
+}
+
 void ConcurrentCopying::SweepLargeObjects(bool swap_bitmaps) {
   TimingLogger::ScopedTiming split("SweepLargeObjects", GetTimings());
   RecordFreeLOS(heap_->GetLargeObjectsSpace()->Sweep(swap_bitmaps));
@@ -1334,7 +1705,8 @@ void ConcurrentCopying::ReclaimPhase() {
     }
   }
 
-  {
+  if (!young_gen_) {
+    // The old objects of a young-generation collection keep the live bytes of their regions.
     TimingLogger::ScopedTiming split3("ComputeUnevacFromSpaceLiveRatio", GetTimings());
     ComputeUnevacFromSpaceLiveRatio();
   }
@@ -1348,9 +1720,14 @@ void ConcurrentCopying::ReclaimPhase() {
     WriterMutexLock mu(self, *Locks::heap_bitmap_lock_);
     if (kUseBakerReadBarrier) {
       ClearBlackPtrs();
+      ClearDirtyObjectsBlackPtrs();
+    }
+    if (young_gen_) {
+      SweepYoungGen();
+    } else {
+      Sweep(false);
+      SwapBitmaps();
     }
-    Sweep(false);
-    SwapBitmaps();
     heap_->UnBindBitmaps();
 
     // Remove bitmaps for the immune spaces.
@@ -1360,7 +1737,9 @@ void ConcurrentCopying::ReclaimPhase() {
       delete cc_bitmap;
       cc_bitmaps_.pop_back();
     }
-    region_space_bitmap_ = nullptr;
+    if (!young_gen_enabled_) {
+      region_space_bitmap_ = nullptr;
+    }
   }
 
   CheckEmptyMarkStack();
@@ -1378,6 +1757,11 @@ class ConcurrentCopying::ComputeUnevacFromSpaceLiveRatioVisitor {
       SHARED_REQUIRES(Locks::heap_bitmap_lock_) {
     DCHECK(ref != nullptr);
     DCHECK(collector_->region_space_bitmap_->Test(ref)) << ref;
+    if (collector_->young_gen_enabled_ && !collector_->region_space_->IsInUnevacFromSpace(ref)) {
+      // A copy in the to-space, marked as an old object.
+      DCHECK(collector_->region_space_->IsInToSpace(ref)) << ref;
+      return;
+    }
     DCHECK(collector_->region_space_->IsInUnevacFromSpace(ref)) << ref;
     if (kUseBakerReadBarrier) {
       DCHECK_EQ(ref->GetReadBarrierPointer(), ReadBarrier::BlackPtr()) << ref;
@@ -1569,6 +1953,10 @@ void ConcurrentCopying::AssertToSpaceInvariantInNonMovingSpace(mirror::Object* o
     if ((!is_los && mark_bitmap->Test(ref)) ||
         (is_los && los_bitmap->Test(ref))) {
       // OK.
+    } else if (young_gen_ &&
+               ((!is_los && heap_live_bitmap_->GetContinuousSpaceBitmap(ref)->Test(ref)) ||
+                (is_los && heap_live_bitmap_->GetLargeObjectBitmap(ref)->Test(ref)))) {
+      // OK. An old object, which a young-generation collection does not mark.
     } else {
       // If ref is on the allocation stack, then it may not be
       // marked live, but considered marked/alive (but not
@@ -1894,6 +2282,10 @@ mirror::Object* ConcurrentCopying::Copy(mirror::Object* from_ref) {
       bytes_moved_.FetchAndAddSequentiallyConsistent(region_space_alloc_size);
       if (LIKELY(!fall_back_to_non_moving)) {
         DCHECK(region_space_->IsInToSpace(to_ref));
+        if (young_gen_enabled_) {
+          // The copy is old from now on.
+          region_space_bitmap_->AtomicTestAndSet(to_ref);
+        }
       } else {
         DCHECK(heap_->non_moving_space_->HasAddress(to_ref));
         DCHECK_EQ(bytes_allocated, non_moving_space_bytes_allocated);
@@ -1949,6 +2341,9 @@ mirror::Object* ConcurrentCopying::IsMarked(mirror::Object* from_ref) {
         // Newly marked.
         to_ref = nullptr;
       }
+    } else if (young_gen_) {
+      // A young-generation collection keeps the objects of the non-moving spaces.
+      to_ref = from_ref;
     } else {
       // Non-immune non-moving space. Use the mark bitmap.
       accounting::ContinuousSpaceBitmap* mark_bitmap =
@@ -2009,6 +2404,8 @@ mirror::Object* ConcurrentCopying::MarkNonMoving(mirror::Object* ref) {
       }
       PushOntoMarkStack(ref);
     }
+  } else if (young_gen_) {
+    // An old object, see Mark().
   } else {
     // Use the mark bitmap.
     accounting::ContinuousSpaceBitmap* mark_bitmap =
@@ -2111,6 +2508,30 @@ void ConcurrentCopying::ProcessReferences(Thread* self) {
       true /*concurrent*/, GetTimings(), GetCurrentIteration()->GetClearSoftReferences(), this);
 }
 
+void ConcurrentCopying::DumpPerformanceInfo(std::ostream& os) {
+  GarbageCollector::DumpPerformanceInfo(os);
+  MutexLock mu(Thread::Current(), cycle_stats_lock_);
+  for (const auto& it : cycle_stats_) {
+    const CycleStats& stats = it.second;
+    os << GetName() << " cycles with " << it.first << " marking thread(s): " << stats.cycles
+       << " mean time: " << PrettyDuration(stats.total_ns / stats.cycles)
+       << " mean marking time: " << PrettyDuration(stats.marking_ns / stats.cycles) << "\n";
+  }
+  if (young_gen_enabled_) {
+    for (bool young : {true, false}) {
+      const GenerationStats& stats = young ? young_gen_stats_ : full_gen_stats_;
+      if (stats.cycles == 0) {
+        continue;
+      }
+      os << GetName() << (young ? " young" : " full") << " cycles: " << stats.cycles
+         << " mean time: " << PrettyDuration(stats.total_ns / stats.cycles)
+         << " mean pause time: " << PrettyDuration(stats.pause_ns / stats.cycles)
+         << " max pause time: " << PrettyDuration(stats.max_pause_ns)
+         << " mean freed: " << PrettySize(stats.freed_bytes / stats.cycles) << "\n";
+    }
+  }
+}
+
 void ConcurrentCopying::RevokeAllThreadLocalBuffers() {
   TimingLogger::ScopedTiming t(__FUNCTION__, GetTimings());
   region_space_->RevokeAllThreadLocalBuffers();
@@ -30,6 +30,7 @@
 #include "mirror/object_reference.h"
 #include "safe_map.h"
 
+#include <map>
 #include <unordered_map>
 #include <vector>
 
@@ -58,6 +59,8 @@ class ConcurrentCopying : public GarbageCollector {
   static constexpr bool kEnableFromSpaceAccountingCheck = true;
   // Enable verbose mode.
   static constexpr bool kVerboseMode = false;
+  // With -Xgc:generational_cc, the number of young-generation collections between two full ones.
+  static constexpr size_t kYoungCyclesPerFullCycle = 8;
 
   ConcurrentCopying(Heap* heap, const std::string& name_prefix = "");
   ~ConcurrentCopying();
@@ -78,6 +81,8 @@ class ConcurrentCopying : public GarbageCollector {
     return kCollectorTypeCC;
   }
   virtual void RevokeAllThreadLocalBuffers() OVERRIDE;
+  virtual void DumpPerformanceInfo(std::ostream& os) OVERRIDE
+      REQUIRES(!pause_histogram_lock_, !cycle_stats_lock_);
   void SetRegionSpace(space::RegionSpace* region_space) {
     DCHECK(region_space != nullptr);
     region_space_ = region_space;
@@ -109,6 +114,11 @@ class ConcurrentCopying : public GarbageCollector {
   }
   void RevokeThreadLocalMarkStack(Thread* thread) SHARED_REQUIRES(Locks::mutator_lock_)
       REQUIRES(!mark_stack_lock_);
+  // Makes the next collection a full one. Called when another collector emptied the region
+  // space, which invalidates the bookkeeping of the young generation.
+  void RequestFullCollection() {
+    force_full_cycle_ = true;
+  }
 
  private:
   void PushOntoMarkStack(mirror::Object* obj) SHARED_REQUIRES(Locks::mutator_lock_)
@@ -134,6 +144,23 @@ class ConcurrentCopying : public GarbageCollector {
   virtual void ProcessMarkStack() OVERRIDE SHARED_REQUIRES(Locks::mutator_lock_)
       REQUIRES(!mark_stack_lock_);
   bool ProcessMarkStackOnce() SHARED_REQUIRES(Locks::mutator_lock_) REQUIRES(!mark_stack_lock_);
+  // Returns how many threads, including the GC-running thread, mark in parallel.
+  size_t GetThreadCount() const;
+  // Processes the GC mark stack and the thread-local mark stacks with thread_count_ threads, in
+  // the thread-local mark stack mode. Returns the number of processed refs.
+  size_t ProcessMarkStackParallel() SHARED_REQUIRES(Locks::mutator_lock_)
+      REQUIRES(!mark_stack_lock_);
+  // Marks on a GC thread until all of the markers run out of work.
+  void RunParallelMarker(Thread* self) SHARED_REQUIRES(Locks::mutator_lock_)
+      REQUIRES(!mark_stack_lock_);
+  // Moves the top half of the mark stack of a marker to the shared mark stacks.
+  void ShareMarkStack(Thread* self, accounting::ObjectStack* mark_stack)
+      SHARED_REQUIRES(Locks::mutator_lock_) REQUIRES(!mark_stack_lock_);
+  accounting::ObjectStack* TakeSharedMarkStack(Thread* self) REQUIRES(!mark_stack_lock_);
+  // Polled by idle markers, without taking mark_stack_lock_.
+  bool HasSharedMarkStack() const;
+  accounting::ObjectStack* GetMarkStackFromPool() REQUIRES(mark_stack_lock_);
+  void ReturnMarkStackToPool(accounting::ObjectStack* mark_stack) REQUIRES(mark_stack_lock_);
   void ProcessMarkStackRef(mirror::Object* to_ref) SHARED_REQUIRES(Locks::mutator_lock_)
       REQUIRES(!mark_stack_lock_);
   size_t ProcessThreadLocalMarkStacks(bool disable_weak_ref_access)
@@ -174,6 +201,20 @@ class ConcurrentCopying : public GarbageCollector {
   void FlipThreadRoots() REQUIRES(!Locks::mutator_lock_);
   void SwapStacks() SHARED_REQUIRES(Locks::mutator_lock_);
   void RecordLiveStackFreezeSize(Thread* self);
+  // Returns whether the current collection only evacuates the young generation.
+  bool ShouldCollectYoungGen();
+  // Grays the old objects on dirty cards in a young-generation collection, as they may refer to
+  // the young generation. Clears the cards of the old objects in all collections.
+  void ProcessCards(Thread* self) REQUIRES(Locks::mutator_lock_) REQUIRES(!mark_stack_lock_);
+  void ProcessCardRange(accounting::ContinuousSpaceBitmap* bitmap, uint8_t* begin, uint8_t* end)
+      REQUIRES(Locks::mutator_lock_, Locks::heap_bitmap_lock_) REQUIRES(!mark_stack_lock_);
+  // Turns the objects grayed by ProcessCards() back to white.
+  void ClearDirtyObjectsBlackPtrs() SHARED_REQUIRES(Locks::mutator_lock_);
+  void MarkLiveStackAsLive()
+      SHARED_REQUIRES(Locks::mutator_lock_) REQUIRES(Locks::heap_bitmap_lock_);
+  // Keeps the objects of the non-moving spaces, which a young-generation collection does not mark.
+  void SweepYoungGen()
+      SHARED_REQUIRES(Locks::mutator_lock_) REQUIRES(Locks::heap_bitmap_lock_, !mark_stack_lock_);
   void ComputeUnevacFromSpaceLiveRatio();
   void LogFromSpaceRefHolder(mirror::Object* obj, MemberOffset offset)
       SHARED_REQUIRES(Locks::mutator_lock_);
@@ -192,10 +233,22 @@ class ConcurrentCopying : public GarbageCollector {
   Mutex mark_stack_lock_ DEFAULT_MUTEX_ACQUIRED_AFTER;
   std::vector<accounting::ObjectStack*> revoked_mark_stacks_
       GUARDED_BY(mark_stack_lock_);
+  // The size of revoked_mark_stacks_, updated with mark_stack_lock_ held.
+  Atomic<size_t> num_revoked_mark_stacks_;
   static constexpr size_t kMarkStackSize = kPageSize;
   static constexpr size_t kMarkStackPoolSize = 256;
   std::vector<accounting::ObjectStack*> pooled_mark_stacks_
       GUARDED_BY(mark_stack_lock_);
+  // The mark stack is processed in parallel if it holds at least this many refs.
+  static constexpr size_t kMinimumParallelMarkStackSize = 128;
+  // A marker shares half of its mark stack with idle markers if it holds at least this many refs.
+  static constexpr size_t kMinimumSharedMarkStackSize = 64;
+  // How many threads mark in the current collection, including the GC-running thread.
+  size_t thread_count_;
+  // The markers started and idle in the current parallel marking, and the refs they processed.
+  Atomic<size_t> started_markers_;
+  Atomic<size_t> idle_markers_;
+  Atomic<size_t> parallel_marked_refs_;
   Thread* thread_running_gc_;
   bool is_marking_;                       // True while marking is ongoing.
   bool is_active_;                        // True while the collection is ongoing.
@@ -203,9 +256,13 @@ class ConcurrentCopying : public GarbageCollector {
   ImmuneSpaces immune_spaces_;
   std::unique_ptr<accounting::HeapBitmap> cc_heap_bitmap_;
   std::vector<accounting::SpaceBitmap<kObjectAlignment>*> cc_bitmaps_;
+  // With young-generation collections, the bitmap is kept across collections and marks the old
+  // objects of the region space. Full collections clear it.
   accounting::SpaceBitmap<kObjectAlignment>* region_space_bitmap_;
   // A cache of Heap::GetMarkBitmap().
   accounting::HeapBitmap* heap_mark_bitmap_;
+  // A cache of Heap::GetLiveBitmap().
+  accounting::HeapBitmap* heap_live_bitmap_;
   size_t live_stack_freeze_size_;
   size_t from_space_num_objects_at_first_pause_;
   size_t from_space_num_bytes_at_first_pause_;
@@ -237,6 +294,35 @@ class ConcurrentCopying : public GarbageCollector {
   accounting::ReadBarrierTable* rb_table_;
   bool force_evacuate_all_;  // True if all regions are evacuated.
 
+  // Set with -Xgc:generational_cc.
+  const bool young_gen_enabled_;
+  // True if only the regions allocated by mutators since the previous collection are evacuated.
+  // The other objects are assumed to be live.
+  bool young_gen_;
+  bool force_full_cycle_;
+  size_t young_cycles_since_full_cycle_;
+  // The old objects grayed by ProcessCards().
+  std::vector<mirror::Object*> dirty_objects_;
+
+  // Cycle times, by number of marking threads.
+  struct CycleStats {
+    size_t cycles = 0;
+    uint64_t total_ns = 0;
+    uint64_t marking_ns = 0;
+  };
+  Mutex cycle_stats_lock_ DEFAULT_MUTEX_ACQUIRED_AFTER;
+  std::map<size_t, CycleStats> cycle_stats_ GUARDED_BY(cycle_stats_lock_);
+  // Pauses and freed bytes of the young-generation and of the full collections.
+  struct GenerationStats {
+    size_t cycles = 0;
+    uint64_t total_ns = 0;
+    uint64_t pause_ns = 0;
+    uint64_t max_pause_ns = 0;
+    uint64_t freed_bytes = 0;
+  };
+  GenerationStats young_gen_stats_ GUARDED_BY(cycle_stats_lock_);
+  GenerationStats full_gen_stats_ GUARDED_BY(cycle_stats_lock_);
+
   class AssertToSpaceInvariantFieldVisitor;
   class AssertToSpaceInvariantObjectVisitor;
   class AssertToSpaceInvariantRefsVisitor;
@@ -244,14 +330,17 @@ class ConcurrentCopying : public GarbageCollector {
   class ComputeUnevacFromSpaceLiveRatioVisitor;
   class DisableMarkingCheckpoint;
   class FlipCallback;
+  class GrayDirtyObjectVisitor;
   class ImmuneSpaceObjVisitor;
   class LostCopyVisitor;
+  class ParallelMarkTask;
   class RefFieldsVisitor;
   class RevokeThreadLocalMarkStackCheckpoint;
   class VerifyNoFromSpaceRefsFieldVisitor;
   class VerifyNoFromSpaceRefsObjectVisitor;
   class VerifyNoFromSpaceRefsVisitor;
   class ThreadFlipVisitor;
+  class UnevacFromSpaceCardsVisitor;
 
   DISALLOW_IMPLICIT_CONSTRUCTORS(ConcurrentCopying);
 };
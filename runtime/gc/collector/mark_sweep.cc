@@ -20,6 +20,7 @@
 #include <functional>
 #include <numeric>
 #include <climits>
+#include <sched.h>
 #include <vector>
 
 #include "base/bounded_fifo.h"
@@ -36,6 +37,7 @@
 #include "gc/heap.h"
 #include "gc/reference_processor.h"
 #include "gc/space/large_object_space.h"
+#include "gc/space/rosalloc_space.h"
 #include "gc/space/space-inl.h"
 #include "mark_sweep-inl.h"
 #include "mirror/object-inl.h"
@@ -63,6 +65,12 @@ static constexpr bool kParallelRecursiveMark = true;
 // ProcessMarkStack with very small mark stacks.
 static constexpr size_t kMinimumParallelMarkStackSize = 128;
 static constexpr bool kParallelProcessMarkStack = true;
+// Initial capacity of the deques of the parallel mark stack processing, in objects.
+static constexpr size_t kMarkDequeInitialCapacity = 4 * KB;
+static constexpr bool kParallelSweep = true;
+// The ranges the GC threads sweep, more than one per thread to balance the work.
+static constexpr size_t kSweepRangesPerThread = 4;
+static constexpr size_t kMinimumSweepRangeSize = 256 * KB;
 
 // Profiling and information flags.
 static constexpr bool kProfileLargeObjects = false;
@@ -99,7 +107,8 @@ MarkSweep::MarkSweep(Heap* heap, bool is_concurrent, const std::string& name_pre
       gc_barrier_(new Barrier(0)),
       mark_stack_lock_("mark sweep mark stack lock", kMarkSweepMarkStackLock),
       is_concurrent_(is_concurrent),
-      live_stack_freeze_size_(0) {
+      live_stack_freeze_size_(0),
+      use_work_stealing_(true) {
   std::string error_msg;
   MemMap* mem_map = MemMap::MapAnonymous(
       "mark sweep sweep array free buffer", nullptr,
@@ -125,6 +134,7 @@ void MarkSweep::InitializePhase() {
   overhead_time_ .StoreRelaxed(0);
   work_chunks_created_.StoreRelaxed(0);
   work_chunks_deleted_.StoreRelaxed(0);
+  work_steals_.StoreRelaxed(0);
   mark_null_count_.StoreRelaxed(0);
   mark_immune_count_.StoreRelaxed(0);
   mark_fastpath_count_.StoreRelaxed(0);
@@ -1295,18 +1305,99 @@ void MarkSweep::Sweep(bool swap_bitmaps) {
     live_stack->Reset();
     DCHECK(mark_stack_->IsEmpty());
   }
+  const size_t thread_count = GetThreadCount(false);
   for (const auto& space : GetHeap()->GetContinuousSpaces()) {
     if (space->IsContinuousMemMapAllocSpace()) {
       space::ContinuousMemMapAllocSpace* alloc_space = space->AsContinuousMemMapAllocSpace();
       TimingLogger::ScopedTiming split(
           alloc_space->IsZygoteSpace() ? "SweepZygoteSpace" : "SweepMallocSpace",
           GetTimings());
-      RecordFree(alloc_space->Sweep(swap_bitmaps));
+      if (kParallelSweep && thread_count > 1 && alloc_space->IsRosAllocSpace()) {
+        RecordFree(SweepRosAllocSpaceParallel(alloc_space->AsRosAllocSpace(),
+                                              swap_bitmaps,
+                                              thread_count));
+      } else {
+        RecordFree(alloc_space->Sweep(swap_bitmaps));
+      }
     }
   }
   SweepLargeObjects(swap_bitmaps);
 }
 
+// Sweeps a range of a space, while the GC thread holds the heap bitmap lock.
+class MarkSweep::SweepTask : public Task {
+ public:
+  SweepTask(space::ContinuousMemMapAllocSpace* space,
+            bool swap_bitmaps,
+            uint8_t* begin,
+            uint8_t* end,
+            ObjectBytePair* freed)
+      : space_(space), swap_bitmaps_(swap_bitmaps), begin_(begin), end_(end), freed_(freed) {}
+
+  virtual void Run(Thread* self ATTRIBUTE_UNUSED) {
+    *freed_ = space_->SweepRange(swap_bitmaps_, begin_, end_);
+  }
+
+  virtual void Finalize() {
+    delete this;
+  }
+
+ private:
+  space::ContinuousMemMapAllocSpace* const space_;
+  const bool swap_bitmaps_;
+  uint8_t* const begin_;
+  uint8_t* const end_;
+  ObjectBytePair* const freed_;
+
+  DISALLOW_COPY_AND_ASSIGN(SweepTask);
+};
+
+ObjectBytePair MarkSweep::SweepRosAllocSpaceParallel(space::RosAllocSpace* space,
+                                                     bool swap_bitmaps,
+                                                     size_t thread_count) {
+  if (space->GetLiveBitmap() == space->GetMarkBitmap()) {
+    // The bitmaps are bound, there is nothing to sweep.
+    return ObjectBytePair(0, 0);
+  }
+  Thread* self = Thread::Current();
+  ThreadPool* thread_pool = GetHeap()->GetThreadPool();
+  allocator::RosAlloc* rosalloc = space->GetRosAlloc();
+  uint8_t* const begin = space->Begin();
+  uint8_t* const end = space->End();
+  const size_t range_size = std::max(
+      RoundUp(static_cast<size_t>(end - begin) / (thread_count * kSweepRangesPerThread),
+              kPageSize),
+      kMinimumSweepRangeSize);
+  // Split the space at the beginning of page runs, so that a single thread frees the slots of a
+  // run, and takes its size bracket lock once per batch of slots. As the boundaries are page
+  // aligned, the ranges do not share words of the bitmaps either.
+  std::vector<uint8_t*> boundaries(1, begin);
+  for (uint8_t* addr = begin + range_size; addr < end; addr += range_size) {
+    uint8_t* boundary = rosalloc->PageRunBegin(addr);
+    if (boundary > boundaries.back()) {
+      boundaries.push_back(boundary);
+    }
+  }
+  boundaries.push_back(end);
+  const size_t range_count = boundaries.size() - 1;
+  // The mutators allocate from the runs the tasks return to the allocator while the sweep is
+  // still in progress.
+  std::vector<ObjectBytePair> freed(range_count);
+  for (size_t i = 0; i < range_count; ++i) {
+    thread_pool->AddTask(
+        self, new SweepTask(space, swap_bitmaps, boundaries[i], boundaries[i + 1], &freed[i]));
+  }
+  thread_pool->SetMaxActiveWorkers(thread_count - 1);
+  thread_pool->StartWorkers(self);
+  thread_pool->Wait(self, true, true);
+  thread_pool->StopWorkers(self);
+  ObjectBytePair total;
+  for (const ObjectBytePair& range_freed : freed) {
+    total.Add(range_freed);
+  }
+  return total;
+}
+
 void MarkSweep::SweepLargeObjects(bool swap_bitmaps) {
   space::LargeObjectSpace* los = heap_->GetLargeObjectsSpace();
   if (los != nullptr) {
@@ -1367,7 +1458,200 @@ void MarkSweep::ScanObject(mirror::Object* obj) {
   ScanObjectVisit(obj, mark_visitor, ref_visitor);
 }
 
+// Marks from a deque of its own, and steals from the deques of the other tasks once it runs out of
+// work. The tasks finish when none of them has work left.
+class MarkSweep::WorkStealingMarkTask : public Task {
+ public:
+  WorkStealingMarkTask(MarkSweep* mark_sweep, size_t index, size_t task_count)
+      : mark_sweep_(mark_sweep),
+        index_(index),
+        task_count_(task_count),
+        deque_(mark_sweep->mark_deques_[index].get()),
+        random_state_(static_cast<uint32_t>(index) + 1) {}
+
+  virtual void Finalize() {
+    delete this;
+  }
+
+  virtual void Run(Thread* self ATTRIBUTE_UNUSED)
+      REQUIRES(Locks::heap_bitmap_lock_)
+      SHARED_REQUIRES(Locks::mutator_lock_) {
+    AtomicInteger* const active_workers = &mark_sweep_->active_mark_workers_;
+    active_workers->FetchAndAddSequentiallyConsistent(1);
+    for (;;) {
+      ProcessDeque();
+      mirror::Object* obj = StealObject();
+      if (obj != nullptr) {
+        ScanObject(obj);
+        continue;
+      }
+      // Wait until another task has work to steal, or until no task is marking. An idle task has
+      // an empty deque, and only a marking task pushes objects, so once no task is marking there
+      // is no work left.
+      active_workers->FetchAndSubSequentiallyConsistent(1);
+      while (!HasWorkToSteal()) {
+        if (active_workers->LoadSequentiallyConsistent() == 0) {
+          return;
+        }
+        sched_yield();
+      }
+      active_workers->FetchAndAddSequentiallyConsistent(1);
+    }
+  }
+
+ private:
+  class MarkObjectVisitor {
+   public:
+    ALWAYS_INLINE explicit MarkObjectVisitor(WorkStealingMarkTask* task) : task_(task) {}
+
+    ALWAYS_INLINE void operator()(mirror::Object* obj,
+                                  MemberOffset offset,
+                                  bool is_static ATTRIBUTE_UNUSED) const
+        SHARED_REQUIRES(Locks::mutator_lock_) {
+      Mark(obj->GetFieldObject<mirror::Object>(offset));
+    }
+
+    void VisitRootIfNonNull(mirror::CompressedReference<mirror::Object>* root) const
+        SHARED_REQUIRES(Locks::mutator_lock_) {
+      if (!root->IsNull()) {
+        VisitRoot(root);
+      }
+    }
+
+    void VisitRoot(mirror::CompressedReference<mirror::Object>* root) const
+        SHARED_REQUIRES(Locks::mutator_lock_) {
+      Mark(root->AsMirrorPtr());
+    }
+
+   private:
+    ALWAYS_INLINE void Mark(mirror::Object* ref) const SHARED_REQUIRES(Locks::mutator_lock_) {
+      if (ref != nullptr && task_->mark_sweep_->MarkObjectParallel(ref)) {
+        task_->deque_->Push(ref);
+      }
+    }
+
+    WorkStealingMarkTask* const task_;
+  };
+
+  void ScanObject(mirror::Object* obj)
+      REQUIRES(Locks::heap_bitmap_lock_)
+      SHARED_REQUIRES(Locks::mutator_lock_) {
+    MarkObjectVisitor mark_visitor(this);
+    DelayReferenceReferentVisitor ref_visitor(mark_sweep_);
+    mark_sweep_->ScanObjectVisit(obj, mark_visitor, ref_visitor);
+  }
+
+  // Scans the objects of the deque, and the objects they mark, until the deque is empty.
+  void ProcessDeque()
+      REQUIRES(Locks::heap_bitmap_lock_)
+      SHARED_REQUIRES(Locks::mutator_lock_) {
+    // TODO: Tune this.
+    static const size_t kFifoSize = 4;
+    BoundedFifoPowerOfTwo<mirror::Object*, kFifoSize> prefetch_fifo;
+    for (;;) {
+      mirror::Object* obj = nullptr;
+      if (kUseMarkStackPrefetch) {
+        while (prefetch_fifo.size() < kFifoSize) {
+          mirror::Object* const deque_obj = deque_->Pop();
+          if (deque_obj == nullptr) {
+            break;
+          }
+          __builtin_prefetch(deque_obj);
+          prefetch_fifo.push_back(deque_obj);
+        }
+        if (UNLIKELY(prefetch_fifo.empty())) {
+          break;
+        }
+        obj = prefetch_fifo.front();
+        prefetch_fifo.pop_front();
+      } else {
+        obj = deque_->Pop();
+        if (UNLIKELY(obj == nullptr)) {
+          break;
+        }
+      }
+      ScanObject(obj);
+    }
+  }
+
+  // Tries the deques of the other tasks, starting from a random one so that the thieves spread
+  // over the deques. Returns null if it found nothing to steal.
+  mirror::Object* StealObject() {
+    size_t victim = NextRandom() % task_count_;
+    for (size_t i = 0; i < task_count_; ++i) {
+      if (victim != index_) {
+        mirror::Object* obj = mark_sweep_->mark_deques_[victim]->Steal();
+        if (obj != nullptr) {
+          if (kCountTasks) {
+            ++mark_sweep_->work_steals_;
+          }
+          return obj;
+        }
+      }
+      victim = (victim + 1 == task_count_) ? 0 : victim + 1;
+    }
+    return nullptr;
+  }
+
+  bool HasWorkToSteal() const {
+    for (size_t i = 0; i < task_count_; ++i) {
+      if (i != index_ && !mark_sweep_->mark_deques_[i]->IsEmpty()) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  // Xorshift, which only needs to be cheap.
+  uint32_t NextRandom() {
+    random_state_ ^= random_state_ << 13;
+    random_state_ ^= random_state_ >> 17;
+    random_state_ ^= random_state_ << 5;
+    return random_state_;
+  }
+
+  MarkSweep* const mark_sweep_;
+  const size_t index_;
+  const size_t task_count_;
+  accounting::WorkStealingDeque<mirror::Object>* const deque_;
+  uint32_t random_state_;
+
+  DISALLOW_COPY_AND_ASSIGN(WorkStealingMarkTask);
+};
+
 void MarkSweep::ProcessMarkStackParallel(size_t thread_count) {
+  if (!use_work_stealing_) {
+    ProcessMarkStackParallelChunked(thread_count);
+    return;
+  }
+  Thread* self = Thread::Current();
+  ThreadPool* thread_pool = GetHeap()->GetThreadPool();
+  while (mark_deques_.size() < thread_count) {
+    mark_deques_.emplace_back(
+        new accounting::WorkStealingDeque<mirror::Object>(kMarkDequeInitialCapacity));
+  }
+  // Deal the mark stack to the deques. The tasks steal from each other if this is unbalanced.
+  size_t index = 0;
+  for (auto* it = mark_stack_->Begin(), *end = mark_stack_->End(); it < end; ++it) {
+    mark_deques_[index]->Push(it->AsMirrorPtr());
+    index = (index + 1 == thread_count) ? 0 : index + 1;
+  }
+  mark_stack_->Reset();
+  DCHECK_EQ(active_mark_workers_.LoadRelaxed(), 0);
+  for (size_t i = 0; i < thread_count; ++i) {
+    thread_pool->AddTask(self, new WorkStealingMarkTask(this, i, thread_count));
+  }
+  thread_pool->SetMaxActiveWorkers(thread_count - 1);
+  thread_pool->StartWorkers(self);
+  thread_pool->Wait(self, true, true);
+  thread_pool->StopWorkers(self);
+  DCHECK_EQ(active_mark_workers_.LoadRelaxed(), 0);
+  for (size_t i = 0; i < thread_count; ++i) {
+    mark_deques_[i]->Reset();
+  }
+}
+
+void MarkSweep::ProcessMarkStackParallelChunked(size_t thread_count) {
   Thread* self = Thread::Current();
   ThreadPool* thread_pool = GetHeap()->GetThreadPool();
   const size_t chunk_size = std::min(mark_stack_->Size() / thread_count + 1,
@@ -1450,6 +1734,7 @@ void MarkSweep::FinishPhase() {
   }
   if (kCountTasks) {
     VLOG(gc) << "Total number of work chunks allocated: " << work_chunks_created_.LoadRelaxed();
+    VLOG(gc) << "Total number of objects stolen: " << work_steals_.LoadRelaxed();
   }
   if (kMeasureOverhead) {
     VLOG(gc) << "Overhead time " << PrettyDuration(overhead_time_.LoadRelaxed());
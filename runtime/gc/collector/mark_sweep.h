@@ -18,6 +18,7 @@
 #define ART_RUNTIME_GC_COLLECTOR_MARK_SWEEP_H_
 
 #include <memory>
+#include <vector>
 
 #include "atomic.h"
 #include "barrier.h"
@@ -26,6 +27,7 @@
 #include "garbage_collector.h"
 #include "gc_root.h"
 #include "gc/accounting/heap_bitmap.h"
+#include "gc/accounting/work_stealing_deque.h"
 #include "immune_spaces.h"
 #include "object_callbacks.h"
 #include "offsets.h"
@@ -50,6 +52,10 @@ template<typename T> class AtomicStack;
 typedef AtomicStack<mirror::Object> ObjectStack;
 }  // namespace accounting
 
+namespace space {
+class RosAllocSpace;
+}  // namespace space
+
 namespace collector {
 
 class MarkSweep : public GarbageCollector {
@@ -154,6 +160,12 @@ class MarkSweep : public GarbageCollector {
   // Sweeps unmarked objects to complete the garbage collection.
   void SweepLargeObjects(bool swap_bitmaps) REQUIRES(Locks::heap_bitmap_lock_);
 
+  // Sweeps ranges of a RosAlloc space with `thread_count` threads.
+  ObjectBytePair SweepRosAllocSpaceParallel(space::RosAllocSpace* space,
+                                            bool swap_bitmaps,
+                                            size_t thread_count)
+      REQUIRES(Locks::heap_bitmap_lock_);
+
   // Sweep only pointers within an array. WARNING: Trashes objects.
   void SweepArray(accounting::ObjectStack* allocation_stack_, bool swap_bitmaps)
       REQUIRES(Locks::heap_bitmap_lock_)
@@ -291,11 +303,24 @@ class MarkSweep : public GarbageCollector {
       REQUIRES(!mark_stack_lock_)
       SHARED_REQUIRES(Locks::mutator_lock_);
 
+  // Each of the `thread_count` workers marks from a deque of its own, and steals from the deques
+  // of the others when it runs out of work.
   void ProcessMarkStackParallel(size_t thread_count)
       REQUIRES(Locks::heap_bitmap_lock_)
       REQUIRES(!mark_stack_lock_)
       SHARED_REQUIRES(Locks::mutator_lock_);
 
+  // Splits the mark stack in fixed size chunks, which the workers process without sharing work.
+  void ProcessMarkStackParallelChunked(size_t thread_count)
+      REQUIRES(Locks::heap_bitmap_lock_)
+      REQUIRES(!mark_stack_lock_)
+      SHARED_REQUIRES(Locks::mutator_lock_);
+
+  // Selects how ProcessMarkStackParallel shares the work, to compare both schemes in tests.
+  void SetUseWorkStealingForTesting(bool use_work_stealing) {
+    use_work_stealing_ = use_work_stealing;
+  }
+
   // Used to Get around thread safety annotations. The call is from MarkingPhase and is guarded by
   // IsExclusiveHeld.
   void RevokeAllThreadLocalAllocationStacks(Thread* self) NO_THREAD_SAFETY_ANALYSIS;
@@ -337,6 +362,7 @@ class MarkSweep : public GarbageCollector {
   AtomicInteger overhead_time_;
   AtomicInteger work_chunks_created_;
   AtomicInteger work_chunks_deleted_;
+  AtomicInteger work_steals_;
   AtomicInteger mark_null_count_;
   AtomicInteger mark_immune_count_;
   AtomicInteger mark_fastpath_count_;
@@ -352,6 +378,14 @@ class MarkSweep : public GarbageCollector {
 
   std::unique_ptr<MemMap> sweep_array_free_buffer_mem_map_;
 
+  // The deques of the workers of ProcessMarkStackParallel, kept across collections.
+  std::vector<std::unique_ptr<accounting::WorkStealingDeque<mirror::Object>>> mark_deques_;
+  // Number of workers of ProcessMarkStackParallel which are marking or stealing, as opposed to
+  // waiting for work.
+  AtomicInteger active_mark_workers_;
+  // Whether ProcessMarkStackParallel uses work stealing or fixed chunks.
+  bool use_work_stealing_;
+
  private:
   class CardScanTask;
   class CheckpointMarkThreadRoots;
@@ -361,9 +395,11 @@ class MarkSweep : public GarbageCollector {
   class RecursiveMarkTask;
   class ScanObjectParallelVisitor;
   class ScanObjectVisitor;
+  class SweepTask;
   class VerifyRootMarkedVisitor;
   class VerifyRootVisitor;
   class VerifySystemWeakVisitor;
+  class WorkStealingMarkTask;
 
   DISALLOW_IMPLICIT_CONSTRUCTORS(MarkSweep);
 };
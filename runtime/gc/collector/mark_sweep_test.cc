@@ -0,0 +1,172 @@
+/*
+ * Copyright (C) 2016 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "gc/collector/mark_sweep.h"
+
+#include <vector>
+
+#include "base/timing_logger.h"
+#include "class_linker-inl.h"
+#include "common_runtime_test.h"
+#include "gc/heap.h"
+#include "handle_scope-inl.h"
+#include "java_vm_ext.h"
+#include "mirror/object-inl.h"
+#include "mirror/object_array-inl.h"
+#include "mirror/string.h"
+#include "scoped_thread_state_change.h"
+
+namespace art {
+namespace gc {
+namespace collector {
+
+// Compares the marking time of ProcessMarkStackParallel with work stealing and with fixed chunks.
+// The heaps are held through kRoots global references, so that the mark stack is large enough for
+// the parallel processing once the roots are marked.
+class MarkSweepTest : public CommonRuntimeTest {
+ protected:
+  static constexpr size_t kRoots = 256;
+  static constexpr size_t kCollections = 4;
+
+  void SetUpRuntimeOptions(RuntimeOptions* options) OVERRIDE {
+    CommonRuntimeTest::SetUpRuntimeOptions(options);
+    if (!kUseReadBarrier) {
+      // Mark with four threads.
+      options->push_back(std::make_pair("-Xgc:MS", nullptr));
+      options->push_back(std::make_pair("-XX:ParallelGCThreads=3", nullptr));
+      options->push_back(std::make_pair("-XX:ConcGCThreads=3", nullptr));
+    }
+  }
+
+  // Returns the time RecursiveMark took over kCollections full collections.
+  uint64_t TimeMarking(bool use_work_stealing) {
+    Heap* heap = Runtime::Current()->GetHeap();
+    MarkSweep* mark_sweep = down_cast<MarkSweep*>(heap->FindCollectorByGcType(kGcTypeFull));
+    CHECK(mark_sweep != nullptr);
+    mark_sweep->SetUseWorkStealingForTesting(use_work_stealing);
+    uint64_t marking_ns = 0;
+    for (size_t i = 0; i < kCollections; ++i) {
+      heap->CollectGarbage(/* clear_soft_references */ false);
+      const TimingLogger* timings = mark_sweep->GetTimings();
+      size_t index = timings->FindTimingIndex("RecursiveMark", 0);
+      CHECK_NE(index, TimingLogger::kIndexNotFound);
+      marking_ns += timings->CalculateTimingData().GetTotalTime(index);
+    }
+    mark_sweep->SetUseWorkStealingForTesting(true);
+    return marking_ns;
+  }
+
+  void CompareMarkingTimes(const char* heap_name) {
+    uint64_t chunked_ns = TimeMarking(false);
+    uint64_t work_stealing_ns = TimeMarking(true);
+    LOG(INFO) << heap_name << " marking time: chunked " << PrettyDuration(chunked_ns)
+              << ", work stealing " << PrettyDuration(work_stealing_ns);
+  }
+};
+
+// Linked lists, the first few of which are long, so that the chunks holding them take much
+// longer to mark than the others.
+TEST_F(MarkSweepTest, DeepLists) {
+  if (kUseReadBarrier) {
+    // The read barrier configuration only uses the concurrent copying collector.
+    return;
+  }
+  static constexpr size_t kLongLists = 32;
+  static constexpr size_t kLongListLength = 8 * KB;
+  auto list_length = [](size_t root) { return root < kLongLists ? kLongListLength : 1u; };
+  std::vector<jobject> roots;
+  {
+    ScopedObjectAccess soa(Thread::Current());
+    StackHandleScope<2> hs(soa.Self());
+    Handle<mirror::Class> node_class(
+        hs.NewHandle(class_linker_->FindSystemClass(soa.Self(), "[Ljava/lang/Object;")));
+    MutableHandle<mirror::ObjectArray<mirror::Object>> head(
+        hs.NewHandle<mirror::ObjectArray<mirror::Object>>(nullptr));
+    for (size_t i = 0; i < kRoots; ++i) {
+      head.Assign(nullptr);
+      for (size_t j = 0; j < list_length(i); ++j) {
+        mirror::ObjectArray<mirror::Object>* node =
+            mirror::ObjectArray<mirror::Object>::Alloc(soa.Self(), node_class.Get(), 1);
+        ASSERT_TRUE(node != nullptr);
+        node->Set<false>(0, head.Get());
+        head.Assign(node);
+      }
+      roots.push_back(soa.Vm()->AddGlobalRef(soa.Self(), head.Get()));
+    }
+  }
+
+  CompareMarkingTimes("Deep lists");
+
+  ScopedObjectAccess soa(Thread::Current());
+  for (size_t i = 0; i < kRoots; ++i) {
+    size_t length = 0;
+    for (mirror::Object* node = soa.Decode<mirror::Object*>(roots[i]);
+         node != nullptr;
+         node = node->AsObjectArray<mirror::Object>()->Get(0)) {
+      ++length;
+    }
+    EXPECT_EQ(list_length(i), length);
+    soa.Vm()->DeleteGlobalRef(soa.Self(), roots[i]);
+  }
+}
+
+// Arrays of many leaf objects.
+TEST_F(MarkSweepTest, WideFanOut) {
+  if (kUseReadBarrier) {
+    // The read barrier configuration only uses the concurrent copying collector.
+    return;
+  }
+  static constexpr size_t kFanOut = 1 * KB;
+  std::vector<jobject> roots;
+  {
+    ScopedObjectAccess soa(Thread::Current());
+    StackHandleScope<2> hs(soa.Self());
+    Handle<mirror::Class> array_class(
+        hs.NewHandle(class_linker_->FindSystemClass(soa.Self(), "[Ljava/lang/Object;")));
+    MutableHandle<mirror::ObjectArray<mirror::Object>> array(
+        hs.NewHandle<mirror::ObjectArray<mirror::Object>>(nullptr));
+    for (size_t i = 0; i < kRoots; ++i) {
+      array.Assign(mirror::ObjectArray<mirror::Object>::Alloc(soa.Self(), array_class.Get(),
+                                                               kFanOut));
+      ASSERT_TRUE(array.Get() != nullptr);
+      for (size_t j = 0; j < kFanOut; ++j) {
+        mirror::String* leaf = mirror::String::AllocFromModifiedUtf8(soa.Self(), "leaf");
+        ASSERT_TRUE(leaf != nullptr);
+        array->Set<false>(j, leaf);
+      }
+      roots.push_back(soa.Vm()->AddGlobalRef(soa.Self(), array.Get()));
+    }
+  }
+
+  CompareMarkingTimes("Wide fan-out");
+
+  ScopedObjectAccess soa(Thread::Current());
+  for (size_t i = 0; i < kRoots; ++i) {
+    mirror::ObjectArray<mirror::Object>* array =
+        soa.Decode<mirror::ObjectArray<mirror::Object>*>(roots[i]);
+    ASSERT_EQ(static_cast<int32_t>(kFanOut), array->GetLength());
+    for (size_t j = 0; j < kFanOut; ++j) {
+      mirror::Object* leaf = array->Get(j);
+      ASSERT_TRUE(leaf != nullptr);
+      EXPECT_TRUE(leaf->IsString());
+    }
+    soa.Vm()->DeleteGlobalRef(soa.Self(), roots[i]);
+  }
+}
+
+}  // namespace collector
+}  // namespace gc
+}  // namespace art
@@ -153,6 +153,7 @@ Heap::Heap(size_t initial_size,
            bool verify_pre_sweeping_rosalloc,
            bool verify_post_gc_rosalloc,
            bool gc_stress_mode,
+           bool use_generational_cc,
            bool use_homogeneous_space_compaction_for_oom,
            uint64_t min_interval_homogeneous_space_compaction_by_oom)
     : non_moving_space_(nullptr),
@@ -204,6 +205,7 @@ Heap::Heap(size_t initial_size,
       verify_pre_sweeping_rosalloc_(verify_pre_sweeping_rosalloc),
       verify_post_gc_rosalloc_(verify_post_gc_rosalloc),
       gc_stress_mode_(gc_stress_mode),
+      use_generational_cc_(use_generational_cc),
       /* For GC a lot mode, we limit the allocations stacks to be kGcAlotInterval allocations. This
        * causes a lot of GC since we do a GC for alloc whenever the stack is full. When heap
        * verification is enabled, we limit the size of allocation stacks to speed up their
@@ -2457,6 +2459,8 @@ void Heap::PreZygoteFork() {
     if (IsMovingGc(collector_type_)) {
       if (collector_type_ == kCollectorTypeCC) {
         zygote_collector.SetFromSpace(region_space_);
+        // The compaction empties the region space.
+        concurrent_copying_collector_->RequestFullCollection();
       } else {
         zygote_collector.SetFromSpace(bump_pointer_space_);
       }
@@ -3842,6 +3846,16 @@ void Heap::RevokeRosAllocThreadLocalBuffers(Thread* thread) {
   }
 }
 
+void Heap::RevokeIdleThreadLocalBuffers(Thread* self) {
+  if (rosalloc_space_ != nullptr) {
+    size_t freed_bytes_revoke = rosalloc_space_->RevokeIdleThreadLocalBuffers(self);
+    if (freed_bytes_revoke > 0U) {
+      num_bytes_freed_revoke_.FetchAndAddSequentiallyConsistent(freed_bytes_revoke);
+      CHECK_GE(num_bytes_allocated_.LoadRelaxed(), num_bytes_freed_revoke_.LoadRelaxed());
+    }
+  }
+}
+
 void Heap::RevokeAllThreadLocalBuffers() {
   if (rosalloc_space_ != nullptr) {
     size_t freed_bytes_revoke = rosalloc_space_->RevokeAllThreadLocalBuffers();
@@ -71,6 +71,7 @@ namespace collector {
   class GarbageCollector;
   class MarkCompact;
   class MarkSweep;
+  class MarkSweepTest;
   class SemiSpace;
 }  // namespace collector
 
@@ -182,6 +183,7 @@ class Heap {
        bool verify_pre_sweeping_rosalloc,
        bool verify_post_gc_rosalloc,
        bool gc_stress_mode,
+       bool use_generational_cc,
        bool use_homogeneous_space_compaction,
        uint64_t min_interval_homogeneous_space_compaction_by_oom);
 
@@ -542,6 +544,9 @@ class Heap {
 
   void RevokeThreadLocalBuffers(Thread* thread);
   void RevokeRosAllocThreadLocalBuffers(Thread* thread);
+  // Called by a thread about to wait or sleep for long, to return the thread-local buffers it is
+  // unlikely to use soon.
+  void RevokeIdleThreadLocalBuffers(Thread* self);
   void RevokeAllThreadLocalBuffers();
   void AssertThreadLocalBuffersAreRevoked(Thread* thread);
   void AssertAllBumpPointerSpaceThreadLocalBuffersAreRevoked();
@@ -670,6 +675,9 @@ class Heap {
   size_t GetConcGCThreadCount() const {
     return conc_gc_threads_;
   }
+  bool UseGenerationalConcurrentCopying() const {
+    return use_generational_cc_;
+  }
   accounting::ModUnionTable* FindModUnionTableFromSpace(space::Space* space);
   void AddModUnionTable(accounting::ModUnionTable* mod_union_table);
 
@@ -1183,6 +1191,8 @@ class Heap {
   bool verify_pre_sweeping_rosalloc_;
   bool verify_post_gc_rosalloc_;
   const bool gc_stress_mode_;
+  // Whether the concurrent copying collector runs young-generation cycles.
+  const bool use_generational_cc_;
 
   // RAII that temporarily disables the rosalloc verification during
   // the zygote fork.
@@ -1354,6 +1364,7 @@ class Heap {
   friend class collector::MarkCompact;
   friend class collector::ConcurrentCopying;
   friend class collector::MarkSweep;
+  friend class collector::MarkSweepTest;  // For FindCollectorByGcType.
   friend class collector::SemiSpace;
   friend class ReferenceQueue;
   friend class ScopedGCCriticalSection;
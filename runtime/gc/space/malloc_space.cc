@@ -232,7 +232,12 @@ void MallocSpace::SweepCallback(size_t num_ptrs, mirror::Object** ptrs, void* ar
   SweepCallbackContext* context = static_cast<SweepCallbackContext*>(arg);
   space::MallocSpace* space = context->space->AsMallocSpace();
   Thread* self = context->self;
-  Locks::heap_bitmap_lock_->AssertExclusiveHeld(self);
+  // The GC thread holds the heap bitmap lock, also while GC workers sweep ranges of the space.
+  if (kIsDebugBuild) {
+    uint64_t owner_tid = Locks::heap_bitmap_lock_->GetExclusiveOwnerTid();
+    CHECK(owner_tid != 0u && owner_tid != static_cast<uint64_t>(-1))
+        << "The heap bitmap lock isn't exclusively held";
+  }
   // If the bitmaps aren't swapped we need to clear the bits since the GC isn't going to re-swap
   // the bitmaps as an optimization.
   if (!context->swap_bitmaps) {
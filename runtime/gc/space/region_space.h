@@ -159,6 +159,11 @@ class RegionSpace FINAL : public ContinuousMemMapAllocSpace {
     WalkInternal<true>(callback, arg);
   }
 
+  // Calls visitor(begin, end) with the allocated range of each unevacuated from-space region.
+  // The regions of a large object are visited once, as a single range.
+  template <typename Visitor>
+  void VisitUnevacFromSpaceRanges(const Visitor& visitor) REQUIRES(Locks::mutator_lock_);
+
   accounting::ContinuousSpaceBitmap::SweepCallback* GetSweepCallback() OVERRIDE {
     return nullptr;
   }
@@ -202,7 +207,11 @@ class RegionSpace FINAL : public ContinuousMemMapAllocSpace {
     return RegionType::kRegionTypeNone;
   }
 
-  void SetFromSpace(accounting::ReadBarrierTable* rb_table, bool force_evacuate_all)
+  // Flips the non-free regions to the from-space. In a young-generation collection, only the
+  // regions allocated by mutators since the previous flip are evacuated and the others keep
+  // their live bytes.
+  void SetFromSpace(accounting::ReadBarrierTable* rb_table, bool force_evacuate_all,
+                    bool young_gen)
       REQUIRES(!region_lock_);
 
   size_t FromSpaceSize() REQUIRES(!region_lock_);
@@ -237,13 +246,13 @@ class RegionSpace FINAL : public ContinuousMemMapAllocSpace {
           begin_(nullptr), top_(nullptr), end_(nullptr),
           state_(RegionState::kRegionStateAllocated), type_(RegionType::kRegionTypeToSpace),
           objects_allocated_(0), alloc_time_(0), live_bytes_(static_cast<size_t>(-1)),
-          is_newly_allocated_(false), is_a_tlab_(false), thread_(nullptr) {}
+          is_newly_allocated_(false), is_young_(false), is_a_tlab_(false), thread_(nullptr) {}
 
     Region(size_t idx, uint8_t* begin, uint8_t* end)
         : idx_(idx), begin_(begin), top_(begin), end_(end),
           state_(RegionState::kRegionStateFree), type_(RegionType::kRegionTypeNone),
           objects_allocated_(0), alloc_time_(0), live_bytes_(static_cast<size_t>(-1)),
-          is_newly_allocated_(false), is_a_tlab_(false), thread_(nullptr) {
+          is_newly_allocated_(false), is_young_(false), is_a_tlab_(false), thread_(nullptr) {
       DCHECK_LT(begin, end);
       DCHECK_EQ(static_cast<size_t>(end - begin), kRegionSize);
     }
@@ -268,6 +277,7 @@ class RegionSpace FINAL : public ContinuousMemMapAllocSpace {
       }
       madvise(begin_, end_ - begin_, MADV_DONTNEED);
       is_newly_allocated_ = false;
+      is_young_ = false;
       is_a_tlab_ = false;
       thread_ = nullptr;
     }
@@ -312,6 +322,15 @@ class RegionSpace FINAL : public ContinuousMemMapAllocSpace {
       is_newly_allocated_ = true;
     }
 
+    // Mutators allocated in the region since the last flip.
+    void SetYoung() {
+      is_young_ = true;
+    }
+
+    bool IsYoung() const {
+      return is_young_;
+    }
+
     // Non-large, non-large-tail allocated.
     bool IsAllocated() const {
       return state_ == RegionState::kRegionStateAllocated;
@@ -361,10 +380,14 @@ class RegionSpace FINAL : public ContinuousMemMapAllocSpace {
       live_bytes_ = static_cast<size_t>(-1);
     }
 
-    void SetAsUnevacFromSpace() {
+    // A young-generation collection does not recompute the live bytes, so it keeps them.
+    void SetAsUnevacFromSpace(bool clear_live_bytes) {
       DCHECK(!IsFree() && IsInToSpace());
       type_ = RegionType::kRegionTypeUnevacFromSpace;
-      live_bytes_ = 0U;
+      if (clear_live_bytes) {
+        live_bytes_ = 0U;
+      }
+      is_young_ = false;
     }
 
     void SetUnevacFromSpaceAsToSpace() {
@@ -472,6 +495,7 @@ class RegionSpace FINAL : public ContinuousMemMapAllocSpace {
     uint32_t alloc_time_;          // The allocation time of the region.
     size_t live_bytes_;            // The live bytes. Used to compute the live percent.
     bool is_newly_allocated_;      // True if it's allocated after the last collection.
+    bool is_young_;                // True if mutators allocated in it since the last flip.
     bool is_a_tlab_;               // True if it's a tlab.
     Thread* thread_;               // The owning thread if it's a tlab.
 
@@ -339,6 +339,10 @@ size_t RosAllocSpace::RevokeThreadLocalBuffers(Thread* thread) {
   return rosalloc_->RevokeThreadLocalRuns(thread);
 }
 
+size_t RosAllocSpace::RevokeIdleThreadLocalBuffers(Thread* thread) {
+  return rosalloc_->RevokeIdleThreadLocalRuns(thread);
+}
+
 size_t RosAllocSpace::RevokeAllThreadLocalBuffers() {
   return rosalloc_->RevokeAllThreadLocalRuns();
 }
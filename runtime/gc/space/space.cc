@@ -87,6 +87,15 @@ DiscontinuousSpace::DiscontinuousSpace(const std::string& name,
 }
 
 collector::ObjectBytePair ContinuousMemMapAllocSpace::Sweep(bool swap_bitmaps) {
+  return SweepRange(swap_bitmaps, Begin(), End());
+}
+
+collector::ObjectBytePair ContinuousMemMapAllocSpace::SweepRange(bool swap_bitmaps,
+                                                                 uint8_t* begin,
+                                                                 uint8_t* end) {
+  DCHECK_LE(Begin(), begin);
+  DCHECK_LE(begin, end);
+  DCHECK_LE(end, End());
   accounting::ContinuousSpaceBitmap* live_bitmap = GetLiveBitmap();
   accounting::ContinuousSpaceBitmap* mark_bitmap = GetMarkBitmap();
   // If the bitmaps are bound then sweeping this space clearly won't do anything.
@@ -99,8 +108,8 @@ collector::ObjectBytePair ContinuousMemMapAllocSpace::Sweep(bool swap_bitmaps) {
   }
   // Bitmaps are pre-swapped for optimization which enables sweeping with the heap unlocked.
   accounting::ContinuousSpaceBitmap::SweepWalk(
-      *live_bitmap, *mark_bitmap, reinterpret_cast<uintptr_t>(Begin()),
-      reinterpret_cast<uintptr_t>(End()), GetSweepCallback(), reinterpret_cast<void*>(&scc));
+      *live_bitmap, *mark_bitmap, reinterpret_cast<uintptr_t>(begin),
+      reinterpret_cast<uintptr_t>(end), GetSweepCallback(), reinterpret_cast<void*>(&scc));
   return scc.freed;
 }
 
@@ -438,6 +438,9 @@ class ContinuousMemMapAllocSpace : public MemMapSpace, public AllocSpace {
   }
 
   collector::ObjectBytePair Sweep(bool swap_bitmaps);
+  // Sweeps the objects in [begin, end). Threads may sweep ranges of the same space in parallel if
+  // the ranges do not share bitmap words.
+  collector::ObjectBytePair SweepRange(bool swap_bitmaps, uint8_t* begin, uint8_t* end);
   virtual accounting::ContinuousSpaceBitmap::SweepCallback* GetSweepCallback() = 0;
 
  protected:
@@ -16,6 +16,8 @@
 
 #include "space_test.h"
 
+#include <set>
+
 #include "dlmalloc_space.h"
 #include "rosalloc_space.h"
 #include "scoped_thread_state_change.h"
@@ -352,6 +354,54 @@ TEST_P(SpaceCreateTest, AllocAndFreeListTestBody) {
   space->FreeList(self, arraysize(lots_of_objects), lots_of_objects);
 }
 
+// The slots freed by FreeList() must be handed out again by the following allocations.
+TEST_P(SpaceCreateTest, FreeListReusesSlotsTestBody) {
+  MallocSpace* space(CreateSpace("test", 4 * MB, 16 * MB, 16 * MB, nullptr));
+  ASSERT_TRUE(space != nullptr);
+
+  // Make space findable to the heap, will also delete space when runtime is cleaned up
+  AddSpace(space);
+  Thread* self = Thread::Current();
+  ScopedObjectAccess soa(self);
+
+  static constexpr size_t kObjectSize = 256;
+  uint64_t bytes_allocated_before = space->GetBytesAllocated();
+  mirror::Object* objects[1024];
+  for (size_t i = 0; i < arraysize(objects); i++) {
+    size_t allocation_size, usable_size, bytes_tl_bulk_allocated;
+    objects[i] = Alloc(space,
+                       self,
+                       kObjectSize,
+                       &allocation_size,
+                       &usable_size,
+                       &bytes_tl_bulk_allocated);
+    ASSERT_TRUE(objects[i] != nullptr);
+  }
+  std::set<mirror::Object*> freed_objects(objects, objects + arraysize(objects));
+  // Return the thread-local run to the space, so that its slots are freed like the others, and
+  // the never allocated slots of the run are not handed out below.
+  space->RevokeThreadLocalBuffers(self);
+
+  space->FreeList(self, arraysize(objects), objects);
+  EXPECT_EQ(bytes_allocated_before, space->GetBytesAllocated());
+
+  if (GetParam() == kMallocSpaceRosAlloc) {
+    // RosAlloc refills its runs with the lowest free pages, which are the ones freed above.
+    for (size_t i = 0; i < arraysize(objects); i++) {
+      size_t allocation_size, usable_size, bytes_tl_bulk_allocated;
+      objects[i] = Alloc(space,
+                         self,
+                         kObjectSize,
+                         &allocation_size,
+                         &usable_size,
+                         &bytes_tl_bulk_allocated);
+      ASSERT_TRUE(objects[i] != nullptr);
+      EXPECT_TRUE(freed_objects.find(objects[i]) != freed_objects.end()) << i;
+    }
+    space->FreeList(self, arraysize(objects), objects);
+  }
+}
+
 INSTANTIATE_TEST_CASE_P(CreateRosAllocSpace,
                         SpaceCreateTest,
                         testing::Values(kMallocSpaceRosAlloc));
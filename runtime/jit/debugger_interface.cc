@@ -127,17 +127,37 @@ void DeleteJITCodeEntry(JITCodeEntry* entry) {
   DeleteJITCodeEntryInternal(entry);
 }
 
+// An entry registered for the code at some address, and the call frame information of the code,
+// which cannot be recomputed once the code is compiled.
+struct JITCodeEntryForAddress {
+  JITCodeEntry* entry;
+  std::vector<uint8_t> cfi;
+};
+
 // Mapping from address to entry.  It takes ownership of the entries
 // so that the user of the JIT interface does not have to store them.
-static std::unordered_map<uintptr_t, JITCodeEntry*> g_jit_code_entries;
+static std::unordered_map<uintptr_t, JITCodeEntryForAddress> g_jit_code_entries;
 
-void CreateJITCodeEntryForAddress(uintptr_t address, std::vector<uint8_t> symfile) {
+void CreateJITCodeEntryForAddress(uintptr_t address,
+                                  std::vector<uint8_t> symfile,
+                                  std::vector<uint8_t> cfi) {
   Thread* self = Thread::Current();
   MutexLock mu(self, g_jit_debug_mutex);
   DCHECK_NE(address, 0u);
   DCHECK(g_jit_code_entries.find(address) == g_jit_code_entries.end());
   JITCodeEntry* entry = CreateJITCodeEntryInternal(std::move(symfile));
-  g_jit_code_entries.emplace(address, entry);
+  g_jit_code_entries.emplace(address, JITCodeEntryForAddress { entry, std::move(cfi) });
+}
+
+bool GetJITCodeEntryCfiForAddress(uintptr_t address, std::vector<uint8_t>* cfi) {
+  Thread* self = Thread::Current();
+  MutexLock mu(self, g_jit_debug_mutex);
+  const auto& it = g_jit_code_entries.find(address);
+  if (it == g_jit_code_entries.end()) {
+    return false;
+  }
+  *cfi = it->second.cfi;
+  return true;
 }
 
 bool DeleteJITCodeEntryForAddress(uintptr_t address) {
@@ -147,7 +167,7 @@ bool DeleteJITCodeEntryForAddress(uintptr_t address) {
   if (it == g_jit_code_entries.end()) {
     return false;
   }
-  DeleteJITCodeEntryInternal(it->second);
+  DeleteJITCodeEntryInternal(it->second.entry);
   g_jit_code_entries.erase(it);
   return true;
 }
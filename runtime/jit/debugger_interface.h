@@ -37,8 +37,15 @@ void DeleteJITCodeEntry(JITCodeEntry* entry);
 
 // Notify native debugger about new JITed code by passing in-memory ELF.
 // The address is used only to uniquely identify the entry.
-// It takes ownership of the in-memory ELF file.
-void CreateJITCodeEntryForAddress(uintptr_t address, std::vector<uint8_t> symfile);
+// It takes ownership of the in-memory ELF file, and keeps the call frame
+// information `cfi` of the code to describe it again if the code moves.
+void CreateJITCodeEntryForAddress(uintptr_t address,
+                                  std::vector<uint8_t> symfile,
+                                  std::vector<uint8_t> cfi);
+
+// Copies to `cfi` the call frame information of the entry for the given address.
+// Returns false if entry for the given address was not found.
+bool GetJITCodeEntryCfiForAddress(uintptr_t address, std::vector<uint8_t>* cfi);
 
 // Notify native debugger that JITed code has been removed.
 // Returns false if entry for the given address was not found.
@@ -19,13 +19,17 @@
 #include <dlfcn.h>
 
 #include "art_method-inl.h"
+#include "base/time_utils.h"
 #include "debugger.h"
 #include "entrypoints/runtime_asm_entrypoints.h"
 #include "interpreter/interpreter.h"
+#include "java_vm_ext.h"
 #include "jit_code_cache.h"
 #include "oat_file_manager.h"
 #include "oat_quick_method_header.h"
 #include "offline_profiling_info.h"
+#include "persistent_code_cache.h"
+#include "profile_class_preloader.h"
 #include "profile_saver.h"
 #include "runtime.h"
 #include "runtime_options.h"
@@ -37,6 +41,8 @@ namespace art {
 namespace jit {
 
 static constexpr bool kEnableOnStackReplacement = true;
+// Number of the hottest compiled methods whose time to compiled code is dumped.
+static constexpr size_t kMaxHottestCompiledMethods = 10;
 // At what priority to schedule jit threads. 9 is the lowest foreground priority on device.
 static constexpr int kJitPoolThreadPthreadPriority = 9;
 
@@ -45,8 +51,9 @@ void* Jit::jit_library_handle_= nullptr;
 void* Jit::jit_compiler_handle_ = nullptr;
 void* (*Jit::jit_load_)(bool*) = nullptr;
 void (*Jit::jit_unload_)(void*) = nullptr;
-bool (*Jit::jit_compile_method_)(void*, ArtMethod*, Thread*, bool) = nullptr;
+bool (*Jit::jit_compile_method_)(void*, ArtMethod*, Thread*, bool, bool) = nullptr;
 void (*Jit::jit_types_loaded_)(void*, mirror::Class**, size_t count) = nullptr;
+void (*Jit::jit_code_moved_)(void*, ArtMethod*, const void*, const void*) = nullptr;
 bool Jit::generate_debug_info_ = false;
 
 JitOptions* JitOptions::CreateFromRuntimeArguments(const RuntimeArgumentMap& options) {
@@ -61,6 +68,7 @@ JitOptions* JitOptions::CreateFromRuntimeArguments(const RuntimeArgumentMap& opt
       options.Exists(RuntimeArgumentMap::DumpJITInfoOnShutdown);
   jit_options->save_profiling_info_ =
       options.GetOrDefault(RuntimeArgumentMap::JITSaveProfilingInfo);
+  jit_options->preload_classes_ = options.GetOrDefault(RuntimeArgumentMap::JITPreloadClasses);
 
   jit_options->compile_threshold_ = options.GetOrDefault(RuntimeArgumentMap::JITCompileThreshold);
   if (jit_options->compile_threshold_ > std::numeric_limits<uint16_t>::max()) {
@@ -88,6 +96,11 @@ JitOptions* JitOptions::CreateFromRuntimeArguments(const RuntimeArgumentMap& opt
     }
   }
 
+  jit_options->optimize_threshold_ = options.GetOrDefault(RuntimeArgumentMap::JITOptimizeThreshold);
+  if (jit_options->optimize_threshold_ > std::numeric_limits<uint16_t>::max()) {
+    LOG(FATAL) << "Method optimization threshold is above its internal limit.";
+  }
+
   if (options.Exists(RuntimeArgumentMap::JITPriorityThreadWeight)) {
     jit_options->priority_thread_weight_ =
         *options.Get(RuntimeArgumentMap::JITPriorityThreadWeight);
@@ -116,6 +129,17 @@ JitOptions* JitOptions::CreateFromRuntimeArguments(const RuntimeArgumentMap& opt
         static_cast<size_t>(1));;
   }
 
+  if (options.Exists(RuntimeArgumentMap::JITCodeCacheFile)) {
+    jit_options->code_cache_file_ = *options.Get(RuntimeArgumentMap::JITCodeCacheFile);
+  }
+
+  jit_options->thread_count_ = options.GetOrDefault(RuntimeArgumentMap::JITThreadCount);
+  if (jit_options->thread_count_ == 0) {
+    LOG(FATAL) << "JIT thread count cannot be 0.";
+  } else if (jit_options->thread_count_ > Jit::kMaxThreadCount) {
+    LOG(FATAL) << "JIT thread count is above its internal limit.";
+  }
+
   return jit_options;
 }
 
@@ -127,13 +151,37 @@ bool Jit::ShouldUsePriorityThreadWeight() {
 void Jit::DumpInfo(std::ostream& os) {
   code_cache_->Dump(os);
   cumulative_timings_.Dump(os);
+  compile_queue_.Dump(os);
+  if (persistent_code_cache_ != nullptr) {
+    persistent_code_cache_->Dump(os);
+  }
   MutexLock mu(Thread::Current(), lock_);
   memory_use_.PrintMemoryUse(os);
+  os << "JIT stale requests dropped=" << stale_requests_ << "\n";
+  if (time_to_compiled_code_.SampleSize() != 0) {
+    Histogram<uint64_t>::CumulativeData data;
+    time_to_compiled_code_.CreateHistogram(&data);
+    time_to_compiled_code_.PrintConfidenceIntervals(os, 0.99, data);
+    if (time_to_optimized_code_.SampleSize() != 0) {
+      time_to_optimized_code_.CreateHistogram(&data);
+      time_to_optimized_code_.PrintConfidenceIntervals(os, 0.99, data);
+    }
+    os << "Hottest compiled methods:\n";
+    for (const CompiledMethodLatency& latency : hottest_compiled_methods_) {
+      os << "  " << latency.method << " hotness=" << latency.hotness
+         << (latency.osr ? " osr" : "")
+         << " time to compiled code=" << PrettyDuration(latency.time_to_compiled_code_ns) << "\n";
+    }
+  }
 }
 
 void Jit::DumpForSigQuit(std::ostream& os) {
   DumpInfo(os);
+  if (thread_pool_ != nullptr) {
+    thread_pool_->DumpWorkerTimes(os);
+  }
   ProfileSaver::DumpInstanceInfo(os);
+  ProfileClassPreloader::DumpInstanceInfo(os);
 }
 
 void Jit::AddTimingLogger(const TimingLogger& logger) {
@@ -143,14 +191,20 @@ void Jit::AddTimingLogger(const TimingLogger& logger) {
 Jit::Jit() : dump_info_on_shutdown_(false),
              cumulative_timings_("JIT timings"),
              memory_use_("Memory used for compilation", 16),
+             time_to_compiled_code_("Time to compiled code", 16),
+             time_to_optimized_code_("Time to optimized code", 16),
+             stale_requests_(0),
              lock_("JIT memory use lock"),
              use_jit_compilation_(true),
              save_profiling_info_(false),
+             preload_classes_(false),
              hot_method_threshold_(0),
              warm_method_threshold_(0),
              osr_method_threshold_(0),
+             optimize_method_threshold_(0),
              priority_thread_weight_(0),
-             invoke_transition_weight_(0) {}
+             invoke_transition_weight_(0),
+             thread_count_(kDefaultThreadCount) {}
 
 Jit* Jit::Create(JitOptions* options, std::string* error_msg) {
   DCHECK(options->UseJitCompilation() || options->GetSaveProfilingInfo());
@@ -169,18 +223,27 @@ Jit* Jit::Create(JitOptions* options, std::string* error_msg) {
   }
   jit->use_jit_compilation_ = options->UseJitCompilation();
   jit->save_profiling_info_ = options->GetSaveProfilingInfo();
+  jit->preload_classes_ = options->GetPreloadClasses();
   VLOG(jit) << "JIT created with initial_capacity="
       << PrettySize(options->GetCodeCacheInitialCapacity())
       << ", max_capacity=" << PrettySize(options->GetCodeCacheMaxCapacity())
       << ", compile_threshold=" << options->GetCompileThreshold()
-      << ", save_profiling_info=" << options->GetSaveProfilingInfo();
+      << ", optimize_threshold=" << options->GetOptimizeThreshold()
+      << ", save_profiling_info=" << options->GetSaveProfilingInfo()
+      << ", preload_classes=" << options->GetPreloadClasses()
+      << ", thread_count=" << options->GetThreadCount();
 
 
   jit->hot_method_threshold_ = options->GetCompileThreshold();
   jit->warm_method_threshold_ = options->GetWarmupThreshold();
   jit->osr_method_threshold_ = options->GetOsrThreshold();
+  jit->optimize_method_threshold_ = options->GetOptimizeThreshold();
   jit->priority_thread_weight_ = options->GetPriorityThreadWeight();
   jit->invoke_transition_weight_ = options->GetInvokeTransitionWeight();
+  jit->thread_count_ = options->GetThreadCount();
+  if (jit->use_jit_compilation_ && !options->GetCodeCacheFile().empty()) {
+    jit->persistent_code_cache_.reset(PersistentCodeCache::Create(options->GetCodeCacheFile()));
+  }
 
   jit->CreateThreadPool();
 
@@ -211,7 +274,7 @@ bool Jit::LoadCompilerLibrary(std::string* error_msg) {
     *error_msg = "JIT couldn't find jit_unload entry point";
     return false;
   }
-  jit_compile_method_ = reinterpret_cast<bool (*)(void*, ArtMethod*, Thread*, bool)>(
+  jit_compile_method_ = reinterpret_cast<bool (*)(void*, ArtMethod*, Thread*, bool, bool)>(
       dlsym(jit_library_handle_, "jit_compile_method"));
   if (jit_compile_method_ == nullptr) {
     dlclose(jit_library_handle_);
@@ -225,6 +288,13 @@ bool Jit::LoadCompilerLibrary(std::string* error_msg) {
     *error_msg = "JIT couldn't find jit_types_loaded entry point";
     return false;
   }
+  jit_code_moved_ = reinterpret_cast<void (*)(void*, ArtMethod*, const void*, const void*)>(
+      dlsym(jit_library_handle_, "jit_code_moved"));
+  if (jit_code_moved_ == nullptr) {
+    dlclose(jit_library_handle_);
+    *error_msg = "JIT couldn't find jit_code_moved entry point";
+    return false;
+  }
   return true;
 }
 
@@ -245,34 +315,35 @@ bool Jit::LoadCompiler(std::string* error_msg) {
   return true;
 }
 
-bool Jit::CompileMethod(ArtMethod* method, Thread* self, bool osr) {
+bool Jit::CompileMethod(ArtMethod* method, Thread* self, bool osr, bool baseline) {
   DCHECK(Runtime::Current()->UseJitCompilation());
   DCHECK(!method->IsRuntimeMethod());
+  DCHECK(!(osr && baseline));
 
-  // Don't compile the method if it has breakpoints.
-  if (Dbg::IsDebuggerActive() && Dbg::MethodHasAnyBreakpoints(method)) {
-    VLOG(jit) << "JIT not compiling " << PrettyMethod(method) << " due to breakpoint";
-    return false;
-  }
-
-  // Don't compile the method if we are supposed to be deoptimized.
-  instrumentation::Instrumentation* instrumentation = Runtime::Current()->GetInstrumentation();
-  if (instrumentation->AreAllMethodsDeoptimized() || instrumentation->IsDeoptimized(method)) {
-    VLOG(jit) << "JIT not compiling " << PrettyMethod(method) << " due to deoptimization";
+  const char* reason = ReasonNotToUseCompiledCode(method);
+  if (reason != nullptr) {
+    VLOG(jit) << "JIT not compiling " << PrettyMethod(method) << " due to " << reason;
     return false;
   }
 
   // If we get a request to compile a proxy method, we pass the actual Java method
   // of that proxy method, as the compiler does not expect a proxy method.
   ArtMethod* method_to_compile = method->GetInterfaceMethodIfProxy(sizeof(void*));
+  if (baseline &&
+      code_cache_->ContainsPc(method_to_compile->GetEntryPointFromQuickCompiledCode())) {
+    // Baseline code only replaces the interpreter.
+    return false;
+  }
   if (!code_cache_->NotifyCompilationOf(method_to_compile, self, osr)) {
     return false;
   }
 
   VLOG(jit) << "Compiling method "
             << PrettyMethod(method_to_compile)
-            << " osr=" << std::boolalpha << osr;
-  bool success = jit_compile_method_(jit_compiler_handle_, method_to_compile, self, osr);
+            << " osr=" << std::boolalpha << osr
+            << " baseline=" << baseline;
+  bool success =
+      jit_compile_method_(jit_compiler_handle_, method_to_compile, self, osr, baseline);
   code_cache_->DoneCompiling(method_to_compile, self, osr);
   if (!success) {
     VLOG(jit) << "Failed to compile method "
@@ -282,13 +353,99 @@ bool Jit::CompileMethod(ArtMethod* method, Thread* self, bool osr) {
   return success;
 }
 
+const char* Jit::ReasonNotToUseCompiledCode(ArtMethod* method) {
+  // Don't compile the method if it has breakpoints.
+  if (Dbg::IsDebuggerActive() && Dbg::MethodHasAnyBreakpoints(method)) {
+    return "breakpoint";
+  }
+
+  // Hooked methods run the Xposed hook handler, their original code is compiled with the backup.
+  if (method->IsXposedHookedMethod()) {
+    return "Xposed hook";
+  }
+
+  // Don't compile the method if we are supposed to be deoptimized.
+  instrumentation::Instrumentation* instrumentation = Runtime::Current()->GetInstrumentation();
+  if (instrumentation->AreAllMethodsDeoptimized() || instrumentation->IsDeoptimized(method)) {
+    return "deoptimization";
+  }
+  return nullptr;
+}
+
+bool Jit::InstallPersistedCode(Thread* self, ArtMethod* method) {
+  DCHECK(persistent_code_cache_ != nullptr);
+  // Saved code does not initialize the class of the method.
+  if (method->IsProxyMethod() ||
+      !method->GetDeclaringClass()->IsInitialized() ||
+      ReasonNotToUseCompiledCode(method) != nullptr) {
+    return false;
+  }
+  if (!persistent_code_cache_->Install(self, code_cache_.get(), method)) {
+    return false;
+  }
+  ProfileSaver::NotifyJitActivity();
+  return true;
+}
+
+void Jit::SavePersistentCodeCache(Thread* self) {
+  if (persistent_code_cache_ != nullptr) {
+    persistent_code_cache_->Save(self, code_cache_.get());
+  }
+}
+
+class JitSavePersistentCodeCacheTask FINAL : public Task {
+ public:
+  JitSavePersistentCodeCacheTask() {}
+
+  void Run(Thread* self) OVERRIDE {
+    ScopedObjectAccess soa(self);
+    Runtime::Current()->GetJit()->SavePersistentCodeCache(self);
+  }
+
+  void Finalize() OVERRIDE {
+    delete this;
+  }
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(JitSavePersistentCodeCacheTask);
+};
+
+void Jit::AddSavePersistentCodeCacheTask(Thread* self) {
+  if (persistent_code_cache_ != nullptr && thread_pool_ != nullptr) {
+    thread_pool_->AddTask(self, new JitSavePersistentCodeCacheTask());
+  }
+}
+
+class JitCompactCodeCacheTask FINAL : public Task {
+ public:
+  JitCompactCodeCacheTask() {}
+
+  void Run(Thread* self) OVERRIDE {
+    ScopedObjectAccess soa(self);
+    Runtime::Current()->GetJit()->GetCodeCache()->CompactCode(self);
+  }
+
+  void Finalize() OVERRIDE {
+    delete this;
+  }
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(JitCompactCodeCacheTask);
+};
+
+void Jit::AddCompactCodeCacheTask(Thread* self) {
+  if (thread_pool_ != nullptr) {
+    thread_pool_->AddTask(self, new JitCompactCodeCacheTask());
+  }
+}
+
 void Jit::CreateThreadPool() {
   // There is a DCHECK in the 'AddSamples' method to ensure the tread pool
   // is not null when we instrument.
 
   // We need peers as we may report the JIT thread, e.g., in the debugger.
   constexpr bool kJitPoolNeedsPeers = true;
-  thread_pool_.reset(new ThreadPool("Jit thread pool", 1, kJitPoolNeedsPeers));
+  thread_pool_.reset(new ThreadPool("Jit thread pool", thread_count_, kJitPoolNeedsPeers));
 
   thread_pool_->SetPthreadPriority(kJitPoolThreadPthreadPriority);
   thread_pool_->StartWorkers(Thread::Current());
@@ -307,6 +464,12 @@ void Jit::DeleteThreadPool() {
     }
     cache->StopWorkers(self);
     cache->RemoveAllTasks(self);
+    // The requests of the removed tasks will not run, release the classes they keep alive.
+    JavaVMExt* vm = Runtime::Current()->GetJavaVM();
+    JitCompileRequest request;
+    while (compile_queue_.Take(self, &request)) {
+      vm->DeleteGlobalRef(self, request.klass);
+    }
     // We could just suspend all threads, but we know those threads
     // will finish in a short period, so it's not worth adding a suspend logic
     // here. Besides, this is only done for shutdown.
@@ -321,10 +484,20 @@ void Jit::StartProfileSaver(const std::string& filename,
                             const std::string& app_dir) {
   if (save_profiling_info_) {
     ProfileSaver::Start(filename, code_cache_.get(), code_paths, foreign_dex_profile_path, app_dir);
+    if (preload_classes_) {
+      // The classes recorded on the previous launches are loaded ahead of the main thread.
+      ProfileClassPreloader::Start(filename, code_paths);
+    }
   }
 }
 
 void Jit::StopProfileSaver() {
+  if (preload_classes_ && ProfileClassPreloader::IsStarted()) {
+    if (dump_info_on_shutdown_) {
+      ProfileClassPreloader::DumpInstanceInfo(LOG(INFO));
+    }
+    ProfileClassPreloader::Stop();
+  }
   if (save_profiling_info_ && ProfileSaver::IsStarted()) {
     ProfileSaver::Stop(dump_info_on_shutdown_);
   }
@@ -384,6 +557,13 @@ void Jit::DumpTypeInfoForLoadedTypes(ClassLinker* linker) {
   }
 }
 
+void Jit::CodeMoved(ArtMethod* method, const void* old_code, const void* new_code) {
+  if (generate_debug_info_) {
+    DCHECK(jit_code_moved_ != nullptr);
+    jit_code_moved_(jit_compiler_handle_, method, old_code, new_code);
+  }
+}
+
 extern "C" void art_quick_osr_stub(void** stack,
                                    uint32_t stack_size_in_bytes,
                                    const uint8_t* native_pc,
@@ -549,39 +729,15 @@ void Jit::AddMemoryUsage(ArtMethod* method, size_t bytes) {
   memory_use_.AddValue(bytes);
 }
 
+// Runs the most urgent request of the compile queue, which is not necessarily the request added
+// along with the task. The thread pool gets one task per request in the queue, so waiting for the
+// pool waits for all requests.
 class JitCompileTask FINAL : public Task {
  public:
-  enum TaskKind {
-    kAllocateProfile,
-    kCompile,
-    kCompileOsr
-  };
-
-  JitCompileTask(ArtMethod* method, TaskKind kind) : method_(method), kind_(kind) {
-    ScopedObjectAccess soa(Thread::Current());
-    // Add a global ref to the class to prevent class unloading until compilation is done.
-    klass_ = soa.Vm()->AddGlobalRef(soa.Self(), method_->GetDeclaringClass());
-    CHECK(klass_ != nullptr);
-  }
-
-  ~JitCompileTask() {
-    ScopedObjectAccess soa(Thread::Current());
-    soa.Vm()->DeleteGlobalRef(soa.Self(), klass_);
-  }
+  JitCompileTask() {}
 
   void Run(Thread* self) OVERRIDE {
-    ScopedObjectAccess soa(self);
-    if (kind_ == kCompile) {
-      Runtime::Current()->GetJit()->CompileMethod(method_, self, /* osr */ false);
-    } else if (kind_ == kCompileOsr) {
-      Runtime::Current()->GetJit()->CompileMethod(method_, self, /* osr */ true);
-    } else {
-      DCHECK(kind_ == kAllocateProfile);
-      if (ProfilingInfo::Create(self, method_, /* retry_allocation */ true)) {
-        VLOG(jit) << "Start profiling " << PrettyMethod(method_);
-      }
-    }
-    ProfileSaver::NotifyJitActivity();
+    Runtime::Current()->GetJit()->RunNextCompileRequest(self);
   }
 
   void Finalize() OVERRIDE {
@@ -589,13 +745,115 @@ class JitCompileTask FINAL : public Task {
   }
 
  private:
-  ArtMethod* const method_;
-  const TaskKind kind_;
-  jobject klass_;
-
-  DISALLOW_IMPLICIT_CONSTRUCTORS(JitCompileTask);
+  DISALLOW_COPY_AND_ASSIGN(JitCompileTask);
 };
 
+void Jit::AddCompileRequest(Thread* self,
+                            ArtMethod* method,
+                            JitCompileKind kind,
+                            uint32_t hotness) {
+  DCHECK(thread_pool_ != nullptr);
+  JavaVMExt* vm = Runtime::Current()->GetJavaVM();
+  JitCompileRequest request;
+  request.method = method;
+  request.kind = kind;
+  request.hotness = hotness;
+  request.enqueue_time_ns = NanoTime();
+  // Add a global ref to the class to prevent class unloading until compilation is done.
+  request.klass = vm->AddGlobalRef(self, method->GetDeclaringClass());
+  CHECK(request.klass != nullptr);
+  if (compile_queue_.Add(self, request)) {
+    thread_pool_->AddTask(self, new JitCompileTask());
+  } else {
+    vm->DeleteGlobalRef(self, request.klass);
+  }
+}
+
+bool Jit::IsStaleCompileRequest(const JitCompileRequest& request) {
+  ArtMethod* method = request.method;
+  if (method->IsXposedHookedMethod()) {
+    // The method was hooked after the request was made, see CompileMethod().
+    return true;
+  }
+  switch (request.kind) {
+    case JitCompileKind::kCompileOsr:
+      return code_cache_->IsOsrCompiled(method);
+    case JitCompileKind::kCompile:
+      return code_cache_->ContainsPc(method->GetEntryPointFromQuickCompiledCode());
+    case JitCompileKind::kCompileOptimized:
+      return !code_cache_->IsBaselineCode(method);
+    case JitCompileKind::kAllocateProfile:
+      return method->GetProfilingInfo(sizeof(void*)) != nullptr;
+  }
+  LOG(FATAL) << "Unreachable";
+  UNREACHABLE();
+}
+
+bool Jit::RunCompileRequest(Thread* self, ArtMethod* method, JitCompileKind kind) {
+  bool success;
+  if (kind == JitCompileKind::kAllocateProfile) {
+    success = ProfilingInfo::Create(self, method, /* retry_allocation */ true);
+    if (success) {
+      VLOG(jit) << "Start profiling " << PrettyMethod(method);
+    }
+  } else {
+    success = CompileMethod(method,
+                            self,
+                            /* osr */ kind == JitCompileKind::kCompileOsr,
+                            /* baseline */ kind == JitCompileKind::kCompile &&
+                                optimize_method_threshold_ != 0);
+  }
+  ProfileSaver::NotifyJitActivity();
+  return success;
+}
+
+void Jit::RunNextCompileRequest(Thread* self) {
+  JitCompileRequest request;
+  if (!compile_queue_.Take(self, &request)) {
+    // The queue was drained on shutdown, see DeleteThreadPool().
+    return;
+  }
+  ScopedObjectAccess soa(self);
+  if (IsStaleCompileRequest(request)) {
+    VLOG(jit) << "Dropping stale JIT request for " << PrettyMethod(request.method);
+    MutexLock mu(self, lock_);
+    ++stale_requests_;
+  } else if (RunCompileRequest(self, request.method, request.kind) &&
+             request.kind != JitCompileKind::kAllocateProfile) {
+    RecordTimeToCompiledCode(request, NanoTime());
+  }
+  soa.Vm()->DeleteGlobalRef(self, request.klass);
+}
+
+void Jit::RecordTimeToCompiledCode(const JitCompileRequest& request, uint64_t compiled_time_ns) {
+  const uint64_t time_ns = compiled_time_ns - request.enqueue_time_ns;
+  MutexLock mu(Thread::Current(), lock_);
+  if (request.kind == JitCompileKind::kCompileOptimized) {
+    // The method already runs compiled code, see time_to_compiled_code_.
+    time_to_optimized_code_.AdjustAndAddValue(time_ns);
+    return;
+  }
+  time_to_compiled_code_.AdjustAndAddValue(time_ns);
+  auto position = std::find_if(hottest_compiled_methods_.begin(),
+                               hottest_compiled_methods_.end(),
+                               [&request](const CompiledMethodLatency& latency) {
+                                 return latency.hotness < request.hotness;
+                               });
+  if (position == hottest_compiled_methods_.end() &&
+      hottest_compiled_methods_.size() == kMaxHottestCompiledMethods) {
+    return;
+  }
+  CompiledMethodLatency latency = {
+      PrettyMethod(request.method),
+      request.hotness,
+      request.kind == JitCompileKind::kCompileOsr,
+      time_ns };
+  hottest_compiled_methods_.insert(position, latency);
+  if (hottest_compiled_methods_.size() > kMaxHottestCompiledMethods) {
+    hottest_compiled_methods_.pop_back();
+  }
+}
+
 void Jit::AddSamples(Thread* self, ArtMethod* method, uint16_t count, bool with_backedges) {
   if (thread_pool_ == nullptr) {
     // Should only see this when shutting down.
@@ -619,6 +877,19 @@ void Jit::AddSamples(Thread* self, ArtMethod* method, uint16_t count, bool with_
     count *= priority_thread_weight_;
   }
   int32_t new_count = starting_count + count;   // int32 here to avoid wrap-around;
+  // Saved code is looked up on the first sample. It is looked up again when the method gets warm
+  // and hot, as the first samples may have come before its class was initialized, e.g. when
+  // <clinit> called the method.
+  if (persistent_code_cache_ != nullptr &&
+      (starting_count == 0 ||
+       (starting_count < warm_method_threshold_ && new_count >= warm_method_threshold_) ||
+       (starting_count < hot_method_threshold_ && new_count >= hot_method_threshold_)) &&
+      !code_cache_->ContainsPc(method->GetEntryPointFromQuickCompiledCode()) &&
+      InstallPersistedCode(self, method)) {
+    // The method was hot in a previous run, it does not need to warm up again.
+    method->SetCounter(hot_method_threshold_);
+    return;
+  }
   if (starting_count < warm_method_threshold_) {
     if ((new_count >= warm_method_threshold_) &&
         (method->GetProfilingInfo(sizeof(void*)) == nullptr)) {
@@ -637,7 +908,7 @@ void Jit::AddSamples(Thread* self, ArtMethod* method, uint16_t count, bool with_
       if (!success) {
         // We failed allocating. Instead of doing the collection on the Java thread, we push
         // an allocation to a compiler thread, that will do the collection.
-        thread_pool_->AddTask(self, new JitCompileTask(method, JitCompileTask::kAllocateProfile));
+        AddCompileRequest(self, method, JitCompileKind::kAllocateProfile, new_count);
       }
     }
     // Avoid jumping more than one state at a time.
@@ -646,8 +917,7 @@ void Jit::AddSamples(Thread* self, ArtMethod* method, uint16_t count, bool with_
     if (starting_count < hot_method_threshold_) {
       if ((new_count >= hot_method_threshold_) &&
           !code_cache_->ContainsPc(method->GetEntryPointFromQuickCompiledCode())) {
-        DCHECK(thread_pool_ != nullptr);
-        thread_pool_->AddTask(self, new JitCompileTask(method, JitCompileTask::kCompile));
+        AddCompileRequest(self, method, JitCompileKind::kCompile, new_count);
       }
       // Avoid jumping more than one state at a time.
       new_count = std::min(new_count, osr_method_threshold_ - 1);
@@ -657,8 +927,7 @@ void Jit::AddSamples(Thread* self, ArtMethod* method, uint16_t count, bool with_
         return;
       }
       if ((new_count >= osr_method_threshold_) &&  !code_cache_->IsOsrCompiled(method)) {
-        DCHECK(thread_pool_ != nullptr);
-        thread_pool_->AddTask(self, new JitCompileTask(method, JitCompileTask::kCompileOsr));
+        AddCompileRequest(self, method, JitCompileKind::kCompileOsr, new_count);
       }
     }
   }
@@ -666,13 +935,40 @@ void Jit::AddSamples(Thread* self, ArtMethod* method, uint16_t count, bool with_
   method->SetCounter(new_count);
 }
 
+void Jit::NotifyBaselineCodeIsHot(Thread* self, ArtMethod* method, const void* pc) {
+  if (thread_pool_ == nullptr) {
+    // Should only see this when shutting down.
+    DCHECK(Runtime::Current()->IsShuttingDown(self));
+    return;
+  }
+  // Only baseline code calls this, but leave the counter of any other caller alone.
+  if (optimize_method_threshold_ == 0 || !code_cache_->ContainsPc(pc)) {
+    return;
+  }
+  if (!code_cache_->ContainsPc(method->GetEntryPointFromQuickCompiledCode())) {
+    // The method runs in the interpreter or in non-JIT code again, which own the counter.
+    return;
+  }
+  if (!code_cache_->IsBaselineCode(method)) {
+    // Frames still looping in baseline code which has been replaced by optimized code keep
+    // counting down. Do not let the count wrap around, it would look like the hotness of a
+    // method looping in the interpreter.
+    method->SetCounter(hot_method_threshold_);
+    return;
+  }
+  VLOG(jit) << "Baseline code of " << PrettyMethod(method) << " is hot";
+  AddCompileRequest(self, method, JitCompileKind::kCompileOptimized, optimize_method_threshold_);
+  // Restart the countdown until the optimized code is committed, rather than wrap around. The
+  // request is only queued once.
+  method->SetCounter(optimize_method_threshold_);
+}
+
 void Jit::MethodEntered(Thread* thread, ArtMethod* method) {
   Runtime* runtime = Runtime::Current();
   if (UNLIKELY(runtime->UseJitCompilation() && runtime->GetJit()->JitAtFirstUse())) {
     // The compiler requires a ProfilingInfo object.
     ProfilingInfo::Create(thread, method, /* retry_allocation */ true);
-    JitCompileTask compile_task(method, JitCompileTask::kCompile);
-    compile_task.Run(thread);
+    runtime->GetJit()->RunCompileRequest(thread, method, JitCompileKind::kCompile);
     return;
   }
 
@@ -680,6 +976,8 @@ void Jit::MethodEntered(Thread* thread, ArtMethod* method) {
   // Update the entrypoint if the ProfilingInfo has one. The interpreter will call it
   // instead of interpreting the method.
   if ((profiling_info != nullptr) && (profiling_info->GetSavedEntryPoint() != nullptr)) {
+    // The compiled code is still in use, see JitCodeCache::MoveHotCodeToHotRegion().
+    profiling_info->AddCompiledCodeSample();
     Runtime::Current()->GetInstrumentation()->UpdateMethodsCode(
         method, profiling_info->GetSavedEntryPoint());
   } else {
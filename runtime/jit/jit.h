@@ -22,6 +22,7 @@
 #include "base/macros.h"
 #include "base/mutex.h"
 #include "base/timing_logger.h"
+#include "jit_compile_queue.h"
 #include "object_callbacks.h"
 #include "offline_profiling_info.h"
 #include "thread_pool.h"
@@ -35,6 +36,7 @@ namespace jit {
 
 class JitCodeCache;
 class JitOptions;
+class PersistentCodeCache;
 
 static constexpr int16_t kJitCheckForOSR = -1;
 static constexpr int16_t kJitHotnessDisabled = -2;
@@ -45,10 +47,16 @@ class Jit {
   static constexpr size_t kDefaultCompileThreshold = kStressMode ? 2 : 10000;
   static constexpr size_t kDefaultPriorityThreadWeightRatio = 1000;
   static constexpr size_t kDefaultInvokeTransitionWeightRatio = 500;
+  static constexpr size_t kDefaultThreadCount = 1;
+  // Each compiler thread may hold an inline use of a ProfilingInfo per inlining level, and the
+  // inline use counter is 16 bits.
+  static constexpr size_t kMaxThreadCount = 64;
 
   virtual ~Jit();
   static Jit* Create(JitOptions* options, std::string* error_msg);
-  bool CompileMethod(ArtMethod* method, Thread* self, bool osr)
+  // Baseline code is quick to compile, and counts down the hotness of the method to request its
+  // optimized code, see NotifyBaselineCodeIsHot.
+  bool CompileMethod(ArtMethod* method, Thread* self, bool osr, bool baseline = false)
       SHARED_REQUIRES(Locks::mutator_lock_);
   void CreateThreadPool();
 
@@ -79,6 +87,12 @@ class Jit {
     return hot_method_threshold_;
   }
 
+  // Number of invocations and back edges of baseline code before the method is optimized. Zero
+  // if methods are optimized right away.
+  size_t OptimizeMethodThreshold() const {
+    return optimize_method_threshold_;
+  }
+
   size_t WarmMethodThreshold() const {
     return warm_method_threshold_;
   }
@@ -96,9 +110,28 @@ class Jit {
     return save_profiling_info_;
   }
 
+  // Returns whether compiled code is saved for later runs of the application.
+  bool HasPersistentCodeCache() const {
+    return persistent_code_cache_ != nullptr;
+  }
+
+  // Saves the code compiled so far to the persistent code cache, if there is one.
+  void SavePersistentCodeCache(Thread* self)
+      SHARED_REQUIRES(Locks::mutator_lock_);
+
+  // Same as SavePersistentCodeCache, but on a JIT thread.
+  void AddSavePersistentCodeCacheTask(Thread* self);
+
+  // Compacts the code cache on a JIT thread, see JitCodeCache::CompactCode.
+  void AddCompactCodeCacheTask(Thread* self);
+
   // Wait until there is no more pending compilation tasks.
   void WaitForCompilationToFinish(Thread* self);
 
+  // Runs the most urgent request of the compile queue, unless it has become stale. Called by the
+  // tasks of the JIT thread pool, one per request added to the queue.
+  void RunNextCompileRequest(Thread* self) REQUIRES(!lock_);
+
   // Profiling methods.
   void MethodEntered(Thread* thread, ArtMethod* method)
       SHARED_REQUIRES(Locks::mutator_lock_);
@@ -106,6 +139,11 @@ class Jit {
   void AddSamples(Thread* self, ArtMethod* method, uint16_t samples, bool with_backedges)
       SHARED_REQUIRES(Locks::mutator_lock_);
 
+  // Called by baseline code of `method` at `pc` once its hotness counter reaches zero. Requests
+  // the optimized code of `method`.
+  void NotifyBaselineCodeIsHot(Thread* self, ArtMethod* method, const void* pc)
+      SHARED_REQUIRES(Locks::mutator_lock_);
+
   void InvokeVirtualOrInterface(Thread* thread,
                                 mirror::Object* this_object,
                                 ArtMethod* caller,
@@ -145,6 +183,11 @@ class Jit {
   // into the specified class linker to the jit debug interface,
   void DumpTypeInfoForLoadedTypes(ClassLinker* linker);
 
+  // If debug info generation is turned on then describe the copy `new_code` of the compiled code
+  // `old_code` of `method` to the jit debug interface and to perf.
+  void CodeMoved(ArtMethod* method, const void* old_code, const void* new_code)
+      SHARED_REQUIRES(Locks::mutator_lock_);
+
   // Return whether we should try to JIT compiled code as soon as an ArtMethod is invoked.
   bool JitAtFirstUse();
 
@@ -172,30 +215,75 @@ class Jit {
 
   static bool LoadCompiler(std::string* error_msg);
 
+  // Returns why compiled code must not be used for `method`, or null if it can be.
+  static const char* ReasonNotToUseCompiledCode(ArtMethod* method)
+      SHARED_REQUIRES(Locks::mutator_lock_);
+
+  // Installs the code `method` was compiled to by a previous run of the application. Fails
+  // while the class of `method` is not initialized, see AddSamples() for the retries.
+  bool InstallPersistedCode(Thread* self, ArtMethod* method)
+      SHARED_REQUIRES(Locks::mutator_lock_);
+
+  // Queues a request and a thread pool task to run it, unless it is merged into a pending request.
+  void AddCompileRequest(Thread* self, ArtMethod* method, JitCompileKind kind, uint32_t hotness)
+      SHARED_REQUIRES(Locks::mutator_lock_);
+
+  // Returns whether the work of `request` has already been done.
+  bool IsStaleCompileRequest(const JitCompileRequest& request)
+      SHARED_REQUIRES(Locks::mutator_lock_);
+
+  bool RunCompileRequest(Thread* self, ArtMethod* method, JitCompileKind kind)
+      SHARED_REQUIRES(Locks::mutator_lock_);
+
+  void RecordTimeToCompiledCode(const JitCompileRequest& request, uint64_t compiled_time_ns)
+      REQUIRES(!lock_)
+      SHARED_REQUIRES(Locks::mutator_lock_);
+
   // JIT compiler
   static void* jit_library_handle_;
   static void* jit_compiler_handle_;
   static void* (*jit_load_)(bool*);
   static void (*jit_unload_)(void*);
-  static bool (*jit_compile_method_)(void*, ArtMethod*, Thread*, bool);
+  static bool (*jit_compile_method_)(void*, ArtMethod*, Thread*, bool, bool);
   static void (*jit_types_loaded_)(void*, mirror::Class**, size_t count);
+  static void (*jit_code_moved_)(void*, ArtMethod*, const void*, const void*);
 
   // Performance monitoring.
   bool dump_info_on_shutdown_;
   CumulativeLogger cumulative_timings_;
   Histogram<uint64_t> memory_use_ GUARDED_BY(lock_);
+  // Time from the first request for a method to its compiled code.
+  Histogram<uint64_t> time_to_compiled_code_ GUARDED_BY(lock_);
+  // Time from the baseline code becoming hot to the optimized code.
+  Histogram<uint64_t> time_to_optimized_code_ GUARDED_BY(lock_);
+  struct CompiledMethodLatency {
+    std::string method;
+    uint32_t hotness;
+    bool osr;
+    uint64_t time_to_compiled_code_ns;
+  };
+  // The hottest methods compiled from the queue, hottest first.
+  std::vector<CompiledMethodLatency> hottest_compiled_methods_ GUARDED_BY(lock_);
+  // Requests dropped because their work had been done in the meantime.
+  uint64_t stale_requests_ GUARDED_BY(lock_);
   Mutex lock_ DEFAULT_MUTEX_ACQUIRED_AFTER;
 
+  JitCompileQueue compile_queue_;
+
   std::unique_ptr<jit::JitCodeCache> code_cache_;
+  std::unique_ptr<PersistentCodeCache> persistent_code_cache_;
 
   bool use_jit_compilation_;
   bool save_profiling_info_;
+  bool preload_classes_;
   static bool generate_debug_info_;
   uint16_t hot_method_threshold_;
   uint16_t warm_method_threshold_;
   uint16_t osr_method_threshold_;
+  uint16_t optimize_method_threshold_;
   uint16_t priority_thread_weight_;
   uint16_t invoke_transition_weight_;
+  size_t thread_count_;
   std::unique_ptr<ThreadPool> thread_pool_;
 
   DISALLOW_COPY_AND_ASSIGN(Jit);
@@ -213,6 +301,10 @@ class JitOptions {
   size_t GetOsrThreshold() const {
     return osr_threshold_;
   }
+  // Zero if the JIT compiles optimized code right away, instead of baseline code first.
+  size_t GetOptimizeThreshold() const {
+    return optimize_threshold_;
+  }
   uint16_t GetPriorityThreadWeight() const {
     return priority_thread_weight_;
   }
@@ -225,12 +317,23 @@ class JitOptions {
   size_t GetCodeCacheMaxCapacity() const {
     return code_cache_max_capacity_;
   }
+  size_t GetThreadCount() const {
+    return thread_count_;
+  }
+  // The file keeping compiled code across runs of the application, empty if there is none.
+  const std::string& GetCodeCacheFile() const {
+    return code_cache_file_;
+  }
   bool DumpJitInfoOnShutdown() const {
     return dump_info_on_shutdown_;
   }
   bool GetSaveProfilingInfo() const {
     return save_profiling_info_;
   }
+  // Whether the classes recorded in the profile are loaded on a background thread at startup.
+  bool GetPreloadClasses() const {
+    return preload_classes_;
+  }
   bool UseJitCompilation() const {
     return use_jit_compilation_;
   }
@@ -249,21 +352,28 @@ class JitOptions {
   bool use_jit_compilation_;
   size_t code_cache_initial_capacity_;
   size_t code_cache_max_capacity_;
+  std::string code_cache_file_;
   size_t compile_threshold_;
   size_t warmup_threshold_;
   size_t osr_threshold_;
+  size_t optimize_threshold_;
   uint16_t priority_thread_weight_;
   size_t invoke_transition_weight_;
+  size_t thread_count_;
   bool dump_info_on_shutdown_;
   bool save_profiling_info_;
+  bool preload_classes_;
 
   JitOptions()
       : use_jit_compilation_(false),
         code_cache_initial_capacity_(0),
         code_cache_max_capacity_(0),
         compile_threshold_(0),
+        optimize_threshold_(0),
+        thread_count_(Jit::kDefaultThreadCount),
         dump_info_on_shutdown_(false),
-        save_profiling_info_(false) { }
+        save_profiling_info_(false),
+        preload_classes_(false) { }
 
   DISALLOW_COPY_AND_ASSIGN(JitOptions);
 };
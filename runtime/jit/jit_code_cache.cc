@@ -16,6 +16,8 @@
 
 #include "jit_code_cache.h"
 
+#include <algorithm>
+#include <functional>
 #include <sstream>
 
 #include "art_method-inl.h"
@@ -44,6 +46,19 @@ static constexpr int kProtCode = PROT_READ | PROT_EXEC;
 static constexpr size_t kCodeSizeLogThreshold = 50 * KB;
 static constexpr size_t kStackMapSizeLogThreshold = 50 * KB;
 
+// The hot region takes this fraction of the code portion of the code cache, so that hot code
+// shares few pages, and therefore few i-TLB entries.
+static constexpr size_t kHotCodeRegionDivisor = 4;
+
+// Compiled code moves to the hot region once it was seen running this many times, see
+// ProfilingInfo::AddCompiledCodeSample(). The samples are halved at each collection.
+static constexpr uint16_t kCompiledCodeSamplesOfHotCode = 2;
+
+// The cold region is compacted once this fraction of its footprint is free, and at least
+// kMinCompactionFreeBytes are.
+static constexpr size_t kCompactionFragmentationDivisor = 4;
+static constexpr size_t kMinCompactionFreeBytes = 4 * kPageSize;
+
 #define CHECKED_MPROTECT(memory, size, prot)                \
   do {                                                      \
     int rc = mprotect(memory, size, prot);                  \
@@ -124,27 +139,51 @@ JitCodeCache::JitCodeCache(MemMap* code_map,
     : lock_("Jit code cache", kJitCodeCacheLock),
       lock_cond_("Jit code cache variable", lock_),
       collection_in_progress_(false),
+      code_writers_(0),
       code_map_(code_map),
       data_map_(data_map),
       max_capacity_(max_capacity),
       current_capacity_(initial_code_capacity + initial_data_capacity),
       code_end_(initial_code_capacity),
+      hot_code_end_(0),
       data_end_(initial_data_capacity),
       last_collection_increased_code_cache_(false),
       last_update_time_ns_(0),
       garbage_collect_code_(garbage_collect_code),
       used_memory_for_data_(0),
       used_memory_for_code_(0),
+      used_memory_for_hot_code_(0),
       number_of_compilations_(0),
       number_of_osr_compilations_(0),
+      number_of_baseline_compilations_(0),
       number_of_deoptimizations_(0),
       number_of_collections_(0),
+      number_of_hot_code_moves_(0),
+      number_of_compactions_(0),
+      number_of_compaction_moves_(0),
+      compaction_released_bytes_(0),
       histogram_stack_map_memory_use_("Memory used for stack maps", 16),
       histogram_code_memory_use_("Memory used for compiled code", 16),
       histogram_profiling_info_memory_use_("Memory used for profiling info", 16) {
 
   DCHECK_GE(max_capacity, initial_code_capacity + initial_data_capacity);
-  code_mspace_ = create_mspace_with_base(code_map_->Begin(), code_end_, false /*locked*/);
+  // The hot region is at the start of the code map, and the cold region after it. Each region
+  // grows from its start, up to its share of the current capacity.
+  size_t hot_region_size = RoundDown(max_capacity / 2 / kHotCodeRegionDivisor, kPageSize);
+  hot_code_mspace_ = nullptr;
+  cold_code_begin_ = code_map_->Begin();
+  if (hot_region_size != 0 && initial_code_capacity >= 2 * kPageSize) {
+    hot_code_end_ = std::max(RoundDown(initial_code_capacity / kHotCodeRegionDivisor, kPageSize),
+                             kPageSize);
+    code_end_ = initial_code_capacity - hot_code_end_;
+    cold_code_begin_ = code_map_->Begin() + hot_region_size;
+    hot_code_mspace_ =
+        create_mspace_with_base(code_map_->Begin(), hot_code_end_, false /*locked*/);
+    if (hot_code_mspace_ == nullptr) {
+      PLOG(FATAL) << "create_mspace_with_base failed";
+    }
+  }
+  code_mspace_ = create_mspace_with_base(cold_code_begin_, code_end_, false /*locked*/);
   data_mspace_ = create_mspace_with_base(data_map_->Begin(), data_end_, false /*locked*/);
 
   if (code_mspace_ == nullptr || data_mspace_ == nullptr) {
@@ -159,7 +198,9 @@ JitCodeCache::JitCodeCache(MemMap* code_map,
   VLOG(jit) << "Created jit code cache: initial data size="
             << PrettySize(initial_data_capacity)
             << ", initial code size="
-            << PrettySize(initial_code_capacity);
+            << PrettySize(initial_code_capacity)
+            << ", hot code region size="
+            << PrettySize(cold_code_begin_ - code_map_->Begin());
 }
 
 bool JitCodeCache::ContainsPc(const void* ptr) const {
@@ -178,22 +219,35 @@ bool JitCodeCache::ContainsMethod(ArtMethod* method) {
 
 class ScopedCodeCacheWrite : ScopedTrace {
  public:
-  explicit ScopedCodeCacheWrite(MemMap* code_map)
+  explicit ScopedCodeCacheWrite(JitCodeCache* code_cache)
       : ScopedTrace("ScopedCodeCacheWrite"),
-        code_map_(code_map) {
-    ScopedTrace trace("mprotect all");
-    CHECKED_MPROTECT(code_map_->Begin(), code_map_->Size(), kProtAll);
+        code_cache_(code_cache) {
+    code_cache_->BeginCodeWrite();
   }
   ~ScopedCodeCacheWrite() {
-    ScopedTrace trace("mprotect code");
-    CHECKED_MPROTECT(code_map_->Begin(), code_map_->Size(), kProtCode);
+    code_cache_->EndCodeWrite();
   }
  private:
-  MemMap* const code_map_;
+  JitCodeCache* const code_cache_;
 
   DISALLOW_COPY_AND_ASSIGN(ScopedCodeCacheWrite);
 };
 
+void JitCodeCache::BeginCodeWrite() {
+  if (code_writers_++ == 0) {
+    ScopedTrace trace("mprotect all");
+    CHECKED_MPROTECT(code_map_->Begin(), code_map_->Size(), kProtAll);
+  }
+}
+
+void JitCodeCache::EndCodeWrite() {
+  DCHECK_NE(code_writers_, 0u);
+  if (--code_writers_ == 0) {
+    ScopedTrace trace("mprotect code");
+    CHECKED_MPROTECT(code_map_->Begin(), code_map_->Size(), kProtCode);
+  }
+}
+
 uint8_t* JitCodeCache::CommitCode(Thread* self,
                                   ArtMethod* method,
                                   const uint8_t* vmap_table,
@@ -202,7 +256,8 @@ uint8_t* JitCodeCache::CommitCode(Thread* self,
                                   size_t fp_spill_mask,
                                   const uint8_t* code,
                                   size_t code_size,
-                                  bool osr) {
+                                  bool osr,
+                                  bool baseline) {
   uint8_t* result = CommitCodeInternal(self,
                                        method,
                                        vmap_table,
@@ -211,7 +266,8 @@ uint8_t* JitCodeCache::CommitCode(Thread* self,
                                        fp_spill_mask,
                                        code,
                                        code_size,
-                                       osr);
+                                       osr,
+                                       baseline);
   if (result == nullptr) {
     // Retry.
     GarbageCollectCache(self);
@@ -223,7 +279,8 @@ uint8_t* JitCodeCache::CommitCode(Thread* self,
                                 fp_spill_mask,
                                 code,
                                 code_size,
-                                osr);
+                                osr,
+                                baseline);
   }
   return result;
 }
@@ -243,6 +300,7 @@ static uintptr_t FromCodeToAllocation(const void* code) {
 }
 
 void JitCodeCache::FreeCode(const void* code_ptr, ArtMethod* method ATTRIBUTE_UNUSED) {
+  baseline_code_.erase(code_ptr);
   uintptr_t allocation = FromCodeToAllocation(code_ptr);
   const OatQuickMethodHeader* method_header = OatQuickMethodHeader::FromCodePointer(code_ptr);
   // Notify native debugger that we are about to remove the code.
@@ -266,7 +324,7 @@ void JitCodeCache::RemoveMethodsIn(Thread* self, const LinearAlloc& alloc) {
   // with the classlinker_classes_lock_ held, and suspending ourselves could
   // lead to a deadlock.
   {
-    ScopedCodeCacheWrite scc(code_map_.get());
+    ScopedCodeCacheWrite scc(this);
     for (auto it = method_code_map_.begin(); it != method_code_map_.end();) {
       if (alloc.ContainsUnsafe(it->second)) {
         FreeCode(it->first, it->second);
@@ -313,7 +371,8 @@ uint8_t* JitCodeCache::CommitCodeInternal(Thread* self,
                                           size_t fp_spill_mask,
                                           const uint8_t* code,
                                           size_t code_size,
-                                          bool osr) {
+                                          bool osr,
+                                          bool baseline) {
   size_t alignment = GetInstructionSetAlignment(kRuntimeISA);
   // Ensure the header ends up at expected instruction alignment.
   size_t header_size = RoundUp(sizeof(OatQuickMethodHeader), alignment);
@@ -322,46 +381,72 @@ uint8_t* JitCodeCache::CommitCodeInternal(Thread* self,
   OatQuickMethodHeader* method_header = nullptr;
   uint8_t* code_ptr = nullptr;
   uint8_t* memory = nullptr;
+  DCHECK(!(osr && baseline));
+  // Baseline code is replaced soon if it runs often, so it stays in the cold region. While
+  // baseline code runs, the counter of the method holds its countdown rather than its hotness.
+  bool hot = !baseline && !IsBaselineCode(method) && IsHotCode(method, osr);
   {
     ScopedThreadSuspension sts(self, kSuspended);
-    MutexLock mu(self, lock_);
-    WaitForPotentialCollectionToComplete(self);
     {
-      ScopedCodeCacheWrite scc(code_map_.get());
-      memory = AllocateCode(total_size);
+      MutexLock mu(self, lock_);
+      WaitForPotentialCollectionToComplete(self);
+      BeginCodeWrite();
+      memory = AllocateCode(total_size, hot);
       if (memory == nullptr) {
+        EndCodeWrite();
         return nullptr;
       }
-      code_ptr = memory + header_size;
-
-      std::copy(code, code + code_size, code_ptr);
-      method_header = OatQuickMethodHeader::FromCodePointer(code_ptr);
-      new (method_header) OatQuickMethodHeader(
-          (vmap_table == nullptr) ? 0 : code_ptr - vmap_table,
-          frame_size_in_bytes,
-          core_spill_mask,
-          fp_spill_mask,
-          code_size);
-      // Flush caches before we remove write permission because on some ARMv8 hardware,
-      // flushing caches require write permissions.
-      //
-      // For reference, here are kernel patches discussing about this issue:
-      // https://android.googlesource.com/kernel/msm/%2B/0e7f7bcc3fc87489cda5aa6aff8ce40eed912279
-      // https://patchwork.kernel.org/patch/9047921/
-      FlushInstructionCache(reinterpret_cast<char*>(code_ptr),
-                            reinterpret_cast<char*>(code_ptr + code_size));
+      number_of_compilations_++;
     }
-
-    number_of_compilations_++;
+    // Copy the code without holding the lock, so that other JIT threads can commit their code in
+    // the meantime. The code cache stays writable until the last writer is done, and a collection
+    // cannot free the allocation as it is not in the method_code_map_ yet.
+    code_ptr = memory + header_size;
+
+    std::copy(code, code + code_size, code_ptr);
+    method_header = OatQuickMethodHeader::FromCodePointer(code_ptr);
+    new (method_header) OatQuickMethodHeader(
+        (vmap_table == nullptr) ? 0 : code_ptr - vmap_table,
+        frame_size_in_bytes,
+        core_spill_mask,
+        fp_spill_mask,
+        code_size);
+    // Flush caches before we remove write permission because on some ARMv8 hardware,
+    // flushing caches require write permissions.
+    //
+    // For reference, here are kernel patches discussing about this issue:
+    // https://android.googlesource.com/kernel/msm/%2B/0e7f7bcc3fc87489cda5aa6aff8ce40eed912279
+    // https://patchwork.kernel.org/patch/9047921/
+    FlushInstructionCache(reinterpret_cast<char*>(code_ptr),
+                          reinterpret_cast<char*>(code_ptr + code_size));
   }
   // We need to update the entry point in the runnable state for the instrumentation.
   {
     MutexLock mu(self, lock_);
+    EndCodeWrite();
     method_code_map_.Put(code_ptr, method);
-    if (osr) {
+    if (UNLIKELY(method->IsXposedHookedMethod())) {
+      // A hook was installed while compiling. The code is not used and will be collected.
+      VLOG(jit) << "JIT not installing code of " << PrettyMethod(method)
+                << " which is hooked by Xposed";
+    } else if (osr) {
       number_of_osr_compilations_++;
       osr_code_map_.Put(method, code_ptr);
     } else {
+      const void* old_entry_point = method->GetEntryPointFromQuickCompiledCode();
+      bool replaces_baseline_code = ContainsPc(old_entry_point) &&
+          baseline_code_.count(OatQuickMethodHeader::FromEntryPoint(old_entry_point)->GetCode());
+      if (baseline) {
+        number_of_baseline_compilations_++;
+        baseline_code_.insert(code_ptr);
+        // The code counts down from the threshold, see Jit::NotifyBaselineCodeIsHot.
+        method->SetCounter(Runtime::Current()->GetJit()->OptimizeMethodThreshold());
+      } else if (replaces_baseline_code) {
+        // The countdown of the baseline code left an arbitrary count, which the interpreter and
+        // IsHotCode() would take for the hotness of the method. Start from the count a method has
+        // when it is first compiled.
+        method->SetCounter(Runtime::Current()->GetJit()->HotMethodThreshold());
+      }
       Runtime::Current()->GetInstrumentation()->UpdateMethodsCode(
           method, method_header->GetEntryPoint());
     }
@@ -372,7 +457,8 @@ uint8_t* JitCodeCache::CommitCodeInternal(Thread* self,
     }
     last_update_time_ns_.StoreRelease(NanoTime());
     VLOG(jit)
-        << "JIT added (osr=" << std::boolalpha << osr << std::noboolalpha << ") "
+        << "JIT added (osr=" << std::boolalpha << osr << ", baseline=" << baseline
+        << std::noboolalpha << ") "
         << PrettyMethod(method) << "@" << method
         << " ccache_size=" << PrettySize(CodeCacheSizeLocked()) << ": "
         << " dcache_size=" << PrettySize(DataCacheSizeLocked()) << ": "
@@ -460,6 +546,11 @@ class MarkCodeVisitor FINAL : public StackVisitor {
     if (code_cache_->ContainsPc(code)) {
       // Use the atomic set version, as multiple threads are executing this code.
       bitmap_->AtomicTestAndSet(FromCodeToAllocation(code));
+      // The frame samples the activity of the compiled code, see MoveHotCodeToHotRegion().
+      ProfilingInfo* info = GetMethod()->GetProfilingInfo(sizeof(void*));
+      if (info != nullptr) {
+        info->AddCompiledCodeSample();
+      }
     }
     return true;
   }
@@ -515,8 +606,17 @@ void JitCodeCache::SetFootprintLimit(size_t new_footprint) {
   DCHECK_EQ(per_space_footprint * 2, new_footprint);
   mspace_set_footprint_limit(data_mspace_, per_space_footprint);
   {
-    ScopedCodeCacheWrite scc(code_map_.get());
-    mspace_set_footprint_limit(code_mspace_, per_space_footprint);
+    ScopedCodeCacheWrite scc(this);
+    size_t cold_footprint = per_space_footprint;
+    if (hot_code_mspace_ != nullptr) {
+      size_t hot_footprint = std::max(
+          RoundDown(per_space_footprint / kHotCodeRegionDivisor, kPageSize), kPageSize);
+      hot_footprint = std::min(hot_footprint,
+                               static_cast<size_t>(cold_code_begin_ - code_map_->Begin()));
+      mspace_set_footprint_limit(hot_code_mspace_, hot_footprint);
+      cold_footprint -= hot_footprint;
+    }
+    mspace_set_footprint_limit(code_mspace_, cold_footprint);
   }
 }
 
@@ -591,15 +691,17 @@ void JitCodeCache::GarbageCollectCache(Thread* self) {
       return;
     } else {
       number_of_collections_++;
+      // The cold region does not start at the beginning of the code map, so cover all of it.
       live_bitmap_.reset(CodeCacheBitmap::Create(
           "code-cache-bitmap",
           reinterpret_cast<uintptr_t>(code_map_->Begin()),
-          reinterpret_cast<uintptr_t>(code_map_->Begin() + current_capacity_ / 2)));
+          reinterpret_cast<uintptr_t>(code_map_->End())));
       collection_in_progress_ = true;
     }
   }
 
   TimingLogger logger("JIT code cache timing logger", true, VLOG_IS_ON(jit));
+  bool compact = false;
   {
     TimingLogger::ScopedTiming st("Code cache collection", &logger);
 
@@ -637,6 +739,10 @@ void JitCodeCache::GarbageCollectCache(Thread* self) {
         IncreaseCodeCacheCapacity();
       }
 
+      // Move the code which has become hot since it was compiled before saving entry points
+      // below, so that the saved entry points are the hot copies.
+      MoveHotCodeToHotRegion();
+
       bool next_collection_will_be_full = ShouldDoFullCollection();
 
       // Start polling the liveness of compiled code to prepare for the next full collection.
@@ -655,17 +761,269 @@ void JitCodeCache::GarbageCollectCache(Thread* self) {
 
         DCHECK(CheckLiveCompiledCodeHasProfilingInfo());
       }
+      // The entry points are the interpreter until the next collection, there is no code to move.
+      compact = !next_collection_will_be_full && ShouldCompactCode();
       live_bitmap_.reset(nullptr);
       NotifyCollectionDone(self);
     }
   }
   Runtime::Current()->GetJit()->AddTimingLogger(logger);
+  if (compact) {
+    Runtime::Current()->GetJit()->AddCompactCodeCacheTask(self);
+  }
+}
+
+bool JitCodeCache::IsHotCode(ArtMethod* method, bool osr) {
+  if (osr) {
+    return true;
+  }
+  // Compiled code does not update the hotness counter, which only keeps increasing while frames
+  // of the method loop in the interpreter.
+  Jit* jit = Runtime::Current()->GetJit();
+  size_t hot_threshold = jit->HotMethodThreshold();
+  return method->GetCounter() >= hot_threshold + (jit->OSRMethodThreshold() - hot_threshold) / 2;
+}
+
+bool JitCodeCache::IsHotCompiledCode(ArtMethod* method) {
+  ProfilingInfo* info = method->GetProfilingInfo(sizeof(void*));
+  return info != nullptr && info->GetCompiledCodeSamples() >= kCompiledCodeSamplesOfHotCode;
+}
+
+void JitCodeCache::MoveHotCodeToHotRegion() {
+  if (hot_code_mspace_ == nullptr) {
+    return;
+  }
+  size_t alignment = GetInstructionSetAlignment(kRuntimeISA);
+  size_t header_size = RoundUp(sizeof(OatQuickMethodHeader), alignment);
+  std::vector<std::pair<const void*, const void*>> moved_code;
+  ScopedCodeCacheWrite scc(this);
+  for (const auto& it : method_code_map_) {
+    const void* code_ptr = it.first;
+    ArtMethod* method = it.second;
+    const OatQuickMethodHeader* method_header = OatQuickMethodHeader::FromCodePointer(code_ptr);
+    if (IsInHotRegion(code_ptr) ||
+        baseline_code_.find(code_ptr) != baseline_code_.end() ||
+        method_header->GetEntryPoint() != method->GetEntryPointFromQuickCompiledCode() ||
+        !IsHotCompiledCode(method)) {
+      continue;
+    }
+    uint8_t* memory = AllocateCode(header_size + method_header->code_size_, /* hot */ true);
+    if (memory == nullptr || !IsInHotRegion(memory)) {
+      if (memory != nullptr) {
+        FreeCode(memory);
+      }
+      // The hot region is full.
+      break;
+    }
+    uint8_t* new_code_ptr = CopyCode(code_ptr, memory);
+    if (new_code_ptr == nullptr) {
+      FreeCode(memory);
+      break;
+    }
+    moved_code.emplace_back(code_ptr, new_code_ptr);
+  }
+  for (const auto& it : moved_code) {
+    ArtMethod* method = method_code_map_.Get(it.first);
+    const OatQuickMethodHeader* method_header = OatQuickMethodHeader::FromCodePointer(it.second);
+    method_code_map_.Put(it.second, method);
+    // The entry of the old copy is removed when a later collection frees it.
+    Runtime::Current()->GetJit()->CodeMoved(method, it.first, it.second);
+    Runtime::Current()->GetInstrumentation()->UpdateMethodsCode(
+        method, method_header->GetEntryPoint());
+    VLOG(jit) << "JIT moved code of " << PrettyMethod(method) << " to the hot region";
+  }
+  number_of_hot_code_moves_ += moved_code.size();
+  for (ProfilingInfo* info : profiling_infos_) {
+    info->DecayCompiledCodeSamples();
+  }
+}
+
+uint8_t* JitCodeCache::CopyCode(const void* code_ptr, uint8_t* memory) {
+  // Compiled code only uses PC-relative addressing within itself, so it can be copied as is.
+  // Its stack maps are copied too, as each copy frees its own.
+  size_t alignment = GetInstructionSetAlignment(kRuntimeISA);
+  size_t header_size = RoundUp(sizeof(OatQuickMethodHeader), alignment);
+  const OatQuickMethodHeader* method_header = OatQuickMethodHeader::FromCodePointer(code_ptr);
+  uint8_t* new_data = nullptr;
+  if (method_header->vmap_table_offset_ != 0) {
+    const uint8_t* data = method_header->code_ - method_header->vmap_table_offset_;
+    size_t data_size = mspace_usable_size(data);
+    new_data = AllocateData(data_size);
+    if (new_data == nullptr) {
+      return nullptr;
+    }
+    memcpy(new_data, data, data_size);
+  }
+  uint8_t* new_code_ptr = memory + header_size;
+  memcpy(memory,
+         reinterpret_cast<const uint8_t*>(FromCodeToAllocation(code_ptr)),
+         header_size + method_header->code_size_);
+  OatQuickMethodHeader* new_method_header = OatQuickMethodHeader::FromCodePointer(new_code_ptr);
+  new_method_header->vmap_table_offset_ = (new_data == nullptr) ? 0 : new_code_ptr - new_data;
+  FlushInstructionCache(reinterpret_cast<char*>(memory),
+                        reinterpret_cast<char*>(new_code_ptr + method_header->code_size_));
+  return new_code_ptr;
+}
+
+// Free bytes of an mspace, and the part of them after its last allocation.
+struct MspaceHoles {
+  size_t free_bytes;
+  size_t free_bytes_at_top;
+};
+
+// Callback for mspace_inspect_all, which visits the chunks in address order.
+static void CountMspaceHoles(void* start, void* end, size_t used_bytes, void* arg) {
+  MspaceHoles* holes = reinterpret_cast<MspaceHoles*>(arg);
+  if (used_bytes == 0) {
+    size_t size = reinterpret_cast<uintptr_t>(end) - reinterpret_cast<uintptr_t>(start);
+    holes->free_bytes += size;
+    holes->free_bytes_at_top += size;
+  } else {
+    holes->free_bytes_at_top = 0;
+  }
+}
+
+bool JitCodeCache::ShouldCompactCode() {
+  if (!garbage_collect_code_) {
+    return false;
+  }
+  // The free space at the top of the region is not fragmentation, the mspace grows into it.
+  MspaceHoles holes = { 0, 0 };
+  mspace_inspect_all(code_mspace_, CountMspaceHoles, &holes);
+  size_t hole_bytes = holes.free_bytes - holes.free_bytes_at_top;
+  return hole_bytes >= kMinCompactionFreeBytes &&
+      hole_bytes >= mspace_footprint(code_mspace_) / kCompactionFragmentationDivisor;
+}
+
+void JitCodeCache::MoveColdCodeDown(std::vector<const void*>* moved_code) {
+  size_t alignment = GetInstructionSetAlignment(kRuntimeISA);
+  size_t header_size = RoundUp(sizeof(OatQuickMethodHeader), alignment);
+  // Only the entry points are moved. OSR code and replaced code are not entered anymore, and are
+  // freed by the next collection.
+  std::vector<const void*> candidates;
+  for (const auto& it : method_code_map_) {
+    const OatQuickMethodHeader* method_header = OatQuickMethodHeader::FromCodePointer(it.first);
+    if (!IsInHotRegion(it.first) &&
+        method_header->GetEntryPoint() == it.second->GetEntryPointFromQuickCompiledCode()) {
+      candidates.push_back(it.first);
+    }
+  }
+  // From the top down, so that the top of the region ends up free.
+  std::sort(candidates.begin(), candidates.end(), std::greater<const void*>());
+  std::vector<std::pair<const void*, const void*>> new_code;
+  ScopedCodeCacheWrite scc(this);
+  for (const void* code_ptr : candidates) {
+    const OatQuickMethodHeader* method_header = OatQuickMethodHeader::FromCodePointer(code_ptr);
+    uint8_t* memory = AllocateCode(header_size + method_header->code_size_, /* hot */ false);
+    if (memory == nullptr) {
+      break;
+    }
+    if (IsInHotRegion(memory) ||
+        reinterpret_cast<uintptr_t>(memory) > FromCodeToAllocation(code_ptr)) {
+      // No hole below the code fits it.
+      FreeCode(memory);
+      continue;
+    }
+    uint8_t* new_code_ptr = CopyCode(code_ptr, memory);
+    if (new_code_ptr == nullptr) {
+      FreeCode(memory);
+      break;
+    }
+    new_code.emplace_back(code_ptr, new_code_ptr);
+  }
+  for (const auto& it : new_code) {
+    ArtMethod* method = method_code_map_.Get(it.first);
+    method_code_map_.Put(it.second, method);
+    if (baseline_code_.find(it.first) != baseline_code_.end()) {
+      baseline_code_.insert(it.second);
+    }
+    // The entry of the old copy is removed when CompactCode() or a later collection frees it.
+    Runtime::Current()->GetJit()->CodeMoved(method, it.first, it.second);
+    const OatQuickMethodHeader* method_header = OatQuickMethodHeader::FromCodePointer(it.second);
+    Runtime::Current()->GetInstrumentation()->UpdateMethodsCode(
+        method, method_header->GetEntryPoint());
+    moved_code->push_back(it.first);
+  }
+}
+
+void JitCodeCache::TrimColdRegion() {
+  size_t old_code_end = code_end_;
+  {
+    ScopedCodeCacheWrite scc(this);
+    mspace_trim(code_mspace_, 0);
+  }
+  if (code_end_ < old_code_end) {
+    size_t released = old_code_end - code_end_;
+    // The pages are still part of the code map, the mspace gets them back when it grows again.
+    if (madvise(cold_code_begin_ + code_end_, released, MADV_DONTNEED) == -1) {
+      PLOG(WARNING) << "madvise failed while trimming the JIT code cache";
+    } else {
+      compaction_released_bytes_ += released;
+    }
+  }
+}
+
+void JitCodeCache::CompactCode(Thread* self) {
+  ScopedTrace trace(__FUNCTION__);
+  // Compactions and collections exclude each other, as both free code once they have marked the
+  // code on the thread stacks.
+  {
+    ScopedThreadSuspension sts(self, kSuspended);
+    MutexLock mu(self, lock_);
+    if (WaitForPotentialCollectionToComplete(self) || !ShouldCompactCode()) {
+      return;
+    }
+    live_bitmap_.reset(CodeCacheBitmap::Create(
+        "code-cache-bitmap",
+        reinterpret_cast<uintptr_t>(code_map_->Begin()),
+        reinterpret_cast<uintptr_t>(code_map_->End())));
+    collection_in_progress_ = true;
+  }
+
+  TimingLogger logger("JIT code cache timing logger", true, VLOG_IS_ON(jit));
+  {
+    TimingLogger::ScopedTiming st("Code cache compaction", &logger);
+    std::vector<const void*> moved_code;
+    {
+      MutexLock mu(self, lock_);
+      MoveColdCodeDown(&moved_code);
+    }
+
+    // The old copies are not entry points anymore, only frames of the threads may still run them.
+    if (!moved_code.empty()) {
+      MarkCompiledCodeOnThreadStacks(self);
+    }
+
+    MutexLock mu(self, lock_);
+    size_t freed = 0;
+    {
+      ScopedCodeCacheWrite scc(this);
+      for (const void* code_ptr : moved_code) {
+        if (!GetLiveBitmap()->Test(FromCodeToAllocation(code_ptr))) {
+          auto it = method_code_map_.find(code_ptr);
+          DCHECK(it != method_code_map_.end());
+          FreeCode(it->first, it->second);
+          method_code_map_.erase(it);
+          ++freed;
+        }
+      }
+    }
+    TrimColdRegion();
+    number_of_compactions_++;
+    number_of_compaction_moves_ += moved_code.size();
+    VLOG(jit) << "JIT code cache compaction moved " << moved_code.size() << " methods, freed "
+              << freed << " old copies, code=" << PrettySize(used_memory_for_code_)
+              << ", cold region footprint=" << PrettySize(code_end_);
+    live_bitmap_.reset(nullptr);
+    NotifyCollectionDone(self);
+  }
+  Runtime::Current()->GetJit()->AddTimingLogger(logger);
 }
 
 void JitCodeCache::RemoveUnmarkedCode(Thread* self) {
   ScopedTrace trace(__FUNCTION__);
   MutexLock mu(self, lock_);
-  ScopedCodeCacheWrite scc(code_map_.get());
+  ScopedCodeCacheWrite scc(this);
   // Iterate over all compiled code and remove entries that are not marked.
   for (auto it = method_code_map_.begin(); it != method_code_map_.end();) {
     const void* code_ptr = it->first;
@@ -689,7 +1047,9 @@ void JitCodeCache::DoCollection(Thread* self, bool collect_profiling_info) {
       // Also remove the saved entry point from the ProfilingInfo objects.
       for (ProfilingInfo* info : profiling_infos_) {
         const void* ptr = info->GetMethod()->GetEntryPointFromQuickCompiledCode();
-        if (!ContainsPc(ptr) && !info->IsInUseByCompiler()) {
+        if (!ContainsPc(ptr) &&
+            !info->IsInUseByCompiler() &&
+            !info->GetMethod()->IsXposedHookedMethod()) {
           info->GetMethod()->SetProfilingInfo(nullptr);
         }
 
@@ -754,8 +1114,10 @@ void JitCodeCache::DoCollection(Thread* self, bool collect_profiling_info) {
           // Do a fence to make sure the clearing is seen before attaching to the method.
           QuasiAtomic::ThreadFenceRelease();
           info->GetMethod()->SetProfilingInfo(info);
-        } else if (info->GetMethod()->GetProfilingInfo(sizeof(void*)) != info) {
-          // No need for this ProfilingInfo object anymore.
+        } else if (info->GetMethod()->GetProfilingInfo(sizeof(void*)) != info &&
+                   !(info->GetMethod()->IsXposedHookedMethod() && info->IsInUseByCompiler())) {
+          // No need for this ProfilingInfo object anymore. The one of a hooked method is kept
+          // until the compiler is done with it.
           FreeData(reinterpret_cast<uint8_t*>(info));
           return true;
         }
@@ -888,6 +1250,11 @@ void* JitCodeCache::MoreCore(const void* mspace, intptr_t increment) NO_THREAD_S
   if (code_mspace_ == mspace) {
     size_t result = code_end_;
     code_end_ += increment;
+    return reinterpret_cast<void*>(result + cold_code_begin_);
+  } else if (hot_code_mspace_ == mspace) {
+    size_t result = hot_code_end_;
+    hot_code_end_ += increment;
+    DCHECK_LE(code_map_->Begin() + hot_code_end_, cold_code_begin_);
     return reinterpret_cast<void*>(result + code_map_->Begin());
   } else {
     DCHECK_EQ(data_mspace_, mspace);
@@ -897,15 +1264,60 @@ void* JitCodeCache::MoreCore(const void* mspace, intptr_t increment) NO_THREAD_S
   }
 }
 
-void JitCodeCache::GetProfiledMethods(const std::set<std::string>& dex_base_locations,
-                                      std::vector<MethodReference>& methods) {
+// Returns the index of the type of `cls` in `dex_file`, or DexFile::kDexNoIndex if the dex file
+// does not reference it.
+static uint32_t GetTypeIndexIn(mirror::Class* cls, const DexFile& dex_file)
+    SHARED_REQUIRES(Locks::mutator_lock_) {
+  if (cls->GetDexCache() != nullptr &&
+      cls->GetDexTypeIndex() != DexFile::kDexNoIndex16 &&
+      &cls->GetDexFile() == &dex_file) {
+    return cls->GetDexTypeIndex();
+  }
+  return cls->FindTypeIndexInOtherDexFile(dex_file);
+}
+
+void JitCodeCache::GetProfiledMethods(
+    const std::set<std::string>& dex_base_locations,
+    std::vector<ProfileCompilationInfo::ProfileMethodInfo>& methods) {
   ScopedTrace trace(__FUNCTION__);
   MutexLock mu(Thread::Current(), lock_);
   for (const ProfilingInfo* info : profiling_infos_) {
     ArtMethod* method = info->GetMethod();
     const DexFile* dex_file = method->GetDexFile();
-    if (ContainsElement(dex_base_locations, dex_file->GetBaseLocation())) {
-      methods.emplace_back(dex_file,  method->GetDexMethodIndex());
+    if (!ContainsElement(dex_base_locations, dex_file->GetBaseLocation())) {
+      continue;
+    }
+    ProfileCompilationInfo::MethodHotness hotness = ProfileCompilationInfo::kHotnessWarm;
+    if (osr_code_map_.find(method) != osr_code_map_.end()) {
+      hotness = ProfileCompilationInfo::kHotnessOsr;
+    } else if (ContainsPc(method->GetEntryPointFromQuickCompiledCode()) ||
+               info->GetSavedEntryPoint() != nullptr) {
+      hotness = ProfileCompilationInfo::kHotnessHot;
+    }
+    methods.emplace_back(dex_file, method->GetDexMethodIndex(), hotness);
+
+    // Record the receiver types as type indices in the dex file of the method, which is
+    // what the compiler looks them up with.
+    for (size_t i = 0; i < info->number_of_inline_caches_; ++i) {
+      const InlineCache& cache = info->cache_[i];
+      if (cache.IsUninitialized()) {
+        continue;
+      }
+      ProfileCompilationInfo::InlineCacheData data;
+      data.is_megamorphic = cache.IsMegamorphic();
+      for (size_t j = 0; j < InlineCache::kIndividualCacheSize && !data.is_megamorphic; ++j) {
+        mirror::Class* type = cache.GetTypeAt(j);
+        if (type == nullptr) {
+          break;
+        }
+        uint32_t type_index = GetTypeIndexIn(type, *dex_file);
+        if (type_index == DexFile::kDexNoIndex) {
+          data.is_missing_types = true;
+        } else {
+          data.classes.insert(type_index);
+        }
+      }
+      methods.back().inline_caches.Put(cache.GetDexPc(), data);
     }
   }
 }
@@ -919,8 +1331,20 @@ bool JitCodeCache::IsOsrCompiled(ArtMethod* method) {
   return osr_code_map_.find(method) != osr_code_map_.end();
 }
 
+bool JitCodeCache::IsBaselineCode(ArtMethod* method) {
+  const void* entry_point = method->GetEntryPointFromQuickCompiledCode();
+  if (!ContainsPc(entry_point)) {
+    return false;
+  }
+  const void* code_ptr = OatQuickMethodHeader::FromEntryPoint(entry_point)->GetCode();
+  MutexLock mu(Thread::Current(), lock_);
+  return baseline_code_.find(code_ptr) != baseline_code_.end();
+}
+
 bool JitCodeCache::NotifyCompilationOf(ArtMethod* method, Thread* self, bool osr) {
-  if (!osr && ContainsPc(method->GetEntryPointFromQuickCompiledCode())) {
+  // Baseline code is only replaced by optimized code.
+  if (!osr && ContainsPc(method->GetEntryPointFromQuickCompiledCode()) &&
+      !IsBaselineCode(method)) {
     return false;
   }
 
@@ -949,7 +1373,7 @@ bool JitCodeCache::NotifyCompilationOf(ArtMethod* method, Thread* self, bool osr
 
 ProfilingInfo* JitCodeCache::NotifyCompilerUse(ArtMethod* method, Thread* self) {
   MutexLock mu(self, lock_);
-  ProfilingInfo* info = method->GetProfilingInfo(sizeof(void*));
+  ProfilingInfo* info = GetProfilingInfoLocked(method);
   if (info != nullptr) {
     info->IncrementInlineUse();
   }
@@ -958,17 +1382,113 @@ ProfilingInfo* JitCodeCache::NotifyCompilerUse(ArtMethod* method, Thread* self)
 
 void JitCodeCache::DoneCompilerUse(ArtMethod* method, Thread* self) {
   MutexLock mu(self, lock_);
-  ProfilingInfo* info = method->GetProfilingInfo(sizeof(void*));
+  ProfilingInfo* info = GetProfilingInfoLocked(method);
   DCHECK(info != nullptr);
   info->DecrementInlineUse();
 }
 
-void JitCodeCache::DoneCompiling(ArtMethod* method, Thread* self ATTRIBUTE_UNUSED, bool osr) {
-  ProfilingInfo* info = method->GetProfilingInfo(sizeof(void*));
+void JitCodeCache::DoneCompiling(ArtMethod* method, Thread* self, bool osr) {
+  MutexLock mu(self, lock_);
+  ProfilingInfo* info = GetProfilingInfoLocked(method);
   DCHECK(info->IsMethodBeingCompiled(osr));
   info->SetIsMethodBeingCompiled(false, osr);
 }
 
+ProfilingInfo* JitCodeCache::GetProfilingInfoLocked(ArtMethod* method) {
+  if (LIKELY(!method->IsXposedHookedMethod())) {
+    return method->GetProfilingInfo(sizeof(void*));
+  }
+  for (ProfilingInfo* info : profiling_infos_) {
+    if (info->GetMethod() == method) {
+      return info;
+    }
+  }
+  return nullptr;
+}
+
+void JitCodeCache::InvalidateCompiledCodeForXposedHooks(
+    const std::vector<ArtMethod*>& methods,
+    const std::vector<ArtMethod*>& original_methods) {
+  DCHECK_EQ(methods.size(), original_methods.size());
+  MutexLock mu(Thread::Current(), lock_);
+  for (size_t i = 0; i != methods.size(); ++i) {
+    ArtMethod* method = methods[i];
+    ArtMethod* original_method = original_methods[i];
+    // The backup is a copy of the method, including the pointer to the ProfilingInfo, which
+    // stays attached to the hooked method. Native methods keep their JNI entry point instead.
+    if (!original_method->IsNative()) {
+      original_method->SetProfilingInfo(nullptr);
+    }
+    if (ContainsPc(original_method->GetEntryPointFromQuickCompiledCode())) {
+      original_method->SetEntryPointFromQuickCompiledCode(GetQuickToInterpreterBridge());
+      original_method->ClearCounter();
+    }
+    osr_code_map_.erase(method);
+  }
+  for (auto& it : method_code_map_) {
+    auto original = std::find(methods.begin(), methods.end(), it.second);
+    if (original != methods.end()) {
+      // Frames of the hooked method which are still executing this code now belong to the
+      // backup, see ArtMethod::EnableXposedHooks. The code is collected once they are done.
+      it.second = original_methods[original - methods.begin()];
+    }
+  }
+}
+
+void JitCodeCache::RestoreCompiledCodeForXposedUnhooks(
+    const std::vector<ArtMethod*>& methods,
+    const std::vector<ArtMethod*>& original_methods) {
+  DCHECK_EQ(methods.size(), original_methods.size());
+  MutexLock mu(Thread::Current(), lock_);
+  for (size_t i = 0; i != methods.size(); ++i) {
+    ArtMethod* method = methods[i];
+    ArtMethod* original_method = original_methods[i];
+    DCHECK(!method->IsXposedHookedMethod()) << PrettyMethod(method);
+    if (!method->IsNative()) {
+      auto info = std::find_if(profiling_infos_.begin(), profiling_infos_.end(),
+                               [method](ProfilingInfo* profiling_info) {
+                                 return profiling_info->GetMethod() == method;
+                               });
+      method->SetProfilingInfo(info != profiling_infos_.end() ? *info : nullptr);
+    }
+    original_method->SetAccessFlags(original_method->GetAccessFlags() | kAccCompileDontBother);
+    if (ContainsPc(original_method->GetEntryPointFromQuickCompiledCode())) {
+      original_method->SetEntryPointFromQuickCompiledCode(GetQuickToInterpreterBridge());
+    }
+    if (!original_method->IsNative()) {
+      original_method->SetProfilingInfo(nullptr);
+    }
+  }
+}
+
+bool JitCodeCache::RemoveUnusedXposedBackup(Thread* self, ArtMethod* original_method) {
+  MutexLock mu(self, lock_);
+  auto info = std::find_if(profiling_infos_.begin(), profiling_infos_.end(),
+                           [original_method](ProfilingInfo* profiling_info) {
+                             return profiling_info->GetMethod() == original_method;
+                           });
+  if (info != profiling_infos_.end()) {
+    if ((*info)->IsInUseByCompiler()) {
+      return false;
+    }
+    FreeData(reinterpret_cast<uint8_t*>(*info));
+    profiling_infos_.erase(info);
+  }
+  {
+    ScopedCodeCacheWrite scc(this);
+    for (auto it = method_code_map_.begin(); it != method_code_map_.end();) {
+      if (it->second == original_method) {
+        FreeCode(it->first, it->second);
+        it = method_code_map_.erase(it);
+      } else {
+        ++it;
+      }
+    }
+  }
+  osr_code_map_.erase(original_method);
+  return true;
+}
+
 size_t JitCodeCache::GetMemorySizeOfCodePointer(const void* ptr) {
   MutexLock mu(Thread::Current(), lock_);
   return mspace_usable_size(reinterpret_cast<const void*>(FromCodeToAllocation(ptr)));
@@ -1002,20 +1522,38 @@ void JitCodeCache::InvalidateCompiledCodeFor(ArtMethod* method,
   number_of_deoptimizations_++;
 }
 
-uint8_t* JitCodeCache::AllocateCode(size_t code_size) {
+uint8_t* JitCodeCache::AllocateCode(size_t code_size, bool hot) {
   size_t alignment = GetInstructionSetAlignment(kRuntimeISA);
-  uint8_t* result = reinterpret_cast<uint8_t*>(
-      mspace_memalign(code_mspace_, alignment, code_size));
+  uint8_t* result = nullptr;
+  if (hot && hot_code_mspace_ != nullptr) {
+    result = reinterpret_cast<uint8_t*>(mspace_memalign(hot_code_mspace_, alignment, code_size));
+  }
+  if (result == nullptr) {
+    result = reinterpret_cast<uint8_t*>(mspace_memalign(code_mspace_, alignment, code_size));
+  }
+  if (result == nullptr) {
+    return nullptr;
+  }
   size_t header_size = RoundUp(sizeof(OatQuickMethodHeader), alignment);
   // Ensure the header ends up at expected instruction alignment.
   DCHECK_ALIGNED_PARAM(reinterpret_cast<uintptr_t>(result + header_size), alignment);
-  used_memory_for_code_ += mspace_usable_size(result);
+  size_t size = mspace_usable_size(result);
+  used_memory_for_code_ += size;
+  if (IsInHotRegion(result)) {
+    used_memory_for_hot_code_ += size;
+  }
   return result;
 }
 
 void JitCodeCache::FreeCode(uint8_t* code) {
-  used_memory_for_code_ -= mspace_usable_size(code);
-  mspace_free(code_mspace_, code);
+  size_t size = mspace_usable_size(code);
+  used_memory_for_code_ -= size;
+  if (IsInHotRegion(code)) {
+    used_memory_for_hot_code_ -= size;
+    mspace_free(hot_code_mspace_, code);
+  } else {
+    mspace_free(code_mspace_, code);
+  }
 }
 
 uint8_t* JitCodeCache::AllocateData(size_t data_size) {
@@ -1032,14 +1570,23 @@ void JitCodeCache::FreeData(uint8_t* data) {
 void JitCodeCache::Dump(std::ostream& os) {
   MutexLock mu(Thread::Current(), lock_);
   os << "Current JIT code cache size: " << PrettySize(used_memory_for_code_) << "\n"
+     << "Current JIT hot code region size: " << PrettySize(used_memory_for_hot_code_) << "\n"
      << "Current JIT data cache size: " << PrettySize(used_memory_for_data_) << "\n"
      << "Current JIT capacity: " << PrettySize(current_capacity_) << "\n"
      << "Current number of JIT code cache entries: " << method_code_map_.size() << "\n"
      << "Total number of JIT compilations: " << number_of_compilations_ << "\n"
      << "Total number of JIT compilations for on stack replacement: "
         << number_of_osr_compilations_ << "\n"
+     << "Total number of baseline JIT compilations: " << number_of_baseline_compilations_ << "\n"
+     << "Current number of baseline JIT code cache entries: " << baseline_code_.size() << "\n"
      << "Total number of deoptimizations: " << number_of_deoptimizations_ << "\n"
-     << "Total number of JIT code cache collections: " << number_of_collections_ << std::endl;
+     << "Total number of JIT code cache collections: " << number_of_collections_ << "\n"
+     << "Total number of methods moved to the hot code region: "
+        << number_of_hot_code_moves_ << "\n"
+     << "Total number of JIT code cache compactions: " << number_of_compactions_ << "\n"
+     << "Total number of methods moved by compactions: " << number_of_compaction_moves_ << "\n"
+     << "Total memory released by compactions: "
+        << PrettySize(compaction_released_bytes_) << std::endl;
   histogram_stack_map_memory_use_.PrintMemoryUse(os);
   histogram_code_memory_use_.PrintMemoryUse(os);
   histogram_profiling_info_memory_use_.PrintMemoryUse(os);
@@ -25,6 +25,7 @@
 #include "base/mutex.h"
 #include "gc/accounting/bitmap.h"
 #include "gc_root.h"
+#include "jit/offline_profiling_info.h"
 #include "jni.h"
 #include "method_reference.h"
 #include "oat_file.h"
@@ -41,6 +42,7 @@ class ProfilingInfo;
 namespace jit {
 
 class JitInstrumentationCache;
+class ScopedCodeCacheWrite;
 
 // Alignment in bits that will suit all architectures.
 static constexpr int kJitCodeAlignment = 16;
@@ -89,7 +91,8 @@ class JitCodeCache {
       SHARED_REQUIRES(Locks::mutator_lock_)
       REQUIRES(!lock_);
 
-  // Allocate and write code and its metadata to the code cache.
+  // Allocate and write code and its metadata to the code cache. `baseline` code counts down the
+  // hotness counter of `method`, and is replaced by optimized code once it reaches zero.
   uint8_t* CommitCode(Thread* self,
                       ArtMethod* method,
                       const uint8_t* vmap_table,
@@ -98,13 +101,29 @@ class JitCodeCache {
                       size_t fp_spill_mask,
                       const uint8_t* code,
                       size_t code_size,
-                      bool osr)
+                      bool osr,
+                      bool baseline)
+      SHARED_REQUIRES(Locks::mutator_lock_)
+      REQUIRES(!lock_);
+
+  // Return true if the entry point of `method` is baseline code of the code cache.
+  bool IsBaselineCode(ArtMethod* method)
       SHARED_REQUIRES(Locks::mutator_lock_)
       REQUIRES(!lock_);
 
   // Return true if the code cache contains this pc.
   bool ContainsPc(const void* pc) const;
 
+  // Return true if the code cache has a hot region, which is set up once at creation.
+  bool HasHotRegion() const NO_THREAD_SAFETY_ANALYSIS {
+    return hot_code_mspace_ != nullptr;
+  }
+
+  // Return true if `ptr`, a pc of the code cache, is in its hot region.
+  bool IsInHotRegion(const void* ptr) const NO_THREAD_SAFETY_ANALYSIS {
+    return hot_code_mspace_ != nullptr && ptr < cold_code_begin_;
+  }
+
   // Return true if the code cache contains this method.
   bool ContainsMethod(ArtMethod* method) REQUIRES(!lock_);
 
@@ -132,6 +151,13 @@ class JitCodeCache {
       REQUIRES(!lock_)
       SHARED_REQUIRES(Locks::mutator_lock_);
 
+  // Moves the code of the cold region down into the holes left by collections, and returns the
+  // pages freed at its top to the kernel. Mutators keep running: the moved copies no thread runs
+  // are freed right away, the others by a later collection.
+  void CompactCode(Thread* self)
+      REQUIRES(!lock_)
+      SHARED_REQUIRES(Locks::mutator_lock_);
+
   // Given the 'pc', try to find the JIT compiled code associated with it.
   // Return null if 'pc' is not in the code cache. 'method' is passed for
   // sanity check.
@@ -160,14 +186,15 @@ class JitCodeCache {
       SHARED_REQUIRES(Locks::mutator_lock_);
 
   bool OwnsSpace(const void* mspace) const NO_THREAD_SAFETY_ANALYSIS {
-    return mspace == code_mspace_ || mspace == data_mspace_;
+    return mspace == code_mspace_ || mspace == hot_code_mspace_ || mspace == data_mspace_;
   }
 
   void* MoreCore(const void* mspace, intptr_t increment);
 
-  // Adds to `methods` all profiled methods which are part of any of the given dex locations.
+  // Adds to `methods` all profiled methods which are part of any of the given dex locations,
+  // with their hotness and the receiver types seen by their inline caches.
   void GetProfiledMethods(const std::set<std::string>& dex_base_locations,
-                          std::vector<MethodReference>& methods)
+                          std::vector<ProfileCompilationInfo::ProfileMethodInfo>& methods)
       REQUIRES(!lock_)
       SHARED_REQUIRES(Locks::mutator_lock_);
 
@@ -184,6 +211,33 @@ class JitCodeCache {
       REQUIRES(!lock_)
       SHARED_REQUIRES(Locks::mutator_lock_);
 
+  // Prepares the code cache for `methods` being hooked by Xposed, `original_methods` being their
+  // backups. The compiled code of the methods moves to the backups, which fall back to the
+  // interpreter until they are compiled again. The inliner is disabled, so no other code needs
+  // to be invalidated. Must be called with all threads suspended, before the hook information is
+  // stored in the methods.
+  void InvalidateCompiledCodeForXposedHooks(const std::vector<ArtMethod*>& methods,
+                                            const std::vector<ArtMethod*>& original_methods)
+      REQUIRES(!lock_)
+      REQUIRES(Locks::mutator_lock_);
+
+  // Counterpart of InvalidateCompiledCodeForXposedHooks() for `methods` whose hooks are being
+  // disabled. The methods may be compiled again, and get back the ProfilingInfo they
+  // had. The backups fall back to the interpreter and are not compiled anymore, so their code and
+  // ProfilingInfo are collected once no frame uses them. Must be called with all threads
+  // suspended, after the original access flags of the methods have been restored.
+  void RestoreCompiledCodeForXposedUnhooks(const std::vector<ArtMethod*>& methods,
+                                           const std::vector<ArtMethod*>& original_methods)
+      REQUIRES(!lock_)
+      REQUIRES(Locks::mutator_lock_);
+
+  // Removes the compiled code and ProfilingInfo of the backup of a released Xposed hook, which no
+  // frame runs anymore, so that the backup can be reused for another method. Returns false if the
+  // backup is being compiled.
+  bool RemoveUnusedXposedBackup(Thread* self, ArtMethod* original_method)
+      REQUIRES(!lock_)
+      SHARED_REQUIRES(Locks::mutator_lock_);
+
   void Dump(std::ostream& os) REQUIRES(!lock_);
 
   bool IsOsrCompiled(ArtMethod* method) REQUIRES(!lock_);
@@ -207,7 +261,8 @@ class JitCodeCache {
                               size_t fp_spill_mask,
                               const uint8_t* code,
                               size_t code_size,
-                              bool osr)
+                              bool osr,
+                              bool baseline)
       REQUIRES(!lock_)
       SHARED_REQUIRES(Locks::mutator_lock_);
 
@@ -217,6 +272,12 @@ class JitCodeCache {
       REQUIRES(lock_)
       SHARED_REQUIRES(Locks::mutator_lock_);
 
+  // Returns the ProfilingInfo of `method`. Methods hooked by Xposed store their hook information
+  // in place of the ProfilingInfo pointer, so the ProfilingInfo they had is looked up instead.
+  ProfilingInfo* GetProfilingInfoLocked(ArtMethod* method)
+      REQUIRES(lock_)
+      SHARED_REQUIRES(Locks::mutator_lock_);
+
   // If a collection is in progress, wait for it to finish. Return
   // whether the thread actually waited.
   bool WaitForPotentialCollectionToComplete(Thread* self)
@@ -256,8 +317,47 @@ class JitCodeCache {
   bool CheckLiveCompiledCodeHasProfilingInfo()
       REQUIRES(lock_);
 
+  // Returns whether the code of `method` belongs to the hot region of the code cache when it is
+  // committed: OSR code, and code of methods which kept looping in the interpreter after being
+  // queued for compilation.
+  bool IsHotCode(ArtMethod* method, bool osr)
+      SHARED_REQUIRES(Locks::mutator_lock_);
+
+  // Returns whether the compiled code of `method` was seen running often enough since the last
+  // collections to be moved to the hot region.
+  bool IsHotCompiledCode(ArtMethod* method)
+      SHARED_REQUIRES(Locks::mutator_lock_);
+
+  // Copies the code of methods which have become hot to the hot region, and makes it their entry
+  // point. The cold copy is not an entry point anymore and is freed by a later collection, once no
+  // thread runs it. Then decays the samples of compiled code, see IsHotCompiledCode().
+  void MoveHotCodeToHotRegion()
+      REQUIRES(lock_)
+      SHARED_REQUIRES(Locks::mutator_lock_);
+
+  // Copies the header, code and stack maps of `code_ptr` to `memory`, an allocation of the code
+  // cache large enough for them. Returns the new code pointer, or null if the data cache is full.
+  uint8_t* CopyCode(const void* code_ptr, uint8_t* memory) REQUIRES(lock_);
+
+  // Returns whether enough of the cold region is free below its top to be worth compacting.
+  bool ShouldCompactCode() REQUIRES(lock_);
+
+  // Moves the code of the cold region to lower addresses, from the top down, and makes the new
+  // copies the entry points. The old copies are returned in `moved_code`.
+  void MoveColdCodeDown(std::vector<const void*>* moved_code)
+      REQUIRES(lock_)
+      SHARED_REQUIRES(Locks::mutator_lock_);
+
+  // Releases the free pages at the top of the cold region.
+  void TrimColdRegion() REQUIRES(lock_);
+
   void FreeCode(uint8_t* code) REQUIRES(lock_);
-  uint8_t* AllocateCode(size_t code_size) REQUIRES(lock_);
+  // Allocates in the hot region if `hot`, or if the cold region is full.
+  uint8_t* AllocateCode(size_t code_size, bool hot) REQUIRES(lock_);
+  // Make the code cache writable until the matching EndCodeWrite. Writes can overlap, the code
+  // cache is made executable only again at the end of the last one.
+  void BeginCodeWrite() REQUIRES(lock_);
+  void EndCodeWrite() REQUIRES(lock_);
   void FreeData(uint8_t* data) REQUIRES(lock_);
   uint8_t* AllocateData(size_t data_size) REQUIRES(lock_);
 
@@ -267,12 +367,19 @@ class JitCodeCache {
   ConditionVariable lock_cond_ GUARDED_BY(lock_);
   // Whether there is a code cache collection in progress.
   bool collection_in_progress_ GUARDED_BY(lock_);
+  // Number of ongoing writes to the code cache.
+  size_t code_writers_ GUARDED_BY(lock_);
   // Mem map which holds code.
   std::unique_ptr<MemMap> code_map_;
   // Mem map which holds data (stack maps and profiling info).
   std::unique_ptr<MemMap> data_map_;
-  // The opaque mspace for allocating code.
+  // The opaque mspace for allocating code, in the cold region of the code map.
   void* code_mspace_ GUARDED_BY(lock_);
+  // The opaque mspace for allocating hot code, at the start of the code map. Null if the code
+  // cache is too small to be split.
+  void* hot_code_mspace_ GUARDED_BY(lock_);
+  // Start of the cold region of the code map.
+  uint8_t* cold_code_begin_;
   // The opaque mspace for allocating data.
   void* data_mspace_ GUARDED_BY(lock_);
   // Bitmap for collecting code and data.
@@ -284,15 +391,21 @@ class JitCodeCache {
   // ProfilingInfo objects we have allocated.
   std::vector<ProfilingInfo*> profiling_infos_ GUARDED_BY(lock_);
 
+  // Code pointers of the baseline code in the method_code_map_.
+  std::set<const void*> baseline_code_ GUARDED_BY(lock_);
+
   // The maximum capacity in bytes this code cache can go to.
   size_t max_capacity_ GUARDED_BY(lock_);
 
   // The current capacity in bytes of the code cache.
   size_t current_capacity_ GUARDED_BY(lock_);
 
-  // The current footprint in bytes of the code portion of the code cache.
+  // The current footprint in bytes of the cold code portion of the code cache.
   size_t code_end_ GUARDED_BY(lock_);
 
+  // The current footprint in bytes of the hot code portion of the code cache.
+  size_t hot_code_end_ GUARDED_BY(lock_);
+
   // The current footprint in bytes of the data portion of the code cache.
   size_t data_end_ GUARDED_BY(lock_);
 
@@ -312,18 +425,35 @@ class JitCodeCache {
   // The size in bytes of used memory for the code portion of the code cache.
   size_t used_memory_for_code_ GUARDED_BY(lock_);
 
+  // The part of `used_memory_for_code_` in the hot region.
+  size_t used_memory_for_hot_code_ GUARDED_BY(lock_);
+
   // Number of compilations done throughout the lifetime of the JIT.
   size_t number_of_compilations_ GUARDED_BY(lock_);
 
   // Number of compilations for on-stack-replacement done throughout the lifetime of the JIT.
   size_t number_of_osr_compilations_ GUARDED_BY(lock_);
 
+  // Number of baseline compilations done throughout the lifetime of the JIT.
+  size_t number_of_baseline_compilations_ GUARDED_BY(lock_);
+
   // Number of deoptimizations done throughout the lifetime of the JIT.
   size_t number_of_deoptimizations_ GUARDED_BY(lock_);
 
   // Number of code cache collections done throughout the lifetime of the JIT.
   size_t number_of_collections_ GUARDED_BY(lock_);
 
+  // Number of compiled methods moved to the hot region throughout the lifetime of the JIT.
+  size_t number_of_hot_code_moves_ GUARDED_BY(lock_);
+
+  // Number of cold region compactions, and of compiled methods they moved, throughout the
+  // lifetime of the JIT.
+  size_t number_of_compactions_ GUARDED_BY(lock_);
+  size_t number_of_compaction_moves_ GUARDED_BY(lock_);
+
+  // Bytes returned to the kernel by the compactions throughout the lifetime of the JIT.
+  size_t compaction_released_bytes_ GUARDED_BY(lock_);
+
   // Histograms for keeping track of stack map size statistics.
   Histogram<uint64_t> histogram_stack_map_memory_use_ GUARDED_BY(lock_);
 
@@ -333,6 +463,9 @@ class JitCodeCache {
   // Histograms for keeping track of profiling info statistics.
   Histogram<uint64_t> histogram_profiling_info_memory_use_ GUARDED_BY(lock_);
 
+  friend class PersistentCodeCache;
+  friend class ScopedCodeCacheWrite;
+
   DISALLOW_IMPLICIT_CONSTRUCTORS(JitCodeCache);
 };
 
@@ -0,0 +1,75 @@
+/*
+ * Copyright (C) 2016 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "jit_compile_queue.h"
+
+#include <algorithm>
+
+#include "thread-inl.h"
+
+namespace art {
+namespace jit {
+
+JitCompileQueue::JitCompileQueue() : lock_("JIT compile queue lock"), merged_(0) {}
+
+bool JitCompileQueue::Add(Thread* self, const JitCompileRequest& request) {
+  MutexLock mu(self, lock_);
+  auto key = std::make_pair(request.method, request.kind);
+  auto it = pending_.find(key);
+  if (it == pending_.end()) {
+    pending_.emplace(key, requests_.insert(request).first);
+    return true;
+  }
+  ++merged_;
+  // The merged request keeps its place among equally hot methods, but moves up if the method got
+  // hotter in the meantime.
+  JitCompileRequest merged = *it->second;
+  if (request.hotness > merged.hotness) {
+    merged.hotness = request.hotness;
+    requests_.erase(it->second);
+    it->second = requests_.insert(merged).first;
+  }
+  return false;
+}
+
+bool JitCompileQueue::Take(Thread* self, JitCompileRequest* request) {
+  MutexLock mu(self, lock_);
+  if (requests_.empty()) {
+    return false;
+  }
+  *request = *requests_.begin();
+  requests_.erase(requests_.begin());
+  pending_.erase(std::make_pair(request->method, request->kind));
+  return true;
+}
+
+size_t JitCompileQueue::Size(Thread* self) {
+  MutexLock mu(self, lock_);
+  return requests_.size();
+}
+
+void JitCompileQueue::Dump(std::ostream& os) {
+  MutexLock mu(Thread::Current(), lock_);
+  size_t osr_requests = std::count_if(requests_.begin(), requests_.end(),
+                                      [](const JitCompileRequest& request) {
+                                        return request.kind == JitCompileKind::kCompileOsr;
+                                      });
+  os << "JIT compile queue: pending=" << requests_.size() << " (osr=" << osr_requests << ")"
+     << " merged=" << merged_ << "\n";
+}
+
+}  // namespace jit
+}  // namespace art
@@ -0,0 +1,106 @@
+/*
+ * Copyright (C) 2016 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ART_RUNTIME_JIT_JIT_COMPILE_QUEUE_H_
+#define ART_RUNTIME_JIT_JIT_COMPILE_QUEUE_H_
+
+#include <map>
+#include <ostream>
+#include <set>
+#include <utility>
+
+#include "base/macros.h"
+#include "base/mutex.h"
+#include "jni.h"
+
+namespace art {
+
+class ArtMethod;
+
+namespace jit {
+
+// Kinds of JIT requests, from the least to the most urgent.
+enum class JitCompileKind : uint8_t {
+  kAllocateProfile,
+  // Replaces baseline code, which is already faster than the interpreter.
+  kCompileOptimized,
+  kCompile,
+  kCompileOsr,
+};
+
+struct JitCompileRequest {
+  ArtMethod* method;
+  JitCompileKind kind;
+  // Hotness count of the method when the request was made, the highest one of merged requests.
+  uint32_t hotness;
+  // When the first of the merged requests was made.
+  uint64_t enqueue_time_ns;
+  // Global reference to the declaring class of the method, preventing class unloading until the
+  // request is done.
+  jobject klass;
+};
+
+// Requests waiting for the JIT thread pool. OSR compilations are taken first, then compilations,
+// then recompilations of baseline code, then profile allocations. Requests of the same kind are
+// taken from the hottest method down, and in the order they were made for equally hot methods. A
+// request for a method which already has a pending request of the same kind is merged into it.
+class JitCompileQueue {
+ public:
+  JitCompileQueue();
+
+  // Returns false if the request was merged into a pending request, in which case the caller keeps
+  // the ownership of `request.klass`.
+  bool Add(Thread* self, const JitCompileRequest& request) REQUIRES(!lock_);
+
+  // Removes the most urgent request. Returns false if the queue is empty.
+  bool Take(Thread* self, JitCompileRequest* request) REQUIRES(!lock_);
+
+  size_t Size(Thread* self) REQUIRES(!lock_);
+
+  void Dump(std::ostream& os) REQUIRES(!lock_);
+
+ private:
+  struct RequestComparator {
+    bool operator()(const JitCompileRequest& lhs, const JitCompileRequest& rhs) const {
+      if (lhs.kind != rhs.kind) {
+        return lhs.kind > rhs.kind;
+      }
+      if (lhs.hotness != rhs.hotness) {
+        return lhs.hotness > rhs.hotness;
+      }
+      if (lhs.enqueue_time_ns != rhs.enqueue_time_ns) {
+        return lhs.enqueue_time_ns < rhs.enqueue_time_ns;
+      }
+      return lhs.method < rhs.method;
+    }
+  };
+
+  typedef std::set<JitCompileRequest, RequestComparator> RequestSet;
+
+  Mutex lock_ DEFAULT_MUTEX_ACQUIRED_AFTER;
+  RequestSet requests_ GUARDED_BY(lock_);
+  // The pending request of each method and kind.
+  std::map<std::pair<ArtMethod*, JitCompileKind>, RequestSet::iterator> pending_ GUARDED_BY(lock_);
+  // Number of requests merged into pending ones.
+  uint64_t merged_ GUARDED_BY(lock_);
+
+  DISALLOW_COPY_AND_ASSIGN(JitCompileQueue);
+};
+
+}  // namespace jit
+}  // namespace art
+
+#endif  // ART_RUNTIME_JIT_JIT_COMPILE_QUEUE_H_
@@ -0,0 +1,89 @@
+/*
+ * Copyright (C) 2016 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include "common_runtime_test.h"
+#include "jit/jit_compile_queue.h"
+
+namespace art {
+namespace jit {
+
+class JitCompileQueueTest : public CommonRuntimeTest {
+ protected:
+  // The queue never looks at the methods.
+  static ArtMethod* FakeMethod(uintptr_t id) {
+    return reinterpret_cast<ArtMethod*>(id * 8);
+  }
+
+  static JitCompileRequest Request(uintptr_t id, JitCompileKind kind, uint32_t hotness,
+                                   uint64_t time) {
+    JitCompileRequest request = { FakeMethod(id), kind, hotness, time, nullptr };
+    return request;
+  }
+};
+
+TEST_F(JitCompileQueueTest, OsrThenCompileThenProfile) {
+  Thread* self = Thread::Current();
+  JitCompileQueue queue;
+  EXPECT_TRUE(queue.Add(self, Request(1, JitCompileKind::kAllocateProfile, 60000, 0)));
+  EXPECT_TRUE(queue.Add(self, Request(2, JitCompileKind::kCompile, 10000, 1)));
+  EXPECT_TRUE(queue.Add(self, Request(3, JitCompileKind::kCompile, 12000, 2)));
+  EXPECT_TRUE(queue.Add(self, Request(4, JitCompileKind::kCompileOsr, 20000, 3)));
+  EXPECT_TRUE(queue.Add(self, Request(5, JitCompileKind::kCompile, 12000, 4)));
+  EXPECT_TRUE(queue.Add(self, Request(6, JitCompileKind::kCompileOptimized, 20000, 5)));
+  EXPECT_EQ(6u, queue.Size(self));
+
+  const uintptr_t expected_order[] = { 4, 3, 5, 2, 6, 1 };
+  for (uintptr_t id : expected_order) {
+    JitCompileRequest request;
+    ASSERT_TRUE(queue.Take(self, &request));
+    EXPECT_EQ(FakeMethod(id), request.method);
+  }
+  JitCompileRequest request;
+  EXPECT_FALSE(queue.Take(self, &request));
+}
+
+TEST_F(JitCompileQueueTest, DuplicatesAreMerged) {
+  Thread* self = Thread::Current();
+  JitCompileQueue queue;
+  EXPECT_TRUE(queue.Add(self, Request(1, JitCompileKind::kCompile, 10000, 0)));
+  EXPECT_TRUE(queue.Add(self, Request(2, JitCompileKind::kCompile, 11000, 1)));
+  // The merged request keeps the time of the first one, and the highest hotness.
+  EXPECT_FALSE(queue.Add(self, Request(1, JitCompileKind::kCompile, 15000, 2)));
+  // Other kinds of requests for the same method are kept apart.
+  EXPECT_TRUE(queue.Add(self, Request(1, JitCompileKind::kCompileOsr, 20000, 3)));
+  EXPECT_EQ(3u, queue.Size(self));
+
+  JitCompileRequest request;
+  ASSERT_TRUE(queue.Take(self, &request));
+  EXPECT_EQ(JitCompileKind::kCompileOsr, request.kind);
+  ASSERT_TRUE(queue.Take(self, &request));
+  EXPECT_EQ(FakeMethod(1), request.method);
+  EXPECT_EQ(15000u, request.hotness);
+  EXPECT_EQ(0u, request.enqueue_time_ns);
+
+  // Once taken, a new request for the method is queued again.
+  EXPECT_TRUE(queue.Add(self, Request(1, JitCompileKind::kCompile, 10000, 4)));
+  EXPECT_EQ(2u, queue.Size(self));
+
+  std::ostringstream oss;
+  queue.Dump(oss);
+  EXPECT_EQ("JIT compile queue: pending=2 (osr=0) merged=1\n", oss.str());
+}
+
+}  // namespace jit
+}  // namespace art
@@ -22,6 +22,8 @@
 #include <sys/file.h>
 #include <sys/stat.h>
 #include <sys/uio.h>
+#include <unistd.h>
+#include <zlib.h>
 
 #include "art_method-inl.h"
 #include "base/mutex.h"
@@ -30,16 +32,35 @@
 #include "base/systrace.h"
 #include "base/unix_file/fd_file.h"
 #include "jit/profiling_info.h"
+#include "leb128.h"
 #include "os.h"
 #include "safe_map.h"
 
 namespace art {
 
 const uint8_t ProfileCompilationInfo::kProfileMagic[] = { 'p', 'r', 'o', '\0' };
-const uint8_t ProfileCompilationInfo::kProfileVersion[] = { '0', '0', '1', '\0' };
+const uint8_t ProfileCompilationInfo::kProfileVersion[] = { '0', '0', '2', '\0' };
 
 static constexpr uint16_t kMaxDexFileKeyLength = PATH_MAX;
 
+// Size of the chunks the profile body is compressed and decompressed in.
+static constexpr size_t kCompressionChunkSize = 4 * KB;
+
+// Flags of a serialized inline cache.
+static constexpr uint8_t kInlineCacheMegamorphic = 1 << 0;
+static constexpr uint8_t kInlineCacheMissingTypes = 1 << 1;
+
+// Returns the value of the index `key` in `map`, default constructed if it was not there.
+template <typename K, typename V>
+static V* FindOrAdd(SafeMap<K, V>* map, uint32_t key) {
+  DCHECK_LE(key, std::numeric_limits<K>::max());
+  auto it = map->find(static_cast<K>(key));
+  if (it == map->end()) {
+    it = map->Put(static_cast<K>(key), V());
+  }
+  return &it->second;
+}
+
 // Transform the actual dex location into relative paths.
 // Note: this is OK because we don't store profiles of different apps into the same file.
 // Apps with split apks don't cause trouble because each split has a different name and will not
@@ -73,6 +94,45 @@ bool ProfileCompilationInfo::AddMethodsAndClasses(
   return true;
 }
 
+bool ProfileCompilationInfo::AddMethods(const std::vector<ProfileMethodInfo>& methods) {
+  for (const ProfileMethodInfo& method : methods) {
+    DexFileData* const data = GetOrAddDexFileData(
+        GetProfileDexFileKey(method.ref.dex_file->GetLocation()),
+        method.ref.dex_file->GetLocationChecksum());
+    if (data == nullptr) {
+      return false;
+    }
+    MethodData method_data;
+    method_data.hotness = method.hotness;
+    method_data.inline_caches = method.inline_caches;
+    MergeMethodData(method_data, FindOrAdd(&data->method_map, method.ref.dex_method_index));
+  }
+  return true;
+}
+
+bool ProfileCompilationInfo::MergeMethodData(const MethodData& other, MethodData* data) {
+  bool changed = (other.hotness > data->hotness);
+  data->hotness = std::max(data->hotness, other.hotness);
+  for (const auto& it : other.inline_caches) {
+    const InlineCacheData& other_cache = it.second;
+    size_t number_of_caches = data->inline_caches.size();
+    InlineCacheData* cache = FindOrAdd(&data->inline_caches, it.first);
+    const InlineCacheData previous_cache = *cache;
+    cache->is_missing_types |= other_cache.is_missing_types;
+    cache->is_megamorphic |= other_cache.is_megamorphic;
+    if (!cache->is_megamorphic) {
+      cache->classes.insert(other_cache.classes.begin(), other_cache.classes.end());
+      cache->is_megamorphic = (cache->classes.size() > InlineCache::kIndividualCacheSize);
+    }
+    if (cache->is_megamorphic) {
+      // The types of megamorphic call sites are not worth keeping.
+      cache->classes.clear();
+    }
+    changed |= (number_of_caches != data->inline_caches.size()) || !(previous_cache == *cache);
+  }
+  return changed;
+}
+
 bool ProfileCompilationInfo::MergeAndSave(const std::string& filename,
                                           uint64_t* bytes_written,
                                           bool force) {
@@ -163,79 +223,227 @@ static void AddUintToBuffer(std::vector<uint8_t>* buffer, T value) {
   }
 }
 
-static constexpr size_t kLineHeaderSize =
-    3 * sizeof(uint16_t) +  // method_set.size + class_set.size + dex_location.size
-    sizeof(uint32_t);       // checksum
+// Add the elements of a sorted set as the differences between consecutive elements.
+template <typename Set>
+static void AddDeltasToBuffer(std::vector<uint8_t>* buffer, const Set& values) {
+  EncodeUnsignedLeb128(buffer, values.size());
+  uint32_t last_value = 0;
+  for (uint16_t value : values) {
+    EncodeUnsignedLeb128(buffer, value - last_value);
+    last_value = value;
+  }
+}
+
+class ProfileCompilationInfo::CompressedWriter {
+ public:
+  explicit CompressedWriter(int fd) : fd_(fd), initialized_(false) {
+    memset(&stream_, 0, sizeof(stream_));
+  }
+
+  ~CompressedWriter() {
+    if (initialized_) {
+      deflateEnd(&stream_);
+    }
+  }
+
+  bool Init() {
+    initialized_ = (deflateInit(&stream_, Z_DEFAULT_COMPRESSION) == Z_OK);
+    return initialized_;
+  }
+
+  // Compresses `data` and writes what the compressor outputs.
+  bool Write(const uint8_t* data, size_t size) {
+    stream_.next_in = const_cast<uint8_t*>(data);
+    stream_.avail_in = size;
+    return Deflate(Z_NO_FLUSH);
+  }
+
+  // Writes the end of the compressed stream.
+  bool Finish() {
+    stream_.next_in = nullptr;
+    stream_.avail_in = 0;
+    return Deflate(Z_FINISH);
+  }
+
+ private:
+  bool Deflate(int flush) {
+    int result;
+    do {
+      stream_.next_out = output_;
+      stream_.avail_out = sizeof(output_);
+      result = deflate(&stream_, flush);
+      if (result == Z_STREAM_ERROR) {
+        return false;
+      }
+      if (!WriteBuffer(fd_, output_, sizeof(output_) - stream_.avail_out)) {
+        return false;
+      }
+    } while (stream_.avail_out == 0 || (flush == Z_FINISH && result != Z_STREAM_END));
+    return true;
+  }
+
+  const int fd_;
+  bool initialized_;
+  z_stream stream_;
+  uint8_t output_[kCompressionChunkSize];
+
+  DISALLOW_COPY_AND_ASSIGN(CompressedWriter);
+};
 
 /**
  * Serialization format:
- *    magic,version,number_of_lines
- *    dex_location1,number_of_methods1,number_of_classes1,dex_location_checksum1, \
- *        method_id11,method_id12...,class_id1,class_id2...
- *    dex_location2,number_of_methods2,number_of_classes2,dex_location_checksum2, \
- *        method_id21,method_id22...,,class_id1,class_id2...
+ *    magic,version,
+ *    followed by one or more records, each a zlib stream of:
+ *    number_of_lines
+ *    dex_location1_size,dex_location1,dex_location_checksum1,
+ *        number_of_methods1,method_delta11,hotness11,inline_caches11,...
+ *        number_of_classes1,class_delta11,...
+ *    dex_location2_size,dex_location2,dex_location_checksum2,...
  *    .....
+ * where inline caches are:
+ *    number_of_inline_caches,dex_pc_delta1,flags1,number_of_types1,type_delta11,...
+ *
+ * Checksums are 32-bit little endian, hotness and flags single bytes, and all other
+ * numbers unsigned LEB128. Indices and dex pcs are stored as differences to the previous
+ * one in the same list, the first one as is.
+ * Save writes a single record. AppendToFile adds a record, which loading merges with the
+ * records before it, so that saving new data does not need to rewrite the file.
  **/
 bool ProfileCompilationInfo::Save(int fd) {
   ScopedTrace trace(__PRETTY_FUNCTION__);
   DCHECK_GE(fd, 0);
 
-  // Cache at most 5KB before writing.
+  if (!WriteBuffer(fd, kProfileMagic, sizeof(kProfileMagic)) ||
+      !WriteBuffer(fd, kProfileVersion, sizeof(kProfileVersion))) {
+    return false;
+  }
+  return SaveRecord(fd);
+}
+
+bool ProfileCompilationInfo::AppendToFile(const std::string& filename, uint64_t* bytes_written) {
+  ScopedTrace trace(__PRETTY_FUNCTION__);
+  ScopedFlock flock;
+  std::string error;
+  if (!flock.Init(filename.c_str(), O_RDWR | O_NOFOLLOW | O_CLOEXEC, /* block */ false, &error)) {
+    LOG(WARNING) << "Couldn't lock the profile file " << filename << ": " << error;
+    return false;
+  }
+
+  int fd = flock.GetFile()->Fd();
+  struct stat stat_buffer;
+  if (fstat(fd, &stat_buffer) != 0) {
+    PLOG(WARNING) << "Could not stat profile file " << filename;
+    return false;
+  }
+  off_t original_size = stat_buffer.st_size;
+  if (original_size == 0) {
+    if (!WriteBuffer(fd, kProfileMagic, sizeof(kProfileMagic)) ||
+        !WriteBuffer(fd, kProfileVersion, sizeof(kProfileVersion))) {
+      PLOG(WARNING) << "Could not write profile header to " << filename;
+      return false;
+    }
+  } else {
+    // Records can only be appended to a profile of the same version.
+    if (ReadProfileHeader(fd, &error) != kProfileLoadSuccess) {
+      VLOG(profiler) << "Cannot append to profile file " << filename << ": " << error;
+      return false;
+    }
+    if (lseek(fd, 0, SEEK_END) != original_size) {
+      PLOG(WARNING) << "Could not seek to the end of profile file " << filename;
+      return false;
+    }
+  }
+
+  if (!SaveRecord(fd)) {
+    // Do not leave a partial record, which would make the whole file unreadable.
+    if (ftruncate(fd, original_size) != 0) {
+      PLOG(WARNING) << "Could not truncate profile file " << filename;
+    }
+    VLOG(profiler) << "Failed to append profile info to " << filename;
+    return false;
+  }
+  if (fstat(fd, &stat_buffer) != 0) {
+    PLOG(WARNING) << "Could not stat profile file " << filename;
+    return false;
+  }
+  if (bytes_written != nullptr) {
+    *bytes_written = stat_buffer.st_size - original_size;
+  }
+  VLOG(profiler) << "Successfully appended profile info to " << filename
+      << " Size: " << stat_buffer.st_size;
+  return true;
+}
+
+bool ProfileCompilationInfo::SaveRecord(int fd) {
+  CompressedWriter writer(fd);
+  if (!writer.Init()) {
+    LOG(WARNING) << "Could not initialize the profile compression";
+    return false;
+  }
+
+  // Compress at least 5KB at a time.
   static constexpr size_t kMaxSizeToKeepBeforeWriting = 5 * KB;
   // Use a vector wrapper to avoid keeping track of offsets when we add elements.
   std::vector<uint8_t> buffer;
-  WriteBuffer(fd, kProfileMagic, sizeof(kProfileMagic));
-  WriteBuffer(fd, kProfileVersion, sizeof(kProfileVersion));
-  AddUintToBuffer(&buffer, static_cast<uint16_t>(info_.size()));
-
+  uint32_t number_of_lines = 0;
   for (const auto& it : info_) {
-    if (buffer.size() > kMaxSizeToKeepBeforeWriting) {
-      if (!WriteBuffer(fd, buffer.data(), buffer.size())) {
-        return false;
-      }
-      buffer.clear();
-    }
     const std::string& dex_location = it.first;
     const DexFileData& dex_data = it.second;
-    if (dex_data.method_set.empty() && dex_data.class_set.empty()) {
+    if (dex_data.method_map.empty() && dex_data.class_set.empty()) {
       continue;
     }
-
     if (dex_location.size() >= kMaxDexFileKeyLength) {
       LOG(WARNING) << "DexFileKey exceeds allocated limit";
       return false;
     }
+    number_of_lines++;
+  }
+  EncodeUnsignedLeb128(&buffer, number_of_lines);
 
-    // Make sure that the buffer has enough capacity to avoid repeated resizings
-    // while we add data.
-    size_t required_capacity = buffer.size() +
-        kLineHeaderSize +
-        dex_location.size() +
-        sizeof(uint16_t) * (dex_data.class_set.size() + dex_data.method_set.size());
-
-    buffer.reserve(required_capacity);
-
-    DCHECK_LE(dex_location.size(), std::numeric_limits<uint16_t>::max());
-    DCHECK_LE(dex_data.method_set.size(), std::numeric_limits<uint16_t>::max());
-    DCHECK_LE(dex_data.class_set.size(), std::numeric_limits<uint16_t>::max());
-    AddUintToBuffer(&buffer, static_cast<uint16_t>(dex_location.size()));
-    AddUintToBuffer(&buffer, static_cast<uint16_t>(dex_data.method_set.size()));
-    AddUintToBuffer(&buffer, static_cast<uint16_t>(dex_data.class_set.size()));
-    AddUintToBuffer(&buffer, dex_data.checksum);  // uint32_t
-
-    AddStringToBuffer(&buffer, dex_location);
-
-    for (auto method_it : dex_data.method_set) {
-      AddUintToBuffer(&buffer, method_it);
+  for (const auto& it : info_) {
+    if (buffer.size() > kMaxSizeToKeepBeforeWriting) {
+      if (!writer.Write(buffer.data(), buffer.size())) {
+        return false;
+      }
+      buffer.clear();
     }
-    for (auto class_id : dex_data.class_set) {
-      AddUintToBuffer(&buffer, class_id);
+    const DexFileData& dex_data = it.second;
+    if (dex_data.method_map.empty() && dex_data.class_set.empty()) {
+      continue;
     }
-    DCHECK_EQ(required_capacity, buffer.size())
-        << "Failed to add the expected number of bytes in the buffer";
+    AddLineToBuffer(it.first, dex_data, &buffer);
   }
 
-  return WriteBuffer(fd, buffer.data(), buffer.size());
+  return writer.Write(buffer.data(), buffer.size()) && writer.Finish();
+}
+
+void ProfileCompilationInfo::AddLineToBuffer(const std::string& dex_location,
+                                             const DexFileData& dex_data,
+                                             /*out*/std::vector<uint8_t>* buffer) {
+  EncodeUnsignedLeb128(buffer, dex_location.size());
+  AddStringToBuffer(buffer, dex_location);
+  AddUintToBuffer(buffer, dex_data.checksum);  // uint32_t
+
+  EncodeUnsignedLeb128(buffer, dex_data.method_map.size());
+  uint32_t last_method_idx = 0;
+  for (const auto& method_it : dex_data.method_map) {
+    const MethodData& method_data = method_it.second;
+    EncodeUnsignedLeb128(buffer, method_it.first - last_method_idx);
+    last_method_idx = method_it.first;
+    buffer->push_back(method_data.hotness);
+
+    EncodeUnsignedLeb128(buffer, method_data.inline_caches.size());
+    uint32_t last_dex_pc = 0;
+    for (const auto& cache_it : method_data.inline_caches) {
+      const InlineCacheData& cache = cache_it.second;
+      EncodeUnsignedLeb128(buffer, cache_it.first - last_dex_pc);
+      last_dex_pc = cache_it.first;
+      buffer->push_back((cache.is_megamorphic ? kInlineCacheMegamorphic : 0) |
+                        (cache.is_missing_types ? kInlineCacheMissingTypes : 0));
+      AddDeltasToBuffer(buffer, cache.classes);
+    }
+  }
+  AddDeltasToBuffer(buffer, dex_data.class_set);
 }
 
 ProfileCompilationInfo::DexFileData* ProfileCompilationInfo::GetOrAddDexFileData(
@@ -265,12 +473,14 @@ bool ProfileCompilationInfo::AddResolvedClasses(const DexCacheResolvedClasses& c
 
 bool ProfileCompilationInfo::AddMethodIndex(const std::string& dex_location,
                                             uint32_t checksum,
-                                            uint16_t method_idx) {
+                                            uint16_t method_idx,
+                                            MethodHotness hotness) {
   DexFileData* const data = GetOrAddDexFileData(dex_location, checksum);
   if (data == nullptr) {
     return false;
   }
-  data->method_set.insert(method_idx);
+  MethodData* method_data = FindOrAdd(&data->method_map, method_idx);
+  method_data->hotness = std::max(method_data->hotness, hotness);
   return true;
 }
 
@@ -285,50 +495,6 @@ bool ProfileCompilationInfo::AddClassIndex(const std::string& dex_location,
   return true;
 }
 
-bool ProfileCompilationInfo::ProcessLine(SafeBuffer& line_buffer,
-                                         uint16_t method_set_size,
-                                         uint16_t class_set_size,
-                                         uint32_t checksum,
-                                         const std::string& dex_location) {
-  for (uint16_t i = 0; i < method_set_size; i++) {
-    uint16_t method_idx = line_buffer.ReadUintAndAdvance<uint16_t>();
-    if (!AddMethodIndex(dex_location, checksum, method_idx)) {
-      return false;
-    }
-  }
-
-  for (uint16_t i = 0; i < class_set_size; i++) {
-    uint16_t class_def_idx = line_buffer.ReadUintAndAdvance<uint16_t>();
-    if (!AddClassIndex(dex_location, checksum, class_def_idx)) {
-      return false;
-    }
-  }
-  return true;
-}
-
-// Tests for EOF by trying to read 1 byte from the descriptor.
-// Returns:
-//   0 if the descriptor is at the EOF,
-//  -1 if there was an IO error
-//   1 if the descriptor has more content to read
-static int testEOF(int fd) {
-  uint8_t buffer[1];
-  return TEMP_FAILURE_RETRY(read(fd, buffer, 1));
-}
-
-// Reads an uint value previously written with AddUintToBuffer.
-template <typename T>
-T ProfileCompilationInfo::SafeBuffer::ReadUintAndAdvance() {
-  static_assert(std::is_unsigned<T>::value, "Type is not unsigned");
-  CHECK_LE(ptr_current_ + sizeof(T), ptr_end_);
-  T value = 0;
-  for (size_t i = 0; i < sizeof(T); i++) {
-    value += ptr_current_[i] << (i * kBitsPerByte);
-  }
-  ptr_current_ += sizeof(T);
-  return value;
-}
-
 bool ProfileCompilationInfo::SafeBuffer::CompareAndAdvance(const uint8_t* data, size_t data_size) {
   if (ptr_current_ + data_size > ptr_end_) {
     return false;
@@ -361,15 +527,184 @@ ProfileCompilationInfo::ProfileLoadSatus ProfileCompilationInfo::SafeBuffer::Fil
   return kProfileLoadSuccess;
 }
 
+class ProfileCompilationInfo::CompressedReader {
+ public:
+  explicit CompressedReader(int fd)
+      : fd_(fd), initialized_(false), stream_end_(false), output_begin_(0), output_end_(0) {
+    memset(&stream_, 0, sizeof(stream_));
+  }
+
+  ~CompressedReader() {
+    if (initialized_) {
+      inflateEnd(&stream_);
+    }
+  }
+
+  bool Init() {
+    initialized_ = (inflateInit(&stream_) == Z_OK);
+    return initialized_;
+  }
+
+  ProfileLoadSatus ReadBytes(uint8_t* data, size_t size, /*out*/std::string* error) {
+    while (size > 0) {
+      if (output_begin_ == output_end_) {
+        ProfileLoadSatus status = Fill(error);
+        if (status != kProfileLoadSuccess) {
+          return status;
+        }
+        if (output_begin_ == output_end_) {
+          *error += "Profile EOF reached prematurely";
+          return kProfileLoadBadData;
+        }
+      }
+      size_t bytes = std::min(size, output_end_ - output_begin_);
+      memcpy(data, output_ + output_begin_, bytes);
+      output_begin_ += bytes;
+      data += bytes;
+      size -= bytes;
+    }
+    return kProfileLoadSuccess;
+  }
+
+  // Reads an uint value previously written with AddUintToBuffer.
+  template <typename T>
+  ProfileLoadSatus ReadUint(/*out*/T* value, /*out*/std::string* error) {
+    static_assert(std::is_unsigned<T>::value, "Type is not unsigned");
+    uint8_t bytes[sizeof(T)];
+    ProfileLoadSatus status = ReadBytes(bytes, sizeof(T), error);
+    *value = 0;
+    for (size_t i = 0; i < sizeof(T); i++) {
+      *value += static_cast<T>(bytes[i]) << (i * kBitsPerByte);
+    }
+    return status;
+  }
+
+  ProfileLoadSatus ReadUnsignedLeb128(/*out*/uint32_t* value, /*out*/std::string* error) {
+    *value = 0;
+    for (size_t shift = 0; shift < 5 * 7; shift += 7) {
+      uint8_t byte;
+      ProfileLoadSatus status = ReadUint(&byte, error);
+      if (status != kProfileLoadSuccess) {
+        return status;
+      }
+      *value |= static_cast<uint32_t>(byte & 0x7f) << shift;
+      if ((byte & 0x80) == 0) {
+        return kProfileLoadSuccess;
+      }
+    }
+    *error += "Profile has an invalid LEB128 value";
+    return kProfileLoadBadData;
+  }
+
+  // Reads a list of indices written with AddDeltasToBuffer, and inserts them in `values`.
+  ProfileLoadSatus ReadDeltas(/*out*/std::set<uint16_t>* values, /*out*/std::string* error) {
+    uint32_t size;
+    ProfileLoadSatus status = ReadUnsignedLeb128(&size, error);
+    uint32_t value = 0;
+    for (uint32_t i = 0; (status == kProfileLoadSuccess) && i < size; i++) {
+      uint32_t delta;
+      status = ReadUnsignedLeb128(&delta, error);
+      if (status != kProfileLoadSuccess) {
+        return status;
+      }
+      value += delta;
+      if (value > std::numeric_limits<uint16_t>::max()) {
+        *error = "Profile has an invalid index: " + std::to_string(value);
+        return kProfileLoadBadData;
+      }
+      values->insert(value);
+    }
+    return status;
+  }
+
+  // Checks that the compressed stream of the current record ends after the data read, and
+  // sets `has_next` to whether another record follows it in the file.
+  ProfileLoadSatus EndRecord(/*out*/bool* has_next, /*out*/std::string* error) {
+    while (output_begin_ == output_end_ && !stream_end_) {
+      ProfileLoadSatus status = Fill(error);
+      if (status != kProfileLoadSuccess) {
+        return status;
+      }
+    }
+    if (output_begin_ != output_end_) {
+      *error = "Unexpected content in the profile file";
+      return kProfileLoadBadData;
+    }
+    if (stream_.avail_in == 0) {
+      int bytes_read = TEMP_FAILURE_RETRY(read(fd_, input_, sizeof(input_)));
+      if (bytes_read < 0) {
+        *error += std::string("Profile IO error ") + strerror(errno);
+        return kProfileLoadIOError;
+      }
+      stream_.next_in = input_;
+      stream_.avail_in = bytes_read;
+    }
+    *has_next = (stream_.avail_in != 0);
+    if (*has_next) {
+      // Anything following a record must be another record, `Fill` rejects junk data.
+      if (inflateReset(&stream_) != Z_OK) {
+        *error = "Could not reset the profile decompression";
+        return kProfileLoadIOError;
+      }
+      stream_end_ = false;
+    }
+    return kProfileLoadSuccess;
+  }
+
+ private:
+  // Decompresses the next chunk of the stream, reading the file as needed.
+  ProfileLoadSatus Fill(/*out*/std::string* error) {
+    output_begin_ = 0;
+    output_end_ = 0;
+    if (stream_end_) {
+      return kProfileLoadSuccess;
+    }
+    while (output_end_ == 0 && !stream_end_) {
+      if (stream_.avail_in == 0) {
+        int bytes_read = TEMP_FAILURE_RETRY(read(fd_, input_, sizeof(input_)));
+        if (bytes_read == 0) {
+          *error += "Profile EOF reached prematurely";
+          return kProfileLoadBadData;
+        } else if (bytes_read < 0) {
+          *error += std::string("Profile IO error ") + strerror(errno);
+          return kProfileLoadIOError;
+        }
+        stream_.next_in = input_;
+        stream_.avail_in = bytes_read;
+      }
+      stream_.next_out = output_;
+      stream_.avail_out = sizeof(output_);
+      int result = inflate(&stream_, Z_NO_FLUSH);
+      if (result == Z_STREAM_END) {
+        stream_end_ = true;
+      } else if (result != Z_OK && result != Z_BUF_ERROR) {
+        *error += "Profile has invalid compressed data";
+        return kProfileLoadBadData;
+      }
+      output_end_ = sizeof(output_) - stream_.avail_out;
+    }
+    return kProfileLoadSuccess;
+  }
+
+  const int fd_;
+  bool initialized_;
+  bool stream_end_;
+  z_stream stream_;
+  uint8_t input_[kCompressionChunkSize];
+  uint8_t output_[kCompressionChunkSize];
+  size_t output_begin_;
+  size_t output_end_;
+
+  DISALLOW_COPY_AND_ASSIGN(CompressedReader);
+};
+
 ProfileCompilationInfo::ProfileLoadSatus ProfileCompilationInfo::ReadProfileHeader(
       int fd,
-      /*out*/uint16_t* number_of_lines,
       /*out*/std::string* error) {
   // Read magic and version
   const size_t kMagicVersionSize =
     sizeof(kProfileMagic) +
-    sizeof(kProfileVersion) +
-    sizeof(uint16_t);  // number of lines
+    sizeof(kProfileVersion);
 
   SafeBuffer safe_buffer(kMagicVersionSize);
 
@@ -386,74 +721,88 @@ ProfileCompilationInfo::ProfileLoadSatus ProfileCompilationInfo::ReadProfileHead
     *error = "Profile version mismatch";
     return kProfileLoadVersionMismatch;
   }
-  *number_of_lines = safe_buffer.ReadUintAndAdvance<uint16_t>();
   return kProfileLoadSuccess;
 }
 
-ProfileCompilationInfo::ProfileLoadSatus ProfileCompilationInfo::ReadProfileLineHeader(
-      int fd,
-      /*out*/ProfileLineHeader* line_header,
+ProfileCompilationInfo::ProfileLoadSatus ProfileCompilationInfo::ReadProfileLine(
+      CompressedReader& reader,
       /*out*/std::string* error) {
-  SafeBuffer header_buffer(kLineHeaderSize);
-  ProfileLoadSatus status = header_buffer.FillFromFd(fd, "ReadProfileHeader", error);
+  uint32_t dex_location_size;
+  ProfileLoadSatus status = reader.ReadUnsignedLeb128(&dex_location_size, error);
   if (status != kProfileLoadSuccess) {
     return status;
   }
-
-  uint16_t dex_location_size = header_buffer.ReadUintAndAdvance<uint16_t>();
-  line_header->method_set_size = header_buffer.ReadUintAndAdvance<uint16_t>();
-  line_header->class_set_size = header_buffer.ReadUintAndAdvance<uint16_t>();
-  line_header->checksum = header_buffer.ReadUintAndAdvance<uint32_t>();
-
   if (dex_location_size == 0 || dex_location_size > kMaxDexFileKeyLength) {
     *error = "DexFileKey has an invalid size: " + std::to_string(dex_location_size);
     return kProfileLoadBadData;
   }
+  std::string dex_location(dex_location_size, '\0');
+  status = reader.ReadBytes(reinterpret_cast<uint8_t*>(&dex_location[0]), dex_location_size, error);
+  if (status != kProfileLoadSuccess) {
+    return status;
+  }
+  uint32_t checksum;
+  status = reader.ReadUint(&checksum, error);
+  if (status != kProfileLoadSuccess) {
+    return status;
+  }
 
-  SafeBuffer location_buffer(dex_location_size);
-  status = location_buffer.FillFromFd(fd, "ReadProfileHeaderDexLocation", error);
+  DexFileData* const data = GetOrAddDexFileData(dex_location, checksum);
+  if (data == nullptr) {
+    *error = "Error when reading profile file line";
+    return kProfileLoadBadData;
+  }
+  status = ReadMethods(reader, data, error);
   if (status != kProfileLoadSuccess) {
     return status;
   }
-  line_header->dex_location.assign(
-      reinterpret_cast<char*>(location_buffer.Get()), dex_location_size);
-  return kProfileLoadSuccess;
+  return reader.ReadDeltas(&data->class_set, error);
 }
 
-ProfileCompilationInfo::ProfileLoadSatus ProfileCompilationInfo::ReadProfileLine(
-      int fd,
-      const ProfileLineHeader& line_header,
+ProfileCompilationInfo::ProfileLoadSatus ProfileCompilationInfo::ReadMethods(
+      CompressedReader& reader,
+      /*out*/DexFileData* dex_data,
       /*out*/std::string* error) {
-  // Make sure that we don't try to read everything in memory (in case the profile if full).
-  // Split readings in chunks of at most 10kb.
-  static constexpr uint16_t kMaxNumberOfEntriesToRead = 5120;
-  uint16_t methods_left_to_read = line_header.method_set_size;
-  uint16_t classes_left_to_read = line_header.class_set_size;
-
-  while ((methods_left_to_read > 0) || (classes_left_to_read > 0)) {
-    uint16_t methods_to_read = std::min(kMaxNumberOfEntriesToRead, methods_left_to_read);
-    uint16_t max_classes_to_read = kMaxNumberOfEntriesToRead - methods_to_read;
-    uint16_t classes_to_read = std::min(max_classes_to_read, classes_left_to_read);
-
-    size_t line_size = sizeof(uint16_t) * (methods_to_read + classes_to_read);
-    SafeBuffer line_buffer(line_size);
-
-    ProfileLoadSatus status = line_buffer.FillFromFd(fd, "ReadProfileLine", error);
-    if (status != kProfileLoadSuccess) {
+  uint32_t number_of_methods;
+  ProfileLoadSatus status = reader.ReadUnsignedLeb128(&number_of_methods, error);
+  uint32_t method_idx = 0;
+  for (uint32_t i = 0; (status == kProfileLoadSuccess) && i < number_of_methods; i++) {
+    uint32_t delta;
+    uint8_t hotness;
+    uint32_t number_of_inline_caches;
+    if ((status = reader.ReadUnsignedLeb128(&delta, error)) != kProfileLoadSuccess ||
+        (status = reader.ReadUint(&hotness, error)) != kProfileLoadSuccess ||
+        (status = reader.ReadUnsignedLeb128(&number_of_inline_caches, error))
+            != kProfileLoadSuccess) {
       return status;
     }
-    if (!ProcessLine(line_buffer,
-                     methods_to_read,
-                     classes_to_read,
-                     line_header.checksum,
-                     line_header.dex_location)) {
-      *error = "Error when reading profile file line";
+    method_idx += delta;
+    if (method_idx > std::numeric_limits<uint16_t>::max() || hotness > kHotnessLast) {
+      *error = "Profile has invalid data for method " + std::to_string(method_idx);
       return kProfileLoadBadData;
     }
-    methods_left_to_read -= methods_to_read;
-    classes_left_to_read -= classes_to_read;
+
+    MethodData method_data;
+    method_data.hotness = static_cast<MethodHotness>(hotness);
+    uint32_t dex_pc = 0;
+    for (uint32_t j = 0; j < number_of_inline_caches; j++) {
+      uint8_t flags;
+      if ((status = reader.ReadUnsignedLeb128(&delta, error)) != kProfileLoadSuccess ||
+          (status = reader.ReadUint(&flags, error)) != kProfileLoadSuccess) {
+        return status;
+      }
+      dex_pc += delta;
+      InlineCacheData* cache = FindOrAdd(&method_data.inline_caches, dex_pc);
+      cache->is_megamorphic = (flags & kInlineCacheMegamorphic) != 0;
+      cache->is_missing_types = (flags & kInlineCacheMissingTypes) != 0;
+      status = reader.ReadDeltas(&cache->classes, error);
+      if (status != kProfileLoadSuccess) {
+        return status;
+      }
+    }
+    MergeMethodData(method_data, FindOrAdd(&dex_data->method_map, method_idx));
   }
-  return kProfileLoadSuccess;
+  return status;
 }
 
 bool ProfileCompilationInfo::Load(int fd) {
@@ -468,6 +817,22 @@ bool ProfileCompilationInfo::Load(int fd) {
   }
 }
 
+bool ProfileCompilationInfo::Load(int fd, /*out*/bool* is_obsolete) {
+  std::string error;
+  ProfileLoadSatus status = LoadInternal(fd, &error);
+  // The version is checked before any data is read, so nothing was merged on a mismatch.
+  *is_obsolete = (status == kProfileLoadVersionMismatch);
+  if (status == kProfileLoadSuccess) {
+    return true;
+  } else if (*is_obsolete) {
+    LOG(WARNING) << "Ignoring obsolete profile: " << error;
+    return true;
+  } else {
+    PLOG(WARNING) << "Error when reading profile " << error;
+    return false;
+  }
+}
+
 ProfileCompilationInfo::ProfileLoadSatus ProfileCompilationInfo::LoadInternal(
       int fd, std::string* error) {
   ScopedTrace trace(__PRETTY_FUNCTION__);
@@ -483,42 +848,46 @@ ProfileCompilationInfo::ProfileLoadSatus ProfileCompilationInfo::LoadInternal(
   if (stat_buffer.st_size == 0) {
     return kProfileLoadSuccess;
   }
-  // Read profile header: magic + version + number_of_lines.
-  uint16_t number_of_lines;
-  ProfileLoadSatus status = ReadProfileHeader(fd, &number_of_lines, error);
+  // Read profile header: magic + version.
+  ProfileLoadSatus status = ReadProfileHeader(fd, error);
   if (status != kProfileLoadSuccess) {
     return status;
   }
 
-  while (number_of_lines > 0) {
-    ProfileLineHeader line_header;
-    // First, read the line header to get the amount of data we need to read.
-    status = ReadProfileLineHeader(fd, &line_header, error);
+  // The rest of the file is compressed, and read a chunk at a time.
+  CompressedReader reader(fd);
+  if (!reader.Init()) {
+    *error = "Could not initialize the profile decompression";
+    return kProfileLoadIOError;
+  }
+  bool has_next = true;
+  while (has_next) {
+    uint32_t number_of_lines;
+    status = reader.ReadUnsignedLeb128(&number_of_lines, error);
     if (status != kProfileLoadSuccess) {
       return status;
     }
-
-    // Now read the actual profile line.
-    status = ReadProfileLine(fd, line_header, error);
+    while (number_of_lines > 0) {
+      status = ReadProfileLine(reader, error);
+      if (status != kProfileLoadSuccess) {
+        return status;
+      }
+      number_of_lines--;
+    }
+    status = reader.EndRecord(&has_next, error);
     if (status != kProfileLoadSuccess) {
       return status;
     }
-    number_of_lines--;
-  }
-
-  // Check that we read everything and that profiles don't contain junk data.
-  int result = testEOF(fd);
-  if (result == 0) {
-    return kProfileLoadSuccess;
-  } else if (result < 0) {
-    return kProfileLoadIOError;
-  } else {
-    *error = "Unexpected content in the profile file";
-    return kProfileLoadBadData;
   }
+  return kProfileLoadSuccess;
 }
 
 bool ProfileCompilationInfo::MergeWith(const ProfileCompilationInfo& other) {
+  return MergeWith(other, /* changes */ nullptr);
+}
+
+bool ProfileCompilationInfo::MergeWith(const ProfileCompilationInfo& other,
+                                       /*out*/ProfileCompilationInfo* changes) {
   // First verify that all checksums match. This will avoid adding garbage to
   // the current profile info.
   // Note that the number of elements should be very small, so this should not
@@ -538,10 +907,26 @@ bool ProfileCompilationInfo::MergeWith(const ProfileCompilationInfo& other) {
     if (info_it == info_.end()) {
       info_it = info_.Put(other_dex_location, DexFileData(other_dex_data.checksum));
     }
-    info_it->second.method_set.insert(other_dex_data.method_set.begin(),
-                                      other_dex_data.method_set.end());
-    info_it->second.class_set.insert(other_dex_data.class_set.begin(),
-                                     other_dex_data.class_set.end());
+    DexFileData* const dex_data = &info_it->second;
+    // The changes only ever hold data of the current object, so their checksums match too.
+    DexFileData* const changed_dex_data = (changes == nullptr)
+        ? nullptr
+        : changes->GetOrAddDexFileData(other_dex_location, other_dex_data.checksum);
+    for (const auto& method_it : other_dex_data.method_map) {
+      size_t number_of_methods = dex_data->method_map.size();
+      bool changed = MergeMethodData(method_it.second,
+                                     FindOrAdd(&dex_data->method_map, method_it.first));
+      if ((changed || number_of_methods != dex_data->method_map.size()) &&
+          changed_dex_data != nullptr) {
+        MergeMethodData(method_it.second,
+                        FindOrAdd(&changed_dex_data->method_map, method_it.first));
+      }
+    }
+    for (uint16_t class_idx : other_dex_data.class_set) {
+      if (dex_data->class_set.insert(class_idx).second && changed_dex_data != nullptr) {
+        changed_dex_data->class_set.insert(class_idx);
+      }
+    }
   }
   return true;
 }
@@ -552,12 +937,43 @@ bool ProfileCompilationInfo::ContainsMethod(const MethodReference& method_ref) c
     if (method_ref.dex_file->GetLocationChecksum() != info_it->second.checksum) {
       return false;
     }
-    const std::set<uint16_t>& methods = info_it->second.method_set;
+    const SafeMap<uint16_t, MethodData>& methods = info_it->second.method_map;
     return methods.find(method_ref.dex_method_index) != methods.end();
   }
   return false;
 }
 
+bool ProfileCompilationInfo::GetMethodHotness(const MethodReference& method_ref,
+                                              /*out*/MethodHotness* hotness) const {
+  auto info_it = info_.find(GetProfileDexFileKey(method_ref.dex_file->GetLocation()));
+  if (info_it == info_.end() ||
+      method_ref.dex_file->GetLocationChecksum() != info_it->second.checksum) {
+    return false;
+  }
+  auto method_it = info_it->second.method_map.find(method_ref.dex_method_index);
+  if (method_it == info_it->second.method_map.end()) {
+    return false;
+  }
+  *hotness = method_it->second.hotness;
+  return true;
+}
+
+const ProfileCompilationInfo::InlineCacheData* ProfileCompilationInfo::FindInlineCache(
+    const MethodReference& method_ref,
+    uint32_t dex_pc) const {
+  auto info_it = info_.find(GetProfileDexFileKey(method_ref.dex_file->GetLocation()));
+  if (info_it == info_.end() ||
+      method_ref.dex_file->GetLocationChecksum() != info_it->second.checksum) {
+    return nullptr;
+  }
+  auto method_it = info_it->second.method_map.find(method_ref.dex_method_index);
+  if (method_it == info_it->second.method_map.end()) {
+    return nullptr;
+  }
+  auto cache_it = method_it->second.inline_caches.find(dex_pc);
+  return (cache_it == method_it->second.inline_caches.end()) ? nullptr : &cache_it->second;
+}
+
 bool ProfileCompilationInfo::ContainsClass(const DexFile& dex_file, uint16_t class_def_idx) const {
   auto info_it = info_.find(GetProfileDexFileKey(dex_file.GetLocation()));
   if (info_it != info_.end()) {
@@ -573,7 +989,7 @@ bool ProfileCompilationInfo::ContainsClass(const DexFile& dex_file, uint16_t cla
 uint32_t ProfileCompilationInfo::GetNumberOfMethods() const {
   uint32_t total = 0;
   for (const auto& it : info_) {
-    total += it.second.method_set.size();
+    total += it.second.method_map.size();
   }
   return total;
 }
@@ -616,12 +1032,32 @@ std::string ProfileCompilationInfo::DumpInfo(const std::vector<const DexFile*>*
       }
     }
     os << "\n\tmethods: ";
-    for (const auto method_it : dex_data.method_set) {
+    for (const auto& method_it : dex_data.method_map) {
+      const MethodData& method_data = method_it.second;
       if (dex_file != nullptr) {
-        os << "\n\t\t" << PrettyMethod(method_it, *dex_file, true);
+        os << "\n\t\t" << PrettyMethod(method_it.first, *dex_file, true);
       } else {
-        os << method_it << ",";
+        os << method_it.first;
+      }
+      os << "[hotness=" << static_cast<int>(method_data.hotness);
+      for (const auto& cache_it : method_data.inline_caches) {
+        const InlineCacheData& cache = cache_it.second;
+        os << " " << cache_it.first << ":";
+        if (cache.is_megamorphic) {
+          os << "megamorphic";
+        } else {
+          os << "{";
+          for (uint16_t class_idx : cache.classes) {
+            if (dex_file != nullptr) {
+              os << dex_file->StringByTypeIdx(class_idx) << ",";
+            } else {
+              os << class_idx << ",";
+            }
+          }
+          os << (cache.is_missing_types ? "...}" : "}");
+        }
       }
+      os << "]" << (dex_file != nullptr ? "" : ",");
     }
     os << "\n\tclasses: ";
     for (const auto class_it : dex_data.class_set) {
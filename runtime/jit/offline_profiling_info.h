@@ -34,22 +34,75 @@ namespace art {
  * performing profile guided compilation.
  * It is a serialize-friendly format based on information collected by the
  * interpreter (ProfileInfo).
- * Currently it stores only the hot compiled methods.
+ * It stores the profiled methods with their hotness and the receiver types of
+ * their invokes, and the classes resolved at startup.
  */
 class ProfileCompilationInfo {
  public:
   static const uint8_t kProfileMagic[];
   static const uint8_t kProfileVersion[];
 
+  // How hot a method was in the profiled runs. Merging profiles keeps the hottest.
+  enum MethodHotness : uint8_t {
+    kHotnessStartup,  // Executed during startup.
+    kHotnessWarm,     // Profiled by the JIT.
+    kHotnessHot,      // Compiled by the JIT.
+    kHotnessOsr,      // Compiled by the JIT for on-stack replacement.
+    kHotnessLast = kHotnessOsr
+  };
+
+  // Receiver types seen at an invoke, as type indices in the dex file of the calling method.
+  struct InlineCacheData {
+    InlineCacheData() : is_megamorphic(false), is_missing_types(false) {}
+
+    // Too many receiver types were seen to list them.
+    bool is_megamorphic;
+    // Some receiver types have no type index in the dex file of the calling method.
+    bool is_missing_types;
+    std::set<uint16_t> classes;
+
+    bool operator==(const InlineCacheData& other) const {
+      return is_megamorphic == other.is_megamorphic &&
+          is_missing_types == other.is_missing_types &&
+          classes == other.classes;
+    }
+  };
+
+  // Inline caches of a method, by dex pc.
+  using InlineCacheMap = SafeMap<uint32_t, InlineCacheData>;
+
+  // A method collected by the runtime, with what it knows about it.
+  struct ProfileMethodInfo {
+    ProfileMethodInfo(const DexFile* dex_file, uint32_t dex_method_index, MethodHotness hot)
+        : ref(dex_file, dex_method_index), hotness(hot) {}
+
+    MethodReference ref;
+    MethodHotness hotness;
+    InlineCacheMap inline_caches;
+  };
+
   // Add the given methods and classes to the current profile object.
   bool AddMethodsAndClasses(const std::vector<MethodReference>& methods,
                             const std::set<DexCacheResolvedClasses>& resolved_classes);
+  // Add the given methods, with their hotness and inline caches.
+  bool AddMethods(const std::vector<ProfileMethodInfo>& methods);
   // Loads profile information from the given file descriptor.
   bool Load(int fd);
+  // Same as Load, but a file which does not hold a profile of the current version is loaded as
+  // an empty profile, in which case `is_obsolete` is set to true.
+  bool Load(int fd, /*out*/bool* is_obsolete);
   // Merge the data from another ProfileCompilationInfo into the current object.
   bool MergeWith(const ProfileCompilationInfo& info);
+  // Merge the data from another ProfileCompilationInfo into the current object, and the part
+  // of it the current object did not have yet into `changes`.
+  bool MergeWith(const ProfileCompilationInfo& info, /*out*/ProfileCompilationInfo* changes);
   // Saves the profile data to the given file descriptor.
   bool Save(int fd);
+  // Appends the profile data to the given file as a record that loading the file merges with
+  // the records before it, and sets `bytes_written` to the size of the record. Returns false
+  // if the file is locked or does not hold a profile of the current version, in which case
+  // MergeAndSave should rewrite it.
+  bool AppendToFile(const std::string& filename, uint64_t* bytes_written);
   // Loads and merges profile information from the given file into the current
   // object and tries to save it back to disk.
   // If `force` is true then the save will go through even if the given file
@@ -65,6 +118,14 @@ class ProfileCompilationInfo {
   // Returns true if the method reference is present in the profiling info.
   bool ContainsMethod(const MethodReference& method_ref) const;
 
+  // Returns true and sets `hotness` if the method reference is present in the profiling info.
+  bool GetMethodHotness(const MethodReference& method_ref, /*out*/MethodHotness* hotness) const;
+
+  // Returns the inline cache of the invoke at `dex_pc` in the given method, or null if the
+  // profile has none.
+  const InlineCacheData* FindInlineCache(const MethodReference& method_ref,
+                                         uint32_t dex_pc) const;
+
   // Returns true if the class is present in the profiling info.
   bool ContainsClass(const DexFile& dex_file, uint16_t class_def_idx) const;
 
@@ -95,33 +156,48 @@ class ProfileCompilationInfo {
     kProfileLoadSuccess
   };
 
+  struct MethodData {
+    MethodData() : hotness(kHotnessStartup) {}
+
+    MethodHotness hotness;
+    InlineCacheMap inline_caches;
+
+    bool operator==(const MethodData& other) const {
+      return hotness == other.hotness && inline_caches == other.inline_caches;
+    }
+  };
+
   struct DexFileData {
     explicit DexFileData(uint32_t location_checksum) : checksum(location_checksum) {}
     uint32_t checksum;
-    std::set<uint16_t> method_set;
+    SafeMap<uint16_t, MethodData> method_map;
     std::set<uint16_t> class_set;
 
     bool operator==(const DexFileData& other) const {
-      return checksum == other.checksum && method_set == other.method_set;
+      return checksum == other.checksum && method_map == other.method_map;
     }
   };
 
   using DexFileToProfileInfoMap = SafeMap<const std::string, DexFileData>;
 
+  // Reads the compressed body of a profile file a chunk at a time, so that loading a profile
+  // never needs the whole file in memory.
+  class CompressedReader;
+  // Compresses the body of a profile file as it is written.
+  class CompressedWriter;
+
   DexFileData* GetOrAddDexFileData(const std::string& dex_location, uint32_t checksum);
-  bool AddMethodIndex(const std::string& dex_location, uint32_t checksum, uint16_t method_idx);
+  bool AddMethodIndex(const std::string& dex_location,
+                      uint32_t checksum,
+                      uint16_t method_idx,
+                      MethodHotness hotness = kHotnessStartup);
   bool AddClassIndex(const std::string& dex_location, uint32_t checksum, uint16_t class_idx);
   bool AddResolvedClasses(const DexCacheResolvedClasses& classes);
+  // Merges `other` into `data`, and returns whether `data` changed.
+  static bool MergeMethodData(const MethodData& other, MethodData* data);
 
   // Parsing functionality.
 
-  struct ProfileLineHeader {
-    std::string dex_location;
-    uint16_t method_set_size;
-    uint16_t class_set_size;
-    uint32_t checksum;
-  };
-
   // A helper structure to make sure we don't read past our buffers in the loops.
   struct SafeBuffer {
    public:
@@ -135,10 +211,6 @@ class ProfileCompilationInfo {
                                 const std::string& source,
                                 /*out*/std::string* error);
 
-    // Reads an uint value (high bits to low bits) and advances the current pointer
-    // with the number of bits read.
-    template <typename T> T ReadUintAndAdvance();
-
     // Compares the given data with the content current pointer. If the contents are
     // equal it advances the current pointer by data_size.
     bool CompareAndAdvance(const uint8_t* data, size_t data_size);
@@ -154,22 +226,27 @@ class ProfileCompilationInfo {
 
   ProfileLoadSatus LoadInternal(int fd, std::string* error);
 
-  ProfileLoadSatus ReadProfileHeader(int fd,
-                                     /*out*/uint16_t* number_of_lines,
-                                     /*out*/std::string* error);
-
-  ProfileLoadSatus ReadProfileLineHeader(int fd,
-                                         /*out*/ProfileLineHeader* line_header,
-                                         /*out*/std::string* error);
-  ProfileLoadSatus ReadProfileLine(int fd,
-                                   const ProfileLineHeader& line_header,
-                                   /*out*/std::string* error);
-
-  bool ProcessLine(SafeBuffer& line_buffer,
-                   uint16_t method_set_size,
-                   uint16_t class_set_size,
-                   uint32_t checksum,
-                   const std::string& dex_location);
+  // Writes the profile data, without the magic and version, as one compressed record.
+  bool SaveRecord(int fd);
+
+  // Reads the uncompressed magic and version of the profile.
+  ProfileLoadSatus ReadProfileHeader(int fd, /*out*/std::string* error);
+
+  // Reads the records following the header and merges them in the current object.
+  ProfileLoadSatus ReadProfileRecords(int fd, /*out*/std::string* error);
+
+  // Reads the data of one dex file and merges it in the current object.
+  ProfileLoadSatus ReadProfileLine(CompressedReader& reader, /*out*/std::string* error);
+
+  // Reads the methods of a dex file, and their data.
+  ProfileLoadSatus ReadMethods(CompressedReader& reader,
+                               /*out*/DexFileData* dex_data,
+                               /*out*/std::string* error);
+
+  // Appends the data of one dex file to `buffer`.
+  static void AddLineToBuffer(const std::string& dex_location,
+                              const DexFileData& dex_data,
+                              /*out*/std::vector<uint8_t>* buffer);
 
   friend class ProfileCompilationInfoTest;
   friend class CompilerDriverProfileTest;
@@ -0,0 +1,589 @@
+/*
+ * Copyright (C) 2016 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "persistent_code_cache.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <zlib.h>
+
+#include <algorithm>
+#include <cstring>
+#include <unordered_set>
+
+#include "arch/instruction_set.h"
+#include "art_method-inl.h"
+#include "base/bit_utils.h"
+#include "base/systrace.h"
+#include "base/unix_file/fd_file.h"
+#include "class_linker.h"
+#include "dex_file.h"
+#include "gc/heap.h"
+#include "gc/space/image_space.h"
+#include "jit/jit_code_cache.h"
+#include "jit/profiling_info.h"
+#include "mirror/array-inl.h"
+#include "mirror/class_loader.h"
+#include "mirror/object-inl.h"
+#include "mirror/object_array-inl.h"
+#include "native/dalvik_system_DexFile.h"
+#include "oat_quick_method_header.h"
+#include "os.h"
+#include "runtime.h"
+#include "scoped_thread_state_change.h"
+#include "stack_map.h"
+#include "thread.h"
+#include "utils.h"
+#include "well_known_classes.h"
+
+namespace art {
+namespace jit {
+
+static const uint8_t kPersistentCodeCacheMagic[] = { 'p', 'j', 'c', '\0' };
+static const uint8_t kPersistentCodeCacheVersion[] = { '0', '0', '2', '\0' };
+
+// Sections of the file are padded to this alignment, so that they can be read in place.
+static constexpr size_t kSectionAlignment = 4;
+
+// Class loader index of the dex files of the boot class path.
+static constexpr uint32_t kBootClassLoaderIndex = 0xFFFFFFFFu;
+
+struct PersistentCodeCacheHeader {
+  uint8_t magic[4];
+  uint8_t version[4];
+  uint32_t instruction_set;
+  uint32_t boot_image_checksum;
+  uint32_t compiler_options_checksum;
+  uint32_t number_of_class_loaders;
+  uint32_t number_of_dex_files;
+  uint32_t number_of_methods;
+  // Checksum of everything after the header.
+  uint32_t data_checksum;
+};
+
+// Followed by the location of the dex file, padded.
+struct SavedDexFileHeader {
+  uint32_t location_checksum;
+  uint32_t class_loader_index;
+  uint32_t location_size;
+};
+
+struct PersistentCodeCache::SavedMethod {
+  uint32_t dex_file_index;
+  uint32_t method_index;
+  uint32_t frame_size_in_bytes;
+  uint32_t core_spill_mask;
+  uint32_t fp_spill_mask;
+  uint32_t code_info_size;
+  uint32_t code_size;
+
+  // The code info and the code follow the saved method, each padded.
+  const uint8_t* GetCodeInfo() const {
+    return reinterpret_cast<const uint8_t*>(this + 1);
+  }
+
+  const uint8_t* GetCode() const {
+    return GetCodeInfo() + RoundUp(code_info_size, kSectionAlignment);
+  }
+
+  size_t SizeWithData() const {
+    return sizeof(*this) +
+        RoundUp(code_info_size, kSectionAlignment) +
+        RoundUp(code_size, kSectionAlignment);
+  }
+};
+
+// The code only works with the boot image it was compiled against.
+static uint32_t ComputeBootImageChecksum() {
+  uint32_t checksum = adler32(0L, Z_NULL, 0);
+  for (gc::space::ImageSpace* space : Runtime::Current()->GetHeap()->GetBootImageSpaces()) {
+    uint32_t oat_checksum = space->GetImageHeader().GetOatChecksum();
+    checksum = adler32(checksum,
+                       reinterpret_cast<const Bytef*>(&oat_checksum),
+                       sizeof(oat_checksum));
+  }
+  return checksum;
+}
+
+// The code depends on the instruction set features and the debuggability given to the compiler.
+static uint32_t ComputeCompilerOptionsChecksum() {
+  Runtime* runtime = Runtime::Current();
+  std::string options = Join(runtime->GetCompilerOptions(), ' ');
+  options += runtime->IsDebuggable() ? " debuggable" : "";
+  return adler32(adler32(0L, Z_NULL, 0),
+                 reinterpret_cast<const Bytef*>(options.data()),
+                 options.size());
+}
+
+// Appends the dex files of `class_loader` and of its parents to `dex_files`. Returns false for
+// class loaders which are not a BaseDexClassLoader, as their dex files cannot be listed.
+static bool GetClassLoaderDexFiles(ScopedObjectAccessAlreadyRunnable& soa,
+                                   mirror::ClassLoader* class_loader,
+                                   std::vector<const DexFile*>* dex_files)
+    SHARED_REQUIRES(Locks::mutator_lock_) {
+  mirror::Class* base_dex_class_loader_class =
+      soa.Decode<mirror::Class*>(WellKnownClasses::dalvik_system_PathClassLoader)->GetSuperClass();
+  ArtField* const path_list_field =
+      soa.DecodeField(WellKnownClasses::dalvik_system_PathClassLoader_pathList);
+  ArtField* const dex_elements_field =
+      soa.DecodeField(WellKnownClasses::dalvik_system_DexPathList_dexElements);
+  ArtField* const dex_file_field =
+      soa.DecodeField(WellKnownClasses::dalvik_system_DexPathList__Element_dexFile);
+  ArtField* const cookie_field = soa.DecodeField(WellKnownClasses::dalvik_system_DexFile_cookie);
+  for (; !ClassLinker::IsBootClassLoader(soa, class_loader);
+       class_loader = class_loader->GetParent()) {
+    if (!base_dex_class_loader_class->IsAssignableFrom(class_loader->GetClass())) {
+      return false;
+    }
+    mirror::Object* dex_path_list = path_list_field->GetObject(class_loader);
+    if (dex_path_list == nullptr) {
+      continue;
+    }
+    mirror::Object* dex_elements_obj = dex_elements_field->GetObject(dex_path_list);
+    if (dex_elements_obj == nullptr) {
+      continue;
+    }
+    mirror::ObjectArray<mirror::Object>* dex_elements =
+        dex_elements_obj->AsObjectArray<mirror::Object>();
+    for (int32_t i = 0; i < dex_elements->GetLength(); ++i) {
+      mirror::Object* element = dex_elements->GetWithoutChecks(i);
+      if (element == nullptr) {
+        continue;
+      }
+      mirror::Object* dex_file = dex_file_field->GetObject(element);
+      if (dex_file == nullptr) {
+        continue;
+      }
+      mirror::Object* cookie = cookie_field->GetObject(dex_file);
+      if (cookie == nullptr) {
+        continue;
+      }
+      mirror::LongArray* long_array = cookie->AsLongArray();
+      for (int32_t j = kDexFileIndexStart; j < long_array->GetLength(); ++j) {
+        dex_files->push_back(reinterpret_cast<const DexFile*>(
+            static_cast<uintptr_t>(long_array->GetWithoutChecks(j))));
+      }
+    }
+  }
+  return true;
+}
+
+static void AppendPadded(std::vector<uint8_t>* buffer, const void* data, size_t size) {
+  const uint8_t* bytes = reinterpret_cast<const uint8_t*>(data);
+  buffer->insert(buffer->end(), bytes, bytes + size);
+  buffer->resize(RoundUp(buffer->size(), kSectionAlignment), 0u);
+}
+
+PersistentCodeCache::PersistentCodeCache(const std::string& filename)
+    : filename_(filename),
+      lock_("JIT persistent code cache lock"),
+      save_lock_("JIT persistent code cache save lock", kJitPersistentCodeCacheSaveLock),
+      number_of_saved_methods_(0),
+      number_of_installed_methods_(0),
+      number_of_dex_file_mismatches_(0),
+      number_of_methods_last_saved_(0) {}
+
+PersistentCodeCache* PersistentCodeCache::Create(const std::string& filename) {
+  std::unique_ptr<PersistentCodeCache> cache(new PersistentCodeCache(filename));
+  std::string error_msg;
+  if (!cache->Load(&error_msg)) {
+    VLOG(jit) << "Not using saved JIT code from " << filename << ": " << error_msg;
+  }
+  return cache.release();
+}
+
+bool PersistentCodeCache::Load(std::string* error_msg) {
+  ScopedTrace trace(__PRETTY_FUNCTION__);
+  std::unique_ptr<File> file(OS::OpenFileForReading(filename_.c_str()));
+  if (file == nullptr) {
+    *error_msg = "no such file";
+    return false;
+  }
+  int64_t length = file->GetLength();
+  if (length < static_cast<int64_t>(sizeof(PersistentCodeCacheHeader))) {
+    *error_msg = "file too short";
+    return false;
+  }
+  std::unique_ptr<MemMap> map(MemMap::MapFile(static_cast<size_t>(length),
+                                              PROT_READ,
+                                              MAP_PRIVATE,
+                                              file->Fd(),
+                                              /* start */ 0,
+                                              /* low_4gb */ false,
+                                              filename_.c_str(),
+                                              error_msg));
+  if (map == nullptr) {
+    return false;
+  }
+
+  const uint8_t* begin = map->Begin();
+  const uint8_t* end = map->End();
+  const PersistentCodeCacheHeader* header =
+      reinterpret_cast<const PersistentCodeCacheHeader*>(begin);
+  if (memcmp(header->magic, kPersistentCodeCacheMagic, sizeof(header->magic)) != 0 ||
+      memcmp(header->version, kPersistentCodeCacheVersion, sizeof(header->version)) != 0) {
+    *error_msg = "unknown file format";
+    return false;
+  }
+  if (header->instruction_set != static_cast<uint32_t>(kRuntimeISA) ||
+      header->boot_image_checksum != ComputeBootImageChecksum() ||
+      header->compiler_options_checksum != ComputeCompilerOptionsChecksum()) {
+    *error_msg = "the code was compiled for another boot image or compiler configuration";
+    return false;
+  }
+  const uint8_t* data = begin + sizeof(PersistentCodeCacheHeader);
+  if (adler32(adler32(0L, Z_NULL, 0), data, end - data) != header->data_checksum) {
+    *error_msg = "corrupted file";
+    return false;
+  }
+
+  std::vector<SavedDexFile*> dex_files;
+  std::unordered_map<std::string, SavedDexFile> saved_dex_files;
+  for (uint32_t i = 0; i < header->number_of_dex_files; ++i) {
+    const SavedDexFileHeader* dex_file_header = reinterpret_cast<const SavedDexFileHeader*>(data);
+    if (static_cast<size_t>(end - data) < sizeof(SavedDexFileHeader) ||
+        static_cast<size_t>(end - data) <
+            sizeof(SavedDexFileHeader) + dex_file_header->location_size) {
+      *error_msg = "truncated dex file entry";
+      return false;
+    }
+    if (dex_file_header->class_loader_index != kBootClassLoaderIndex &&
+        dex_file_header->class_loader_index >= header->number_of_class_loaders) {
+      *error_msg = "invalid class loader index";
+      return false;
+    }
+    std::string location(reinterpret_cast<const char*>(dex_file_header + 1),
+                         dex_file_header->location_size);
+    if (saved_dex_files.find(location) != saved_dex_files.end()) {
+      *error_msg = "duplicate dex file " + location;
+      return false;
+    }
+    SavedDexFile* saved_dex_file = &saved_dex_files[location];
+    saved_dex_file->location_checksum = dex_file_header->location_checksum;
+    saved_dex_file->class_loader_index = dex_file_header->class_loader_index;
+    dex_files.push_back(saved_dex_file);
+    data += RoundUp(sizeof(SavedDexFileHeader) + dex_file_header->location_size,
+                    kSectionAlignment);
+  }
+  for (uint32_t i = 0; i < header->number_of_methods; ++i) {
+    const SavedMethod* saved_method = reinterpret_cast<const SavedMethod*>(data);
+    if (static_cast<size_t>(end - data) < sizeof(SavedMethod) ||
+        static_cast<size_t>(end - data) < saved_method->SizeWithData() ||
+        saved_method->dex_file_index >= dex_files.size()) {
+      *error_msg = "truncated method entry";
+      return false;
+    }
+    dex_files[saved_method->dex_file_index]->methods.emplace(saved_method->method_index,
+                                                             saved_method);
+    data += saved_method->SizeWithData();
+  }
+
+  MutexLock mu(Thread::Current(), lock_);
+  map_ = std::move(map);
+  saved_dex_files_ = std::move(saved_dex_files);
+  validated_class_loaders_.assign(header->number_of_class_loaders, false);
+  number_of_saved_methods_ = header->number_of_methods;
+  VLOG(jit) << "Loaded " << number_of_saved_methods_ << " saved JIT methods from " << filename_;
+  return true;
+}
+
+void PersistentCodeCache::DropSavedCode(const std::string& reason) {
+  VLOG(jit) << "Dropping saved JIT code from " << filename_ << ": " << reason;
+  ++number_of_dex_file_mismatches_;
+  // Keep the file mapped, Install copies the code of a saved method without holding the lock.
+  saved_dex_files_.clear();
+}
+
+bool PersistentCodeCache::ValidateClassLoader(mirror::ClassLoader* class_loader,
+                                              uint32_t class_loader_index,
+                                              std::string* error_msg) {
+  ScopedObjectAccessUnchecked soa(Thread::Current());
+  std::vector<const DexFile*> dex_files;
+  if (!GetClassLoaderDexFiles(soa, class_loader, &dex_files)) {
+    *error_msg = "unsupported class loader " + PrettyClass(class_loader->GetClass());
+    return false;
+  }
+  // The code may depend on any dex file of the class loader, so they must all be the same as when
+  // the code was saved.
+  size_t number_of_saved_dex_files = 0;
+  for (const auto& it : saved_dex_files_) {
+    if (it.second.class_loader_index == class_loader_index) {
+      ++number_of_saved_dex_files;
+    }
+  }
+  if (dex_files.size() != number_of_saved_dex_files) {
+    *error_msg = "the class loader has " + std::to_string(dex_files.size()) +
+        " dex files instead of " + std::to_string(number_of_saved_dex_files);
+    return false;
+  }
+  for (const DexFile* dex_file : dex_files) {
+    auto it = saved_dex_files_.find(dex_file->GetLocation());
+    if (it == saved_dex_files_.end() ||
+        it->second.class_loader_index != class_loader_index ||
+        it->second.location_checksum != dex_file->GetLocationChecksum()) {
+      *error_msg = "the code was compiled for another version of " + dex_file->GetLocation();
+      return false;
+    }
+  }
+  return true;
+}
+
+const PersistentCodeCache::SavedMethod* PersistentCodeCache::FindSavedMethod(ArtMethod* method) {
+  if (saved_dex_files_.empty()) {
+    return nullptr;
+  }
+  // Dex files are looked up by location rather than cached by pointer, as a dex file may be
+  // unloaded and another one take its place.
+  const DexFile* dex_file = method->GetDexFile();
+  auto it = saved_dex_files_.find(dex_file->GetLocation());
+  if (it == saved_dex_files_.end()) {
+    return nullptr;
+  }
+  uint32_t class_loader_index = it->second.class_loader_index;
+  if (class_loader_index == kBootClassLoaderIndex) {
+    // The rest of the boot class path is covered by the boot image checksum.
+    if (it->second.location_checksum != dex_file->GetLocationChecksum()) {
+      DropSavedCode("the code was compiled for another version of " + dex_file->GetLocation());
+      return nullptr;
+    }
+  } else if (!validated_class_loaders_[class_loader_index]) {
+    std::string error_msg;
+    if (!ValidateClassLoader(method->GetDeclaringClass()->GetClassLoader(),
+                             class_loader_index,
+                             &error_msg)) {
+      DropSavedCode(error_msg);
+      return nullptr;
+    }
+    validated_class_loaders_[class_loader_index] = true;
+  }
+  auto method_it = it->second.methods.find(method->GetDexMethodIndex());
+  return (method_it == it->second.methods.end()) ? nullptr : method_it->second;
+}
+
+bool PersistentCodeCache::Install(Thread* self, JitCodeCache* code_cache, ArtMethod* method) {
+  const SavedMethod* saved_method = nullptr;
+  {
+    MutexLock mu(self, lock_);
+    saved_method = FindSavedMethod(method);
+  }
+  if (saved_method == nullptr) {
+    return false;
+  }
+
+  // Like compiled code, installed code needs a ProfilingInfo to be kept by collections.
+  if (method->GetProfilingInfo(sizeof(void*)) == nullptr &&
+      !ProfilingInfo::Create(self, method, /* retry_allocation */ false)) {
+    return false;
+  }
+  if (!code_cache->NotifyCompilationOf(method, self, /* osr */ false)) {
+    return false;
+  }
+  bool success = false;
+  uint8_t* code_info = code_cache->ReserveData(self, saved_method->code_info_size, method);
+  if (code_info != nullptr) {
+    memcpy(code_info, saved_method->GetCodeInfo(), saved_method->code_info_size);
+    const uint8_t* code = code_cache->CommitCode(self,
+                                                 method,
+                                                 code_info,
+                                                 saved_method->frame_size_in_bytes,
+                                                 saved_method->core_spill_mask,
+                                                 saved_method->fp_spill_mask,
+                                                 saved_method->GetCode(),
+                                                 saved_method->code_size,
+                                                 /* osr */ false,
+                                                 /* baseline */ false);
+    if (code == nullptr) {
+      code_cache->ClearData(self, code_info);
+    } else {
+      success = true;
+    }
+  }
+  code_cache->DoneCompiling(method, self, /* osr */ false);
+  if (success) {
+    VLOG(jit) << "Installed saved JIT code of " << PrettyMethod(method);
+    MutexLock mu(self, lock_);
+    ++number_of_installed_methods_;
+  }
+  return success;
+}
+
+void PersistentCodeCache::AddSavedDexFile(const DexFile* dex_file,
+                                          uint32_t class_loader_index,
+                                          std::vector<uint8_t>* dex_files_data,
+                                          std::unordered_map<const DexFile*, uint32_t>* indices) {
+  indices->emplace(dex_file, indices->size());
+  SavedDexFileHeader dex_file_header;
+  dex_file_header.location_checksum = dex_file->GetLocationChecksum();
+  dex_file_header.class_loader_index = class_loader_index;
+  dex_file_header.location_size = dex_file->GetLocation().size();
+  dex_files_data->insert(dex_files_data->end(),
+                         reinterpret_cast<const uint8_t*>(&dex_file_header),
+                         reinterpret_cast<const uint8_t*>(&dex_file_header + 1));
+  AppendPadded(dex_files_data, dex_file->GetLocation().data(), dex_file_header.location_size);
+}
+
+bool PersistentCodeCache::Save(Thread* self, JitCodeCache* code_cache) {
+  ScopedTrace trace(__PRETTY_FUNCTION__);
+  // Saves run at shutdown and from a JIT thread when the process state changes.
+  MutexLock save_mu(self, save_lock_);
+  ScopedObjectAccessUnchecked soa(self);
+  std::vector<uint8_t> dex_files_data;
+  std::vector<uint8_t> methods_data;
+  std::unordered_map<const DexFile*, uint32_t> dex_file_indices;
+  // Locations of the saved dex files, a location can only be saved once.
+  std::unordered_set<std::string> locations;
+  // Class loaders whose dex files were looked at, and whether they were saved.
+  std::unordered_map<mirror::ClassLoader*, bool> class_loaders;
+  uint32_t number_of_class_loaders = 0;
+  uint32_t number_of_methods = 0;
+  {
+    MutexLock mu(self, code_cache->lock_);
+    for (const auto& it : code_cache->method_code_map_) {
+      const void* code_ptr = it.first;
+      ArtMethod* method = it.second;
+      const OatQuickMethodHeader* method_header = OatQuickMethodHeader::FromCodePointer(code_ptr);
+      // Hooks are installed again by each run, and proxies get their own ArtMethods. Baseline code
+      // is only saved once it has been replaced by optimized code.
+      if (method->IsXposedHookedMethod() ||
+          method->IsXposedOriginalMethod() ||
+          method->IsProxyMethod() ||
+          !method_header->IsOptimized() ||
+          code_cache->baseline_code_.find(code_ptr) != code_cache->baseline_code_.end()) {
+        continue;
+      }
+      // Only save the code the method uses, OSR code and code replaced in the meantime is not
+      // entered at the start of the method.
+      const void* entry_point = method->GetEntryPointFromQuickCompiledCode();
+      ProfilingInfo* info = code_cache->GetProfilingInfoLocked(method);
+      if (entry_point != method_header->GetEntryPoint() &&
+          (info == nullptr || info->GetSavedEntryPoint() != method_header->GetEntryPoint())) {
+        continue;
+      }
+      const DexFile* dex_file = method->GetDexFile();
+      if (dex_file->GetLocation().empty()) {
+        continue;
+      }
+      auto index_it = dex_file_indices.find(dex_file);
+      if (index_it == dex_file_indices.end()) {
+        mirror::ClassLoader* class_loader = method->GetDeclaringClass()->GetClassLoader();
+        if (ClassLinker::IsBootClassLoader(soa, class_loader)) {
+          if (!locations.insert(dex_file->GetLocation()).second) {
+            continue;
+          }
+          AddSavedDexFile(dex_file, kBootClassLoaderIndex, &dex_files_data, &dex_file_indices);
+        } else if (class_loaders.find(class_loader) == class_loaders.end()) {
+          // Record all the dex files of the class loader, so that the next run can check that
+          // none of them changed.
+          std::vector<const DexFile*> dex_files;
+          bool saved = GetClassLoaderDexFiles(soa, class_loader, &dex_files) &&
+              std::none_of(dex_files.begin(), dex_files.end(), [&](const DexFile* other) {
+                return other->GetLocation().empty() || locations.count(other->GetLocation()) != 0;
+              });
+          class_loaders.emplace(class_loader, saved);
+          if (saved) {
+            for (const DexFile* d : dex_files) {
+              locations.insert(d->GetLocation());
+              AddSavedDexFile(d, number_of_class_loaders, &dex_files_data, &dex_file_indices);
+            }
+            ++number_of_class_loaders;
+          }
+        }
+        index_it = dex_file_indices.find(dex_file);
+        if (index_it == dex_file_indices.end()) {
+          continue;
+        }
+      }
+      const void* code_info = method_header->GetOptimizedCodeInfoPtr();
+      CodeInfoEncoding encoding(code_info);
+      QuickMethodFrameInfo frame_info = method_header->GetFrameInfo();
+      SavedMethod saved_method;
+      saved_method.dex_file_index = index_it->second;
+      saved_method.method_index = method->GetDexMethodIndex();
+      saved_method.frame_size_in_bytes = frame_info.FrameSizeInBytes();
+      saved_method.core_spill_mask = frame_info.CoreSpillMask();
+      saved_method.fp_spill_mask = frame_info.FpSpillMask();
+      saved_method.code_info_size = encoding.header_size + encoding.non_header_size;
+      saved_method.code_size = method_header->GetCodeSize();
+      methods_data.insert(methods_data.end(),
+                          reinterpret_cast<const uint8_t*>(&saved_method),
+                          reinterpret_cast<const uint8_t*>(&saved_method + 1));
+      AppendPadded(&methods_data, code_info, saved_method.code_info_size);
+      AppendPadded(&methods_data, method_header->GetCode(), saved_method.code_size);
+      ++number_of_methods;
+    }
+  }
+
+  PersistentCodeCacheHeader header;
+  memcpy(header.magic, kPersistentCodeCacheMagic, sizeof(header.magic));
+  memcpy(header.version, kPersistentCodeCacheVersion, sizeof(header.version));
+  header.instruction_set = static_cast<uint32_t>(kRuntimeISA);
+  header.boot_image_checksum = ComputeBootImageChecksum();
+  header.compiler_options_checksum = ComputeCompilerOptionsChecksum();
+  header.number_of_class_loaders = number_of_class_loaders;
+  header.number_of_dex_files = dex_file_indices.size();
+  header.number_of_methods = number_of_methods;
+  uint32_t data_checksum = adler32(0L, Z_NULL, 0);
+  data_checksum = adler32(data_checksum, dex_files_data.data(), dex_files_data.size());
+  data_checksum = adler32(data_checksum, methods_data.data(), methods_data.size());
+  header.data_checksum = data_checksum;
+
+  // Write a new file and rename it, so that a process reading the old one keeps a valid mapping
+  // and a crash does not leave a partial file behind. Other processes of the application may
+  // save to the same file, so the temporary file has a unique name.
+  std::string temp_filename = filename_ + ".XXXXXX";
+  int fd = mkstemp(&temp_filename[0]);
+  if (fd == -1) {
+    PLOG(WARNING) << "Could not create " << temp_filename;
+    return false;
+  }
+  std::unique_ptr<File> file(new File(fd, temp_filename, /* check_usage */ true));
+  if (!file->WriteFully(&header, sizeof(header)) ||
+      !file->WriteFully(dex_files_data.data(), dex_files_data.size()) ||
+      !file->WriteFully(methods_data.data(), methods_data.size())) {
+    PLOG(WARNING) << "Could not write saved JIT code to " << temp_filename;
+    file->Erase();
+    unlink(temp_filename.c_str());
+    return false;
+  }
+  if (file->FlushCloseOrErase() != 0) {
+    PLOG(WARNING) << "Could not flush saved JIT code to " << temp_filename;
+    unlink(temp_filename.c_str());
+    return false;
+  }
+  if (rename(temp_filename.c_str(), filename_.c_str()) != 0) {
+    PLOG(WARNING) << "Could not rename " << temp_filename << " to " << filename_;
+    unlink(temp_filename.c_str());
+    return false;
+  }
+  VLOG(jit) << "Saved " << number_of_methods << " JIT methods to " << filename_;
+  MutexLock mu(self, lock_);
+  number_of_methods_last_saved_ = number_of_methods;
+  return true;
+}
+
+void PersistentCodeCache::Dump(std::ostream& os) {
+  MutexLock mu(Thread::Current(), lock_);
+  os << "JIT persistent code cache: file=" << filename_
+     << " saved methods loaded=" << number_of_saved_methods_
+     << " installed=" << number_of_installed_methods_
+     << " dex file mismatches=" << number_of_dex_file_mismatches_
+     << " last saved=" << number_of_methods_last_saved_ << "\n";
+}
+
+}  // namespace jit
+}  // namespace art
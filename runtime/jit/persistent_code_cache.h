@@ -0,0 +1,125 @@
+/*
+ * Copyright (C) 2016 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ART_RUNTIME_JIT_PERSISTENT_CODE_CACHE_H_
+#define ART_RUNTIME_JIT_PERSISTENT_CODE_CACHE_H_
+
+#include <memory>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "base/macros.h"
+#include "base/mutex.h"
+#include "mem_map.h"
+
+namespace art {
+
+class ArtMethod;
+class DexFile;
+class Thread;
+
+namespace mirror {
+class ClassLoader;
+}  // namespace mirror
+
+namespace jit {
+
+class JitCodeCache;
+
+// Compiled code of the JIT saved to a file, so that the methods which were hot in a previous run
+// of the application start executing compiled code right away.
+//
+// The file is keyed by the boot image checksum and the compiler options. It records the location
+// checksums of all the dex files of the class loaders of the saved methods, and all the saved code
+// is dropped if any of them changed. Saved code must not depend on the process it was compiled in,
+// so the compiler neither embeds addresses nor relies on the resolution and initialization state
+// of the process when the persistent code cache is used.
+class PersistentCodeCache {
+ public:
+  // Maps and validates `filename`. A missing, obsolete or corrupted file leaves the cache empty,
+  // and is replaced by the next Save.
+  static PersistentCodeCache* Create(const std::string& filename);
+
+  // Installs the saved code of `method` in `code_cache`. Returns false if there is none, or if
+  // it was compiled for another version of the dex file of the method.
+  bool Install(Thread* self, JitCodeCache* code_cache, ArtMethod* method)
+      SHARED_REQUIRES(Locks::mutator_lock_)
+      REQUIRES(!lock_);
+
+  // Saves the code currently used by the methods of `code_cache`, except OSR code.
+  bool Save(Thread* self, JitCodeCache* code_cache)
+      SHARED_REQUIRES(Locks::mutator_lock_)
+      REQUIRES(!lock_, !save_lock_);
+
+  void Dump(std::ostream& os) REQUIRES(!lock_);
+
+ private:
+  struct SavedMethod;
+  struct SavedDexFile {
+    uint32_t location_checksum;
+    uint32_t class_loader_index;
+    std::unordered_map<uint32_t, const SavedMethod*> methods;
+  };
+
+  explicit PersistentCodeCache(const std::string& filename);
+
+  bool Load(std::string* error_msg) REQUIRES(!lock_);
+
+  const SavedMethod* FindSavedMethod(ArtMethod* method)
+      SHARED_REQUIRES(Locks::mutator_lock_)
+      REQUIRES(lock_);
+
+  // Returns whether the dex files of `class_loader` are the ones saved with `class_loader_index`.
+  bool ValidateClassLoader(mirror::ClassLoader* class_loader,
+                           uint32_t class_loader_index,
+                           std::string* error_msg)
+      SHARED_REQUIRES(Locks::mutator_lock_)
+      REQUIRES(lock_);
+
+  // Stops installing saved code, the file is replaced by the next Save.
+  void DropSavedCode(const std::string& reason) REQUIRES(lock_);
+
+  static void AddSavedDexFile(const DexFile* dex_file,
+                              uint32_t class_loader_index,
+                              std::vector<uint8_t>* dex_files_data,
+                              std::unordered_map<const DexFile*, uint32_t>* indices);
+
+  const std::string filename_;
+  Mutex lock_ DEFAULT_MUTEX_ACQUIRED_AFTER;
+  // Serializes the saves.
+  Mutex save_lock_ ACQUIRED_BEFORE(lock_);
+  // The mapped file, null if there was no valid file.
+  std::unique_ptr<MemMap> map_ GUARDED_BY(lock_);
+  // Saved methods by dex location.
+  std::unordered_map<std::string, SavedDexFile> saved_dex_files_ GUARDED_BY(lock_);
+  // Whether the dex files of each saved class loader were checked against the loaded ones.
+  std::vector<bool> validated_class_loaders_ GUARDED_BY(lock_);
+  size_t number_of_saved_methods_ GUARDED_BY(lock_);
+  size_t number_of_installed_methods_ GUARDED_BY(lock_);
+  size_t number_of_dex_file_mismatches_ GUARDED_BY(lock_);
+  size_t number_of_methods_last_saved_ GUARDED_BY(lock_);
+
+  friend class PersistentCodeCacheTest;
+
+  DISALLOW_COPY_AND_ASSIGN(PersistentCodeCache);
+};
+
+}  // namespace jit
+}  // namespace art
+
+#endif  // ART_RUNTIME_JIT_PERSISTENT_CODE_CACHE_H_
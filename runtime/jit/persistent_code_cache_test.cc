@@ -0,0 +1,275 @@
+/*
+ * Copyright (C) 2016 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <sstream>
+
+#include "base/unix_file/fd_file.h"
+#include "class_linker-inl.h"
+#include "common_runtime_test.h"
+#include "dex_file.h"
+#include "jit/jit_code_cache.h"
+#include "jit/persistent_code_cache.h"
+#include "mirror/class-inl.h"
+#include "mirror/class_loader.h"
+#include "os.h"
+#include "scoped_thread_state_change.h"
+#include "utils.h"
+
+namespace art {
+namespace jit {
+
+// Offsets in the header of the file.
+static constexpr size_t kMagicOffset = 0;
+static constexpr size_t kVersionOffset = 4;
+static constexpr size_t kInstructionSetOffset = 8;
+static constexpr size_t kDataChecksumOffset = 32;
+static constexpr size_t kHeaderSize = 36;
+
+class PersistentCodeCacheTest : public CommonRuntimeTest {
+ protected:
+  void SetUp() OVERRIDE {
+    CommonRuntimeTest::SetUp();
+    std::string error_msg;
+    code_cache_.reset(JitCodeCache::Create(1 * MB, 1 * MB, /* generate_debug_info */ false,
+                                           &error_msg));
+    ASSERT_TRUE(code_cache_ != nullptr) << error_msg;
+  }
+
+  void TearDown() OVERRIDE {
+    code_cache_.reset();
+    CommonRuntimeTest::TearDown();
+  }
+
+  // Saves the (empty) code cache to `filename` and returns the content of the file.
+  std::string SaveEmptyCache(const std::string& filename) {
+    std::unique_ptr<PersistentCodeCache> cache(PersistentCodeCache::Create(filename));
+    Thread* self = Thread::Current();
+    ScopedObjectAccess soa(self);
+    EXPECT_TRUE(cache->Save(self, code_cache_.get()));
+    std::string content;
+    EXPECT_TRUE(ReadFileToString(filename, &content));
+    return content;
+  }
+
+  static void WriteFile(const std::string& filename, const std::string& content) {
+    std::unique_ptr<File> file(OS::CreateEmptyFile(filename.c_str()));
+    ASSERT_TRUE(file != nullptr);
+    ASSERT_TRUE(file->WriteFully(content.data(), content.size()));
+    ASSERT_EQ(0, file->FlushCloseOrErase());
+  }
+
+  // Returns a cache which did not load any file.
+  static PersistentCodeCache* CreateEmpty(const std::string& filename) {
+    return new PersistentCodeCache(filename);
+  }
+
+  static bool Load(const std::string& filename, std::string* error_msg) {
+    std::unique_ptr<PersistentCodeCache> cache(CreateEmpty(filename));
+    return cache->Load(error_msg);
+  }
+
+  // Records `dex_files` as saved with `class_loader_index`.
+  static void AddSavedDexFiles(PersistentCodeCache* cache,
+                               const std::vector<const DexFile*>& dex_files,
+                               uint32_t class_loader_index) NO_THREAD_SAFETY_ANALYSIS {
+    for (const DexFile* dex_file : dex_files) {
+      PersistentCodeCache::SavedDexFile* saved_dex_file =
+          &cache->saved_dex_files_[dex_file->GetLocation()];
+      saved_dex_file->location_checksum = dex_file->GetLocationChecksum();
+      saved_dex_file->class_loader_index = class_loader_index;
+    }
+    cache->validated_class_loaders_.resize(class_loader_index + 1, false);
+  }
+
+  static bool ValidateClassLoader(PersistentCodeCache* cache,
+                                  jobject class_loader,
+                                  uint32_t class_loader_index) NO_THREAD_SAFETY_ANALYSIS {
+    Thread* self = Thread::Current();
+    ScopedObjectAccess soa(self);
+    MutexLock mu(self, cache->lock_);
+    std::string error_msg;
+    return cache->ValidateClassLoader(soa.Decode<mirror::ClassLoader*>(class_loader),
+                                      class_loader_index,
+                                      &error_msg);
+  }
+
+  static void ChangeSavedChecksum(PersistentCodeCache* cache, const DexFile* dex_file)
+      NO_THREAD_SAFETY_ANALYSIS {
+    cache->saved_dex_files_[dex_file->GetLocation()].location_checksum ^= 1;
+  }
+
+  static size_t NumberOfSavedDexFiles(PersistentCodeCache* cache) NO_THREAD_SAFETY_ANALYSIS {
+    return cache->saved_dex_files_.size();
+  }
+
+  static bool FindSavedMethod(PersistentCodeCache* cache, ArtMethod* method)
+      NO_THREAD_SAFETY_ANALYSIS {
+    MutexLock mu(Thread::Current(), cache->lock_);
+    return cache->FindSavedMethod(method) != nullptr;
+  }
+
+  std::unique_ptr<JitCodeCache> code_cache_;
+};
+
+TEST_F(PersistentCodeCacheTest, SaveAndLoad) {
+  ScratchFile file;
+  std::string content = SaveEmptyCache(file.GetFilename());
+  ASSERT_EQ(kHeaderSize, content.size());
+  EXPECT_EQ(0, memcmp(content.data() + kMagicOffset, "pjc", 4));
+
+  std::string error_msg;
+  EXPECT_TRUE(Load(file.GetFilename(), &error_msg)) << error_msg;
+
+  std::unique_ptr<PersistentCodeCache> cache(PersistentCodeCache::Create(file.GetFilename()));
+  std::ostringstream oss;
+  cache->Dump(oss);
+  EXPECT_NE(std::string::npos, oss.str().find("saved methods loaded=0"));
+}
+
+TEST_F(PersistentCodeCacheTest, RejectsInvalidFiles) {
+  ScratchFile file;
+  const std::string content = SaveEmptyCache(file.GetFilename());
+  ASSERT_EQ(kHeaderSize, content.size());
+  std::string error_msg;
+
+  // Missing file.
+  EXPECT_FALSE(Load(file.GetFilename() + ".missing", &error_msg));
+
+  // Truncated header.
+  WriteFile(file.GetFilename(), content.substr(0, kHeaderSize - 1));
+  EXPECT_FALSE(Load(file.GetFilename(), &error_msg));
+  EXPECT_EQ("file too short", error_msg);
+
+  // Wrong magic.
+  std::string modified = content;
+  modified[kMagicOffset] = 'x';
+  WriteFile(file.GetFilename(), modified);
+  EXPECT_FALSE(Load(file.GetFilename(), &error_msg));
+  EXPECT_EQ("unknown file format", error_msg);
+
+  // Older version of the format.
+  modified = content;
+  modified[kVersionOffset + 2] = '1';
+  WriteFile(file.GetFilename(), modified);
+  EXPECT_FALSE(Load(file.GetFilename(), &error_msg));
+  EXPECT_EQ("unknown file format", error_msg);
+
+  // Another instruction set.
+  modified = content;
+  modified[kInstructionSetOffset] ^= 0x7f;
+  WriteFile(file.GetFilename(), modified);
+  EXPECT_FALSE(Load(file.GetFilename(), &error_msg));
+  EXPECT_NE(std::string::npos, error_msg.find("compiler configuration"));
+
+  // Data which does not match the checksum.
+  modified = content + std::string(4, '\0');
+  WriteFile(file.GetFilename(), modified);
+  EXPECT_FALSE(Load(file.GetFilename(), &error_msg));
+  EXPECT_EQ("corrupted file", error_msg);
+  modified = content;
+  modified[kDataChecksumOffset] ^= 1;
+  WriteFile(file.GetFilename(), modified);
+  EXPECT_FALSE(Load(file.GetFilename(), &error_msg));
+  EXPECT_EQ("corrupted file", error_msg);
+
+  // The original file is still valid.
+  WriteFile(file.GetFilename(), content);
+  EXPECT_TRUE(Load(file.GetFilename(), &error_msg)) << error_msg;
+}
+
+TEST_F(PersistentCodeCacheTest, InvalidFileFallsBackToJit) {
+  ScratchFile file;
+  WriteFile(file.GetFilename(), "not a persistent code cache file");
+  std::unique_ptr<PersistentCodeCache> cache(PersistentCodeCache::Create(file.GetFilename()));
+  ASSERT_TRUE(cache != nullptr);
+
+  Thread* self = Thread::Current();
+  ScopedObjectAccess soa(self);
+  ClassLinker* class_linker = Runtime::Current()->GetClassLinker();
+  mirror::Class* klass = class_linker->FindSystemClass(self, "Ljava/lang/Object;");
+  ASSERT_TRUE(klass != nullptr);
+  ArtMethod* method =
+      klass->FindDeclaredVirtualMethodByName("hashCode", class_linker->GetImagePointerSize());
+  ASSERT_TRUE(method != nullptr);
+  EXPECT_FALSE(cache->Install(self, code_cache_.get(), method));
+
+  // The next save replaces the invalid file.
+  EXPECT_TRUE(cache->Save(self, code_cache_.get()));
+  std::string error_msg;
+  EXPECT_TRUE(Load(file.GetFilename(), &error_msg)) << error_msg;
+}
+
+TEST_F(PersistentCodeCacheTest, ValidatesAllDexFilesOfClassLoader) {
+  jobject class_loader;
+  {
+    ScopedObjectAccess soa(Thread::Current());
+    class_loader = LoadDex("MultiDex");
+  }
+  std::vector<const DexFile*> dex_files = GetDexFiles(class_loader);
+  ASSERT_EQ(2u, dex_files.size());
+  ScratchFile file;
+
+  // Same dex files.
+  {
+    std::unique_ptr<PersistentCodeCache> cache(CreateEmpty(file.GetFilename()));
+    AddSavedDexFiles(cache.get(), dex_files, 0);
+    EXPECT_TRUE(ValidateClassLoader(cache.get(), class_loader, 0));
+  }
+
+  // A dex file of the class loader which is not saved.
+  {
+    std::unique_ptr<PersistentCodeCache> cache(CreateEmpty(file.GetFilename()));
+    AddSavedDexFiles(cache.get(), { dex_files[0] }, 0);
+    EXPECT_FALSE(ValidateClassLoader(cache.get(), class_loader, 0));
+  }
+
+  // A dex file saved with another class loader.
+  {
+    std::unique_ptr<PersistentCodeCache> cache(CreateEmpty(file.GetFilename()));
+    AddSavedDexFiles(cache.get(), { dex_files[0] }, 0);
+    AddSavedDexFiles(cache.get(), { dex_files[1] }, 1);
+    EXPECT_FALSE(ValidateClassLoader(cache.get(), class_loader, 0));
+  }
+
+  // The secondary dex file changed: no saved code is used anymore, including the one of the
+  // unchanged primary dex file.
+  {
+    std::unique_ptr<PersistentCodeCache> cache(CreateEmpty(file.GetFilename()));
+    AddSavedDexFiles(cache.get(), dex_files, 0);
+    ChangeSavedChecksum(cache.get(), dex_files[1]);
+    EXPECT_FALSE(ValidateClassLoader(cache.get(), class_loader, 0));
+
+    Thread* self = Thread::Current();
+    ScopedObjectAccess soa(self);
+    StackHandleScope<1> hs(self);
+    Handle<mirror::ClassLoader> h_loader(
+        hs.NewHandle(soa.Decode<mirror::ClassLoader*>(class_loader)));
+    mirror::Class* klass = Runtime::Current()->GetClassLinker()->FindClass(
+        self, "LMain;", h_loader);
+    ASSERT_TRUE(klass != nullptr);
+    ASSERT_EQ(dex_files[0], &klass->GetDexFile());
+    ArtMethod* method = klass->FindDeclaredDirectMethodByName(
+        "main", Runtime::Current()->GetClassLinker()->GetImagePointerSize());
+    ASSERT_TRUE(method != nullptr);
+    EXPECT_FALSE(FindSavedMethod(cache.get(), method));
+    EXPECT_EQ(0u, NumberOfSavedDexFiles(cache.get()));
+  }
+}
+
+}  // namespace jit
+}  // namespace art
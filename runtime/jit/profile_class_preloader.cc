@@ -0,0 +1,356 @@
+/*
+ * Copyright (C) 2016 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "profile_class_preloader.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <set>
+
+#include "base/scoped_flock.h"
+#include "base/systrace.h"
+#include "base/time_utils.h"
+#include "class_linker.h"
+#include "class_table.h"
+#include "dex_cache_resolved_classes.h"
+#include "dex_file.h"
+#include "handle_scope-inl.h"
+#include "jit/offline_profiling_info.h"
+#include "mirror/class-inl.h"
+#include "mirror/class_loader.h"
+#include "mirror/dex_cache.h"
+#include "mirror/iftable-inl.h"
+#include "runtime.h"
+#include "scoped_thread_state_change.h"
+#include "thread.h"
+#include "utils.h"
+
+namespace art {
+
+// The preloader pauses once it has worked for this long, so that it does not keep the locks of the
+// class linker, nor a core, from the main thread for long.
+static constexpr uint64_t kMaxWorkTimeBetweenPausesNs = MsToNs(2);
+static constexpr useconds_t kPauseTimeUs = 500;
+
+ProfileClassPreloader* ProfileClassPreloader::instance_ = nullptr;
+pthread_t ProfileClassPreloader::preloader_pthread_ = 0U;
+
+ProfileClassPreloader::ProfileClassPreloader(const std::string& profile_filename,
+                                             const std::vector<std::string>& code_paths)
+    : profile_filename_(profile_filename),
+      code_paths_(code_paths),
+      shutting_down_(false),
+      total_time_ns_(0),
+      total_number_of_profiled_classes_(0),
+      total_number_of_resolved_classes_(0),
+      total_number_of_initialized_classes_(0),
+      total_number_of_failed_classes_(0),
+      total_number_of_pauses_(0) {}
+
+void ProfileClassPreloader::Start(const std::string& profile_filename,
+                                  const std::vector<std::string>& code_paths) {
+  DCHECK(!profile_filename.empty());
+  MutexLock mu(Thread::Current(), *Locks::profiler_lock_);
+  if (instance_ != nullptr) {
+    // Classes are only preloaded for the first application registered with the runtime.
+    return;
+  }
+  VLOG(profiler) << "Starting class preloader using profile " << profile_filename;
+  instance_ = new ProfileClassPreloader(profile_filename, code_paths);
+  CHECK_PTHREAD_CALL(
+      pthread_create,
+      (&preloader_pthread_, nullptr, &RunPreloaderThread, reinterpret_cast<void*>(instance_)),
+      "Profile class preloader thread");
+}
+
+void ProfileClassPreloader::Stop() {
+  ProfileClassPreloader* preloader = nullptr;
+  pthread_t preloader_pthread = 0U;
+  {
+    MutexLock mu(Thread::Current(), *Locks::profiler_lock_);
+    if (instance_ == nullptr || instance_->shutting_down_) {
+      return;
+    }
+    preloader = instance_;
+    preloader_pthread = preloader_pthread_;
+    instance_->shutting_down_ = true;
+  }
+
+  // The preloader checks for shutdown before each class.
+  CHECK_PTHREAD_CALL(pthread_join, (preloader_pthread, nullptr), "class preloader thread shutdown");
+
+  {
+    MutexLock mu(Thread::Current(), *Locks::profiler_lock_);
+    instance_ = nullptr;
+    preloader_pthread_ = 0U;
+  }
+  delete preloader;
+}
+
+bool ProfileClassPreloader::IsStarted() {
+  MutexLock mu(Thread::Current(), *Locks::profiler_lock_);
+  return instance_ != nullptr;
+}
+
+bool ProfileClassPreloader::ShuttingDown(Thread* self) {
+  MutexLock mu(self, *Locks::profiler_lock_);
+  return shutting_down_;
+}
+
+void* ProfileClassPreloader::RunPreloaderThread(void* arg) {
+  Runtime* runtime = Runtime::Current();
+  bool attached = runtime->AttachCurrentThread("Class Preloader",
+                                               /*as_daemon*/true,
+                                               runtime->GetSystemThreadGroup(),
+                                               /*create_peer*/true);
+  if (!attached) {
+    CHECK(runtime->IsShuttingDown(Thread::Current()));
+    return nullptr;
+  }
+
+  ProfileClassPreloader* preloader = reinterpret_cast<ProfileClassPreloader*>(arg);
+  preloader->Run();
+
+  runtime->DetachCurrentThread();
+  VLOG(profiler) << "Class preloader done";
+  return nullptr;
+}
+
+// Finds the class loader which registered a dex cache.
+class FindClassLoaderOfDexCacheVisitor : public ClassLoaderVisitor {
+ public:
+  explicit FindClassLoaderOfDexCacheVisitor(mirror::DexCache* dex_cache)
+      : dex_cache_(dex_cache), class_loader_(nullptr) {}
+
+  void Visit(mirror::ClassLoader* class_loader)
+      SHARED_REQUIRES(Locks::classlinker_classes_lock_, Locks::mutator_lock_) OVERRIDE {
+    ClassTable* const class_table = class_loader->GetClassTable();
+    if (class_loader_ == nullptr &&
+        class_table != nullptr &&
+        class_table->ContainsStrongRoot(dex_cache_)) {
+      class_loader_ = class_loader;
+    }
+  }
+
+  mirror::ClassLoader* GetClassLoader() const {
+    return class_loader_;
+  }
+
+ private:
+  mirror::DexCache* const dex_cache_;
+  mirror::ClassLoader* class_loader_;
+};
+
+void ProfileClassPreloader::Run() {
+  ScopedTrace trace(__PRETTY_FUNCTION__);
+  Thread* const self = Thread::Current();
+  const uint64_t start_time = NanoTime();
+
+  ProfileCompilationInfo info;
+  {
+    ScopedFlock flock;
+    std::string error;
+    if (!flock.Init(profile_filename_.c_str(),
+                    O_RDONLY | O_NOFOLLOW | O_CLOEXEC,
+                    /* block */ true,
+                    &error)) {
+      LOG(WARNING) << "Couldn't lock the profile file " << profile_filename_ << ": " << error;
+      return;
+    }
+    if (!info.Load(flock.GetFile()->Fd())) {
+      LOG(WARNING) << "Could not load the profile file " << profile_filename_;
+      return;
+    }
+  }
+  std::set<DexCacheResolvedClasses> profiled_classes = info.GetResolvedClasses();
+  if (profiled_classes.empty()) {
+    VLOG(profiler) << "No class to preload from " << profile_filename_;
+    return;
+  }
+
+  ClassLinker* const class_linker = Runtime::Current()->GetClassLinker();
+  ScopedObjectAccess soa(self);
+
+  // Match the profiled dex files with the loaded ones. The dex files of the application are
+  // never unloaded, so they can be used after the dex lock is released.
+  std::vector<std::pair<const DexFile*, const DexCacheResolvedClasses*>> dex_files;
+  {
+    ReaderMutexLock mu(self, *class_linker->DexLock());
+    for (const ClassLinker::DexCacheData& data : class_linker->GetDexCachesData()) {
+      if (self->IsJWeakCleared(data.weak_root)) {
+        continue;
+      }
+      const DexFile* dex_file = data.dex_file;
+      if (std::find(code_paths_.begin(), code_paths_.end(), dex_file->GetBaseLocation()) ==
+          code_paths_.end()) {
+        continue;
+      }
+      DexCacheResolvedClasses key(
+          ProfileCompilationInfo::GetProfileDexFileKey(dex_file->GetLocation()),
+          ProfileCompilationInfo::GetProfileDexFileKey(dex_file->GetBaseLocation()),
+          dex_file->GetLocationChecksum());
+      auto it = profiled_classes.find(key);
+      if (it != profiled_classes.end()) {
+        dex_files.emplace_back(dex_file, &*it);
+      }
+    }
+  }
+
+  for (const auto& it : dex_files) {
+    const DexFile& dex_file = *it.first;
+    StackHandleScope<2> hs(self);
+    Handle<mirror::DexCache> dex_cache(
+        hs.NewHandle(class_linker->FindDexCache(self, dex_file, /* allow_failure */ true)));
+    if (dex_cache.Get() == nullptr) {
+      continue;
+    }
+    MutableHandle<mirror::ClassLoader> class_loader(hs.NewHandle<mirror::ClassLoader>(nullptr));
+    {
+      ReaderMutexLock mu(self, *Locks::classlinker_classes_lock_);
+      FindClassLoaderOfDexCacheVisitor visitor(dex_cache.Get());
+      class_linker->VisitClassLoaders(&visitor);
+      class_loader.Assign(visitor.GetClassLoader());
+    }
+    if (class_loader.Get() == nullptr) {
+      VLOG(profiler) << "No class loader for " << dex_file.GetLocation();
+      continue;
+    }
+    // The profile only keeps which classes were resolved, take them in class definition order,
+    // which puts the classes of a package together.
+    std::vector<uint16_t> class_def_indices(it.second->GetClasses().begin(),
+                                            it.second->GetClasses().end());
+    std::sort(class_def_indices.begin(), class_def_indices.end());
+    PreloadClasses(self, dex_file, dex_cache, class_loader, class_def_indices);
+    if (ShuttingDown(self)) {
+      break;
+    }
+  }
+
+  MutexLock mu(self, *Locks::profiler_lock_);
+  total_time_ns_ = NanoTime() - start_time;
+  VLOG(profiler) << "Class preloader resolved " << total_number_of_resolved_classes_ << " of "
+                 << total_number_of_profiled_classes_ << " profiled classes in "
+                 << PrettyDuration(total_time_ns_);
+}
+
+void ProfileClassPreloader::PreloadClasses(Thread* self,
+                                           const DexFile& dex_file,
+                                           Handle<mirror::DexCache> dex_cache,
+                                           Handle<mirror::ClassLoader> class_loader,
+                                           const std::vector<uint16_t>& class_def_indices) {
+  ClassLinker* const class_linker = Runtime::Current()->GetClassLinker();
+  uint32_t resolved = 0;
+  uint32_t initialized = 0;
+  uint32_t failed = 0;
+  uint32_t pauses = 0;
+  uint64_t work_start_time = NanoTime();
+  for (uint16_t class_def_idx : class_def_indices) {
+    if (ShuttingDown(self)) {
+      break;
+    }
+    if (class_def_idx >= dex_file.NumClassDefs()) {
+      // The profile does not match the dex file.
+      ++failed;
+      continue;
+    }
+    const DexFile::ClassDef& class_def = dex_file.GetClassDef(class_def_idx);
+    StackHandleScope<1> hs(self);
+    Handle<mirror::Class> klass(hs.NewHandle(
+        class_linker->ResolveType(dex_file, class_def.class_idx_, dex_cache, class_loader)));
+    if (klass.Get() == nullptr) {
+      // The main thread gets the same error if it needs the class.
+      self->ClearException();
+      ++failed;
+    } else {
+      ++resolved;
+      if (klass->IsInitialized()) {
+        // The main thread was first.
+      } else if (CanInitializeWithoutCode(klass.Get())) {
+        if (class_linker->EnsureInitialized(self, klass, true, true)) {
+          ++initialized;
+        } else {
+          self->ClearException();
+          ++failed;
+        }
+      } else {
+        // Initialization is left to the main thread, the verification is done here.
+        class_linker->VerifyClass(self, klass);
+        if (self->IsExceptionPending()) {
+          self->ClearException();
+          ++failed;
+        }
+      }
+    }
+    if (NanoTime() - work_start_time > kMaxWorkTimeBetweenPausesNs) {
+      ScopedThreadSuspension sts(self, kSuspended);
+      usleep(kPauseTimeUs);
+      ++pauses;
+      work_start_time = NanoTime();
+    }
+  }
+
+  MutexLock mu(self, *Locks::profiler_lock_);
+  total_number_of_profiled_classes_ += class_def_indices.size();
+  total_number_of_resolved_classes_ += resolved;
+  total_number_of_initialized_classes_ += initialized;
+  total_number_of_failed_classes_ += failed;
+  total_number_of_pauses_ += pauses;
+}
+
+bool ProfileClassPreloader::CanInitializeWithoutCode(mirror::Class* klass) {
+  const size_t pointer_size = Runtime::Current()->GetClassLinker()->GetImagePointerSize();
+  // EnsureInitialized initializes the superclasses and the interfaces with default methods.
+  for (mirror::Class* k = klass; k != nullptr; k = k->GetSuperClass()) {
+    if (k->IsInitialized()) {
+      break;
+    }
+    if (k->FindClassInitializer(pointer_size) != nullptr) {
+      return false;
+    }
+  }
+  mirror::IfTable* iftable = klass->GetIfTable();
+  for (int32_t i = 0, count = klass->GetIfTableCount(); i < count; ++i) {
+    mirror::Class* iface = iftable->GetInterface(i);
+    if (!iface->IsInitialized() && iface->FindClassInitializer(pointer_size) != nullptr) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void ProfileClassPreloader::DumpInstanceInfo(std::ostream& os) {
+  MutexLock mu(Thread::Current(), *Locks::profiler_lock_);
+  if (instance_ != nullptr) {
+    instance_->DumpInfo(os);
+  }
+}
+
+void ProfileClassPreloader::DumpInfo(std::ostream& os) {
+  os << "ProfileClassPreloader total_ms_of_work=" << NsToMs(total_time_ns_) << '\n'
+     << "ProfileClassPreloader total_number_of_profiled_classes="
+     << total_number_of_profiled_classes_ << '\n'
+     << "ProfileClassPreloader total_number_of_resolved_classes="
+     << total_number_of_resolved_classes_ << '\n'
+     << "ProfileClassPreloader total_number_of_initialized_classes="
+     << total_number_of_initialized_classes_ << '\n'
+     << "ProfileClassPreloader total_number_of_failed_classes="
+     << total_number_of_failed_classes_ << '\n'
+     << "ProfileClassPreloader total_number_of_pauses=" << total_number_of_pauses_ << '\n';
+}
+
+}  // namespace art
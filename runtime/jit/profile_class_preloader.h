@@ -0,0 +1,104 @@
+/*
+ * Copyright (C) 2016 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ART_RUNTIME_JIT_PROFILE_CLASS_PRELOADER_H_
+#define ART_RUNTIME_JIT_PROFILE_CLASS_PRELOADER_H_
+
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "base/macros.h"
+#include "base/mutex.h"
+#include "handle.h"
+
+namespace art {
+
+namespace mirror {
+class Class;
+class ClassLoader;
+class DexCache;
+}  // namespace mirror
+
+class DexFile;
+
+// Loads the classes the profile saver recorded on previous launches of the application, on a
+// background thread, so that they are ready when the main thread needs them. Classes are resolved
+// and verified. They are also initialized when no class initializer would run, as running one on
+// another thread could change the behavior of the application.
+class ProfileClassPreloader {
+ public:
+  // Starts preloading the classes of `code_paths` recorded in `profile_filename`, unless the
+  // preloader has already been started.
+  static void Start(const std::string& profile_filename,
+                    const std::vector<std::string>& code_paths)
+      REQUIRES(!Locks::profiler_lock_);
+
+  // Stops the preloader thread, if it is still running.
+  static void Stop() REQUIRES(!Locks::profiler_lock_);
+
+  static bool IsStarted() REQUIRES(!Locks::profiler_lock_);
+
+  // If the preloader was started, dumps statistics to `os`. Otherwise it does nothing.
+  static void DumpInstanceInfo(std::ostream& os) REQUIRES(!Locks::profiler_lock_);
+
+ private:
+  ProfileClassPreloader(const std::string& profile_filename,
+                        const std::vector<std::string>& code_paths);
+
+  static void* RunPreloaderThread(void* arg) REQUIRES(!Locks::profiler_lock_);
+
+  void Run() REQUIRES(!Locks::profiler_lock_);
+
+  // Resolves the classes `class_def_indices` of `dex_file`, in that order.
+  void PreloadClasses(Thread* self,
+                      const DexFile& dex_file,
+                      Handle<mirror::DexCache> dex_cache,
+                      Handle<mirror::ClassLoader> class_loader,
+                      const std::vector<uint16_t>& class_def_indices)
+      REQUIRES(!Locks::profiler_lock_)
+      SHARED_REQUIRES(Locks::mutator_lock_);
+
+  // Returns whether initializing `klass` runs no class initializer.
+  static bool CanInitializeWithoutCode(mirror::Class* klass)
+      SHARED_REQUIRES(Locks::mutator_lock_);
+
+  bool ShuttingDown(Thread* self) REQUIRES(!Locks::profiler_lock_);
+
+  void DumpInfo(std::ostream& os) REQUIRES(Locks::profiler_lock_);
+
+  // The only instance of the preloader.
+  static ProfileClassPreloader* instance_ GUARDED_BY(Locks::profiler_lock_);
+  static pthread_t preloader_pthread_ GUARDED_BY(Locks::profiler_lock_);
+
+  const std::string profile_filename_;
+  const std::vector<std::string> code_paths_;
+  bool shutting_down_ GUARDED_BY(Locks::profiler_lock_);
+
+  // Statistics, updated by the preloader thread.
+  uint64_t total_time_ns_ GUARDED_BY(Locks::profiler_lock_);
+  uint32_t total_number_of_profiled_classes_ GUARDED_BY(Locks::profiler_lock_);
+  uint32_t total_number_of_resolved_classes_ GUARDED_BY(Locks::profiler_lock_);
+  uint32_t total_number_of_initialized_classes_ GUARDED_BY(Locks::profiler_lock_);
+  uint32_t total_number_of_failed_classes_ GUARDED_BY(Locks::profiler_lock_);
+  uint32_t total_number_of_pauses_ GUARDED_BY(Locks::profiler_lock_);
+
+  DISALLOW_COPY_AND_ASSIGN(ProfileClassPreloader);
+};
+
+}  // namespace art
+
+#endif  // ART_RUNTIME_JIT_PROFILE_CLASS_PRELOADER_H_
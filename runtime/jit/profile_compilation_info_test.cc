@@ -15,6 +15,7 @@
  */
 
 #include <gtest/gtest.h>
+#include <zlib.h>
 
 #include "base/unix_file/fd_file.h"
 #include "art_method-inl.h"
@@ -64,6 +65,44 @@ class ProfileCompilationInfoTest : public CommonRuntimeTest {
     return info->AddMethodIndex(dex_location, checksum, class_index);
   }
 
+  bool AddMethodWithInlineCache(const std::string& dex_location,
+                                uint32_t checksum,
+                                uint16_t method_index,
+                                ProfileCompilationInfo::MethodHotness hotness,
+                                uint32_t dex_pc,
+                                const std::set<uint16_t>& classes,
+                                ProfileCompilationInfo* info) {
+    ProfileCompilationInfo::InlineCacheData cache;
+    cache.classes = classes;
+    ProfileCompilationInfo::MethodData method_data;
+    method_data.hotness = hotness;
+    method_data.inline_caches.Put(dex_pc, cache);
+    ProfileCompilationInfo::DexFileData dex_data(checksum);
+    dex_data.method_map.Put(method_index, method_data);
+    ProfileCompilationInfo other;
+    other.info_.Put(dex_location, dex_data);
+    return info->MergeWith(other);
+  }
+
+  const ProfileCompilationInfo::MethodData* GetMethodData(const ProfileCompilationInfo& info,
+                                                          const std::string& dex_location,
+                                                          uint16_t method_index) {
+    auto info_it = info.info_.find(dex_location);
+    if (info_it == info.info_.end()) {
+      return nullptr;
+    }
+    auto method_it = info_it->second.method_map.find(method_index);
+    return (method_it == info_it->second.method_map.end()) ? nullptr : &method_it->second;
+  }
+
+  // Writes the body of a profile the way ProfileCompilationInfo::Save compresses it.
+  void WriteCompressedBody(ScratchFile& profile, const std::vector<uint8_t>& body) {
+    uLongf compressed_size = compressBound(body.size());
+    std::vector<uint8_t> compressed(compressed_size);
+    ASSERT_EQ(Z_OK, compress(compressed.data(), &compressed_size, body.data(), body.size()));
+    ASSERT_TRUE(profile.GetFile()->WriteFully(compressed.data(), compressed_size));
+  }
+
   uint32_t GetFd(const ScratchFile& file) {
     return static_cast<uint32_t>(file.GetFd());
   }
@@ -273,8 +312,7 @@ TEST_F(ProfileCompilationInfoTest, Incomplete) {
   ASSERT_TRUE(profile.GetFile()->WriteFully(
       ProfileCompilationInfo::kProfileVersion, kProfileVersionSize));
   // Write that we have at least one line.
-  uint8_t line_number[] = { 0, 1 };
-  ASSERT_TRUE(profile.GetFile()->WriteFully(line_number, sizeof(line_number)));
+  WriteCompressedBody(profile, { 1 });
   ASSERT_EQ(0, profile.GetFile()->Flush());
 
   ProfileCompilationInfo loaded_info;
@@ -288,14 +326,9 @@ TEST_F(ProfileCompilationInfoTest, TooLongDexLocation) {
       ProfileCompilationInfo::kProfileMagic, kProfileMagicSize));
   ASSERT_TRUE(profile.GetFile()->WriteFully(
       ProfileCompilationInfo::kProfileVersion, kProfileVersionSize));
-  // Write that we have at least one line.
-  uint8_t line_number[] = { 0, 1 };
-  ASSERT_TRUE(profile.GetFile()->WriteFully(line_number, sizeof(line_number)));
-
-  // dex_location_size, methods_size, classes_size, checksum.
+  // Write that we have one line, starting with the dex_location_size.
   // Dex location size is too big and should be rejected.
-  uint8_t line[] = { 255, 255, 0, 1, 0, 1, 0, 0, 0, 0 };
-  ASSERT_TRUE(profile.GetFile()->WriteFully(line, sizeof(line)));
+  WriteCompressedBody(profile, { 1, 255, 255, 3 });
   ASSERT_EQ(0, profile.GetFile()->Flush());
 
   ProfileCompilationInfo loaded_info;
@@ -324,4 +357,157 @@ TEST_F(ProfileCompilationInfoTest, UnexpectedContent) {
   ASSERT_FALSE(loaded_info.Load(GetFd(profile)));
 }
 
+TEST_F(ProfileCompilationInfoTest, SaveHotnessAndInlineCaches) {
+  ScratchFile profile;
+
+  ProfileCompilationInfo saved_info;
+  for (uint16_t i = 0; i < 10; i++) {
+    ASSERT_TRUE(AddMethodWithInlineCache("dex_location1",
+                                         /* checksum */ 1,
+                                         /* method_idx */ i * 1000,
+                                         ProfileCompilationInfo::kHotnessHot,
+                                         /* dex_pc */ i,
+                                         /* classes */ { 0, 100, 60000 },
+                                         &saved_info));
+    ASSERT_TRUE(AddMethod("dex_location2", /* checksum */ 2, /* method_idx */ i, &saved_info));
+  }
+  ASSERT_TRUE(saved_info.Save(GetFd(profile)));
+  ASSERT_EQ(0, profile.GetFile()->Flush());
+
+  // Check that we get back what we saved.
+  ProfileCompilationInfo loaded_info;
+  ASSERT_TRUE(profile.GetFile()->ResetOffset());
+  ASSERT_TRUE(loaded_info.Load(GetFd(profile)));
+  ASSERT_TRUE(loaded_info.Equals(saved_info));
+
+  const auto* method_data = GetMethodData(loaded_info, "dex_location1", /* method_idx */ 9000);
+  ASSERT_TRUE(method_data != nullptr);
+  ASSERT_EQ(ProfileCompilationInfo::kHotnessHot, method_data->hotness);
+  auto cache_it = method_data->inline_caches.find(/* dex_pc */ 9);
+  ASSERT_TRUE(cache_it != method_data->inline_caches.end());
+  ASSERT_EQ(std::set<uint16_t>({ 0, 100, 60000 }), cache_it->second.classes);
+  ASSERT_FALSE(cache_it->second.is_megamorphic);
+}
+
+TEST_F(ProfileCompilationInfoTest, MergeHotnessAndInlineCaches) {
+  ProfileCompilationInfo info;
+  ASSERT_TRUE(AddMethodWithInlineCache("dex_location",
+                                       /* checksum */ 1,
+                                       /* method_idx */ 1,
+                                       ProfileCompilationInfo::kHotnessOsr,
+                                       /* dex_pc */ 3,
+                                       /* classes */ { 1, 2, 3 },
+                                       &info));
+  ASSERT_TRUE(AddMethod("dex_location", /* checksum */ 1, /* method_idx */ 1, &info));
+  ASSERT_TRUE(AddMethodWithInlineCache("dex_location",
+                                       /* checksum */ 1,
+                                       /* method_idx */ 1,
+                                       ProfileCompilationInfo::kHotnessWarm,
+                                       /* dex_pc */ 3,
+                                       /* classes */ { 3, 4 },
+                                       &info));
+
+  // The hottest hotness and all types seen are kept.
+  const auto* method_data = GetMethodData(info, "dex_location", /* method_idx */ 1);
+  ASSERT_TRUE(method_data != nullptr);
+  ASSERT_EQ(ProfileCompilationInfo::kHotnessOsr, method_data->hotness);
+  ASSERT_EQ(std::set<uint16_t>({ 1, 2, 3, 4 }), method_data->inline_caches.Get(3).classes);
+
+  // Too many types make the inline cache megamorphic.
+  ASSERT_TRUE(AddMethodWithInlineCache("dex_location",
+                                       /* checksum */ 1,
+                                       /* method_idx */ 1,
+                                       ProfileCompilationInfo::kHotnessWarm,
+                                       /* dex_pc */ 3,
+                                       /* classes */ { 5, 6 },
+                                       &info));
+  method_data = GetMethodData(info, "dex_location", /* method_idx */ 1);
+  ASSERT_TRUE(method_data->inline_caches.Get(3).is_megamorphic);
+  ASSERT_TRUE(method_data->inline_caches.Get(3).classes.empty());
+}
+
+TEST_F(ProfileCompilationInfoTest, AppendToFile) {
+  ScratchFile profile;
+
+  ProfileCompilationInfo info1;
+  for (uint16_t i = 0; i < 10; i++) {
+    ASSERT_TRUE(AddMethod("dex_location1", /* checksum */ 1, /* method_idx */ i, &info1));
+  }
+  uint64_t bytes_written;
+  ASSERT_TRUE(info1.AppendToFile(profile.GetFilename(), &bytes_written));
+  ASSERT_GT(bytes_written, 0u);
+
+  ProfileCompilationInfo info2;
+  for (uint16_t i = 5; i < 20; i++) {
+    ASSERT_TRUE(AddMethod("dex_location1", /* checksum */ 1, /* method_idx */ i, &info2));
+  }
+  ASSERT_TRUE(AddMethodWithInlineCache("dex_location2",
+                                       /* checksum */ 2,
+                                       /* method_idx */ 1,
+                                       ProfileCompilationInfo::kHotnessHot,
+                                       /* dex_pc */ 7,
+                                       /* classes */ { 1, 2 },
+                                       &info2));
+  ASSERT_TRUE(info2.AppendToFile(profile.GetFilename(), &bytes_written));
+  ASSERT_GT(bytes_written, 0u);
+
+  // Check that loading the file merges the appended records.
+  ProfileCompilationInfo expected_info;
+  ASSERT_TRUE(expected_info.MergeWith(info1));
+  ASSERT_TRUE(expected_info.MergeWith(info2));
+  ProfileCompilationInfo loaded_info;
+  ASSERT_TRUE(profile.GetFile()->ResetOffset());
+  ASSERT_TRUE(loaded_info.Load(GetFd(profile)));
+  ASSERT_TRUE(loaded_info.Equals(expected_info));
+  ASSERT_EQ(21u, loaded_info.GetNumberOfMethods());
+}
+
+TEST_F(ProfileCompilationInfoTest, AppendToBadVersion) {
+  ScratchFile profile;
+  ASSERT_TRUE(profile.GetFile()->WriteFully(
+      ProfileCompilationInfo::kProfileMagic, kProfileMagicSize));
+  uint8_t version[] = { '0', '0', '1', '\0' };
+  ASSERT_TRUE(profile.GetFile()->WriteFully(version, sizeof(version)));
+  ASSERT_EQ(0, profile.GetFile()->Flush());
+
+  // Records cannot be appended to a profile of another version.
+  ProfileCompilationInfo info;
+  ASSERT_TRUE(AddMethod("dex_location", /* checksum */ 1, /* method_idx */ 1, &info));
+  uint64_t bytes_written;
+  ASSERT_FALSE(info.AppendToFile(profile.GetFilename(), &bytes_written));
+}
+
+TEST_F(ProfileCompilationInfoTest, MergeWithChanges) {
+  ProfileCompilationInfo info;
+  for (uint16_t i = 0; i < 10; i++) {
+    ASSERT_TRUE(AddMethod("dex_location", /* checksum */ 1, /* method_idx */ i, &info));
+  }
+
+  ProfileCompilationInfo new_info;
+  for (uint16_t i = 5; i < 15; i++) {
+    ASSERT_TRUE(AddMethod("dex_location", /* checksum */ 1, /* method_idx */ i, &new_info));
+  }
+  ASSERT_TRUE(AddMethodWithInlineCache("dex_location",
+                                       /* checksum */ 1,
+                                       /* method_idx */ 0,
+                                       ProfileCompilationInfo::kHotnessWarm,
+                                       /* dex_pc */ 2,
+                                       /* classes */ { 3 },
+                                       &new_info));
+
+  // Only the new methods and the method which got hotter are changes.
+  ProfileCompilationInfo changes;
+  ASSERT_TRUE(info.MergeWith(new_info, &changes));
+  ASSERT_EQ(15u, info.GetNumberOfMethods());
+  ASSERT_EQ(6u, changes.GetNumberOfMethods());
+  ASSERT_TRUE(GetMethodData(changes, "dex_location", /* method_idx */ 0) != nullptr);
+  ASSERT_TRUE(GetMethodData(changes, "dex_location", /* method_idx */ 5) == nullptr);
+  ASSERT_TRUE(GetMethodData(changes, "dex_location", /* method_idx */ 14) != nullptr);
+
+  // Merging the same data again changes nothing.
+  ProfileCompilationInfo no_changes;
+  ASSERT_TRUE(info.MergeWith(new_info, &no_changes));
+  ASSERT_EQ(0u, no_changes.GetNumberOfMethods());
+}
+
 }  // namespace art
@@ -43,6 +43,9 @@ static constexpr const uint32_t kMinimumNumberOfClassesToSave = 10;
 static constexpr const uint32_t kMinimumNumberOfNotificationBeforeWake =
     kMinimumNumberOfMethodsToSave;
 static constexpr const uint32_t kMaximumNumberOfNotificationBeforeWake = 50;
+// Maximum number of records appended to a profile file before the saver rewrites it. Each
+// record adds a little to the time it takes to load the profile.
+static constexpr const uint32_t kMaximumNumberOfAppendsBeforeRewrite = 32;
 
 
 ProfileSaver* ProfileSaver::instance_ = nullptr;
@@ -56,14 +59,15 @@ ProfileSaver::ProfileSaver(const std::string& output_filename,
     : jit_code_cache_(jit_code_cache),
       foreign_dex_profile_path_(foreign_dex_profile_path),
       shutting_down_(false),
-      last_save_number_of_methods_(0),
-      last_save_number_of_classes_(0),
       last_time_ns_saver_woke_up_(0),
       jit_activity_notifications_(0),
       wait_lock_("ProfileSaver wait lock"),
       period_condition_("ProfileSaver period condition", wait_lock_),
       total_bytes_written_(0),
+      bytes_written_per_save_("ProfileSaver bytes written per save", 16),
       total_number_of_writes_(0),
+      total_number_of_appends_(0),
+      total_number_of_rewrites_(0),
       total_number_of_code_cache_queries_(0),
       total_number_of_skipped_writes_(0),
       total_number_of_failed_writes_(0),
@@ -185,14 +189,42 @@ void ProfileSaver::NotifyJitActivityInternal() {
   }
 }
 
-ProfileCompilationInfo* ProfileSaver::GetCachedProfiledInfo(const std::string& filename) {
+ProfileSaver::CachedProfile* ProfileSaver::GetCachedProfile(const std::string& filename) {
   auto info_it = profile_cache_.find(filename);
   if (info_it == profile_cache_.end()) {
-    info_it = profile_cache_.Put(filename, ProfileCompilationInfo());
+    info_it = profile_cache_.Put(filename, CachedProfile());
   }
   return &info_it->second;
 }
 
+bool ProfileSaver::SaveCachedProfile(const std::string& filename,
+                                     CachedProfile* cached_profile,
+                                     /*out*/uint64_t* bytes_written) {
+  // Append what changed since the last save. The first save of the process rewrites the file
+  // instead, which merges the records appended by previous processes and lets us know what
+  // the file holds, and so does every kMaximumNumberOfAppendsBeforeRewrite-th save.
+  bool saved = false;
+  if (cached_profile->number_of_appends > 0 &&
+      cached_profile->number_of_appends < kMaximumNumberOfAppendsBeforeRewrite) {
+    saved = cached_profile->unsaved_changes.AppendToFile(filename, bytes_written);
+    if (saved) {
+      cached_profile->number_of_appends++;
+      total_number_of_appends_++;
+    }
+  }
+  // Force the save. In case the profile data is corrupted or the the profile
+  // has the wrong version this will "fix" the file to the correct format.
+  if (!saved && cached_profile->info.MergeAndSave(filename, bytes_written, /*force*/ true)) {
+    saved = true;
+    cached_profile->number_of_appends = 1;
+    total_number_of_rewrites_++;
+  }
+  if (saved) {
+    cached_profile->unsaved_changes = ProfileCompilationInfo();
+  }
+  return saved;
+}
+
 // Get resolved methods that have a profile info or more than kStartupMethodSamples samples.
 // Excludes native methods and classes in the boot image.
 class GetMethodsVisitor : public ClassVisitor {
@@ -258,8 +290,10 @@ void ProfileSaver::FetchAndCacheResolvedClassesAndMethods() {
                        << " (" << classes.GetDexLocation() << ")";
       }
     }
-    ProfileCompilationInfo* info = GetCachedProfiledInfo(filename);
-    info->AddMethodsAndClasses(methods_for_location, resolved_classes_for_location);
+    ProfileCompilationInfo new_info;
+    new_info.AddMethodsAndClasses(methods_for_location, resolved_classes_for_location);
+    CachedProfile* cached_profile = GetCachedProfile(filename);
+    cached_profile->info.MergeWith(new_info, &cached_profile->unsaved_changes);
     total_number_of_profile_entries_cached += resolved_classes_for_location.size();
   }
   max_number_of_profile_entries_cached_ = std::max(
@@ -286,21 +320,22 @@ bool ProfileSaver::ProcessProfilingInfo(uint16_t* new_methods) {
     }
     const std::string& filename = it.first;
     const std::set<std::string>& locations = it.second;
-    std::vector<MethodReference> methods;
+    std::vector<ProfileCompilationInfo::ProfileMethodInfo> methods;
     {
       ScopedObjectAccess soa(Thread::Current());
       jit_code_cache_->GetProfiledMethods(locations, methods);
       total_number_of_code_cache_queries_++;
     }
 
-    ProfileCompilationInfo* cached_info = GetCachedProfiledInfo(filename);
-    cached_info->AddMethodsAndClasses(methods, std::set<DexCacheResolvedClasses>());
-    int64_t delta_number_of_methods =
-        cached_info->GetNumberOfMethods() -
-        static_cast<int64_t>(last_save_number_of_methods_);
+    // Only keep track of what changed since the last save.
+    ProfileCompilationInfo new_info;
+    new_info.AddMethods(methods);
+    CachedProfile* cached_profile = GetCachedProfile(filename);
+    ProfileCompilationInfo* cached_info = &cached_profile->info;
+    cached_info->MergeWith(new_info, &cached_profile->unsaved_changes);
+    int64_t delta_number_of_methods = cached_profile->unsaved_changes.GetNumberOfMethods();
     int64_t delta_number_of_classes =
-        cached_info->GetNumberOfResolvedClasses() -
-        static_cast<int64_t>(last_save_number_of_classes_);
+        cached_profile->unsaved_changes.GetNumberOfResolvedClasses();
 
     if (delta_number_of_methods < kMinimumNumberOfMethodsToSave &&
         delta_number_of_classes < kMinimumNumberOfClassesToSave) {
@@ -312,17 +347,14 @@ bool ProfileSaver::ProcessProfilingInfo(uint16_t* new_methods) {
     }
     *new_methods = std::max(static_cast<uint16_t>(delta_number_of_methods), *new_methods);
     uint64_t bytes_written;
-    // Force the save. In case the profile data is corrupted or the the profile
-    // has the wrong version this will "fix" the file to the correct format.
-    if (cached_info->MergeAndSave(filename, &bytes_written, /*force*/ true)) {
-      last_save_number_of_methods_ = cached_info->GetNumberOfMethods();
-      last_save_number_of_classes_ = cached_info->GetNumberOfResolvedClasses();
+    if (SaveCachedProfile(filename, cached_profile, &bytes_written)) {
       // Clear resolved classes. No need to store them around as
       // they don't change after the first write.
       cached_info->ClearResolvedClasses();
       if (bytes_written > 0) {
         total_number_of_writes_++;
         total_bytes_written_ += bytes_written;
+        bytes_written_per_save_.AddValue(bytes_written);
         profile_file_saved = true;
       } else {
         // At this point we could still have avoided the write.
@@ -642,6 +674,8 @@ void ProfileSaver::DumpInstanceInfo(std::ostream& os) {
 void ProfileSaver::DumpInfo(std::ostream& os) {
   os << "ProfileSaver total_bytes_written=" << total_bytes_written_ << '\n'
      << "ProfileSaver total_number_of_writes=" << total_number_of_writes_ << '\n'
+     << "ProfileSaver total_number_of_appends=" << total_number_of_appends_ << '\n'
+     << "ProfileSaver total_number_of_rewrites=" << total_number_of_rewrites_ << '\n'
      << "ProfileSaver total_number_of_code_cache_queries="
      << total_number_of_code_cache_queries_ << '\n'
      << "ProfileSaver total_number_of_skipped_writes=" << total_number_of_skipped_writes_ << '\n'
@@ -654,6 +688,9 @@ void ProfileSaver::DumpInfo(std::ostream& os) {
      << max_number_of_profile_entries_cached_ << '\n'
      << "ProfileSaver total_number_of_hot_spikes=" << total_number_of_hot_spikes_ << '\n'
      << "ProfileSaver total_number_of_wake_ups=" << total_number_of_wake_ups_ << '\n';
+  if (bytes_written_per_save_.SampleSize() > 0) {
+    bytes_written_per_save_.PrintMemoryUse(os);
+  }
 }
 
 
@@ -677,9 +714,9 @@ bool ProfileSaver::HasSeenMethod(const std::string& profile,
                                  uint16_t method_idx) {
   MutexLock mu(Thread::Current(), *Locks::profiler_lock_);
   if (instance_ != nullptr) {
-    ProfileCompilationInfo* info = instance_->GetCachedProfiledInfo(profile);
-    if (info != nullptr) {
-      return info->ContainsMethod(MethodReference(dex_file, method_idx));
+    CachedProfile* cached_profile = instance_->GetCachedProfile(profile);
+    if (cached_profile != nullptr) {
+      return cached_profile->info.ContainsMethod(MethodReference(dex_file, method_idx));
     }
   }
   return false;
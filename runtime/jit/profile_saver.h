@@ -17,6 +17,7 @@
 #ifndef ART_RUNTIME_JIT_PROFILE_SAVER_H_
 #define ART_RUNTIME_JIT_PROFILE_SAVER_H_
 
+#include "base/histogram-inl.h"
 #include "base/mutex.h"
 #include "jit_code_cache.h"
 #include "offline_profiling_info.h"
@@ -91,10 +92,27 @@ class ProfileSaver {
                            const std::vector<std::string>& code_paths)
       REQUIRES(Locks::profiler_lock_);
 
-  // Retrieves the cached profile compilation info for the given profile file.
+  // What the saver knows of a profile file.
+  struct CachedProfile {
+    CachedProfile() : number_of_appends(0) {}
+
+    // Everything saved or to be saved to the file.
+    ProfileCompilationInfo info;
+    // The part of `info` not saved yet.
+    ProfileCompilationInfo unsaved_changes;
+    // Number of records appended to the file since the saver last rewrote it.
+    uint32_t number_of_appends;
+  };
+
+  // Retrieves the cached profile for the given profile file.
   // If no entry exists, a new empty one will be created, added to the cache and
   // then returned.
-  ProfileCompilationInfo* GetCachedProfiledInfo(const std::string& filename);
+  CachedProfile* GetCachedProfile(const std::string& filename);
+  // Saves the unsaved changes of `cached_profile` to `filename`, appending them to the file
+  // or rewriting it. Returns whether that succeeded, and the number of bytes written.
+  bool SaveCachedProfile(const std::string& filename,
+                         CachedProfile* cached_profile,
+                         /*out*/uint64_t* bytes_written);
   // Fetches the current resolved classes and methods from the ClassLinker and stores them in the
   // profile_cache_ for later save.
   void FetchAndCacheResolvedClassesAndMethods();
@@ -127,23 +145,25 @@ class ProfileSaver {
   std::set<std::string> app_data_dirs_ GUARDED_BY(Locks::profiler_lock_);
 
   bool shutting_down_ GUARDED_BY(Locks::profiler_lock_);
-  uint32_t last_save_number_of_methods_;
-  uint32_t last_save_number_of_classes_;
   uint64_t last_time_ns_saver_woke_up_ GUARDED_BY(wait_lock_);
   uint32_t jit_activity_notifications_;
 
   // A local cache for the profile information. Maps each tracked file to its
   // profile information. The size of this cache is usually very small and tops
   // to just a few hundreds entries in the ProfileCompilationInfo objects.
-  // It helps avoiding unnecessary writes to disk.
-  SafeMap<std::string, ProfileCompilationInfo> profile_cache_;
+  // It helps avoiding unnecessary writes to disk, and lets the saver only write
+  // what changed since the last save.
+  SafeMap<std::string, CachedProfile> profile_cache_;
 
   // Save period condition support.
   Mutex wait_lock_ DEFAULT_MUTEX_ACQUIRED_AFTER;
   ConditionVariable period_condition_ GUARDED_BY(wait_lock_);
 
   uint64_t total_bytes_written_;
+  Histogram<uint64_t> bytes_written_per_save_;
   uint64_t total_number_of_writes_;
+  uint64_t total_number_of_appends_;
+  uint64_t total_number_of_rewrites_;
   uint64_t total_number_of_code_cache_queries_;
   uint64_t total_number_of_skipped_writes_;
   uint64_t total_number_of_failed_writes_;
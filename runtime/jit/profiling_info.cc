@@ -16,6 +16,8 @@
 
 #include "profiling_info.h"
 
+#include <limits>
+
 #include "art_method-inl.h"
 #include "dex_instruction.h"
 #include "jit/jit.h"
@@ -31,6 +33,7 @@ ProfilingInfo::ProfilingInfo(ArtMethod* method, const std::vector<uint32_t>& ent
         is_method_being_compiled_(false),
         is_osr_method_being_compiled_(false),
         current_inline_uses_(0),
+        compiled_code_samples_(0),
         saved_entry_point_(nullptr) {
   memset(&cache_, 0, number_of_inline_caches_ * sizeof(InlineCache));
   for (size_t i = 0; i < number_of_inline_caches_; ++i) {
@@ -103,7 +106,8 @@ void ProfilingInfo::AddInvokeInfo(uint32_t dex_pc, mirror::Class* cls) {
   for (size_t i = 0; i < InlineCache::kIndividualCacheSize; ++i) {
     mirror::Class* existing = cache->classes_[i].Read();
     if (existing == cls) {
-      // Receiver type is already in the cache, nothing else to do.
+      // Receiver type is already in the cache, count it.
+      cache->IncrementCount(&cache->counts_[i]);
       return;
     } else if (existing == nullptr) {
       // Cache entry is empty, try to put `cls` in it.
@@ -115,7 +119,8 @@ void ProfilingInfo::AddInvokeInfo(uint32_t dex_pc, mirror::Class* cls) {
         // entry in case the entry contains `cls`.
         --i;
       } else {
-        // We successfully set `cls`, just return.
+        // We successfully set `cls`, count it and return.
+        cache->IncrementCount(&cache->counts_[i]);
         // Since the instrumentation is marked from the declaring class we need to mark the card so
         // that mod-union tables and card rescanning know about the update.
         // Note that the declaring class is not necessarily the holding class if the method is
@@ -130,6 +135,18 @@ void ProfilingInfo::AddInvokeInfo(uint32_t dex_pc, mirror::Class* cls) {
   }
   // Unsuccessfull - cache is full, making it megamorphic. We do not DCHECK it though,
   // as the garbage collector might clear the entries concurrently.
+  cache->IncrementCount(&cache->untracked_count_);
+}
+
+void InlineCache::IncrementCount(uint16_t* count) {
+  if (UNLIKELY(*count == std::numeric_limits<uint16_t>::max())) {
+    // Halve all counts of the call site to keep their ratios.
+    for (size_t i = 0; i < kIndividualCacheSize; ++i) {
+      counts_[i] /= 2;
+    }
+    untracked_count_ /= 2;
+  }
+  ++*count;
 }
 
 }  // namespace art
@@ -35,8 +35,9 @@ namespace mirror {
 class Class;
 }
 
-// Structure to store the classes seen at runtime for a specific instruction.
-// Once the classes_ array is full, we consider the INVOKE to be megamorphic.
+// Structure to store the classes seen at runtime for a specific instruction, and how often.
+// Once the classes_ array is full, we consider the INVOKE to be megamorphic, and count the
+// receivers of the classes which did not fit as untracked.
 class InlineCache {
  public:
   bool IsMonomorphic() const {
@@ -73,11 +74,27 @@ class InlineCache {
     return classes_[i].Read();
   }
 
+  // Number of receivers seen of the class at `i`. The counts of a call site are halved when one
+  // of them saturates, so they are only meaningful relative to each other.
+  uint16_t GetCountAt(size_t i) const {
+    return counts_[i];
+  }
+
+  // Number of receivers seen of classes which did not fit in the cache.
+  uint16_t GetUntrackedCount() const {
+    return untracked_count_;
+  }
+
   static constexpr uint16_t kIndividualCacheSize = 5;
 
  private:
+  // Counts are updated without synchronization, so some updates may be lost.
+  void IncrementCount(uint16_t* count);
+
   uint32_t dex_pc_;
   GcRoot<mirror::Class> classes_[kIndividualCacheSize];
+  uint16_t counts_[kIndividualCacheSize];
+  uint16_t untracked_count_;
 
   friend class ProfilingInfo;
 
@@ -148,6 +165,8 @@ class ProfilingInfo {
       memset(&cache->classes_[0],
              0,
              InlineCache::kIndividualCacheSize * sizeof(GcRoot<mirror::Class>));
+      memset(&cache->counts_[0], 0, sizeof(cache->counts_));
+      cache->untracked_count_ = 0;
     }
   }
 
@@ -166,6 +185,24 @@ class ProfilingInfo {
         (current_inline_uses_ > 0);
   }
 
+  // Records that compiled code of the method was seen running: a frame of a thread ran it when
+  // the code cache marked the thread stacks, or a call revived it while the code cache was poking
+  // for its liveness. Like the hotness counter, updates are racy and need not be precise.
+  void AddCompiledCodeSample() {
+    if (compiled_code_samples_ != std::numeric_limits<uint16_t>::max()) {
+      compiled_code_samples_++;
+    }
+  }
+
+  uint16_t GetCompiledCodeSamples() const {
+    return compiled_code_samples_;
+  }
+
+  // Halves the samples, so that only the recent activity of the compiled code counts.
+  void DecayCompiledCodeSamples() {
+    compiled_code_samples_ /= 2;
+  }
+
  private:
   ProfilingInfo(ArtMethod* method, const std::vector<uint32_t>& entries);
 
@@ -188,6 +225,9 @@ class ProfilingInfo {
   // it updates this counter so that the GC does not try to clear the inline caches.
   uint16_t current_inline_uses_;
 
+  // Number of times compiled code of the method was seen running, see AddCompiledCodeSample().
+  uint16_t compiled_code_samples_;
+
   // Entry point of the corresponding ArtMethod, while the JIT code cache
   // is poking for the liveness of compiled code.
   const void* saved_entry_point_;
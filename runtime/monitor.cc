@@ -26,10 +26,12 @@
 #include "class_linker.h"
 #include "dex_file-inl.h"
 #include "dex_instruction-inl.h"
+#include "gc/heap.h"
 #include "lock_word-inl.h"
 #include "mirror/class-inl.h"
 #include "mirror/object-inl.h"
 #include "mirror/object_array-inl.h"
+#include "runtime.h"
 #include "scoped_thread_state_change.h"
 #include "thread.h"
 #include "thread_list.h"
@@ -39,6 +41,9 @@
 namespace art {
 
 static constexpr uint64_t kLongWaitMs = 100;
+// A thread which waits without a timeout, or for at least this long, is likely to be idle for a
+// while.
+static constexpr int64_t kIdleWaitMs = 10;
 
 /*
  * Every Object has a monitor associated with it, but not every Object is actually locked.  Even
@@ -599,6 +604,12 @@ void Monitor::Wait(Thread* self, int64_t ms, int32_t ns,
     return;
   }
 
+  if (why == kWaiting || ms >= kIdleWaitMs) {
+    // Let the other threads use the thread-local buffers of this thread while it is idle. The
+    // allocator locks are below the monitor lock, which the thread keeps until it blocks.
+    Runtime::Current()->GetHeap()->RevokeIdleThreadLocalBuffers(self);
+  }
+
   /*
    * Add ourselves to the set of threads waiting on this monitor, and
    * release our hold.  We need to let it go even if we're a few levels
@@ -60,6 +60,7 @@
 #include "base/dumpable.h"
 #include "base/stl_util.h"
 #include "base/systrace.h"
+#include "base/time_utils.h"
 #include "base/unix_file/fd_file.h"
 #include "class_linker-inl.h"
 #include "compiler_callbacks.h"
@@ -87,6 +88,7 @@
 #include "mirror/class_loader.h"
 #include "mirror/field.h"
 #include "mirror/method.h"
+#include "mirror/object_array-inl.h"
 #include "mirror/stack_trace_element.h"
 #include "mirror/throwable.h"
 #include "monitor.h"
@@ -139,6 +141,8 @@
 #include "utils.h"
 #include "verifier/method_verifier.h"
 #include "well_known_classes.h"
+#include "xposed_bridge.h"
+#include "xposed_hook_stats.h"
 
 namespace art {
 
@@ -179,6 +183,13 @@ Runtime::Runtime()
     : resolution_method_(nullptr),
       imt_conflict_method_(nullptr),
       imt_unimplemented_method_(nullptr),
+      xposed_hook_epoch_(0),
+      xposed_hooks_installed_(0),
+      xposed_hooks_disabled_(0),
+      xposed_hooks_released_(0),
+      xposed_hooks_reused_(0),
+      xposed_hook_pause_time_ns_(0),
+      xposed_hook_max_pause_ns_(0),
       instruction_set_(kNone),
       compiler_callbacks_(nullptr),
       is_zygote_(false),
@@ -281,6 +292,11 @@ Runtime::~Runtime() {
                                             WellKnownClasses::java_lang_Daemons_stop);
   }
 
+  if (jit_ != nullptr) {
+    ScopedObjectAccess soa(self);
+    jit_->SavePersistentCodeCache(self);
+  }
+
   Trace::Shutdown();
 
   if (attach_shutdown_thread) {
@@ -1043,6 +1059,7 @@ bool Runtime::Init(RuntimeArgumentMap&& runtime_options_in) {
                        xgc_option.verify_pre_sweeping_rosalloc_,
                        xgc_option.verify_post_gc_rosalloc_,
                        xgc_option.gcstress_,
+                       xgc_option.generational_cc_,
                        runtime_options.GetOrDefault(Opt::EnableHSpaceCompactForOOM),
                        runtime_options.GetOrDefault(Opt::HSpaceCompactForOOMMinIntervalsMs));
 
@@ -1053,6 +1070,11 @@ bool Runtime::Init(RuntimeArgumentMap&& runtime_options_in) {
 
   dump_gc_performance_on_shutdown_ = runtime_options.Exists(Opt::DumpGCPerformanceOnShutdown);
 
+  xposed_bridge_cache_.reset(new XposedBridgeCache());
+  if (runtime_options.Exists(Opt::XposedHookStats)) {
+    xposed_hook_profiler_.reset(new XposedHookProfiler());
+  }
+
   if (runtime_options.Exists(Opt::JdwpOptions)) {
     Dbg::ConfigureJdwp(runtime_options.GetOrDefault(Opt::JdwpOptions));
   }
@@ -1434,6 +1456,17 @@ void Runtime::DumpForSigQuit(std::ostream& os) {
   } else {
     os << "Running non JIT\n";
   }
+  if (xposed_hooks_installed_ != 0) {
+    os << "Xposed hooks installed=" << xposed_hooks_installed_
+       << " disabled=" << xposed_hooks_disabled_
+       << " released=" << xposed_hooks_released_.LoadRelaxed()
+       << " reused=" << xposed_hooks_reused_.LoadRelaxed() << "\n";
+    os << "Xposed hook pauses total=" << PrettyDuration(xposed_hook_pause_time_ns_)
+       << " max=" << PrettyDuration(xposed_hook_max_pause_ns_) << "\n";
+  }
+  if (xposed_hook_profiler_ != nullptr) {
+    xposed_hook_profiler_->DumpForSigQuit(os);
+  }
   TrackedAllocators::Dump(os);
   os << "\n";
 
@@ -1555,6 +1588,14 @@ mirror::Throwable* Runtime::GetPreAllocatedNoClassDefFoundError() {
   return ncdfe;
 }
 
+mirror::ObjectArray<mirror::Object>* Runtime::GetXposedBoxCache() {
+  return xposed_box_cache_.Read();
+}
+
+void Runtime::SetXposedBoxCache(mirror::ObjectArray<mirror::Object>* cache) {
+  xposed_box_cache_ = GcRoot<mirror::ObjectArray<mirror::Object>>(cache);
+}
+
 void Runtime::VisitConstantRoots(RootVisitor* visitor) {
   // Visit the classes held as static in mirror classes, these can be visited concurrently and only
   // need to be visited once per GC since they never change.
@@ -1618,6 +1659,7 @@ void Runtime::VisitNonThreadRoots(RootVisitor* visitor) {
   sentinel_.VisitRootIfNonNull(visitor, RootInfo(kRootVMInternal));
   pre_allocated_OutOfMemoryError_.VisitRootIfNonNull(visitor, RootInfo(kRootVMInternal));
   pre_allocated_NoClassDefFoundError_.VisitRootIfNonNull(visitor, RootInfo(kRootVMInternal));
+  xposed_box_cache_.VisitRootIfNonNull(visitor, RootInfo(kRootVMInternal));
   verifier::MethodVerifier::VisitStaticRoots(visitor);
   VisitTransactionRoots(visitor);
 }
@@ -2033,6 +2075,12 @@ void Runtime::UpdateProcessState(ProcessState process_state) {
   ProcessState old_process_state = process_state_;
   process_state_ = process_state;
   GetHeap()->UpdateProcessState(old_process_state, process_state);
+  if (jit_ != nullptr &&
+      old_process_state == kProcessStateJankPerceptible &&
+      process_state == kProcessStateJankImperceptible) {
+    // The application is going to the background, and may be killed there.
+    jit_->AddSavePersistentCodeCacheTask(Thread::Current());
+  }
 }
 
 void Runtime::RegisterSensitiveThread() const {
@@ -20,6 +20,7 @@
 #include <jni.h>
 #include <stdio.h>
 
+#include <algorithm>
 #include <iosfwd>
 #include <set>
 #include <string>
@@ -93,6 +94,8 @@ class ThreadList;
 class Trace;
 struct TraceConfig;
 class Transaction;
+class XposedBridgeCache;
+class XposedHookProfiler;
 
 typedef std::vector<std::pair<std::string, const void*>> RuntimeOptions;
 
@@ -303,6 +306,63 @@ class Runtime {
   mirror::Throwable* GetPreAllocatedNoClassDefFoundError()
       SHARED_REQUIRES(Locks::mutator_lock_);
 
+  // Boxes of small primitive values passed to Xposed hook callbacks, or null if not created yet.
+  mirror::ObjectArray<mirror::Object>* GetXposedBoxCache() SHARED_REQUIRES(Locks::mutator_lock_);
+
+  void SetXposedBoxCache(mirror::ObjectArray<mirror::Object>* cache)
+      SHARED_REQUIRES(Locks::mutator_lock_);
+
+  // Argument marshaling of hooked methods, shared by methods with the same shorty.
+  XposedBridgeCache* GetXposedBridgeCache() const {
+    return xposed_bridge_cache_.get();
+  }
+
+  // Per-hook call statistics, or null unless enabled with -XX:XposedHookStats.
+  XposedHookProfiler* GetXposedHookProfiler() const {
+    return xposed_hook_profiler_.get();
+  }
+
+  // Number of times Xposed hooks have been installed. Each thread remembers the epoch in which it
+  // last fixed up the frames of methods hooked while they were running.
+  size_t GetXposedHookEpoch() const {
+    return xposed_hook_epoch_;
+  }
+
+  size_t IncrementXposedHookEpoch() REQUIRES(Locks::mutator_lock_) {
+    return ++xposed_hook_epoch_;
+  }
+
+  // Counts of Xposed hooks installed, disabled, and disabled with their global references released,
+  // printed in the SIGQUIT dump.
+  void RecordXposedHooksInstalled(size_t count) REQUIRES(Locks::mutator_lock_) {
+    xposed_hooks_installed_ += count;
+  }
+
+  void RecordXposedHooksDisabled(size_t count) REQUIRES(Locks::mutator_lock_) {
+    xposed_hooks_disabled_ += count;
+  }
+
+  void RecordXposedHookReleased() {
+    xposed_hooks_released_.FetchAndAddSequentiallyConsistent(1);
+  }
+
+  // Called when a hook reuses the backup and hook information of a released hook.
+  void RecordXposedHookReused() {
+    xposed_hooks_reused_.FetchAndAddSequentiallyConsistent(1);
+  }
+
+  // Time from requesting the suspension of all threads to installing hooks, called within the
+  // pause.
+  void RecordXposedHookPause(uint64_t pause_ns) REQUIRES(Locks::mutator_lock_) {
+    xposed_hook_pause_time_ns_ += pause_ns;
+    xposed_hook_max_pause_ns_ = std::max(xposed_hook_max_pause_ns_, pause_ns);
+  }
+
+  // Total pause of the installations of Xposed hooks.
+  uint64_t GetXposedHookPauseTime() const SHARED_REQUIRES(Locks::mutator_lock_) {
+    return xposed_hook_pause_time_ns_;
+  }
+
   const std::vector<std::string>& GetProperties() const {
     return properties_;
   }
@@ -695,6 +755,28 @@ class Runtime {
   // JDWP (invalid references).
   GcRoot<mirror::Object> sentinel_;
 
+  // See GetXposedBoxCache().
+  GcRoot<mirror::ObjectArray<mirror::Object>> xposed_box_cache_;
+
+  // See GetXposedBridgeCache().
+  std::unique_ptr<XposedBridgeCache> xposed_bridge_cache_;
+
+  // See GetXposedHookProfiler().
+  std::unique_ptr<XposedHookProfiler> xposed_hook_profiler_;
+
+  // See GetXposedHookEpoch().
+  size_t xposed_hook_epoch_;
+
+  // See RecordXposedHooksInstalled().
+  size_t xposed_hooks_installed_;
+  size_t xposed_hooks_disabled_;
+  Atomic<size_t> xposed_hooks_released_;
+  Atomic<size_t> xposed_hooks_reused_;
+
+  // See RecordXposedHookPause().
+  uint64_t xposed_hook_pause_time_ns_;
+  uint64_t xposed_hook_max_pause_ns_;
+
   InstructionSet instruction_set_;
   QuickMethodFrameInfo callee_save_method_frame_infos_[kLastCalleeSaveType];
 
@@ -107,6 +107,7 @@ StackVisitor::StackVisitor(Thread* thread,
       num_frames_(num_frames),
       cur_depth_(0),
       current_inlining_depth_(0),
+      xposed_hook_frame_(nullptr),
       context_(context) {
   DCHECK(thread == Thread::Current() || thread->IsSuspended()) << *thread;
 }
@@ -665,7 +666,8 @@ void StackVisitor::SanityCheckFrame() const {
     }
     Runtime* const runtime = Runtime::Current();
     LinearAlloc* const linear_alloc = runtime->GetLinearAlloc();
-    if (!linear_alloc->Contains(method)) {
+    // Backups of Xposed hooked methods live in the hook arenas of their class loaders.
+    if (!linear_alloc->Contains(method) && !method->IsXposedOriginalMethod()) {
       // Check class linker linear allocs.
       mirror::Class* klass = method->GetDeclaringClass();
       LinearAlloc* const class_linear_alloc = (klass != nullptr)
@@ -769,6 +771,15 @@ QuickMethodFrameInfo StackVisitor::GetCurrentQuickFrameInfo() const {
   return QuickMethodFrameInfo(frame_size, callee_info.CoreSpillMask(), callee_info.FpSpillMask());
 }
 
+// Whether a frame of `method` on the stack of `thread` was running the original code when the
+// method was hooked. Calls through the hook trampoline only happen after the thread has caught
+// up with the epoch of the hook, see ArtMethod::FixupXposedHookedFrames().
+static inline bool IsStaleXposedHookedFrame(Thread* thread, ArtMethod* method)
+    SHARED_REQUIRES(Locks::mutator_lock_) {
+  return UNLIKELY(method->IsXposedHookedMethod()) &&
+      method->GetXposedHookInfo()->epoch > thread->GetXposedHookEpoch();
+}
+
 void StackVisitor::WalkStack(bool include_transitions) {
   DCHECK(thread_ == Thread::Current() || thread_->IsSuspended());
   CHECK_EQ(cur_depth_, 0U);
@@ -788,6 +799,11 @@ void StackVisitor::WalkStack(bool include_transitions) {
       DCHECK(current_fragment->GetTopShadowFrame() == nullptr);
       ArtMethod* method = *cur_quick_frame_;
       while (method != nullptr) {
+        if (IsStaleXposedHookedFrame(thread_, method) && cur_quick_frame_ != xposed_hook_frame_) {
+          // The frame and its method header belong to the backup.
+          method = method->GetXposedOriginalMethod();
+          *cur_quick_frame_ = method;
+        }
         cur_oat_quick_method_header_ = method->GetOatQuickMethodHeader(cur_quick_frame_pc_);
         SanityCheckFrame();
 
@@ -883,6 +899,10 @@ void StackVisitor::WalkStack(bool include_transitions) {
       }
     } else if (cur_shadow_frame_ != nullptr) {
       do {
+        ArtMethod* method = cur_shadow_frame_->GetMethod();
+        if (IsStaleXposedHookedFrame(thread_, method)) {
+          cur_shadow_frame_->SetMethod(method->GetXposedOriginalMethod());
+        }
         SanityCheckFrame();
         bool should_continue = VisitFrame();
         if (UNLIKELY(!should_continue)) {
@@ -596,6 +596,12 @@ class StackVisitor {
     return thread_;
   }
 
+  // Leaves `frame`, a call through the Xposed hook trampoline, alone when switching frames of
+  // hooked methods to their backups.
+  void SetXposedHookFrame(ArtMethod** frame) {
+    xposed_hook_frame_ = frame;
+  }
+
   ArtMethod* GetMethod() const SHARED_REQUIRES(Locks::mutator_lock_);
 
   ArtMethod* GetOuterMethod() const {
@@ -838,6 +844,8 @@ class StackVisitor {
   // Current inlining depth of the method we are currently at.
   // 0 if there is no inlined frame.
   size_t current_inlining_depth_;
+  // See SetXposedHookFrame().
+  ArtMethod** xposed_hook_frame_;
 
  protected:
   Context* const context_;
@@ -72,6 +72,7 @@
 #include "verifier/method_verifier.h"
 #include "verify_object-inl.h"
 #include "well_known_classes.h"
+#include "xposed_hook_stats.h"
 #include "interpreter/interpreter.h"
 
 #if ART_USE_FUTEXES
@@ -725,6 +726,9 @@ bool Thread::Init(ThreadList* thread_list, JavaVMExt* java_vm, JNIEnvExt* jni_en
     }
   }
 
+  // A new thread has no frames of hooked methods.
+  tlsPtr_.xposed_hook_epoch = Runtime::Current()->GetXposedHookEpoch();
+
   thread_list->Register(this);
   return true;
 }
@@ -1751,6 +1755,11 @@ void Thread::Destroy() {
       Runtime::Current()->GetHeap()->ConcurrentCopyingCollector()->RevokeThreadLocalMarkStack(this);
     }
   }
+
+  XposedHookProfiler* hook_profiler = Runtime::Current()->GetXposedHookProfiler();
+  if (hook_profiler != nullptr) {
+    hook_profiler->FlushSamples(this);
+  }
 }
 
 Thread::~Thread() {
@@ -1795,6 +1804,7 @@ Thread::~Thread() {
   delete tlsPtr_.instrumentation_stack;
   delete tlsPtr_.name;
   delete tlsPtr_.stack_trace_sample;
+  delete tlsPtr_.xposed_hook_samples;
   free(tlsPtr_.nested_signal_state);
 
   Runtime::Current()->GetHeap()->AssertThreadLocalBuffersAreRevoked(this);
@@ -2544,6 +2554,7 @@ void Thread::DumpThreadOffset(std::ostream& os, uint32_t offset) {
   QUICK_ENTRY_POINT_INFO(pInvokeSuperTrampolineWithAccessCheck)
   QUICK_ENTRY_POINT_INFO(pInvokeVirtualTrampolineWithAccessCheck)
   QUICK_ENTRY_POINT_INFO(pTestSuspend)
+  QUICK_ENTRY_POINT_INFO(pJitBaselineCodeIsHot)
   QUICK_ENTRY_POINT_INFO(pDeliverException)
   QUICK_ENTRY_POINT_INFO(pThrowArrayBounds)
   QUICK_ENTRY_POINT_INFO(pThrowDivZero)
@@ -2832,6 +2843,8 @@ void Thread::VisitRoots(RootVisitor* visitor) {
                        RootInfo(kRootNativeStack, thread_id));
   }
   visitor->VisitRootIfNonNull(&tlsPtr_.monitor_enter_object, RootInfo(kRootNativeStack, thread_id));
+  visitor->VisitRootIfNonNull(reinterpret_cast<mirror::Object**>(&tlsPtr_.xposed_args_pool),
+                              RootInfo(kRootVMInternal, thread_id));
   tlsPtr_.jni_env->locals.VisitRoots(visitor, RootInfo(kRootJNILocal, thread_id));
   tlsPtr_.jni_env->monitors.VisitRoots(visitor, RootInfo(kRootJNIMonitor, thread_id));
   HandleScopeVisitRoots(visitor, thread_id);
@@ -91,6 +91,7 @@ class SingleStepControl;
 class StackedShadowFrameRecord;
 class Thread;
 class ThreadList;
+class XposedHookSampleBuffer;
 
 // Thread priorities. These must match the Thread.MIN_PRIORITY,
 // Thread.NORM_PRIORITY, and Thread.MAX_PRIORITY constants.
@@ -114,7 +115,7 @@ enum class StackedShadowFrameType {
 };
 
 // This should match RosAlloc::kNumThreadLocalSizeBrackets.
-static constexpr size_t kNumRosAllocThreadLocalSizeBracketsInThread = 16;
+static constexpr size_t kNumRosAllocThreadLocalSizeBracketsInThread = 42;
 
 // Thread's stack layout for implicit stack overflow checks:
 //
@@ -244,6 +245,28 @@ class Thread {
     tlsPtr_.thread_local_mark_stack = stack;
   }
 
+  mirror::ObjectArray<mirror::Object>* GetXposedArgsPool() {
+    return tlsPtr_.xposed_args_pool;
+  }
+  void SetXposedArgsPool(mirror::ObjectArray<mirror::Object>* pool) {
+    tlsPtr_.xposed_args_pool = pool;
+  }
+
+  XposedHookSampleBuffer* GetXposedHookSamples() const {
+    return tlsPtr_.xposed_hook_samples;
+  }
+  void SetXposedHookSamples(XposedHookSampleBuffer* samples) {
+    tlsPtr_.xposed_hook_samples = samples;
+  }
+
+  // See Runtime::GetXposedHookEpoch().
+  size_t GetXposedHookEpoch() const {
+    return tlsPtr_.xposed_hook_epoch;
+  }
+  void SetXposedHookEpoch(size_t epoch) {
+    tlsPtr_.xposed_hook_epoch = epoch;
+  }
+
   // Called when thread detected that the thread_suspend_count_ was non-zero. Gives up share of
   // mutator_lock_ and waits until it is resumed and thread_suspend_count_ is zero.
   void FullSuspendCheck()
@@ -1367,7 +1390,8 @@ class Thread {
       mterp_current_ibase(nullptr), mterp_default_ibase(nullptr), mterp_alt_ibase(nullptr),
       thread_local_alloc_stack_top(nullptr), thread_local_alloc_stack_end(nullptr),
       nested_signal_state(nullptr), flip_function(nullptr), method_verifier(nullptr),
-      thread_local_mark_stack(nullptr) {
+      thread_local_mark_stack(nullptr), xposed_args_pool(nullptr),
+      xposed_hook_samples(nullptr), xposed_hook_epoch(0) {
       std::fill(held_mutexes, held_mutexes + kLockLevelCount, nullptr);
     }
 
@@ -1511,6 +1535,15 @@ class Thread {
 
     // Thread-local mark stack for the concurrent copying collector.
     gc::accounting::AtomicStack<mirror::Object>* thread_local_mark_stack;
+
+    // Argument arrays reused across calls to hooked methods, indexed by array length.
+    mirror::ObjectArray<mirror::Object>* xposed_args_pool;
+
+    // Hooked method calls not yet added to the statistics of the Xposed hook profiler.
+    XposedHookSampleBuffer* xposed_hook_samples;
+
+    // Methods hooked after this epoch may still have frames running their original code.
+    size_t xposed_hook_epoch;
   } tlsPtr_;
 
   // Guards the 'interrupted_' and 'wait_monitor_' members.
@@ -21,6 +21,8 @@
 #include <sys/time.h>
 #include <sys/resource.h>
 
+#include <algorithm>
+
 #include "base/bit_utils.h"
 #include "base/casts.h"
 #include "base/logging.h"
@@ -36,7 +38,10 @@ static constexpr bool kMeasureWaitTime = false;
 ThreadPoolWorker::ThreadPoolWorker(ThreadPool* thread_pool, const std::string& name,
                                    size_t stack_size)
     : thread_pool_(thread_pool),
-      name_(name) {
+      name_(name),
+      creation_time_ns_(NanoTime()),
+      busy_time_ns_(0),
+      task_count_(0) {
   // Add an inaccessible page to catch stack overflow.
   stack_size += kPageSize;
   std::string error_msg;
@@ -71,13 +76,20 @@ void ThreadPoolWorker::SetPthreadPriority(int priority) {
 #endif
 }
 
+uint64_t ThreadPoolWorker::GetLifetimeNs() const {
+  return NanoTime() - creation_time_ns_;
+}
+
 void ThreadPoolWorker::Run() {
   Thread* self = Thread::Current();
   Task* task = nullptr;
   thread_pool_->creation_barier_.Wait(self);
   while ((task = thread_pool_->GetTask(self)) != nullptr) {
+    uint64_t start_time = NanoTime();
     task->Run(self);
     task->Finalize();
+    busy_time_ns_.StoreRelaxed(busy_time_ns_.LoadRelaxed() + NanoTime() - start_time);
+    task_count_.StoreRelaxed(task_count_.LoadRelaxed() + 1);
   }
 }
 
@@ -245,4 +257,14 @@ void ThreadPool::SetPthreadPriority(int priority) {
   }
 }
 
+void ThreadPool::DumpWorkerTimes(std::ostream& os) const {
+  for (const ThreadPoolWorker* worker : threads_) {
+    uint64_t lifetime = worker->GetLifetimeNs();
+    uint64_t busy_time = std::min(worker->GetBusyTimeNs(), lifetime);
+    os << worker->name_ << ": tasks=" << worker->GetTaskCount()
+       << " busy=" << PrettyDuration(busy_time)
+       << " idle=" << PrettyDuration(lifetime - busy_time) << "\n";
+  }
+}
+
 }  // namespace art
@@ -18,8 +18,10 @@
 #define ART_RUNTIME_THREAD_POOL_H_
 
 #include <deque>
+#include <ostream>
 #include <vector>
 
+#include "atomic.h"
 #include "barrier.h"
 #include "base/mutex.h"
 #include "mem_map.h"
@@ -62,6 +64,18 @@ class ThreadPoolWorker {
   // Set the "nice" priorty for this worker.
   void SetPthreadPriority(int priority);
 
+  // Returns the time this worker spent running tasks.
+  uint64_t GetBusyTimeNs() const {
+    return busy_time_ns_.LoadRelaxed();
+  }
+
+  // Returns the time since this worker was created.
+  uint64_t GetLifetimeNs() const;
+
+  uint64_t GetTaskCount() const {
+    return task_count_.LoadRelaxed();
+  }
+
  protected:
   ThreadPoolWorker(ThreadPool* thread_pool, const std::string& name, size_t stack_size);
   static void* Callback(void* arg) REQUIRES(!Locks::mutator_lock_);
@@ -71,6 +85,10 @@ class ThreadPoolWorker {
   const std::string name_;
   std::unique_ptr<MemMap> stack_;
   pthread_t pthread_;
+  const uint64_t creation_time_ns_;
+  // Only written by the worker itself, read when dumping.
+  Atomic<uint64_t> busy_time_ns_;
+  Atomic<uint64_t> task_count_;
 
  private:
   friend class ThreadPool;
@@ -124,6 +142,9 @@ class ThreadPool {
   // Set the "nice" priorty for threads in the pool.
   void SetPthreadPriority(int priority);
 
+  // Dump the number of tasks run, and the busy and idle time of each worker.
+  void DumpWorkerTimes(std::ostream& os) const;
+
  protected:
   // get a task to run, blocks if there are no tasks left
   virtual Task* GetTask(Thread* self) REQUIRES(!task_queue_lock_);
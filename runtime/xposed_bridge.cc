@@ -0,0 +1,125 @@
+/*
+ * Copyright (C) 2016 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "xposed_bridge.h"
+
+#include "art_method-inl.h"
+#include "scoped_thread_state_change.h"
+#include "stack.h"
+
+namespace art {
+
+XposedBridge::XposedBridge(const char* shorty, bool is_static, const std::vector<Slot>& slots)
+    : shorty_(shorty), is_static_(is_static), slots_(slots) {
+  DCHECK_EQ(slots_.size(), GetNumberOfArgs() + (is_static ? 0u : 1u)) << shorty;
+}
+
+jobject XposedBridge::ReadArguments(const ScopedObjectAccessAlreadyRunnable& soa,
+                                    ArtMethod** sp,
+                                    jvalue* args) const {
+  uint8_t* const frame = reinterpret_cast<uint8_t*>(sp);
+  auto slot = slots_.begin();
+  jobject receiver = nullptr;
+  if (!is_static_) {
+    receiver = soa.AddLocalReference<jobject>(
+        reinterpret_cast<StackReference<mirror::Object>*>(frame + slot->offset)->AsMirrorPtr());
+    ++slot;
+  }
+  for (jvalue* arg = args; slot != slots_.end(); ++slot, ++arg) {
+    uint8_t* const address = frame + slot->offset;
+    switch (slot->kind) {
+      case SlotKind::kReference:
+        arg->l = soa.AddLocalReference<jobject>(
+            reinterpret_cast<StackReference<mirror::Object>*>(address)->AsMirrorPtr());
+        break;
+      case SlotKind::kWord:
+        arg->j = 0;
+        arg->i = *reinterpret_cast<jint*>(address);
+        break;
+      case SlotKind::kDoubleWord:
+        arg->j = *reinterpret_cast<jlong*>(address);
+        break;
+    }
+  }
+  return receiver;
+}
+
+void XposedBridge::WriteBackReferences(const ScopedObjectAccessAlreadyRunnable& soa,
+                                       ArtMethod** sp,
+                                       jobject receiver,
+                                       const jvalue* args) const {
+  // The local references themselves are released with the enclosing local reference frame.
+  uint8_t* const frame = reinterpret_cast<uint8_t*>(sp);
+  auto slot = slots_.begin();
+  if (!is_static_) {
+    reinterpret_cast<StackReference<mirror::Object>*>(frame + slot->offset)->Assign(
+        soa.Decode<mirror::Object*>(receiver));
+    ++slot;
+  }
+  for (const jvalue* arg = args; slot != slots_.end(); ++slot, ++arg) {
+    if (slot->kind == SlotKind::kReference) {
+      reinterpret_cast<StackReference<mirror::Object>*>(frame + slot->offset)->Assign(
+          soa.Decode<mirror::Object*>(arg->l));
+    }
+  }
+}
+
+uint32_t XposedBridge::ReadArgArray(ArtMethod** sp, uint32_t* arg_array) const {
+  uint8_t* const frame = reinterpret_cast<uint8_t*>(sp);
+  uint32_t num_words = 0;
+  for (const Slot& slot : slots_) {
+    uint8_t* const address = frame + slot.offset;
+    switch (slot.kind) {
+      case SlotKind::kReference:
+        arg_array[num_words++] =
+            reinterpret_cast<StackReference<mirror::Object>*>(address)->AsVRegValue();
+        break;
+      case SlotKind::kWord:
+        arg_array[num_words++] = *reinterpret_cast<uint32_t*>(address);
+        break;
+      case SlotKind::kDoubleWord: {
+        uint64_t value = *reinterpret_cast<uint64_t*>(address);
+        arg_array[num_words++] = static_cast<uint32_t>(value);
+        arg_array[num_words++] = static_cast<uint32_t>(value >> 32);
+        break;
+      }
+    }
+  }
+  return num_words * sizeof(uint32_t);
+}
+
+XposedBridgeCache::XposedBridgeCache() : lock_("Xposed bridge cache lock") {}
+
+const XposedBridge* XposedBridgeCache::GetOrCreate(ArtMethod* method) {
+  uint32_t shorty_len = 0;
+  const char* shorty = method->GetShorty(&shorty_len);
+  const bool is_static = method->IsStatic();
+  MutexLock mu(Thread::Current(), lock_);
+  std::unique_ptr<XposedBridge>& bridge = bridges_[std::make_pair(std::string(shorty), is_static)];
+  if (bridge == nullptr) {
+    std::vector<XposedBridge::Slot> slots;
+    ComputeXposedBridgeSlots(shorty, shorty_len, is_static, &slots);
+    bridge.reset(new XposedBridge(shorty, is_static, slots));
+  }
+  return bridge.get();
+}
+
+size_t XposedBridgeCache::Size() {
+  MutexLock mu(Thread::Current(), lock_);
+  return bridges_.size();
+}
+
+}  // namespace art
@@ -0,0 +1,129 @@
+/*
+ * Copyright (C) 2016 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ART_RUNTIME_XPOSED_BRIDGE_H_
+#define ART_RUNTIME_XPOSED_BRIDGE_H_
+
+#include <jni.h>
+
+#include <map>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "base/macros.h"
+#include "base/mutex.h"
+
+namespace art {
+
+class ArtMethod;
+class ScopedObjectAccessAlreadyRunnable;
+
+// Marshals the arguments of hooked methods with a given shorty between the quick frame of the hook
+// trampoline and the callbacks. The location of each argument in the frame is computed once, so
+// calls neither walk the shorty with a QuickArgumentVisitor nor look up the shorty in the dex file.
+class XposedBridge {
+ public:
+  enum class SlotKind : uint8_t {
+    kReference,   // A StackReference<mirror::Object>.
+    kWord,        // A 32-bit primitive, including float.
+    kDoubleWord,  // A long or double.
+  };
+
+  struct Slot {
+    uint32_t offset;  // From the bottom of the quick frame.
+    SlotKind kind;
+  };
+
+  XposedBridge(const char* shorty, bool is_static, const std::vector<Slot>& slots);
+
+  const char* GetShorty() const {
+    return shorty_.c_str();
+  }
+
+  uint32_t GetShortyLength() const {
+    return shorty_.length();
+  }
+
+  bool IsStatic() const {
+    return is_static_;
+  }
+
+  // Number of arguments, excluding the receiver.
+  size_t GetNumberOfArgs() const {
+    return shorty_.length() - 1;
+  }
+
+  // Converts the arguments in the quick frame `sp` into `args`, with references added as local
+  // references. Returns the receiver, or null for static methods.
+  jobject ReadArguments(const ScopedObjectAccessAlreadyRunnable& soa, ArtMethod** sp,
+                        jvalue* args) const
+      SHARED_REQUIRES(Locks::mutator_lock_);
+
+  // Updates the references in the quick frame `sp` which a moving GC may have changed since they
+  // were read by ReadArguments().
+  void WriteBackReferences(const ScopedObjectAccessAlreadyRunnable& soa, ArtMethod** sp,
+                           jobject receiver, const jvalue* args) const
+      SHARED_REQUIRES(Locks::mutator_lock_);
+
+  // Copies the arguments in the quick frame `sp`, including the receiver, into `arg_array` in the
+  // layout expected by ArtMethod::Invoke. Returns the number of bytes copied.
+  uint32_t ReadArgArray(ArtMethod** sp, uint32_t* arg_array) const
+      SHARED_REQUIRES(Locks::mutator_lock_);
+
+  // Upper bound of the number of words filled by ReadArgArray().
+  size_t GetMaxArgArrayWords() const {
+    return 1 + 2 * GetNumberOfArgs();
+  }
+
+ private:
+  const std::string shorty_;
+  const bool is_static_;
+  // The receiver, if any, followed by the arguments.
+  const std::vector<Slot> slots_;
+
+  DISALLOW_COPY_AND_ASSIGN(XposedBridge);
+};
+
+// Computes the slots of the receiver, if any, and the arguments of a hooked method. Implemented
+// next to QuickArgumentVisitor, which knows the calling convention of the hook trampoline.
+void ComputeXposedBridgeSlots(const char* shorty, uint32_t shorty_len, bool is_static,
+                              std::vector<XposedBridge::Slot>* slots)
+    SHARED_REQUIRES(Locks::mutator_lock_);
+
+// Bridges shared by all hooked methods with the same shorty.
+class XposedBridgeCache {
+ public:
+  XposedBridgeCache();
+
+  const XposedBridge* GetOrCreate(ArtMethod* method)
+      SHARED_REQUIRES(Locks::mutator_lock_)
+      REQUIRES(!lock_);
+
+  size_t Size() REQUIRES(!lock_);
+
+ private:
+  Mutex lock_ DEFAULT_MUTEX_ACQUIRED_AFTER;
+  std::map<std::pair<std::string, bool>, std::unique_ptr<XposedBridge>> bridges_
+      GUARDED_BY(lock_);
+
+  DISALLOW_COPY_AND_ASSIGN(XposedBridgeCache);
+};
+
+}  // namespace art
+
+#endif  // ART_RUNTIME_XPOSED_BRIDGE_H_
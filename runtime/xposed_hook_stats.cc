@@ -0,0 +1,114 @@
+/*
+ * Copyright (C) 2016 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "xposed_hook_stats.h"
+
+#include "art_method-inl.h"
+#include "base/histogram-inl.h"
+#include "base/time_utils.h"
+#include "thread-inl.h"
+#include "utils.h"
+
+namespace art {
+
+XposedHookStats::XposedHookStats(uint32_t id, const std::string& name)
+    : id_(id),
+      name_(name),
+      calls_(0),
+      total_ns_(0),
+      callback_ns_(0),
+      original_ns_(0),
+      latency_ns_(name_.c_str(), 1, 64) {}
+
+XposedHookProfiler::XposedHookProfiler() : lock_("Xposed hook profiler lock"), next_id_(0) {}
+
+XposedHookStats* XposedHookProfiler::AddHook(ArtMethod* method) {
+  const std::string name = PrettyMethod(method);
+  MutexLock mu(Thread::Current(), lock_);
+  XposedHookStats* stats = new XposedHookStats(next_id_, name);
+  stats_.emplace(next_id_, std::unique_ptr<XposedHookStats>(stats));
+  next_id_++;
+  return stats;
+}
+
+void XposedHookProfiler::RemoveHook(XposedHookStats* stats) {
+  MutexLock mu(Thread::Current(), lock_);
+  size_t removed = stats_.erase(stats->id_);
+  DCHECK_EQ(removed, 1u);
+}
+
+void XposedHookProfiler::RecordCall(Thread* self, const XposedHookSample& sample) {
+  XposedHookSampleBuffer* buffer = self->GetXposedHookSamples();
+  if (UNLIKELY(buffer == nullptr)) {
+    buffer = new XposedHookSampleBuffer();
+    self->SetXposedHookSamples(buffer);
+  }
+  XposedHookSampleBuffer::BufferedSample* buffered = &buffer->samples_[buffer->size_++];
+  buffered->stats_id = sample.stats->id_;
+  buffered->total_ns = sample.total_ns;
+  buffered->callback_ns = sample.callback_ns;
+  buffered->original_ns = sample.original_ns;
+  if (UNLIKELY(buffer->size_ == XposedHookSampleBuffer::kCapacity)) {
+    FlushSamples(self);
+  }
+}
+
+void XposedHookProfiler::FlushSamples(Thread* self) {
+  XposedHookSampleBuffer* buffer = self->GetXposedHookSamples();
+  if (buffer == nullptr || buffer->size_ == 0) {
+    return;
+  }
+  MutexLock mu(self, lock_);
+  for (size_t i = 0; i != buffer->size_; ++i) {
+    const XposedHookSampleBuffer::BufferedSample& sample = buffer->samples_[i];
+    auto it = stats_.find(sample.stats_id);
+    if (it == stats_.end()) {
+      // The hook has been removed.
+      continue;
+    }
+    XposedHookStats* stats = it->second.get();
+    stats->calls_++;
+    stats->total_ns_ += sample.total_ns;
+    stats->callback_ns_ += sample.callback_ns;
+    stats->original_ns_ += sample.original_ns;
+    stats->latency_ns_.AdjustAndAddValue(sample.total_ns);
+  }
+  buffer->size_ = 0;
+}
+
+void XposedHookProfiler::DumpForSigQuit(std::ostream& os) {
+  Thread* self = Thread::Current();
+  if (self != nullptr) {
+    FlushSamples(self);
+  }
+  MutexLock mu(self, lock_);
+  os << "Xposed hooks with statistics: " << stats_.size() << "\n";
+  for (const auto& it : stats_) {
+    const XposedHookStats* stats = it.second.get();
+    if (stats->calls_ == 0) {
+      continue;
+    }
+    os << "Xposed hook " << stats->name_ << ": calls=" << stats->calls_
+       << " total=" << PrettyDuration(stats->total_ns_)
+       << " callback=" << PrettyDuration(stats->callback_ns_)
+       << " original=" << PrettyDuration(stats->original_ns_) << "\n";
+    Histogram<uint64_t>::CumulativeData data;
+    stats->latency_ns_.CreateHistogram(&data);
+    stats->latency_ns_.PrintConfidenceIntervals(os, 0.99, data);
+  }
+}
+
+}  // namespace art
@@ -0,0 +1,124 @@
+/*
+ * Copyright (C) 2016 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ART_RUNTIME_XPOSED_HOOK_STATS_H_
+#define ART_RUNTIME_XPOSED_HOOK_STATS_H_
+
+#include <map>
+#include <memory>
+#include <ostream>
+#include <string>
+
+#include "base/histogram.h"
+#include "base/macros.h"
+#include "base/mutex.h"
+
+namespace art {
+
+class ArtMethod;
+class Thread;
+
+// Statistics of the calls of one hooked method.
+class XposedHookStats {
+ public:
+  XposedHookStats(uint32_t id, const std::string& name);
+
+ private:
+  // Identifies the statistics in buffered samples, which may outlive them.
+  const uint32_t id_;
+  const std::string name_;
+  uint64_t calls_;
+  uint64_t total_ns_;
+  uint64_t callback_ns_;
+  uint64_t original_ns_;
+  // Latency of the calls, including the callbacks and the original method.
+  Histogram<uint64_t> latency_ns_;
+
+  friend class XposedHookProfiler;
+  DISALLOW_COPY_AND_ASSIGN(XposedHookStats);
+};
+
+// One call of a hooked method. For hooks going through XposedBridge.handleHookedMethod, the time
+// spent in the original method is part of the callback time.
+struct XposedHookSample {
+  XposedHookStats* stats;
+  uint64_t total_ns;
+  uint64_t callback_ns;
+  uint64_t original_ns;
+};
+
+// Samples recorded by a single thread. Only the owning thread accesses the buffer, so recording
+// a call needs neither locks nor atomic operations.
+class XposedHookSampleBuffer {
+ public:
+  static constexpr size_t kCapacity = 64;
+
+  XposedHookSampleBuffer() : size_(0) {}
+
+ private:
+  // A sample refers to its statistics by id, so that they can be freed while threads still
+  // buffer samples of them.
+  struct BufferedSample {
+    uint32_t stats_id;
+    uint64_t total_ns;
+    uint64_t callback_ns;
+    uint64_t original_ns;
+  };
+
+  size_t size_;
+  BufferedSample samples_[kCapacity];
+
+  friend class XposedHookProfiler;
+  DISALLOW_COPY_AND_ASSIGN(XposedHookSampleBuffer);
+};
+
+// Collects per-hook call statistics, enabled with -XX:XposedHookStats. Hooks installed while it is
+// disabled carry no statistics and pay nothing. Threads buffer their samples and add them to the
+// statistics when their buffer is full, when they exit, and when they dump the statistics, so the
+// dump may not include the latest calls of other threads.
+class XposedHookProfiler {
+ public:
+  XposedHookProfiler();
+
+  // Creates the statistics of a method which is being hooked.
+  XposedHookStats* AddHook(ArtMethod* method)
+      SHARED_REQUIRES(Locks::mutator_lock_)
+      REQUIRES(!lock_);
+
+  // Frees the statistics of a hook which has been disabled or whose class loader is unloaded.
+  // Buffered samples of the hook are dropped.
+  void RemoveHook(XposedHookStats* stats) REQUIRES(!lock_);
+
+  // Records a call of a hooked method made by `self`.
+  void RecordCall(Thread* self, const XposedHookSample& sample) REQUIRES(!lock_);
+
+  // Adds the samples buffered by `self` to the statistics.
+  void FlushSamples(Thread* self) REQUIRES(!lock_);
+
+  void DumpForSigQuit(std::ostream& os) REQUIRES(!lock_);
+
+ private:
+  Mutex lock_ DEFAULT_MUTEX_ACQUIRED_AFTER;
+  // The statistics of the installed hooks, by id. Ids are not reused.
+  std::map<uint32_t, std::unique_ptr<XposedHookStats>> stats_ GUARDED_BY(lock_);
+  uint32_t next_id_ GUARDED_BY(lock_);
+
+  DISALLOW_COPY_AND_ASSIGN(XposedHookProfiler);
+};
+
+}  // namespace art
+
+#endif  // ART_RUNTIME_XPOSED_HOOK_STATS_H_
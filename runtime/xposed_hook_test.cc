@@ -0,0 +1,588 @@
+/*
+ * Copyright (C) 2016 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "art_method-inl.h"
+#include "class_linker.h"
+#include "class_table.h"
+#include "common_runtime_test.h"
+#include "entrypoints/runtime_asm_entrypoints.h"
+#include "gc/heap.h"
+#include "jni_internal.h"
+#include "linear_alloc.h"
+#include "runtime.h"
+#include "scoped_thread_state_change.h"
+#include "ScopedLocalRef.h"
+#include "thread-inl.h"
+#include "xposed_bridge.h"
+#include "xposed_hook_stats.h"
+
+namespace art {
+
+class XposedHookTest : public CommonRuntimeTest {
+ protected:
+  void SetUp() OVERRIDE {
+    CommonRuntimeTest::SetUp();
+    Thread* self = Thread::Current();
+    self->TransitionFromSuspendedToRunnable();
+    LoadDex("XposedHooks");
+    bool started = runtime_->Start();
+    CHECK(started);
+
+    env_ = self->GetJniEnv();
+    klass_ = env_->FindClass("XposedHooks");
+    CHECK(klass_ != nullptr);
+    receiver_ = env_->AllocObject(klass_);
+    CHECK(receiver_ != nullptr);
+
+    // The test class takes the place of XposedBridge.
+    ArtMethod::xposed_callback_class = reinterpret_cast<jclass>(env_->NewGlobalRef(klass_));
+    ArtMethod::xposed_callback_method = env_->GetStaticMethodID(
+        klass_,
+        "handleHookedMethod",
+        "(Ljava/lang/reflect/Member;ILjava/lang/Object;Ljava/lang/Object;[Ljava/lang/Object;)"
+        "Ljava/lang/Object;");
+    CHECK(ArtMethod::xposed_callback_method != nullptr);
+  }
+
+  void TearDown() OVERRIDE {
+    env_->DeleteGlobalRef(ArtMethod::xposed_callback_class);
+    ArtMethod::xposed_callback_class = nullptr;
+    ArtMethod::xposed_callback_method = nullptr;
+    CommonRuntimeTest::TearDown();
+  }
+
+  jmethodID Hook(const char* name, const char* signature, bool is_static, uint32_t flags) {
+    jmethodID mid = is_static ? env_->GetStaticMethodID(klass_, name, signature)
+                              : env_->GetMethodID(klass_, name, signature);
+    CHECK(mid != nullptr) << name;
+    ScopedObjectAccess soa(env_);
+    soa.DecodeMethod(mid)->EnableXposedHook(soa, nullptr, flags);
+    CHECK(!soa.Self()->IsExceptionPending());
+    return mid;
+  }
+
+  // Returns the number of managed objects allocated by the current thread while running `fn`.
+  template <typename Fn>
+  uint64_t CountAllocations(Fn fn) {
+    Thread* self = Thread::Current();
+    {
+      ScopedThreadSuspension sts(self, kSuspended);
+      runtime_->SetStatsEnabled(true);
+    }
+    fn();
+    uint64_t allocated_objects = self->GetStats()->allocated_objects;
+    {
+      ScopedThreadSuspension sts(self, kSuspended);
+      runtime_->SetStatsEnabled(false);
+    }
+    return allocated_objects;
+  }
+
+  size_t BootHookArenaBytes() NO_THREAD_SAFETY_ANALYSIS {
+    ReaderMutexLock mu(Thread::Current(), *Locks::classlinker_classes_lock_);
+    LinearAlloc* arena = runtime_->GetClassLinker()->boot_xposed_hook_allocator_;
+    return arena != nullptr ? arena->GetUsedMemory() : 0u;
+  }
+
+  size_t NumBootStrongRoots() {
+    ScopedObjectAccess soa(env_);
+    return runtime_->GetClassLinker()->ClassTableForClassLoader(nullptr)->NumStrongRoots();
+  }
+
+  JNIEnv* env_;
+  jclass klass_;
+  jobject receiver_;
+};
+
+class XposedHookStatsTest : public XposedHookTest {
+ protected:
+  void SetUpRuntimeOptions(RuntimeOptions* options) OVERRIDE {
+    options->push_back(std::make_pair("-XX:XposedHookStats", nullptr));
+  }
+};
+
+// Records the calls of native observers.
+struct ObservedCalls {
+  size_t before_calls;
+  size_t after_calls;
+  jvalue first_arg;
+  jvalue result;
+};
+
+static void NativeBeforeObserver(JNIEnv*, jobject, jobject, const jvalue* args, size_t num_args,
+                                 const jvalue* result, void* data) {
+  ObservedCalls* calls = reinterpret_cast<ObservedCalls*>(data);
+  EXPECT_TRUE(result == nullptr);
+  ASSERT_GT(num_args, 0u);
+  calls->before_calls++;
+  calls->first_arg = args[0];
+}
+
+static void NativeAfterObserver(JNIEnv*, jobject, jobject, const jvalue*, size_t,
+                                const jvalue* result, void* data) {
+  ObservedCalls* calls = reinterpret_cast<ObservedCalls*>(data);
+  ASSERT_TRUE(result != nullptr);
+  calls->after_calls++;
+  calls->result = *result;
+}
+
+// Disables the hook of the method it observes from within the call.
+struct DisablingObserverData {
+  jmethodID method;
+  ObservedCalls calls;
+};
+
+static void DisablingBeforeObserver(JNIEnv* env, jobject, jobject, const jvalue*, size_t,
+                                    const jvalue*, void* data) {
+  DisablingObserverData* observer_data = reinterpret_cast<DisablingObserverData*>(data);
+  observer_data->calls.before_calls++;
+  ScopedObjectAccess soa(env);
+  soa.DecodeMethod(observer_data->method)->DisableXposedHook(soa);
+}
+
+static void DisablingAfterObserver(JNIEnv*, jobject, jobject, const jvalue*, size_t,
+                                   const jvalue* result, void* data) {
+  DisablingObserverData* observer_data = reinterpret_cast<DisablingObserverData*>(data);
+  ASSERT_TRUE(result != nullptr);
+  observer_data->calls.after_calls++;
+  observer_data->calls.result = *result;
+}
+
+TEST_F(XposedHookTest, NonEscapingArgsDoNotAllocate) {
+  const uint32_t flags = kXposedHookNonEscapingArgs;
+  jmethodID static_int = Hook("staticInt", "(II)I", true, flags);
+  jmethodID instance_boolean = Hook("instanceBoolean", "(ZC)Z", false, flags);
+  jmethodID static_char = Hook("staticChar", "(CBS)C", true, flags);
+  jmethodID instance_object = Hook("instanceObject", "(Ljava/lang/Object;I)Ljava/lang/Object;",
+                                   false, flags);
+  jmethodID static_long = Hook("staticLong", "(J)J", true, flags);
+
+  auto call_all = [&]() {
+    EXPECT_EQ(7, env_->CallStaticIntMethod(klass_, static_int, 7, -8));
+    EXPECT_EQ(JNI_TRUE, env_->CallBooleanMethod(receiver_, instance_boolean, JNI_TRUE, 'x'));
+    EXPECT_EQ('a', env_->CallStaticCharMethod(klass_, static_char, 'a', 1, 2));
+    ScopedLocalRef<jobject> result(
+        env_, env_->CallObjectMethod(receiver_, instance_object, receiver_, 3));
+    EXPECT_TRUE(env_->IsSameObject(receiver_, result.get()));
+    EXPECT_EQ(5, env_->CallStaticLongMethod(klass_, static_long, INT64_C(5)));
+    EXPECT_FALSE(env_->ExceptionCheck());
+  };
+
+  // The first calls set up the pool of arguments arrays.
+  call_all();
+  uint64_t allocated_objects = CountAllocations([&]() {
+    for (size_t i = 0; i < 100; ++i) {
+      call_all();
+    }
+  });
+  EXPECT_EQ(0u, allocated_objects);
+}
+
+TEST_F(XposedHookTest, EscapingArgsAllocateOnlyTheArray) {
+  jmethodID static_int = Hook("staticInt", "(II)I", true, 0u);
+
+  EXPECT_EQ(1, env_->CallStaticIntMethod(klass_, static_int, 1, 2));
+  uint64_t allocated_objects = CountAllocations([&]() {
+    for (size_t i = 0; i < 10; ++i) {
+      EXPECT_EQ(1, env_->CallStaticIntMethod(klass_, static_int, 1, 2));
+    }
+  });
+  // One fresh Object[] per call, the boxes of small values come from the cache.
+  EXPECT_EQ(10u, allocated_objects);
+}
+
+TEST_F(XposedHookTest, UncachedValuesAreBoxed) {
+  jmethodID static_int = Hook("staticInt", "(II)I", true, kXposedHookNonEscapingArgs);
+  jmethodID static_long = Hook("staticLong", "(J)J", true, kXposedHookNonEscapingArgs);
+
+  EXPECT_EQ(100000, env_->CallStaticIntMethod(klass_, static_int, 100000, 0));
+  EXPECT_EQ(-129, env_->CallStaticIntMethod(klass_, static_int, -129, 0));
+  EXPECT_EQ(INT64_C(0x123456789), env_->CallStaticLongMethod(klass_, static_long,
+                                                             INT64_C(0x123456789)));
+  EXPECT_FALSE(env_->ExceptionCheck());
+}
+
+TEST_F(XposedHookTest, BatchedInstallation) {
+  jmethodID static_int = env_->GetStaticMethodID(klass_, "staticInt", "(II)I");
+  jmethodID static_long = env_->GetStaticMethodID(klass_, "staticLong", "(J)J");
+  jmethodID instance_boolean = env_->GetMethodID(klass_, "instanceBoolean", "(ZC)Z");
+  {
+    ScopedObjectAccess soa(env_);
+    // Hook one method up front, it must be skipped by the batch, as must the duplicate.
+    soa.DecodeMethod(static_long)->EnableXposedHook(soa, nullptr);
+    ArtMethod* static_int_method = soa.DecodeMethod(static_int);
+    std::vector<ArtMethod*> methods = {
+        static_int_method, soa.DecodeMethod(static_long), soa.DecodeMethod(instance_boolean),
+        static_int_method };
+    std::vector<jobject> infos(methods.size(), nullptr);
+    ArtMethod::EnableXposedHooks(soa, methods, infos);
+    ASSERT_FALSE(soa.Self()->IsExceptionPending());
+    for (ArtMethod* method : methods) {
+      EXPECT_TRUE(method->IsXposedHookedMethod()) << PrettyMethod(method);
+      EXPECT_TRUE(method->GetXposedOriginalMethod()->IsXposedOriginalMethod());
+    }
+    EXPECT_NE(static_int_method->GetXposedOriginalMethod(),
+              soa.DecodeMethod(instance_boolean)->GetXposedOriginalMethod());
+  }
+
+  jfieldID callback_count = env_->GetStaticFieldID(klass_, "callbackCount", "I");
+  env_->SetStaticIntField(klass_, callback_count, 0);
+  EXPECT_EQ(3, env_->CallStaticIntMethod(klass_, static_int, 3, 4));
+  EXPECT_EQ(9, env_->CallStaticLongMethod(klass_, static_long, INT64_C(9)));
+  EXPECT_EQ(JNI_FALSE, env_->CallBooleanMethod(receiver_, instance_boolean, JNI_FALSE, 'y'));
+  EXPECT_EQ(3, env_->GetStaticIntField(klass_, callback_count));
+}
+
+TEST_F(XposedHookTest, BackupsArePackedInTheHookArena) {
+  jmethodID static_int = env_->GetStaticMethodID(klass_, "staticInt", "(II)I");
+  jmethodID static_long = env_->GetStaticMethodID(klass_, "staticLong", "(J)J");
+  ClassLinker* class_linker = runtime_->GetClassLinker();
+  {
+    ScopedObjectAccess soa(env_);
+    std::vector<ArtMethod*> methods = {
+        soa.DecodeMethod(static_int), soa.DecodeMethod(static_long) };
+    std::vector<jobject> infos(methods.size(), nullptr);
+    ArtMethod::EnableXposedHooks(soa, methods, infos);
+    ASSERT_FALSE(soa.Self()->IsExceptionPending());
+
+    mirror::ClassLoader* class_loader = methods[0]->GetDeclaringClass()->GetClassLoader();
+    ASSERT_TRUE(class_loader != nullptr);
+    LinearAlloc* arena = class_linker->GetOrCreateXposedHookAllocatorForClassLoader(class_loader);
+    EXPECT_NE(arena, class_linker->GetAllocatorForClassLoader(class_loader));
+    ArtMethod* backup0 = methods[0]->GetXposedOriginalMethod();
+    ArtMethod* backup1 = methods[1]->GetXposedOriginalMethod();
+    EXPECT_TRUE(arena->Contains(backup0));
+    EXPECT_TRUE(arena->Contains(const_cast<XposedHookInfo*>(methods[0]->GetXposedHookInfo())));
+    EXPECT_EQ(ArtMethod::Size(class_linker->GetImagePointerSize()),
+              static_cast<size_t>(reinterpret_cast<uint8_t*>(backup1) -
+                                  reinterpret_cast<uint8_t*>(backup0)));
+  }
+  EXPECT_EQ(5, env_->CallStaticIntMethod(klass_, static_int, 5, 6));
+  EXPECT_FALSE(env_->ExceptionCheck());
+
+  std::ostringstream oss;
+  class_linker->DumpForSigQuit(oss);
+  EXPECT_NE(std::string::npos, oss.str().find("Xposed hook arenas=1 used=")) << oss.str();
+}
+
+TEST_F(XposedHookTest, MethodObjectIsKeptByTheClassLoader) {
+  jmethodID static_int = Hook("staticInt", "(II)I", true, 0u);
+  jweak reflected_method;
+  {
+    ScopedObjectAccess soa(env_);
+    reflected_method = soa.DecodeMethod(static_int)->GetXposedHookInfo()->reflectedMethod;
+  }
+  // The hook does not prevent the unloading of the class loader.
+  EXPECT_EQ(JNIWeakGlobalRefType, env_->GetObjectRefType(reflected_method));
+  runtime_->GetHeap()->CollectGarbage(false);
+  EXPECT_FALSE(env_->IsSameObject(reflected_method, nullptr));
+  EXPECT_EQ(5, env_->CallStaticIntMethod(klass_, static_int, 5, 6));
+  EXPECT_FALSE(env_->ExceptionCheck());
+}
+
+TEST_F(XposedHookTest, BridgesAreSharedPerShorty) {
+  jmethodID static_int = Hook("staticInt", "(II)I", true, 0u);
+  jmethodID other_static_int = Hook("otherStaticInt", "(II)I", true, 0u);
+  jmethodID instance_int = Hook("instanceInt", "(II)I", false, 0u);
+  jmethodID static_mixed = Hook("staticMixed", "(DIJFLjava/lang/Object;)D", true, 0u);
+  {
+    ScopedObjectAccess soa(env_);
+    const XposedBridge* bridge = soa.DecodeMethod(static_int)->GetXposedHookInfo()->bridge;
+    EXPECT_STREQ("III", bridge->GetShorty());
+    EXPECT_EQ(bridge, soa.DecodeMethod(other_static_int)->GetXposedHookInfo()->bridge);
+    // The receiver takes an argument slot.
+    EXPECT_NE(bridge, soa.DecodeMethod(instance_int)->GetXposedHookInfo()->bridge);
+  }
+
+  // The callback returns the first argument, wherever the calling convention put it.
+  EXPECT_EQ(7, env_->CallStaticIntMethod(klass_, other_static_int, 7, 8));
+  EXPECT_EQ(9, env_->CallIntMethod(receiver_, instance_int, 9, 10));
+  EXPECT_EQ(1.5, env_->CallStaticDoubleMethod(klass_, static_mixed, 1.5, 2, INT64_C(3), 4.0f,
+                                              receiver_));
+  EXPECT_FALSE(env_->ExceptionCheck());
+}
+
+TEST_F(XposedHookTest, ObserveOnlyNativeObservers) {
+  jmethodID static_int = env_->GetStaticMethodID(klass_, "staticInt", "(II)I");
+  jmethodID instance_object = env_->GetMethodID(klass_, "instanceObject",
+                                                "(Ljava/lang/Object;I)Ljava/lang/Object;");
+  ObservedCalls calls = {};
+  XposedHookObservers observers = {};
+  observers.native_before = NativeBeforeObserver;
+  observers.native_after = NativeAfterObserver;
+  observers.native_data = &calls;
+  {
+    ScopedObjectAccess soa(env_);
+    soa.DecodeMethod(static_int)->EnableXposedHook(soa, nullptr, 0u, &observers);
+    soa.DecodeMethod(instance_object)->EnableXposedHook(soa, nullptr, 0u, &observers);
+    ASSERT_FALSE(soa.Self()->IsExceptionPending());
+  }
+  jfieldID callback_count = env_->GetStaticFieldID(klass_, "callbackCount", "I");
+  env_->SetStaticIntField(klass_, callback_count, 0);
+
+  EXPECT_EQ(42, env_->CallStaticIntMethod(klass_, static_int, 42, 0));
+  EXPECT_EQ(1u, calls.before_calls);
+  EXPECT_EQ(1u, calls.after_calls);
+  EXPECT_EQ(42, calls.first_arg.i);
+  EXPECT_EQ(42, calls.result.i);
+
+  ScopedLocalRef<jobject> result(env_,
+                                 env_->CallObjectMethod(receiver_, instance_object, klass_, 1));
+  EXPECT_TRUE(env_->IsSameObject(klass_, result.get()));
+  EXPECT_EQ(2u, calls.before_calls);
+  EXPECT_EQ(2u, calls.after_calls);
+  EXPECT_TRUE(env_->IsSameObject(klass_, calls.result.l));
+  EXPECT_FALSE(env_->ExceptionCheck());
+
+  // The observers are called instead of handleHookedMethod, and do not allocate anything.
+  EXPECT_EQ(0, env_->GetStaticIntField(klass_, callback_count));
+  uint64_t allocated_objects = CountAllocations([&]() {
+    for (size_t i = 0; i < 10; ++i) {
+      EXPECT_EQ(7, env_->CallStaticIntMethod(klass_, static_int, 7, 8));
+    }
+  });
+  EXPECT_EQ(0u, allocated_objects);
+}
+
+TEST_F(XposedHookTest, ObserveOnlyManagedObservers) {
+  jmethodID static_long = env_->GetStaticMethodID(klass_, "staticLong", "(J)J");
+  XposedHookObservers observers = {};
+  observers.managed_class = klass_;
+  observers.managed_before = env_->GetStaticMethodID(
+      klass_, "beforeObserver",
+      "(Ljava/lang/reflect/Member;Ljava/lang/Object;Ljava/lang/Object;[Ljava/lang/Object;)V");
+  observers.managed_after = env_->GetStaticMethodID(
+      klass_, "afterObserver",
+      "(Ljava/lang/reflect/Member;Ljava/lang/Object;Ljava/lang/Object;[Ljava/lang/Object;"
+      "Ljava/lang/Object;)V");
+  ASSERT_TRUE(observers.managed_before != nullptr);
+  ASSERT_TRUE(observers.managed_after != nullptr);
+  {
+    ScopedObjectAccess soa(env_);
+    soa.DecodeMethod(static_long)->EnableXposedHook(soa, nullptr, kXposedHookNonEscapingArgs,
+                                                    &observers);
+    ASSERT_FALSE(soa.Self()->IsExceptionPending());
+  }
+  jfieldID callback_count = env_->GetStaticFieldID(klass_, "callbackCount", "I");
+  jfieldID observer_count = env_->GetStaticFieldID(klass_, "observerCount", "I");
+  env_->SetStaticIntField(klass_, callback_count, 0);
+
+  EXPECT_EQ(INT64_C(0x123456789), env_->CallStaticLongMethod(klass_, static_long,
+                                                             INT64_C(0x123456789)));
+  EXPECT_FALSE(env_->ExceptionCheck());
+  EXPECT_EQ(2, env_->GetStaticIntField(klass_, observer_count));
+  EXPECT_EQ(0, env_->GetStaticIntField(klass_, callback_count));
+
+  // The after observer sees the boxed result.
+  ScopedLocalRef<jobject> observed(env_, env_->GetStaticObjectField(
+      klass_, env_->GetStaticFieldID(klass_, "lastObservedResult", "Ljava/lang/Object;")));
+  ScopedLocalRef<jclass> long_class(env_, env_->FindClass("java/lang/Long"));
+  jmethodID long_value = env_->GetMethodID(long_class.get(), "longValue", "()J");
+  EXPECT_EQ(INT64_C(0x123456789), env_->CallLongMethod(observed.get(), long_value));
+}
+
+TEST_F(XposedHookTest, DisableAndRehook) {
+  jmethodID other_static_int = env_->GetStaticMethodID(klass_, "otherStaticInt", "(II)I");
+  ASSERT_TRUE(other_static_int != nullptr);
+  uint32_t access_flags;
+  {
+    ScopedObjectAccess soa(env_);
+    access_flags = soa.DecodeMethod(other_static_int)->GetAccessFlags();
+  }
+  jfieldID callback_count = env_->GetStaticFieldID(klass_, "callbackCount", "I");
+  env_->SetStaticIntField(klass_, callback_count, 0);
+
+  // The callback returns the first argument, the original method the second one.
+  Hook("otherStaticInt", "(II)I", true, 0u);
+  EXPECT_EQ(1, env_->CallStaticIntMethod(klass_, other_static_int, 1, 2));
+  ArtMethod* first_backup;
+  // The backup is not reused while its Method object is alive.
+  ScopedLocalRef<jobject> first_backup_object(env_, nullptr);
+  {
+    ScopedObjectAccess soa(env_);
+    ArtMethod* method = soa.DecodeMethod(other_static_int);
+    first_backup = method->GetXposedOriginalMethod();
+    first_backup_object.reset(env_->NewLocalRef(method->GetXposedHookInfo()->reflectedMethod));
+    method->DisableXposedHook(soa);
+    EXPECT_FALSE(method->IsXposedHookedMethod());
+    EXPECT_EQ(access_flags, method->GetAccessFlags());
+    EXPECT_NE(GetQuickXposedInvokeHandler(), method->GetEntryPointFromQuickCompiledCode());
+    // Disabling it again does nothing.
+    method->DisableXposedHook(soa);
+  }
+  EXPECT_EQ(2, env_->CallStaticIntMethod(klass_, other_static_int, 1, 2));
+  EXPECT_EQ(1, env_->GetStaticIntField(klass_, callback_count));
+
+  // Hooking the method again creates a new backup.
+  Hook("otherStaticInt", "(II)I", true, 0u);
+  EXPECT_EQ(3, env_->CallStaticIntMethod(klass_, other_static_int, 3, 4));
+  EXPECT_EQ(2, env_->GetStaticIntField(klass_, callback_count));
+  EXPECT_FALSE(env_->ExceptionCheck());
+  {
+    ScopedObjectAccess soa(env_);
+    EXPECT_NE(first_backup, soa.DecodeMethod(other_static_int)->GetXposedOriginalMethod());
+  }
+
+  std::ostringstream oss;
+  {
+    ScopedThreadSuspension sts(Thread::Current(), kSuspended);
+    runtime_->DumpForSigQuit(oss);
+  }
+  EXPECT_NE(std::string::npos, oss.str().find("Xposed hooks installed=2 disabled=1 released=1 reused=0\n"))
+      << oss.str();
+}
+
+TEST_F(XposedHookTest, DisableDuringCall) {
+  jmethodID other_static_int = env_->GetStaticMethodID(klass_, "otherStaticInt", "(II)I");
+  ASSERT_TRUE(other_static_int != nullptr);
+  DisablingObserverData data = {};
+  data.method = other_static_int;
+  XposedHookObservers observers = {};
+  observers.native_before = DisablingBeforeObserver;
+  observers.native_after = DisablingAfterObserver;
+  observers.native_data = &data;
+  {
+    ScopedObjectAccess soa(env_);
+    soa.DecodeMethod(other_static_int)->EnableXposedHook(soa, nullptr, 0u, &observers);
+    ASSERT_FALSE(soa.Self()->IsExceptionPending());
+  }
+
+  // The call which disables the hook still completes through it.
+  EXPECT_EQ(6, env_->CallStaticIntMethod(klass_, other_static_int, 5, 6));
+  EXPECT_FALSE(env_->ExceptionCheck());
+  EXPECT_EQ(1u, data.calls.before_calls);
+  EXPECT_EQ(1u, data.calls.after_calls);
+  EXPECT_EQ(6, data.calls.result.i);
+  {
+    ScopedObjectAccess soa(env_);
+    EXPECT_FALSE(soa.DecodeMethod(other_static_int)->IsXposedHookedMethod());
+  }
+  EXPECT_EQ(8, env_->CallStaticIntMethod(klass_, other_static_int, 7, 8));
+  EXPECT_EQ(1u, data.calls.before_calls);
+
+  // The global references of the hook are released when that call returns.
+  std::ostringstream oss;
+  {
+    ScopedThreadSuspension sts(Thread::Current(), kSuspended);
+    runtime_->DumpForSigQuit(oss);
+  }
+  EXPECT_NE(std::string::npos, oss.str().find("Xposed hooks installed=1 disabled=1 released=1 reused=0\n"))
+      << oss.str();
+}
+
+TEST_F(XposedHookTest, ToggledBootHookReusesItsMemory) {
+  ScopedLocalRef<jclass> integer_class(env_, env_->FindClass("java/lang/Integer"));
+  jmethodID to_octal_string =
+      env_->GetStaticMethodID(integer_class.get(), "toOctalString", "(I)Ljava/lang/String;");
+  ASSERT_TRUE(to_octal_string != nullptr);
+  static constexpr size_t kCycles = 10;
+  size_t arena_bytes = 0u;
+  size_t num_roots = 0u;
+  for (size_t i = 0; i != kCycles; ++i) {
+    {
+      ScopedObjectAccess soa(env_);
+      ArtMethod* method = soa.DecodeMethod(to_octal_string);
+      method->EnableXposedHook(soa, nullptr, 0u);
+      ASSERT_FALSE(soa.Self()->IsExceptionPending());
+      method->DisableXposedHook(soa);
+      EXPECT_FALSE(method->IsXposedHookedMethod());
+    }
+    // Collects the Method object of the backup, so that the next hook can reuse the backup.
+    runtime_->GetHeap()->CollectGarbage(false);
+    if (i == 0) {
+      arena_bytes = BootHookArenaBytes();
+      num_roots = NumBootStrongRoots();
+      EXPECT_NE(0u, arena_bytes);
+    } else {
+      EXPECT_EQ(arena_bytes, BootHookArenaBytes()) << i;
+      EXPECT_EQ(num_roots, NumBootStrongRoots()) << i;
+    }
+  }
+  ScopedLocalRef<jstring> octal(
+      env_, reinterpret_cast<jstring>(
+          env_->CallStaticObjectMethod(integer_class.get(), to_octal_string, 8)));
+  ASSERT_TRUE(octal.get() != nullptr);
+  const char* chars = env_->GetStringUTFChars(octal.get(), nullptr);
+  EXPECT_STREQ("10", chars);
+  env_->ReleaseStringUTFChars(octal.get(), chars);
+
+  std::ostringstream oss;
+  {
+    ScopedThreadSuspension sts(Thread::Current(), kSuspended);
+    runtime_->DumpForSigQuit(oss);
+  }
+  EXPECT_NE(std::string::npos, oss.str().find("released=10 reused=9\n")) << oss.str();
+  EXPECT_NE(std::string::npos, oss.str().find(" free hooks=1\n")) << oss.str();
+}
+
+TEST_F(XposedHookTest, NoStatisticsByDefault) {
+  jmethodID static_int = Hook("staticInt", "(II)I", true, 0u);
+  EXPECT_EQ(1, env_->CallStaticIntMethod(klass_, static_int, 1, 2));
+  EXPECT_TRUE(runtime_->GetXposedHookProfiler() == nullptr);
+  ScopedObjectAccess soa(env_);
+  EXPECT_TRUE(soa.DecodeMethod(static_int)->GetXposedHookInfo()->stats == nullptr);
+}
+
+TEST_F(XposedHookStatsTest, DumpForSigQuit) {
+  jmethodID static_int = Hook("staticInt", "(II)I", true, 0u);
+  Hook("staticLong", "(J)J", true, 0u);
+  for (size_t i = 0; i < 100; ++i) {
+    EXPECT_EQ(3, env_->CallStaticIntMethod(klass_, static_int, 3, 4));
+  }
+  EXPECT_FALSE(env_->ExceptionCheck());
+
+  std::ostringstream oss;
+  {
+    ScopedObjectAccess soa(env_);
+    EXPECT_TRUE(soa.DecodeMethod(static_int)->GetXposedHookInfo()->stats != nullptr);
+    ASSERT_TRUE(runtime_->GetXposedHookProfiler() != nullptr);
+  }
+  runtime_->GetXposedHookProfiler()->DumpForSigQuit(oss);
+  std::string dump = oss.str();
+  EXPECT_NE(std::string::npos, dump.find("Xposed hooks with statistics: 2\n")) << dump;
+  EXPECT_NE(std::string::npos,
+            dump.find("Xposed hook int XposedHooks.staticInt(int, int): calls=100 total="))
+      << dump;
+  EXPECT_NE(std::string::npos, dump.find(" callback=")) << dump;
+  EXPECT_NE(std::string::npos, dump.find(" original=")) << dump;
+  // Hooks which were never called are not listed.
+  EXPECT_EQ(std::string::npos, dump.find("staticLong")) << dump;
+}
+
+TEST_F(XposedHookStatsTest, DisabledHooksFreeTheirStatistics) {
+  jmethodID static_int = Hook("staticInt", "(II)I", true, 0u);
+  // The samples of these calls stay in the buffer of the thread.
+  for (size_t i = 0; i < 10; ++i) {
+    EXPECT_EQ(3, env_->CallStaticIntMethod(klass_, static_int, 3, 4));
+  }
+  EXPECT_FALSE(env_->ExceptionCheck());
+  {
+    ScopedObjectAccess soa(env_);
+    ArtMethod* method = soa.DecodeMethod(static_int);
+    const XposedHookInfo* hook_info = method->GetXposedHookInfo();
+    method->DisableXposedHook(soa);
+    EXPECT_TRUE(hook_info->stats == nullptr);
+  }
+
+  // The buffered samples of the freed statistics are dropped.
+  std::ostringstream oss;
+  runtime_->GetXposedHookProfiler()->DumpForSigQuit(oss);
+  std::string dump = oss.str();
+  EXPECT_NE(std::string::npos, dump.find("Xposed hooks with statistics: 0\n")) << dump;
+  EXPECT_EQ(std::string::npos, dump.find("staticInt")) << dump;
+}
+
+}  // namespace art
@@ -0,0 +1,56 @@
+/*
+ * Copyright (C) 2016 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+import java.lang.reflect.Member;
+import java.lang.reflect.Method;
+
+public class Main {
+  public static void main(String[] args) throws Exception {
+    System.loadLibrary(args[0]);
+    ensureJitCompiled(Main.class, "getValue");
+    ensureJitCompiled(Main.class, "callGetter");
+    System.out.println("Before hook: " + callGetter());
+
+    Method getter = Main.class.getDeclaredMethod("getValue");
+    hookMethod(getter);
+    // The compiled code of getValue now belongs to the backup. The compiled code of callGetter
+    // reaches the hook through the entry point of getValue.
+    System.out.println("After hook: " + callGetter());
+
+    ensureJitCompiled(Main.class, "callGetter");
+    System.out.println("After recompilation: " + callGetter());
+
+    System.out.println("Original: " + invokeOriginal(getter));
+  }
+
+  private static int getValue() {
+    return 42;
+  }
+
+  private static int callGetter() {
+    return getValue();
+  }
+
+  // Called by the runtime in place of XposedBridge.handleHookedMethod.
+  private static Object handleHookedMethod(Member method, int originalMethodId,
+      Object additionalInfo, Object thisObject, Object[] args) {
+    return 43;
+  }
+
+  private static native void ensureJitCompiled(Class<?> cls, String methodName);
+  private static native void hookMethod(Method method);
+  private static native int invokeOriginal(Method method);
+}
@@ -0,0 +1,49 @@
+/*
+ * Copyright (C) 2016 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "art_method-inl.h"
+#include "jni.h"
+#include "scoped_thread_state_change.h"
+
+namespace art {
+
+// Hooks `method`, routing its invocations to Main.handleHookedMethod.
+extern "C" JNIEXPORT void JNICALL Java_Main_hookMethod(JNIEnv* env, jclass klass, jobject method) {
+  ArtMethod::xposed_callback_class = reinterpret_cast<jclass>(env->NewGlobalRef(klass));
+  ArtMethod::xposed_callback_method = env->GetStaticMethodID(
+      klass,
+      "handleHookedMethod",
+      "(Ljava/lang/reflect/Member;ILjava/lang/Object;Ljava/lang/Object;[Ljava/lang/Object;)"
+      "Ljava/lang/Object;");
+  CHECK(ArtMethod::xposed_callback_method != nullptr);
+  ScopedObjectAccess soa(env);
+  ArtMethod::FromReflectedMethod(soa, method)->EnableXposedHook(soa, nullptr);
+}
+
+// Calls the original implementation of the hooked static int method `method`.
+extern "C" JNIEXPORT jint JNICALL Java_Main_invokeOriginal(JNIEnv* env, jclass klass,
+                                                          jobject method) {
+  jmethodID original;
+  {
+    ScopedObjectAccess soa(env);
+    ArtMethod* hooked_method = ArtMethod::FromReflectedMethod(soa, method);
+    CHECK(hooked_method->IsXposedHookedMethod());
+    original = soa.EncodeMethod(hooked_method->GetXposedOriginalMethod());
+  }
+  return env->CallStaticIntMethod(klass, original);
+}
+
+}  // namespace art
@@ -0,0 +1,150 @@
+/*
+ * Copyright (C) 2016 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+import java.lang.reflect.Member;
+import java.lang.reflect.Method;
+import java.util.Arrays;
+import java.util.concurrent.CountDownLatch;
+import java.util.concurrent.atomic.AtomicInteger;
+
+public class Main implements Runnable {
+  private static final int NUM_WORKERS = 32;
+  private static final int STACK_DEPTH = 200;
+  private static final int NUM_LEAVES = 8;
+  // One installation for recurse(), then one per leaf.
+  private static final int NUM_INSTALLATIONS = NUM_LEAVES + 1;
+
+  private static final CountDownLatch ready = new CountDownLatch(NUM_WORKERS);
+  private static final AtomicInteger hookedCalls = new AtomicInteger();
+  private static volatile boolean stop = false;
+
+  private int result;
+
+  public static void main(String[] args) throws Exception {
+    System.loadLibrary(args[0]);
+
+    Main[] workers = new Main[NUM_WORKERS];
+    Thread[] threads = new Thread[NUM_WORKERS];
+    for (int i = 0; i < NUM_WORKERS; i++) {
+      workers[i] = new Main();
+      threads[i] = new Thread(workers[i]);
+      threads[i].start();
+    }
+    ready.await();
+    System.out.println("Workers ready");
+
+    // The previous installation path walked the stacks of all threads in its pause. Measure that
+    // pause with the same workers running, before any frame needs to be switched.
+    Method recurse = Main.class.getDeclaredMethod("recurse", int.class);
+    long[] eagerPauses = new long[NUM_INSTALLATIONS];
+    for (int i = 0; i < NUM_INSTALLATIONS; i++) {
+      eagerPauses[i] = measureEagerStackWalkPause(recurse);
+      Thread.sleep(10);
+    }
+
+    // Every worker has STACK_DEPTH frames of recurse() running the original code.
+    long[] hookPauses = new long[NUM_INSTALLATIONS];
+    hookPauses[0] = hookMethods(new Method[] { recurse });
+    Runtime.getRuntime().gc();
+    System.out.println("Hooked recurse");
+
+    // Install the other hooks one by one, walking the stacks in between.
+    for (int i = 0; i < NUM_LEAVES; i++) {
+      hookPauses[i + 1] =
+          hookMethods(new Method[] { Main.class.getDeclaredMethod("leaf" + i, int.class) });
+      Runtime.getRuntime().gc();
+      Thread.sleep(10);
+    }
+    System.out.println("Hooked leaf methods");
+
+    // Both pauses suspend the same threads, installations only save the walk of their stacks.
+    long hookPause = median(hookPauses);
+    long eagerPause = median(eagerPauses);
+    if (hookPause >= eagerPause) {
+      System.out.println("Median hook pause of " + hookPause + "ns, not below the " + eagerPause +
+          "ns of the stack walks of the previous installation path");
+    }
+
+    stop = true;
+    for (int i = 0; i < NUM_WORKERS; i++) {
+      threads[i].join();
+      if (workers[i].result != STACK_DEPTH) {
+        System.out.println("Worker " + i + " unwound " + workers[i].result + " frames");
+      }
+    }
+    if (hookedCalls.get() == 0) {
+      System.out.println("No hooked calls");
+    }
+    System.out.println("Workers finished");
+    System.out.println("Finishing");
+  }
+
+  public void run() {
+    result = recurse(STACK_DEPTH);
+  }
+
+  private static int recurse(int depth) {
+    if (depth == 0) {
+      ready.countDown();
+      spin();
+      return 0;
+    }
+    return recurse(depth - 1) + 1;
+  }
+
+  // Exercises everything which walks the stack of a worker.
+  private static void spin() {
+    int sum = 0;
+    while (!stop) {
+      // Calls of hooked leaves catch up with the hooks installed since the previous call.
+      sum += leaf0(sum) + leaf1(sum) + leaf2(sum) + leaf3(sum);
+      sum += leaf4(sum) + leaf5(sum) + leaf6(sum) + leaf7(sum);
+      try {
+        throw new Exception("Unwinding " + sum);
+      } catch (Exception e) {
+        // The stack trace walks all frames of recurse().
+        sum += e.getStackTrace().length;
+      }
+      Object[] garbage = new Object[64];
+      sum += garbage.length;
+    }
+  }
+
+  private static long median(long[] values) {
+    long[] sorted = values.clone();
+    Arrays.sort(sorted);
+    return sorted[sorted.length / 2];
+  }
+
+  private static int leaf0(int value) { return value & 1; }
+  private static int leaf1(int value) { return value & 2; }
+  private static int leaf2(int value) { return value & 4; }
+  private static int leaf3(int value) { return value & 8; }
+  private static int leaf4(int value) { return value & 16; }
+  private static int leaf5(int value) { return value & 32; }
+  private static int leaf6(int value) { return value & 64; }
+  private static int leaf7(int value) { return value & 128; }
+
+  // Called by the runtime in place of XposedBridge.handleHookedMethod.
+  private static Object handleHookedMethod(Member method, int originalMethodId,
+      Object additionalInfo, Object thisObject, Object[] args) {
+    hookedCalls.incrementAndGet();
+    return 0;
+  }
+
+  private static native long hookMethods(Method[] methods);
+  private static native long measureEagerStackWalkPause(Method method);
+}
@@ -0,0 +1,109 @@
+/*
+ * Copyright (C) 2016 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <vector>
+
+#include "art_method-inl.h"
+#include "base/time_utils.h"
+#include "jni.h"
+#include "runtime.h"
+#include "scoped_thread_state_change.h"
+#include "ScopedLocalRef.h"
+#include "stack.h"
+#include "thread_list.h"
+
+namespace art {
+
+// Hooks `methods` in one batch, routing their invocations to Main.handleHookedMethod. Returns
+// how long the installation paused the threads.
+extern "C" JNIEXPORT jlong JNICALL Java_Main_hookMethods(JNIEnv* env,
+                                                        jclass klass,
+                                                        jobjectArray methods) {
+  ArtMethod::xposed_callback_class = reinterpret_cast<jclass>(env->NewGlobalRef(klass));
+  ArtMethod::xposed_callback_method = env->GetStaticMethodID(
+      klass,
+      "handleHookedMethod",
+      "(Ljava/lang/reflect/Member;ILjava/lang/Object;Ljava/lang/Object;[Ljava/lang/Object;)"
+      "Ljava/lang/Object;");
+  CHECK(ArtMethod::xposed_callback_method != nullptr);
+  ScopedObjectAccess soa(env);
+  std::vector<ArtMethod*> hooked_methods;
+  for (jsize i = 0, length = env->GetArrayLength(methods); i != length; ++i) {
+    ScopedLocalRef<jobject> method(env, env->GetObjectArrayElement(methods, i));
+    hooked_methods.push_back(ArtMethod::FromReflectedMethod(soa, method.get()));
+  }
+  uint64_t pause_time_ns = Runtime::Current()->GetXposedHookPauseTime();
+  ArtMethod::EnableXposedHooks(soa, hooked_methods,
+                               std::vector<jobject>(hooked_methods.size(), nullptr));
+  return static_cast<jlong>(Runtime::Current()->GetXposedHookPauseTime() - pause_time_ns);
+}
+
+// Looks for frames of a method in the stack of a thread, like installations did for each hooked
+// method before frames were switched to the backups lazily.
+class FindMethodFramesVisitor FINAL : public StackVisitor {
+ public:
+  FindMethodFramesVisitor(Thread* thread, ArtMethod* method, size_t* number_of_frames)
+      : StackVisitor(thread, nullptr, StackVisitor::StackWalkKind::kSkipInlinedFrames),
+        method_(method),
+        number_of_frames_(number_of_frames) {}
+
+  bool VisitFrame() OVERRIDE SHARED_REQUIRES(Locks::mutator_lock_) {
+    if (GetMethod() == method_) {
+      ++*number_of_frames_;
+    }
+    return true;
+  }
+
+ private:
+  ArtMethod* const method_;
+  size_t* const number_of_frames_;
+};
+
+struct FindMethodFramesArgs {
+  ArtMethod* method;
+  size_t number_of_frames;
+};
+
+static void FindMethodFrames(Thread* thread, void* arg) SHARED_REQUIRES(Locks::mutator_lock_) {
+  FindMethodFramesArgs* args = reinterpret_cast<FindMethodFramesArgs*>(arg);
+  FindMethodFramesVisitor visitor(thread, args->method, &args->number_of_frames);
+  visitor.WalkStack();
+}
+
+// Returns how long the threads are paused to walk all their stacks looking for frames of
+// `method`, as the previous installation path did in its pause. Installations now skip that walk,
+// so they should pause the threads for less time.
+extern "C" JNIEXPORT jlong JNICALL Java_Main_measureEagerStackWalkPause(JNIEnv* env,
+                                                                       jclass,
+                                                                       jobject method) {
+  ScopedObjectAccess soa(env);
+  FindMethodFramesArgs args = { ArtMethod::FromReflectedMethod(soa, method), 0u };
+  uint64_t pause_time_ns;
+  {
+    const uint64_t pause_start_ns = NanoTime();
+    ScopedThreadSuspension sts(soa.Self(), kSuspended);
+    ScopedSuspendAll ssa("Walking all stacks");
+    {
+      MutexLock mu(Thread::Current(), *Locks::thread_list_lock_);
+      Runtime::Current()->GetThreadList()->ForEach(FindMethodFrames, &args);
+    }
+    pause_time_ns = NanoTime() - pause_start_ns;
+  }
+  CHECK_NE(args.number_of_frames, 0u);
+  return static_cast<jlong>(pause_time_ns);
+}
+
+}  // namespace art
@@ -0,0 +1,110 @@
+/*
+ * Copyright (C) 2016 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <vector>
+
+#include "art_method-inl.h"
+#include "class_linker.h"
+#include "dex_instruction.h"
+#include "jit/profiling_info.h"
+#include "jni.h"
+#include "mirror/class-inl.h"
+#include "mirror/object_array-inl.h"
+#include "runtime.h"
+#include "scoped_thread_state_change.h"
+#include "ScopedUtfChars.h"
+
+namespace art {
+
+static ArtMethod* FindMethod(const ScopedObjectAccess& soa, jclass cls, jstring method_name)
+    SHARED_REQUIRES(Locks::mutator_lock_) {
+  ScopedUtfChars chars(soa.Env(), method_name);
+  CHECK(chars.c_str() != nullptr);
+  ArtMethod* method = soa.Decode<mirror::Class*>(cls)->FindDeclaredDirectMethodByName(
+      chars.c_str(), sizeof(void*));
+  CHECK(method != nullptr) << chars.c_str();
+  return method;
+}
+
+extern "C" JNIEXPORT void JNICALL Java_Main_createProfilingInfo(JNIEnv*,
+                                                                 jclass,
+                                                                 jclass cls,
+                                                                 jstring method_name) {
+  if (!Runtime::Current()->UseJitCompilation()) {
+    return;
+  }
+  ScopedObjectAccess soa(Thread::Current());
+  ArtMethod* method = FindMethod(soa, cls, method_name);
+  ProfilingInfo::Create(soa.Self(), method, /* retry_allocation */ true);
+}
+
+// Returns whether the JIT profiles the method when it runs, because the interpreter runs it.
+extern "C" JNIEXPORT jboolean JNICALL Java_Main_isProfiled(JNIEnv*,
+                                                           jclass,
+                                                           jclass cls,
+                                                           jstring method_name) {
+  if (!Runtime::Current()->UseJitCompilation()) {
+    return JNI_FALSE;
+  }
+  ScopedObjectAccess soa(Thread::Current());
+  ArtMethod* method = FindMethod(soa, cls, method_name);
+  return Runtime::Current()->GetClassLinker()->IsQuickToInterpreterBridge(
+      method->GetEntryPointFromQuickCompiledCode());
+}
+
+// Returns the number of receivers of each of `types` counted by the inline cache of the only
+// virtual or interface call of the method, followed by the number of untracked receivers.
+extern "C" JNIEXPORT jintArray JNICALL Java_Main_getReceiverCounts(JNIEnv* env,
+                                                                   jclass,
+                                                                   jclass cls,
+                                                                   jstring method_name,
+                                                                   jobjectArray types) {
+  jsize number_of_types = env->GetArrayLength(types);
+  std::vector<jint> counts(number_of_types + 1, 0);
+  {
+    ScopedObjectAccess soa(Thread::Current());
+    ArtMethod* method = FindMethod(soa, cls, method_name);
+    ProfilingInfo* info = method->GetProfilingInfo(sizeof(void*));
+    CHECK(info != nullptr);
+    const DexFile::CodeItem* code_item = method->GetCodeItem();
+    const InlineCache* cache = nullptr;
+    for (uint32_t dex_pc = 0; dex_pc < code_item->insns_size_in_code_units_;) {
+      const Instruction* instruction = Instruction::At(code_item->insns_ + dex_pc);
+      if (instruction->Opcode() == Instruction::INVOKE_VIRTUAL ||
+          instruction->Opcode() == Instruction::INVOKE_INTERFACE) {
+        CHECK(cache == nullptr) << PrettyMethod(method) << " has several calls";
+        cache = info->GetInlineCache(dex_pc);
+      }
+      dex_pc += instruction->SizeInCodeUnits();
+    }
+    CHECK(cache != nullptr);
+    mirror::ObjectArray<mirror::Class>* classes =
+        soa.Decode<mirror::ObjectArray<mirror::Class>*>(types);
+    for (jsize i = 0; i < number_of_types; ++i) {
+      for (size_t j = 0; j < InlineCache::kIndividualCacheSize; ++j) {
+        if (cache->GetTypeAt(j) == classes->Get(i)) {
+          counts[i] = cache->GetCountAt(j);
+        }
+      }
+    }
+    counts[number_of_types] = cache->GetUntrackedCount();
+  }
+  jintArray result = env->NewIntArray(counts.size());
+  env->SetIntArrayRegion(result, 0, counts.size(), counts.data());
+  return result;
+}
+
+}  // namespace art
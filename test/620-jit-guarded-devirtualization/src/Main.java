@@ -0,0 +1,148 @@
+/*
+ * Copyright (C) 2016 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+import java.util.Arrays;
+
+interface Polygon {
+  int corners();
+}
+
+abstract class Shape implements Polygon {
+  abstract int sides();
+}
+
+class Triangle extends Shape {
+  int sides() { return 3; }
+  public int corners() { return 3; }
+}
+
+class Square extends Shape {
+  int sides() { return 4; }
+  public int corners() { return 4; }
+}
+
+class Pentagon extends Shape {
+  int sides() { return 5; }
+  public int corners() { return 5; }
+}
+
+class Hexagon extends Shape {
+  int sides() { return 6; }
+  public int corners() { return 6; }
+}
+
+class Heptagon extends Shape {
+  int sides() { return 7; }
+  public int corners() { return 7; }
+}
+
+class Octagon extends Shape {
+  int sides() { return 8; }
+  public int corners() { return 8; }
+}
+
+class Nonagon extends Shape {
+  int sides() { return 9; }
+  public int corners() { return 9; }
+}
+
+public class Main {
+  // Squares are dominant, and the six types make the call sites megamorphic. The first five
+  // types fill the inline caches, and octagons are counted as untracked.
+  static final Shape[] SHAPES = {
+      new Square(), new Triangle(), new Square(), new Pentagon(), new Square(), new Hexagon(),
+      new Square(), new Heptagon(), new Square(), new Octagon(), new Square(), new Square(),
+      new Square(), new Square(), new Square()
+  };
+  static final Class<?>[] TYPES = {
+      Square.class, Triangle.class, Pentagon.class, Hexagon.class, Heptagon.class, Octagon.class
+  };
+  static final int ITERATIONS = 100;
+
+  public static void main(String[] args) {
+    System.loadLibrary(args[0]);
+    createProfilingInfo(Main.class, "sumSides");
+    createProfilingInfo(Main.class, "sumCorners");
+    boolean profiled = isProfiled(Main.class, "sumSides") && isProfiled(Main.class, "sumCorners");
+    for (int i = 0; i < ITERATIONS; ++i) {
+      expectEquals(69, sumSides(SHAPES));
+      expectEquals(69, sumCorners(SHAPES));
+    }
+    if (profiled) {
+      int[] expected = { 10 * ITERATIONS, ITERATIONS, ITERATIONS, ITERATIONS, ITERATIONS, 0,
+                         ITERATIONS };
+      expectEquals(expected, getReceiverCounts(Main.class, "sumSides", TYPES));
+      expectEquals(expected, getReceiverCounts(Main.class, "sumCorners", TYPES));
+    }
+
+    // The compiled code calls the methods of squares directly, and dispatches the other shapes.
+    ensureJitCompiled(Main.class, "sumSides");
+    ensureJitCompiled(Main.class, "sumCorners");
+    System.out.println("Sides: " + sumSides(SHAPES));
+    System.out.println("Corners: " + sumCorners(SHAPES));
+    Shape[] unseen = { new Nonagon(), new Square(), new Nonagon() };
+    System.out.println("Unseen sides: " + sumSides(unseen));
+    System.out.println("Unseen corners: " + sumCorners(unseen));
+    Shape[] withNull = { new Square(), null };
+    try {
+      sumSides(withNull);
+      System.out.println("Missing NullPointerException for sides");
+    } catch (NullPointerException expected) {
+      System.out.println("NullPointerException for sides");
+    }
+    try {
+      sumCorners(withNull);
+      System.out.println("Missing NullPointerException for corners");
+    } catch (NullPointerException expected) {
+      System.out.println("NullPointerException for corners");
+    }
+  }
+
+  static int sumSides(Shape[] shapes) {
+    int sum = 0;
+    for (Shape shape : shapes) {
+      sum += shape.sides();
+    }
+    return sum;
+  }
+
+  static int sumCorners(Polygon[] polygons) {
+    int sum = 0;
+    for (Polygon polygon : polygons) {
+      sum += polygon.corners();
+    }
+    return sum;
+  }
+
+  static void expectEquals(int expected, int actual) {
+    if (expected != actual) {
+      throw new Error("Expected " + expected + ", got " + actual);
+    }
+  }
+
+  static void expectEquals(int[] expected, int[] actual) {
+    if (!Arrays.equals(expected, actual)) {
+      throw new Error("Expected " + Arrays.toString(expected) + ", got " +
+          Arrays.toString(actual));
+    }
+  }
+
+  private static native void createProfilingInfo(Class<?> cls, String methodName);
+  private static native boolean isProfiled(Class<?> cls, String methodName);
+  private static native int[] getReceiverCounts(Class<?> cls, String methodName,
+      Class<?>[] types);
+  private static native void ensureJitCompiled(Class<?> cls, String methodName);
+}
@@ -0,0 +1,71 @@
+/*
+ * Copyright (C) 2016 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "art_method-inl.h"
+#include "jit/jit.h"
+#include "jit/jit_code_cache.h"
+#include "jit/profiling_info.h"
+#include "jni.h"
+#include "mirror/class-inl.h"
+#include "oat_quick_method_header.h"
+#include "runtime.h"
+#include "scoped_thread_state_change.h"
+#include "ScopedUtfChars.h"
+
+namespace art {
+
+extern "C" JNIEXPORT jboolean JNICALL Java_Main_hasHotCodeRegion(JNIEnv*, jclass) {
+  jit::Jit* jit = Runtime::Current()->GetJit();
+  return jit != nullptr &&
+      Runtime::Current()->UseJitCompilation() &&
+      jit->GetCodeCache()->HasHotRegion();
+}
+
+extern "C" JNIEXPORT jboolean JNICALL Java_Main_isInHotCodeRegion(JNIEnv* env,
+                                                                  jclass,
+                                                                  jclass cls,
+                                                                  jstring method_name) {
+  jit::JitCodeCache* code_cache = Runtime::Current()->GetJit()->GetCodeCache();
+  ScopedObjectAccess soa(Thread::Current());
+  ScopedUtfChars chars(env, method_name);
+  CHECK(chars.c_str() != nullptr);
+  ArtMethod* method = soa.Decode<mirror::Class*>(cls)->FindDeclaredDirectMethodByName(
+      chars.c_str(), sizeof(void*));
+  CHECK(method != nullptr) << chars.c_str();
+  const void* entry_point = method->GetEntryPointFromQuickCompiledCode();
+  ProfilingInfo* info = method->GetProfilingInfo(sizeof(void*));
+  if (!code_cache->ContainsPc(entry_point) &&
+      info != nullptr &&
+      info->GetSavedEntryPoint() != nullptr) {
+    // The code cache is poking for the liveness of the compiled code.
+    entry_point = info->GetSavedEntryPoint();
+  }
+  CHECK(code_cache->ContainsPc(entry_point)) << PrettyMethod(method);
+  const void* code = OatQuickMethodHeader::FromEntryPoint(entry_point)->GetCode();
+  return code_cache->IsInHotRegion(code);
+}
+
+// Collects the code cache, which samples the compiled code running on the thread stacks.
+extern "C" JNIEXPORT void JNICALL Java_Main_collectCodeCache(JNIEnv*, jclass) {
+  jit::Jit* jit = Runtime::Current()->GetJit();
+  if (jit == nullptr || !Runtime::Current()->UseJitCompilation()) {
+    return;
+  }
+  ScopedObjectAccess soa(Thread::Current());
+  jit->GetCodeCache()->GarbageCollectCache(soa.Self());
+}
+
+}  // namespace art
@@ -0,0 +1,55 @@
+/*
+ * Copyright (C) 2016 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+public class Main {
+  static final int[] VALUES = { 1, 2, 3 };
+
+  public static void main(String[] args) {
+    System.loadLibrary(args[0]);
+    // Without the JIT or a hot region, there is no code to move.
+    boolean checkRegions = hasHotCodeRegion();
+
+    // The method is compiled before it gets hot in the interpreter, so it goes to the cold region.
+    ensureJitCompiled(Main.class, "$noinline$sumAndCollect");
+    if (checkRegions && isInHotCodeRegion(Main.class, "$noinline$sumAndCollect")) {
+      throw new Error("Expected the code to be committed to the cold region");
+    }
+    System.out.println("Committed: " + $noinline$sumAndCollect(VALUES, 0));
+
+    // Two frames of the compiled code run during the collection, which samples both.
+    System.out.println("Promoted: " + $noinline$sumAndCollect(VALUES, 1));
+    if (checkRegions && !isInHotCodeRegion(Main.class, "$noinline$sumAndCollect")) {
+      throw new Error("Expected the code to be moved to the hot region");
+    }
+  }
+
+  static int $noinline$sumAndCollect(int[] values, int depth) {
+    if (depth != 0) {
+      return $noinline$sumAndCollect(values, depth - 1);
+    }
+    int sum = 0;
+    for (int value : values) {
+      sum += value;
+    }
+    collectCodeCache();
+    return sum;
+  }
+
+  private static native boolean hasHotCodeRegion();
+  private static native boolean isInHotCodeRegion(Class<?> cls, String methodName);
+  private static native void collectCodeCache();
+  private static native void ensureJitCompiled(Class<?> cls, String methodName);
+}
@@ -426,11 +426,14 @@ TEST_ART_BROKEN_FALLBACK_RUN_TESTS :=
 # 802 and 570-checker-osr:
 # This test dynamically enables tracing to force a deoptimization. This makes the test meaningless
 # when already tracing, and writes an error message that we do not want to check for.
+# 621-jit-hot-code-region:
+# Tracing keeps methods from running their JIT code.
 TEST_ART_BROKEN_TRACING_RUN_TESTS := \
   087-gc-after-link \
   137-cfi \
   141-class-unload \
   570-checker-osr \
+  621-jit-hot-code-region \
   802-deoptimization
 
 ifneq (,$(filter trace stream,$(TRACE_TYPES)))
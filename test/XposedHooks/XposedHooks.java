@@ -0,0 +1,76 @@
+/*
+ * Copyright (C) 2016 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+import java.lang.reflect.Member;
+
+class XposedHooks {
+  static int callbackCount;
+
+  // Stands in for XposedBridge.handleHookedMethod. All hooked methods below return their first
+  // argument, so does the callback.
+  static Object handleHookedMethod(Member method, int originalMethodId, Object additionalInfo,
+                                   Object thisObject, Object[] args) {
+    callbackCount++;
+    return args[0];
+  }
+
+  static int observerCount;
+  static Object lastObservedResult;
+
+  // Managed observers of observe-only hooks.
+  static void beforeObserver(Member method, Object additionalInfo, Object thisObject,
+                             Object[] args) {
+    observerCount++;
+  }
+
+  static void afterObserver(Member method, Object additionalInfo, Object thisObject,
+                            Object[] args, Object result) {
+    observerCount++;
+    lastObservedResult = result;
+  }
+
+  static int staticInt(int a, int b) {
+    return a;
+  }
+
+  boolean instanceBoolean(boolean z, char c) {
+    return z;
+  }
+
+  static char staticChar(char c, byte b, short s) {
+    return c;
+  }
+
+  Object instanceObject(Object o, int i) {
+    return o;
+  }
+
+  static long staticLong(long j) {
+    return j;
+  }
+
+  static int otherStaticInt(int a, int b) {
+    return b;
+  }
+
+  int instanceInt(int a, int b) {
+    return b;
+  }
+
+  static double staticMixed(double d, int i, long j, float f, Object o) {
+    return i;
+  }
+}